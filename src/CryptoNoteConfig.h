@@ -119,6 +119,8 @@ const char     CRYPTONOTE_BLOCKSCACHE_FILENAME[]             = "blockscache.dat"
 const char     CRYPTONOTE_POOLDATA_FILENAME[]                = "poolstate.bin";
 const char     P2P_NET_DATA_FILENAME[]                       = "p2pstate.bin";
 const char     CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME[]      = "blockchainindices.dat";
+const char     CRYPTONOTE_PAYMENT_ID_INDEX_FILENAME[]        = "paymentidindex.dat";
+const char     CRYPTONOTE_TIMESTAMP_INDEX_FILENAME[]         = "timestampindex.dat";
 const char     MINER_CONFIG_FILE_NAME[]                      = "miner_conf.json";
 } // parameters
 
@@ -137,7 +139,16 @@ const uint8_t  BLOCK_MINOR_VERSION_1                         =  1;
 
 const size_t   BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT        =  10000;  //by default, blocks ids count in synchronizing
 const size_t   BLOCKS_SYNCHRONIZING_DEFAULT_COUNT            =  200;    //by default, blocks count in blocks downloading
+const size_t   BLOCKS_SYNCHRONIZING_SPANS_AHEAD              =  16;     //spans of blocks downloaded in parallel ahead of the lowest one not imported yet
+const size_t   BLOCKS_IMPORT_QUEUE_MAX_SIZE                  =  64 * 1024 * 1024; //bytes of downloaded blocks waiting for validation
+const size_t   P2P_VALIDATION_THREADS_DEFAULT                =  2;      //threads validating blocks and transactions of peers, 0 validates them on the p2p thread
 const size_t   COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT         =  1000;
+const size_t   COMMAND_RPC_GET_BLOCKS_DETAILS_MAX_COUNT      =  100;    //blocks filled in a single batch, the core stays locked meanwhile
+const size_t   COMMAND_RPC_GET_TRANSACTIONS_DETAILS_MAX_COUNT = 1000;
+const size_t   COMMAND_RPC_GET_NOTIFICATIONS_MAX_COUNT       =  1000;
+const uint32_t COMMAND_RPC_GET_NOTIFICATIONS_MAX_WAIT        =  30;     //seconds a notifications request is held while nothing happens
+const size_t   RPC_NOTIFICATIONS_QUEUE_SIZE                  =  4096;   //notifications kept for subscribers, older ones are reported as missed
+const size_t   RPC_NOTIFICATIONS_MAX_WAITERS                 =  64;     //notifications requests held at once, further ones are answered at once
 const int      P2P_DEFAULT_PORT                              = 17333;
 const int      RPC_DEFAULT_PORT                              = 18333; 
 const size_t   P2P_LOCAL_WHITE_PEERLIST_LIMIT                =  1000;
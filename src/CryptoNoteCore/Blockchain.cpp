@@ -47,6 +47,7 @@
 #include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
+#include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Serialization/BinarySerializationTools.h"
 #include "CryptoNoteTools.h"
@@ -82,7 +83,7 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 
 #define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 1
-#define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 2
 
 namespace CryptoNote {
 class BlockCacheSerializer;
@@ -290,12 +291,6 @@ public:
       s(m_lastBlockHash, "blockHash");
     }
 
-    logger(INFO) << operation << "paymentID index...";
-    s(m_bs.m_paymentIdIndex, "paymentIdIndex");
-
-    logger(INFO) << operation << "timestamp index...";
-    s(m_bs.m_timestampIndex, "timestampIndex");
-
     logger(INFO) << operation << "generated transactions index...";
     s(m_bs.m_generatedTransactionsIndex, "generatedTransactionsIndex");
 
@@ -323,12 +318,6 @@ public:
       ar & m_lastBlockHash;
     }
 
-    logger(INFO) << operation << "paymentID index...";
-    ar & m_bs.m_paymentIdIndex;
-
-    logger(INFO) << operation << "timestamp index...";
-    ar & m_bs.m_timestampIndex;
-
     logger(INFO) << operation << "generated transactions index...";
     ar & m_bs.m_generatedTransactionsIndex;
 
@@ -483,6 +472,16 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     return false;
   }
 
+  if (m_blockchainIndexesEnabled) {
+    try {
+      m_paymentIdIndex.open(appendPath(config_folder, m_currency.paymentIdIndexFileName()));
+      m_timestampIndex.open(appendPath(config_folder, m_currency.timestampIndexFileName()));
+    } catch (std::exception& e) {
+      logger(ERROR, BRIGHT_RED) << "Failed to open blockchain indices: " << e.what();
+      return false;
+    }
+  }
+
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
     BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
@@ -498,6 +497,8 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     }
   } else {
     m_blocks.clear();
+    m_paymentIdIndex.clear();
+    m_timestampIndex.clear();
   }
 
   if (m_blocks.empty()) {
@@ -1431,6 +1432,132 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
   return true;
 }
 
+// The block entries below are serialized once, straight from the stored BlockEntry into the response strings.
+// Transactions are taken from the entry itself, so no per-transaction hash lookup and no intermediate copies are made.
+void Blockchain::fillBlockCompleteEntry(const BlockEntry& block, block_complete_entry& entry) {
+  toBinaryString(block.bl, entry.block);
+
+  entry.txs.resize(block.transactions.size() - 1);
+  for (size_t i = 1; i < block.transactions.size(); ++i) {
+    toBinaryString(block.transactions[i].tx, entry.txs[i - 1]);
+  }
+}
+
+bool Blockchain::getBlockEntries(uint32_t startHeight, uint32_t count, uint64_t timestamp, std::vector<BlockFullInfo>& entries) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (startHeight >= m_blocks.size()) {
+    return false;
+  }
+
+  uint32_t endHeight = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(startHeight) + count, m_blocks.size()));
+  entries.reserve(entries.size() + (endHeight - startHeight));
+
+  for (uint32_t height = startHeight; height < endHeight; ++height) {
+    const BlockEntry& block = m_blocks[height];
+
+    entries.emplace_back();
+    BlockFullInfo& item = entries.back();
+    item.block_id = m_blockIndex.getBlockId(height);
+
+    if (block.bl.timestamp >= timestamp) {
+      fillBlockCompleteEntry(block, item);
+    }
+  }
+
+  return true;
+}
+
+bool Blockchain::getBlockEntries(uint32_t startHeight, uint32_t count, uint64_t timestamp, std::vector<BlockShortInfo>& entries) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (startHeight >= m_blocks.size()) {
+    return false;
+  }
+
+  uint32_t endHeight = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(startHeight) + count, m_blocks.size()));
+  entries.reserve(entries.size() + (endHeight - startHeight));
+
+  for (uint32_t height = startHeight; height < endHeight; ++height) {
+    const BlockEntry& block = m_blocks[height];
+
+    entries.emplace_back();
+    BlockShortInfo& item = entries.back();
+    item.blockId = m_blockIndex.getBlockId(height);
+
+    if (block.bl.timestamp >= timestamp) {
+      toBinaryString(block.bl, item.block);
+
+      item.txPrefixes.resize(block.transactions.size() - 1);
+      for (size_t i = 1; i < block.transactions.size(); ++i) {
+        TransactionPrefixInfo& info = item.txPrefixes[i - 1];
+        info.txHash = block.bl.transactionHashes[i - 1];
+        info.txPrefix = block.transactions[i].tx;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Blockchain::getBlockEntries(uint32_t startHeight, uint32_t count, uint64_t timestamp, std::vector<BlockCompactInfo>& entries) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (startHeight >= m_blocks.size()) {
+    return false;
+  }
+
+  uint32_t endHeight = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(startHeight) + count, m_blocks.size()));
+  entries.reserve(entries.size() + (endHeight - startHeight));
+
+  for (uint32_t height = startHeight; height < endHeight; ++height) {
+    const BlockEntry& block = m_blocks[height];
+
+    entries.emplace_back();
+    BlockCompactInfo& item = entries.back();
+    item.blockId = m_blockIndex.getBlockId(height);
+
+    if (block.bl.timestamp >= timestamp) {
+      toBinaryString(block.bl, item.block);
+      item.baseTransactionGlobalIndexes = block.transactions[0].m_global_output_indexes;
+
+      item.transactions.resize(block.transactions.size() - 1);
+      for (size_t i = 1; i < block.transactions.size(); ++i) {
+        TransactionCompactInfo& info = item.transactions[i - 1];
+        info.txHash = block.bl.transactionHashes[i - 1];
+        info.globalIndexes = block.transactions[i].m_global_output_indexes;
+
+        // ring member offsets are useless to a wallet and make up the bulk of a prefix
+        TransactionPrefix prefix = block.transactions[i].tx;
+        for (auto& input : prefix.inputs) {
+          if (input.type() == typeid(KeyInput)) {
+            boost::get<KeyInput>(input).outputIndexes.clear();
+          }
+        }
+
+        toBinaryString(prefix, info.txPrefix);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Blockchain::getBlockEntries(const std::vector<Crypto::Hash>& blockIds, std::vector<block_complete_entry>& entries) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  entries.reserve(entries.size() + blockIds.size());
+
+  for (const auto& blockId : blockIds) {
+    uint32_t height = 0;
+    if (!m_blockIndex.getBlockHeight(blockId, height) || height >= m_blocks.size()) {
+      logger(ERROR, BRIGHT_RED) << "Block " << blockId << " is not found in main chain";
+      return false;
+    }
+
+    entries.emplace_back();
+    fillBlockCompleteEntry(m_blocks[height], entries.back());
+  }
+
+  return true;
+}
+
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
@@ -1688,6 +1815,18 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
   return true;
 }
 
+bool Blockchain::getTransactionOutputGlobalIndexes(const std::vector<Crypto::Hash>& tx_ids, std::vector<std::vector<uint32_t>>& indexs) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  indexs.resize(tx_ids.size());
+  for (size_t i = 0; i < tx_ids.size(); ++i) {
+    if (!getTransactionOutputGlobalIndexes(tx_ids[i], indexs[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_multisignatureOutputs.find(amount);
@@ -2259,6 +2398,7 @@ bool Blockchain::pushBlock(BlockEntry& block) {
 
   assert(m_blockIndex.size() == m_blocks.size());
 
+  m_observerManager.notify(&IBlockchainStorageObserver::blockAdded, block.height, blockHash);
   return true;
 }
 
@@ -2549,10 +2689,13 @@ void Blockchain::removeLastBlock() {
   m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
   m_generatedTransactionsIndex.remove(m_blocks.back().bl);
 
+  uint32_t height = m_blocks.back().height;
   m_blocks.pop_back();
   m_blockIndex.pop();
 
   assert(m_blockIndex.size() == m_blocks.size());
+
+  m_observerManager.notify(&IBlockchainStorageObserver::blockPopped, height, blockHash);
 }
 
 bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
@@ -2671,6 +2814,14 @@ bool Blockchain::storeBlockchainIndices() {
     return false;
   }
 
+  try {
+    m_paymentIdIndex.store(getTailId());
+    m_timestampIndex.store(getTailId());
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain indices: " << e.what();
+    return false;
+  }
+
   return true;
 }
 
@@ -2678,16 +2829,18 @@ bool Blockchain::loadBlockchainIndices() {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   logger(INFO, BRIGHT_WHITE) << "Loading blockchain indices for BlockchainExplorer...";
-  BlockchainIndicesSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
+  Crypto::Hash tailId = get_block_hash(m_blocks.back().bl);
+  BlockchainIndicesSerializer loader(*this, tailId, logger.getLogger());
 
   loadFromBinaryFile(loader, appendPath(m_config_folder, m_currency.blockchainIndicesFileName()));
 
-  if (!loader.loaded()) {
+  // payment id and timestamp indices live in their own files, they are only trusted if stored at the same tail
+  if (!loader.loaded() || m_paymentIdIndex.getTailId() != tailId || m_timestampIndex.getTailId() != tailId) {
     logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain indices for BlockchainExplorer found, rebuilding...";
     std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
 
-    m_paymentIdIndex.clear();
-    m_timestampIndex.clear();
+    m_paymentIdIndex.beginBulkLoad();
+    m_timestampIndex.beginBulkLoad();
     m_generatedTransactionsIndex.clear();
 
     for (uint32_t b = 0; b < m_blocks.size(); ++b) {
@@ -2703,6 +2856,9 @@ bool Blockchain::loadBlockchainIndices() {
       }
     }
 
+    m_paymentIdIndex.endBulkLoad();
+    m_timestampIndex.endBulkLoad();
+
     std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
     logger(INFO, BRIGHT_WHITE) << "Rebuilding blockchain indices took: " << duration.count();
   }
@@ -78,6 +78,10 @@ namespace CryptoNote {
 
   struct NOTIFY_REQUEST_GET_OBJECTS_request;
   struct NOTIFY_RESPONSE_GET_OBJECTS_request;
+  struct block_complete_entry;
+  struct BlockFullInfo;
+  struct BlockShortInfo;
+  struct BlockCompactInfo;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount;
@@ -108,6 +112,10 @@ namespace CryptoNote {
     void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks);
+    bool getBlockEntries(uint32_t startHeight, uint32_t count, uint64_t timestamp, std::vector<BlockFullInfo>& entries);
+    bool getBlockEntries(uint32_t startHeight, uint32_t count, uint64_t timestamp, std::vector<BlockShortInfo>& entries);
+    bool getBlockEntries(uint32_t startHeight, uint32_t count, uint64_t timestamp, std::vector<BlockCompactInfo>& entries);
+    bool getBlockEntries(const std::vector<Crypto::Hash>& blockIds, std::vector<block_complete_entry>& entries);
     bool getAlternativeBlocks(std::list<Block>& blocks);
     uint32_t getAlternativeBlocksCount();
     Crypto::Hash getBlockIdByHeight(uint32_t height);
@@ -141,6 +149,7 @@ namespace CryptoNote {
     bool getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response& res);
     bool getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count);
     bool getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs);
+    bool getTransactionOutputGlobalIndexes(const std::vector<Crypto::Hash>& tx_ids, std::vector<std::vector<uint32_t>>& indexs);
     bool get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out);
     bool checkTransactionInputs(const Transaction& tx, uint32_t& pmax_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail = 0);
     uint64_t getCurrentCumulativeBlocksizeLimit();
@@ -344,7 +353,7 @@ namespace CryptoNote {
     UpgradeDetector m_upgradeDetectorV3;
 	UpgradeDetector m_upgradeDetectorV4;
 
-    PaymentIdIndex m_paymentIdIndex;
+    BlockchainPaymentIdIndex m_paymentIdIndex;
     TimestampBlocksIndex m_timestampIndex;
     GeneratedTransactionsIndex m_generatedTransactionsIndex;
     OrphanBlocksIndex m_orphanBlocksIndex;
@@ -356,6 +365,7 @@ namespace CryptoNote {
 
     uint32_t m_lastKnownBlockHeight;
 
+    void fillBlockCompleteEntry(const BlockEntry& block, block_complete_entry& entry);
     void rebuildCache();
     bool storeCache();
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
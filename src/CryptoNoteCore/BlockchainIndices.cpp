@@ -132,15 +132,103 @@ void PaymentIdIndex::serialize(ISerializer& s) {
   s(index, "index");
 }
 
+BlockchainPaymentIdIndex::BlockchainPaymentIdIndex(bool _enabled) : enabled(_enabled) {
+}
+
+void BlockchainPaymentIdIndex::open(const std::string& path) {
+  if (enabled) {
+    index.open(path);
+  }
+}
+
+Crypto::Hash BlockchainPaymentIdIndex::getTailId() const {
+  return enabled ? index.getTailId() : NULL_HASH;
+}
+
+void BlockchainPaymentIdIndex::store(const Crypto::Hash& tailId) {
+  if (enabled) {
+    index.store(tailId);
+  }
+}
+
+bool BlockchainPaymentIdIndex::add(const Transaction& transaction) {
+  if (!enabled) {
+    return false;
+  }
+
+  Crypto::Hash paymentId;
+  if (!BlockchainExplorerDataBuilder::getPaymentId(transaction, paymentId)) {
+    return false;
+  }
+
+  index.add(paymentId, getObjectHash(transaction));
+  return true;
+}
+
+bool BlockchainPaymentIdIndex::remove(const Transaction& transaction) {
+  if (!enabled) {
+    return false;
+  }
+
+  Crypto::Hash paymentId;
+  if (!BlockchainExplorerDataBuilder::getPaymentId(transaction, paymentId)) {
+    return false;
+  }
+
+  return index.remove(paymentId, getObjectHash(transaction));
+}
+
+bool BlockchainPaymentIdIndex::find(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
+  if (!enabled) {
+    throw std::runtime_error("Payment id index disabled.");
+  }
+
+  return index.find(paymentId, paymentId, std::numeric_limits<uint64_t>::max(), transactionHashes) > 0;
+}
+
+void BlockchainPaymentIdIndex::clear() {
+  if (enabled) {
+    index.clear();
+  }
+}
+
+void BlockchainPaymentIdIndex::beginBulkLoad() {
+  if (enabled) {
+    index.beginBulkLoad();
+  }
+}
+
+void BlockchainPaymentIdIndex::endBulkLoad() {
+  if (enabled) {
+    index.endBulkLoad();
+  }
+}
+
 TimestampBlocksIndex::TimestampBlocksIndex(bool _enabled) : enabled(_enabled) {
 }
 
+void TimestampBlocksIndex::open(const std::string& path) {
+  if (enabled) {
+    index.open(path);
+  }
+}
+
+Crypto::Hash TimestampBlocksIndex::getTailId() const {
+  return enabled ? index.getTailId() : NULL_HASH;
+}
+
+void TimestampBlocksIndex::store(const Crypto::Hash& tailId) {
+  if (enabled) {
+    index.store(tailId);
+  }
+}
+
 bool TimestampBlocksIndex::add(uint64_t timestamp, const Crypto::Hash& hash) {
   if (!enabled) {
     return false;
   }
 
-  index.emplace(timestamp, hash);
+  index.add(timestamp, hash);
   return true;
 }
 
@@ -149,15 +237,7 @@ bool TimestampBlocksIndex::remove(uint64_t timestamp, const Crypto::Hash& hash)
     return false;
   }
 
-  auto range = index.equal_range(timestamp);
-  for (auto iter = range.first; iter != range.second; ++iter) {
-    if (iter->second == hash) {
-      index.erase(iter);
-      return true;
-    }
-  }
-
-  return false;
+  return index.remove(timestamp, hash);
 }
 
 bool TimestampBlocksIndex::find(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t hashesNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& hashesNumberWithinTimestamps) {
@@ -165,21 +245,13 @@ bool TimestampBlocksIndex::find(uint64_t timestampBegin, uint64_t timestampEnd,
     throw std::runtime_error("Timestamp block index disabled.");
   }
 
-  uint32_t hashesNumber = 0;
   if (timestampBegin > timestampEnd) {
-    //std::swap(timestampBegin, timestampEnd);
     return false;
   }
-  auto begin = index.lower_bound(timestampBegin);
-  auto end = index.upper_bound(timestampEnd);
-
-  hashesNumberWithinTimestamps = static_cast<uint32_t>(std::distance(begin, end));
 
-  for (auto iter = begin; iter != end && hashesNumber < hashesNumberLimit; ++iter){
-    ++hashesNumber;
-    hashes.emplace_back(iter->second);
-  }
-  return hashesNumber > 0;
+  size_t hashesNumber = hashes.size();
+  hashesNumberWithinTimestamps = static_cast<uint32_t>(index.find(timestampBegin, timestampEnd, hashesNumberLimit, hashes));
+  return hashes.size() > hashesNumber;
 }
 
 void TimestampBlocksIndex::clear() {
@@ -188,12 +260,16 @@ void TimestampBlocksIndex::clear() {
   }
 }
 
-void TimestampBlocksIndex::serialize(ISerializer& s) {
-  if (!enabled) {
-    throw std::runtime_error("Timestamp block index disabled.");
+void TimestampBlocksIndex::beginBulkLoad() {
+  if (enabled) {
+    index.beginBulkLoad();
   }
+}
 
-  s(index, "index");
+void TimestampBlocksIndex::endBulkLoad() {
+  if (enabled) {
+    index.endBulkLoad();
+  }
 }
 
 TimestampTransactionsIndex::TimestampTransactionsIndex(bool _enabled) : enabled(_enabled) {
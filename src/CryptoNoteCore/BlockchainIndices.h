@@ -44,6 +44,7 @@
 
 #include "crypto/hash.h"
 #include "CryptoNoteBasic.h"
+#include "SortedIndexFile.h"
 
 namespace CryptoNote {
 
@@ -74,23 +75,45 @@ private:
   bool enabled = false;
 };
 
+// payment ids of main chain transactions, kept on disk, see SortedIndexFile
+class BlockchainPaymentIdIndex {
+public:
+  BlockchainPaymentIdIndex(bool enabled);
+
+  void open(const std::string& path);
+  Crypto::Hash getTailId() const;
+  void store(const Crypto::Hash& tailId);
+
+  bool add(const Transaction& transaction);
+  bool remove(const Transaction& transaction);
+  bool find(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes);
+  void clear();
+  // for a rebuild from the chain, see SortedIndexFile
+  void beginBulkLoad();
+  void endBulkLoad();
+
+private:
+  SortedIndexFile<Crypto::Hash> index;
+  bool enabled = false;
+};
+
 class TimestampBlocksIndex {
 public:
   TimestampBlocksIndex(bool enabled);
 
+  void open(const std::string& path);
+  Crypto::Hash getTailId() const;
+  void store(const Crypto::Hash& tailId);
+
   bool add(uint64_t timestamp, const Crypto::Hash& hash);
   bool remove(uint64_t timestamp, const Crypto::Hash& hash);
   bool find(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t hashesNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& hashesNumberWithinTimestamps);
   void clear();
+  void beginBulkLoad();
+  void endBulkLoad();
 
-  void serialize(ISerializer& s);
-
-  template<class Archive> 
-  void serialize(Archive& archive, unsigned int version) {
-    archive & index;
-  }
 private:
-  std::multimap<uint64_t, Crypto::Hash> index;
+  SortedIndexFile<uint64_t> index;
   bool enabled = false;
 };
 
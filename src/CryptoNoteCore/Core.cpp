@@ -634,6 +634,10 @@ bool core::get_tx_outputs_gindexs(const Crypto::Hash& tx_id, std::vector<uint32_
   return m_blockchain.getTransactionOutputGlobalIndexes(tx_id, indexs);
 }
 
+bool core::get_tx_outputs_gindexs(const std::vector<Crypto::Hash>& tx_ids, std::vector<std::vector<uint32_t>>& indexs) {
+  return m_blockchain.getTransactionOutputGlobalIndexes(tx_ids, indexs);
+}
+
 bool core::getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
   return m_blockchain.get_out_by_msig_gindex(amount, gindex, out);
 }
@@ -866,10 +870,26 @@ void core::blockchainUpdated() {
   m_observerManager.notify(&ICoreObserver::blockchainUpdated);
 }
 
+void core::blockAdded(uint32_t height, const Crypto::Hash& blockHash) {
+  m_observerManager.notify(&ICoreObserver::blockAdded, height, blockHash);
+}
+
+void core::blockPopped(uint32_t height, const Crypto::Hash& blockHash) {
+  m_observerManager.notify(&ICoreObserver::blockPopped, height, blockHash);
+}
+
 void core::txDeletedFromPool() {
   poolUpdated();
 }
 
+void core::txAddedToPool(const Crypto::Hash& transactionHash) {
+  m_observerManager.notify(&ICoreObserver::txAddedToPool, transactionHash);
+}
+
+void core::txRemovedFromPool(const Crypto::Hash& transactionHash) {
+  m_observerManager.notify(&ICoreObserver::txRemovedFromPool, transactionHash);
+}
+
 void core::poolUpdated() {
   m_observerManager.notify(&ICoreObserver::poolUpdated);
 }
@@ -905,34 +925,14 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
-
-  for (auto& b : blocks) {
-    BlockFullInfo item;
-
-    item.block_id = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
-      // fill data
-      block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
-      }
-    }
-
-    entries.push_back(std::move(item));
-  }
-
+  lbs->getBlockEntries(startFullOffset, blocksLeft, timestamp, entries);
   return true;
 }
 
+bool core::getBlockEntries(const std::vector<Crypto::Hash>& blockIds, std::vector<block_complete_entry>& entries) {
+  return m_blockchain.getBlockEntries(blockIds, entries);
+}
+
 bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset) {
   LockedBlockchainStorage lbs(m_blockchain);
 
@@ -993,33 +993,37 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(resFullOffset, blocksLeft, blocks);
+  lbs->getBlockEntries(resFullOffset, blocksLeft, timestamp, entries);
+  return true;
+}
 
-  for (auto& b : blocks) {
-    BlockShortInfo item;
+bool core::queryBlocksCompact(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight,
+  uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockCompactInfo>& entries) {
+  LockedBlockchainStorage lbs(m_blockchain);
 
-    item.blockId = get_block_hash(b);
+  resCurrentHeight = lbs->getCurrentBlockchainHeight();
+  resStartHeight = 0;
+  resFullOffset = 0;
 
-    if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+  if (!findStartAndFullOffsets(knownBlockIds, timestamp, resStartHeight, resFullOffset)) {
+    return false;
+  }
 
-      item.block = asString(toBinaryArray(b));
+  std::vector<Crypto::Hash> blockIds = findIdsForShortBlocks(resStartHeight, resFullOffset);
+  entries.reserve(blockIds.size());
 
-      for (const auto& tx: txs) {
-        TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
+  for (const auto& id : blockIds) {
+    entries.push_back(BlockCompactInfo());
+    entries.back().blockId = id;
+  }
 
-        item.txPrefixes.push_back(std::move(info));
-      }
-    }
+  uint32_t blocksLeft = static_cast<uint32_t>(std::min(BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT - entries.size(), size_t(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)));
 
-    entries.push_back(std::move(item));
+  if (blocksLeft == 0) {
+    return true;
   }
 
+  lbs->getBlockEntries(resFullOffset, blocksLeft, timestamp, entries);
   return true;
 }
 
@@ -142,6 +142,9 @@ namespace CryptoNote {
        uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) override;
      virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
        uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) override;
+     virtual bool queryBlocksCompact(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+       uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockCompactInfo>& entries) override;
+     virtual bool getBlockEntries(const std::vector<Crypto::Hash>& blockIds, std::vector<block_complete_entry>& entries) override;
      virtual Crypto::Hash getBlockIdByHeight(uint32_t height) override;
      void getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<Transaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool = false) override;
      virtual bool getBlockByHash(const Crypto::Hash &h, Block &blk) override;
@@ -163,6 +166,7 @@ namespace CryptoNote {
      bool get_stat_info(core_stat_info& st_inf) override;
 
      virtual bool get_tx_outputs_gindexs(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) override;
+     virtual bool get_tx_outputs_gindexs(const std::vector<Crypto::Hash>& tx_ids, std::vector<std::vector<uint32_t>>& indexs) override;
      Crypto::Hash get_tail_id();
      virtual bool get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response& res) override;
      void pause_mining() override;
@@ -214,7 +218,11 @@ namespace CryptoNote {
      bool on_update_blocktemplate_interval();
      bool check_tx_inputs_keyimages_diff(const Transaction& tx);
      virtual void blockchainUpdated() override;
+     virtual void blockAdded(uint32_t height, const Crypto::Hash& blockHash) override;
+     virtual void blockPopped(uint32_t height, const Crypto::Hash& blockHash) override;
      virtual void txDeletedFromPool() override;
+     virtual void txAddedToPool(const Crypto::Hash& transactionHash) override;
+     virtual void txRemovedFromPool(const Crypto::Hash& transactionHash) override;
      void poolUpdated();
 
      bool findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset);
@@ -231,8 +239,23 @@ namespace CryptoNote {
      std::string m_config_folder;
      cryptonote_protocol_stub m_protocol_stub;
      friend class tx_validate_inputs;
+     friend class LockedCore;
      std::atomic<bool> m_starter_message_showed;
      Tools::ObserverManager<ICoreObserver> m_observerManager;
      time_t start_time;
    };
+
+  // Keeps the pool and the blockchain from changing while it lives, so a batch of queries sees a single state.
+  // The locks are recursive and taken in the order core takes them, core methods can still be called.
+  class LockedCore : boost::noncopyable {
+  public:
+
+    LockedCore(core& c)
+      : m_poolLock(c.m_mempool), m_blockchainLock(c.m_blockchain) {}
+
+  private:
+
+    std::lock_guard<tx_memory_pool> m_poolLock;
+    LockedBlockchainStorage m_blockchainLock;
+  };
 }
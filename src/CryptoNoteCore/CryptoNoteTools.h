@@ -39,6 +39,7 @@
 
 #include <limits>
 #include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
 #include "Common/StringTools.h"
 #include "Common/VectorOutputStream.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
@@ -73,6 +74,20 @@ BinaryArray toBinaryArray(const T& object) {
   return ba;
 }
 
+// Serializes object straight into the tail of out, without an intermediate BinaryArray
+template<class T>
+bool toBinaryString(const T& object, std::string& out) {
+  try {
+    ::Common::StringOutputStream stream(out);
+    BinaryOutputStreamSerializer serializer(stream);
+    serialize(const_cast<T&>(object), serializer);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
 template<class T>
 bool fromBinaryArray(T& object, const BinaryArray& binaryArray) {
   bool result = false;
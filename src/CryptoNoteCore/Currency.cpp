@@ -101,6 +101,8 @@ namespace CryptoNote {
 			m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
 			m_txPoolFileName = "testnet_" + m_txPoolFileName;
 			m_blockchainIndicesFileName = "testnet_" + m_blockchainIndicesFileName;
+			m_paymentIdIndexFileName = "testnet_" + m_paymentIdIndexFileName;
+			m_timestampIndexFileName = "testnet_" + m_timestampIndexFileName;
 		}
 		return true;
 	}
@@ -831,6 +833,8 @@ bool Currency::checkProofOfWorkV2(Crypto::cn_context& context, const Block& bloc
 		blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
 		txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
 		blockchainIndicesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME);
+		paymentIdIndexFileName(parameters::CRYPTONOTE_PAYMENT_ID_INDEX_FILENAME);
+		timestampIndexFileName(parameters::CRYPTONOTE_TIMESTAMP_INDEX_FILENAME);
 
 		testnet(false);
 	}
@@ -158,6 +158,8 @@ public:
   const std::string& blockIndexesFileName() const { return m_blockIndexesFileName; }
   const std::string& txPoolFileName() const { return m_txPoolFileName; }
   const std::string& blockchainIndicesFileName() const { return m_blockchainIndicesFileName; }
+  const std::string& paymentIdIndexFileName() const { return m_paymentIdIndexFileName; }
+  const std::string& timestampIndexFileName() const { return m_timestampIndexFileName; }
 
   bool isTestnet() const { return m_testnet; }
 
@@ -275,6 +277,8 @@ private:
   std::string m_blockIndexesFileName;
   std::string m_txPoolFileName;
   std::string m_blockchainIndicesFileName;
+  std::string m_paymentIdIndexFileName;
+  std::string m_timestampIndexFileName;
 
   bool m_testnet;
 
@@ -364,6 +368,8 @@ public:
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchainIndicesFileName(const std::string& val) { m_currency.m_blockchainIndicesFileName = val; return *this; }
+  CurrencyBuilder& paymentIdIndexFileName(const std::string& val) { m_currency.m_paymentIdIndexFileName = val; return *this; }
+  CurrencyBuilder& timestampIndexFileName(const std::string& val) { m_currency.m_timestampIndexFileName = val; return *this; }
   
   CurrencyBuilder& testnet(bool val) { m_currency.m_testnet = val; return *this; }
 
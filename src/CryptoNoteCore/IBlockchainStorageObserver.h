@@ -37,6 +37,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include "crypto/hash.h"
+
 namespace CryptoNote {
   class IBlockchainStorageObserver {
   public:
@@ -44,5 +47,8 @@ namespace CryptoNote {
     }
 
     virtual void blockchainUpdated() = 0;
+    // a block joined or left the main chain, called under the blockchain lock
+    virtual void blockAdded(uint32_t height, const Crypto::Hash& blockHash) {}
+    virtual void blockPopped(uint32_t height, const Crypto::Hash& blockHash) {}
   };
 }
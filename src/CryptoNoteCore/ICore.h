@@ -63,7 +63,9 @@ class ICoreObserver;
 struct Block;
 struct block_verification_context;
 struct BlockFullInfo;
+struct block_complete_entry;
 struct BlockShortInfo;
+struct BlockCompactInfo;
 struct core_stat_info;
 struct i_cryptonote_protocol;
 struct Transaction;
@@ -97,6 +99,7 @@ public:
     uint32_t& totalBlockCount, uint32_t& startBlockIndex) = 0;
   virtual bool get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response& res) = 0;
   virtual bool get_tx_outputs_gindexs(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) = 0;
+  virtual bool get_tx_outputs_gindexs(const std::vector<Crypto::Hash>& tx_ids, std::vector<std::vector<uint32_t>>& indexs) = 0;
   virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) = 0;
   virtual i_cryptonote_protocol* get_protocol() = 0;
   virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) = 0; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
@@ -111,6 +114,9 @@ public:
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) = 0;
   virtual bool queryBlocksLite(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockShortInfo>& entries) = 0;
+  virtual bool queryBlocksCompact(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
+    uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockCompactInfo>& entries) = 0;
+  virtual bool getBlockEntries(const std::vector<Crypto::Hash>& blockIds, std::vector<block_complete_entry>& entries) = 0;
 
   virtual Crypto::Hash getBlockIdByHeight(uint32_t height) = 0;
   virtual bool getBlockByHash(const Crypto::Hash &h, Block &blk) = 0;
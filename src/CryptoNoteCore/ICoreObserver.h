@@ -37,6 +37,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include "crypto/hash.h"
+
 namespace CryptoNote {
 
 class ICoreObserver {
@@ -44,6 +47,12 @@ public:
   virtual ~ICoreObserver() {};
   virtual void blockchainUpdated() {};
   virtual void poolUpdated() {};
+  // a block joined or left the main chain, called with the blockchain locked
+  virtual void blockAdded(uint32_t height, const Crypto::Hash& blockHash) {};
+  virtual void blockPopped(uint32_t height, const Crypto::Hash& blockHash) {};
+  // a transaction entered or left the pool, called with the pool locked
+  virtual void txAddedToPool(const Crypto::Hash& transactionHash) {};
+  virtual void txRemovedFromPool(const Crypto::Hash& transactionHash) {};
 };
 
 }
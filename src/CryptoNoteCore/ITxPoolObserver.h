@@ -37,6 +37,8 @@
 
 #pragma once
 
+#include "crypto/hash.h"
+
 namespace CryptoNote {
 class ITxPoolObserver {
 public:
@@ -44,5 +46,8 @@ public:
   }
 
   virtual void txDeletedFromPool() = 0;
+  // a single transaction entered or left the pool, called with the pool locked
+  virtual void txAddedToPool(const Crypto::Hash& transactionHash) {}
+  virtual void txRemovedFromPool(const Crypto::Hash& transactionHash) {}
 };
 }
@@ -0,0 +1,409 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/FileMappedVector.h"
+#include "crypto/hash.h"
+#include "CryptoNoteBasic.h"
+
+namespace CryptoNote {
+
+inline bool indexKeyLess(uint64_t left, uint64_t right) {
+  return left < right;
+}
+
+inline bool indexKeyLess(const Crypto::Hash& left, const Crypto::Hash& right) {
+  return std::memcmp(&left, &right, sizeof(Crypto::Hash)) < 0;
+}
+
+// Fixed size (key, hash) records sorted by key in a memory mapped file, records with equal keys keep the order they
+// were added in. Added and removed records wait in memory and are merged into the file in place once there are enough
+// of them, so a single change never rewrites the file. Added records are kept in arrival order and only sorted when a
+// lookup or merge needs them. A bulk load appends records straight to the file and sorts it once at the end. The header
+// keeps the chain tail the file was stored at and is reset on the first change, a file left by a crash is never taken
+// for a valid one.
+template<class Key> class SortedIndexFile {
+public:
+  struct Record {
+    Key key;
+    Crypto::Hash hash;
+  };
+
+  SortedIndexFile();
+
+  void open(const std::string& path);
+  void close();
+  bool isOpened() const;
+
+  // NULL_HASH if the file has changed since it was stored
+  Crypto::Hash getTailId() const;
+  void store(const Crypto::Hash& tailId);
+
+  void add(const Key& key, const Crypto::Hash& hash);
+  bool remove(const Key& key, const Crypto::Hash& hash);
+  void clear();
+  uint64_t size() const;
+
+  // clears the file, records added until endBulkLoad are appended to it unsorted
+  void beginBulkLoad();
+  // sorts the records of a bulk load, lookups and store do it when it was not called
+  void endBulkLoad();
+
+  // appends hashes of at most limit records with first <= key <= last in key order, returns all records in the range
+  uint64_t find(const Key& first, const Key& last, uint64_t limit, std::vector<Crypto::Hash>& hashes);
+
+private:
+  struct Header {
+    uint64_t version;
+    Crypto::Hash tailId;
+  };
+
+  static const uint64_t VERSION = 1;
+  static const uint64_t MIN_MERGE_RECORDS = 4096;
+  // pending records are merged once there are more than size() / MERGE_RATIO of them
+  static const uint64_t MERGE_RATIO = 64;
+
+  static bool keyLess(const Record& left, const Record& right);
+  static bool recordLess(const Record& left, const Record& right);
+
+  Header& header();
+  const Header& header() const;
+  const Record* lowerBound(const Key& key) const;
+  const Record* upperBound(const Key& key) const;
+  bool isRemoved(const Record& record) const;
+  void markChanged();
+  void sortAdded();
+  void mergeIfNeeded();
+  void mergePending();
+
+  Common::FileMappedVector<Record> m_records;
+  // in the order they were added until sortAdded
+  std::vector<Record> m_added;
+  bool m_addedSorted;
+  // records of the file to drop, sorted by key and hash
+  std::vector<Record> m_removed;
+  bool m_changed;
+  bool m_bulkLoad;
+};
+
+template<class Key> SortedIndexFile<Key>::SortedIndexFile() : m_addedSorted(true), m_changed(false), m_bulkLoad(false) {
+}
+
+template<class Key> void SortedIndexFile<Key>::open(const std::string& path) {
+  try {
+    m_records.open(path, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE, sizeof(Header));
+  } catch (std::exception&) {
+    // the index can always be rebuilt from the chain
+    if (m_records.isOpened()) {
+      std::error_code ignore;
+      m_records.close(ignore);
+    }
+
+    boost::filesystem::remove(path);
+    m_records.open(path, Common::FileMappedVectorOpenMode::CREATE, sizeof(Header));
+  }
+
+  m_records.setAutoFlush(false);
+  m_added.clear();
+  m_addedSorted = true;
+  m_removed.clear();
+  m_changed = false;
+  m_bulkLoad = false;
+
+  if (header().version != VERSION) {
+    m_records.clear();
+    header().version = VERSION;
+    header().tailId = NULL_HASH;
+    m_records.flush();
+  }
+}
+
+template<class Key> void SortedIndexFile<Key>::close() {
+  m_records.close();
+  m_added.clear();
+  m_addedSorted = true;
+  m_removed.clear();
+  m_bulkLoad = false;
+}
+
+template<class Key> bool SortedIndexFile<Key>::isOpened() const {
+  return m_records.isOpened();
+}
+
+template<class Key> Crypto::Hash SortedIndexFile<Key>::getTailId() const {
+  return m_changed ? NULL_HASH : header().tailId;
+}
+
+template<class Key> void SortedIndexFile<Key>::store(const Crypto::Hash& tailId) {
+  endBulkLoad();
+  mergePending();
+  header().tailId = tailId;
+  m_records.flush();
+  m_changed = false;
+}
+
+template<class Key> void SortedIndexFile<Key>::add(const Key& key, const Crypto::Hash& hash) {
+  markChanged();
+
+  Record record = { key, hash };
+  if (m_bulkLoad) {
+    // every growth copies the file, grow in larger steps than push_back does
+    if (m_records.size() == m_records.capacity()) {
+      uint64_t capacity = m_records.capacity() * 2;
+      m_records.reserve(capacity > MIN_MERGE_RECORDS ? capacity : MIN_MERGE_RECORDS);
+    }
+
+    m_records.push_back(record);
+    return;
+  }
+
+  auto removed = std::lower_bound(m_removed.begin(), m_removed.end(), record, recordLess);
+  if (removed != m_removed.end() && !recordLess(record, *removed)) {
+    m_removed.erase(removed);
+    return;
+  }
+
+  // blocks mostly come in key order for timestamps, then no sort is needed at all
+  m_addedSorted = m_addedSorted && (m_added.empty() || !keyLess(record, m_added.back()));
+  m_added.push_back(record);
+  mergeIfNeeded();
+}
+
+template<class Key> bool SortedIndexFile<Key>::remove(const Key& key, const Crypto::Hash& hash) {
+  endBulkLoad();
+  sortAdded();
+  Record record = { key, hash };
+  auto range = std::equal_range(m_added.begin(), m_added.end(), record, keyLess);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->hash == hash) {
+      markChanged();
+      m_added.erase(it);
+      return true;
+    }
+  }
+
+  const Record* end = upperBound(key);
+  for (const Record* it = lowerBound(key); it != end; ++it) {
+    if (it->hash == hash && !isRemoved(*it)) {
+      markChanged();
+      m_removed.insert(std::upper_bound(m_removed.begin(), m_removed.end(), record, recordLess), record);
+      mergeIfNeeded();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template<class Key> void SortedIndexFile<Key>::clear() {
+  markChanged();
+  m_records.clear();
+  m_added.clear();
+  m_addedSorted = true;
+  m_removed.clear();
+}
+
+template<class Key> uint64_t SortedIndexFile<Key>::size() const {
+  return m_records.size() + m_added.size() - m_removed.size();
+}
+
+template<class Key> void SortedIndexFile<Key>::beginBulkLoad() {
+  clear();
+  m_bulkLoad = true;
+}
+
+template<class Key> void SortedIndexFile<Key>::endBulkLoad() {
+  if (m_bulkLoad) {
+    std::stable_sort(m_records.data(), m_records.data() + m_records.size(), keyLess);
+    m_bulkLoad = false;
+  }
+}
+
+template<class Key> uint64_t SortedIndexFile<Key>::find(const Key& first, const Key& last, uint64_t limit, std::vector<Crypto::Hash>& hashes) {
+  if (indexKeyLess(last, first)) {
+    return 0;
+  }
+
+  endBulkLoad();
+  sortAdded();
+  Record firstRecord = { first, NULL_HASH };
+  Record lastRecord = { last, NULL_HASH };
+  const Record* records = lowerBound(first);
+  const Record* recordsEnd = upperBound(last);
+  auto added = std::lower_bound(m_added.begin(), m_added.end(), firstRecord, keyLess);
+  auto addedEnd = std::upper_bound(m_added.begin(), m_added.end(), lastRecord, keyLess);
+  uint64_t removedCount = std::upper_bound(m_removed.begin(), m_removed.end(), lastRecord, keyLess) -
+    std::lower_bound(m_removed.begin(), m_removed.end(), firstRecord, keyLess);
+  uint64_t count = (recordsEnd - records) + (addedEnd - added) - removedCount;
+
+  for (uint64_t found = 0; found < limit; ++found) {
+    while (records != recordsEnd && isRemoved(*records)) {
+      ++records;
+    }
+
+    if (records != recordsEnd && (added == addedEnd || !keyLess(*added, *records))) {
+      hashes.push_back(records->hash);
+      ++records;
+    } else if (added != addedEnd) {
+      hashes.push_back(added->hash);
+      ++added;
+    } else {
+      break;
+    }
+  }
+
+  return count;
+}
+
+template<class Key> bool SortedIndexFile<Key>::keyLess(const Record& left, const Record& right) {
+  return indexKeyLess(left.key, right.key);
+}
+
+template<class Key> bool SortedIndexFile<Key>::recordLess(const Record& left, const Record& right) {
+  if (indexKeyLess(left.key, right.key)) {
+    return true;
+  }
+
+  if (indexKeyLess(right.key, left.key)) {
+    return false;
+  }
+
+  return indexKeyLess(left.hash, right.hash);
+}
+
+template<class Key> typename SortedIndexFile<Key>::Header& SortedIndexFile<Key>::header() {
+  return *reinterpret_cast<Header*>(m_records.prefix());
+}
+
+template<class Key> const typename SortedIndexFile<Key>::Header& SortedIndexFile<Key>::header() const {
+  return *reinterpret_cast<const Header*>(m_records.prefix());
+}
+
+template<class Key> const typename SortedIndexFile<Key>::Record* SortedIndexFile<Key>::lowerBound(const Key& key) const {
+  Record record = { key, NULL_HASH };
+  return std::lower_bound(m_records.data(), m_records.data() + m_records.size(), record, keyLess);
+}
+
+template<class Key> const typename SortedIndexFile<Key>::Record* SortedIndexFile<Key>::upperBound(const Key& key) const {
+  Record record = { key, NULL_HASH };
+  return std::upper_bound(m_records.data(), m_records.data() + m_records.size(), record, keyLess);
+}
+
+template<class Key> bool SortedIndexFile<Key>::isRemoved(const Record& record) const {
+  return !m_removed.empty() && std::binary_search(m_removed.begin(), m_removed.end(), record, recordLess);
+}
+
+template<class Key> void SortedIndexFile<Key>::markChanged() {
+  if (!m_changed) {
+    header().tailId = NULL_HASH;
+    m_records.flush();
+    m_changed = true;
+  }
+}
+
+template<class Key> void SortedIndexFile<Key>::sortAdded() {
+  if (!m_addedSorted) {
+    std::stable_sort(m_added.begin(), m_added.end(), keyLess);
+    m_addedSorted = true;
+  }
+}
+
+template<class Key> void SortedIndexFile<Key>::mergeIfNeeded() {
+  uint64_t pending = m_added.size() + m_removed.size();
+  if (pending > MIN_MERGE_RECORDS && pending > m_records.size() / MERGE_RATIO) {
+    mergePending();
+  }
+}
+
+template<class Key> void SortedIndexFile<Key>::mergePending() {
+  if (!m_removed.empty()) {
+    Record* records = m_records.data();
+    uint64_t size = m_records.size();
+    uint64_t kept = lowerBound(m_removed.front().key) - records;
+    for (uint64_t i = kept; i < size; ++i) {
+      if (!isRemoved(records[i])) {
+        records[kept++] = records[i];
+      }
+    }
+
+    for (; size > kept; --size) {
+      m_records.pop_back();
+    }
+
+    m_removed.clear();
+  }
+
+  if (!m_added.empty()) {
+    sortAdded();
+    uint64_t size = m_records.size();
+    uint64_t newSize = size + m_added.size();
+    if (newSize > m_records.capacity()) {
+      m_records.reserve(std::max(newSize, m_records.capacity() + m_records.capacity() / 2));
+    }
+
+    for (const Record& record : m_added) {
+      m_records.push_back(record);
+    }
+
+    // merge from the back, only records above the smallest added key move
+    Record* records = m_records.data();
+    uint64_t i = size;
+    uint64_t j = m_added.size();
+    uint64_t k = newSize;
+    while (j > 0) {
+      if (i > 0 && keyLess(m_added[j - 1], records[i - 1])) {
+        records[--k] = records[--i];
+      } else {
+        records[--k] = m_added[--j];
+      }
+    }
+
+    m_added.clear();
+  }
+}
+
+}
@@ -229,6 +229,7 @@ namespace CryptoNote {
       }
       m_paymentIdIndex.add(tx);
       m_timestampIndex.add(txd.receiveTime, txd.id);
+      m_observerManager.notify(&ITxPoolObserver::txAddedToPool, id);
     }
 
     tvc.m_added_to_pool = true;
@@ -603,6 +604,7 @@ namespace CryptoNote {
       m_validated_transactions.erase(i->id);
       logger(DEBUGGING) << "Removing transaction from MemPool cache " << i->id << ". Cache size: " << m_validated_transactions.size();
     }
+    m_observerManager.notify(&ITxPoolObserver::txRemovedFromPool, i->id);
     return m_transactions.erase(i);
   }
 
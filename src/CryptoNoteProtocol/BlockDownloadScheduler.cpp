@@ -0,0 +1,349 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "BlockDownloadScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace CryptoNote {
+
+namespace {
+
+const double SPAN_TIMEOUT = 60;         // seconds a span may take whatever the peer's speed is
+const double HEAD_SPAN_TIMEOUT = 10;    // seconds before the lowest span is moved to a faster peer
+const double SLOW_PEER_FACTOR = 4;
+const double STALLED_PEER_TIMEOUT = 60; // seconds a late response is waited for after its span was reassigned
+
+double secondsBetween(BlockDownloadScheduler::Clock::time_point from, BlockDownloadScheduler::Clock::time_point to) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(to - from).count();
+}
+
+}
+
+BlockDownloadScheduler::BlockDownloadScheduler(size_t spanLength, size_t maxSpansAhead) :
+  m_spanLength(spanLength),
+  m_maxSpansAhead(maxSpansAhead),
+  m_planStart(0),
+  m_bufferedSize(0) {
+  assert(spanLength > 0 && maxSpansAhead > 0);
+}
+
+bool BlockDownloadScheduler::addChain(const PeerId& peer, uint32_t startHeight, const std::vector<Crypto::Hash>& ids) {
+  if (m_spans.empty()) {
+    m_plan.clear();
+    m_planStart = startHeight;
+  }
+
+  // ids below the plan have been imported meanwhile
+  size_t i = startHeight < m_planStart ? std::min<size_t>(m_planStart - startHeight, ids.size()) : 0;
+  for (; i < ids.size(); ++i) {
+    uint32_t height = startHeight + static_cast<uint32_t>(i);
+    if (height < planEnd()) {
+      if (m_plan[height - m_planStart] != ids[i]) {
+        return false;
+      }
+    } else if (height == planEnd()) {
+      addIds(ids, i);
+      break;
+    } else {
+      return false;
+    }
+  }
+
+  Peer& state = m_peers[peer];
+  if (!ids.empty()) {
+    state.knownHeight = std::max(state.knownHeight, startHeight + static_cast<uint32_t>(ids.size()) - 1);
+  }
+
+  state.chainRequested = false;
+  return true;
+}
+
+void BlockDownloadScheduler::removePeer(const PeerId& peer) {
+  auto it = m_peers.find(peer);
+  if (it != m_peers.end()) {
+    releaseSpan(it->second);
+    m_peers.erase(it);
+  }
+}
+
+bool BlockDownloadScheduler::isPeer(const PeerId& peer) const {
+  return m_peers.count(peer) != 0;
+}
+
+bool BlockDownloadScheduler::isPeerIdle(const PeerId& peer) const {
+  auto it = m_peers.find(peer);
+  return it != m_peers.end() && !it->second.hasSpan && !it->second.stalled && !it->second.chainRequested;
+}
+
+bool BlockDownloadScheduler::hasSpansFor(const PeerId& peer) const {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return false;
+  }
+
+  for (const auto& span : m_spans) {
+    if (span.first + span.second.count - 1 > it->second.knownHeight) {
+      break;
+    }
+
+    if (span.second.state == SpanState::PENDING) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BlockDownloadScheduler::setChainRequested(const PeerId& peer) {
+  auto it = m_peers.find(peer);
+  if (it != m_peers.end()) {
+    it->second.chainRequested = true;
+  }
+}
+
+bool BlockDownloadScheduler::assign(const PeerId& peer, Clock::time_point now, std::vector<Crypto::Hash>& blockIds) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end() || it->second.hasSpan || it->second.stalled) {
+    return false;
+  }
+
+  Peer& state = it->second;
+  uint32_t windowEnd = m_planStart + static_cast<uint32_t>(m_spanLength * m_maxSpansAhead);
+  for (auto& span : m_spans) {
+    if (span.first >= windowEnd || span.first + span.second.count - 1 > state.knownHeight) {
+      break;
+    }
+
+    if (span.second.state != SpanState::PENDING) {
+      continue;
+    }
+
+    span.second.state = SpanState::REQUESTED;
+    span.second.peer = peer;
+    span.second.requestTime = now;
+    state.hasSpan = true;
+    state.spanStart = span.first;
+
+    auto first = m_plan.begin() + (span.first - m_planStart);
+    blockIds.assign(first, first + span.second.count);
+    return true;
+  }
+
+  return false;
+}
+
+BlockDownloadScheduler::Delivery BlockDownloadScheduler::deliver(const PeerId& peer, const std::vector<Crypto::Hash>& blockIds,
+  std::vector<parsed_block_entry>&& blocks, size_t size, Clock::time_point now) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return Delivery::STALE;
+  }
+
+  Peer& state = it->second;
+  if (!state.hasSpan) {
+    state.stalled = false;
+    return Delivery::STALE;
+  }
+
+  auto spanIt = m_spans.find(state.spanStart);
+  assert(spanIt != m_spans.end() && spanIt->second.state == SpanState::REQUESTED);
+  Span& span = spanIt->second;
+  if (blockIds.size() != span.count || blocks.size() != span.count ||
+    !std::equal(blockIds.begin(), blockIds.end(), m_plan.begin() + (spanIt->first - m_planStart))) {
+    releaseSpan(state);
+    m_peers.erase(it);
+    return Delivery::INVALID;
+  }
+
+  double sample = span.count / std::max(secondsBetween(span.requestTime, now), 0.001);
+  state.blocksPerSecond = state.blocksPerSecond == 0 ? sample : 0.7 * state.blocksPerSecond + 0.3 * sample;
+  state.hasSpan = false;
+
+  span.state = SpanState::ARRIVED;
+  span.blocks = std::move(blocks);
+  span.size = size;
+  m_bufferedSize += size;
+  return Delivery::ACCEPTED;
+}
+
+bool BlockDownloadScheduler::startImport(std::vector<parsed_block_entry>& blocks, PeerId& source) {
+  if (m_spans.empty() || m_spans.begin()->second.state != SpanState::ARRIVED) {
+    return false;
+  }
+
+  Span& span = m_spans.begin()->second;
+  assert(m_spans.begin()->first == m_planStart);
+  blocks = std::move(span.blocks);
+  source = span.peer;
+  span.state = SpanState::IMPORTING;
+  return true;
+}
+
+void BlockDownloadScheduler::finishImport() {
+  // the plan may have been reset meanwhile
+  if (m_spans.empty() || m_spans.begin()->second.state != SpanState::IMPORTING) {
+    return;
+  }
+
+  auto it = m_spans.begin();
+  m_plan.erase(m_plan.begin(), m_plan.begin() + it->second.count);
+  m_planStart += it->second.count;
+  m_bufferedSize -= it->second.size;
+  m_spans.erase(it);
+}
+
+size_t BlockDownloadScheduler::reassignSlowSpans(Clock::time_point now) {
+  double fastest = 0;
+  for (const auto& peer : m_peers) {
+    fastest = std::max(fastest, peer.second.blocksPerSecond);
+  }
+
+  for (auto& peer : m_peers) {
+    if (peer.second.stalled && secondsBetween(peer.second.stalledTime, now) > STALLED_PEER_TIMEOUT) {
+      // a response arriving even later doesn't match its next span and drops the peer
+      peer.second.stalled = false;
+    }
+  }
+
+  size_t reassigned = 0;
+  for (auto& span : m_spans) {
+    if (span.second.state != SpanState::REQUESTED) {
+      continue;
+    }
+
+    auto it = m_peers.find(span.second.peer);
+    assert(it != m_peers.end());
+    Peer& peer = it->second;
+
+    double elapsed = secondsBetween(span.second.requestTime, now);
+    double expected = peer.blocksPerSecond > 0 ? span.second.count / peer.blocksPerSecond : 0;
+    bool slow = elapsed > std::max(SPAN_TIMEOUT, SLOW_PEER_FACTOR * expected);
+    if (!slow && span.first == m_planStart && fastest > 0) {
+      // the lowest span holds back the import of everything that arrived after it
+      slow = peer.blocksPerSecond * SLOW_PEER_FACTOR < fastest &&
+        elapsed > HEAD_SPAN_TIMEOUT + SLOW_PEER_FACTOR * span.second.count / fastest;
+    }
+
+    if (slow) {
+      double rate = span.second.count / elapsed;
+      peer.blocksPerSecond = peer.blocksPerSecond == 0 ? rate : std::min(peer.blocksPerSecond, rate);
+      peer.hasSpan = false;
+      peer.stalled = true;
+      peer.stalledTime = now;
+      span.second.state = SpanState::PENDING;
+      span.second.peer = PeerId();
+      ++reassigned;
+    }
+  }
+
+  return reassigned;
+}
+
+std::vector<BlockDownloadScheduler::PeerId> BlockDownloadScheduler::reset(Clock::time_point now) {
+  std::vector<PeerId> peers;
+  peers.reserve(m_peers.size());
+  for (auto& peer : m_peers) {
+    peers.push_back(peer.first);
+
+    // responses to spans requested before are recognized as stale
+    Peer& state = peer.second;
+    if (state.hasSpan) {
+      state.stalled = true;
+      state.stalledTime = now;
+    }
+
+    state.hasSpan = false;
+    state.knownHeight = 0;
+    state.chainRequested = true;
+  }
+
+  m_spans.clear();
+  m_plan.clear();
+  m_bufferedSize = 0;
+  return peers;
+}
+
+bool BlockDownloadScheduler::empty() const {
+  return m_spans.empty();
+}
+
+size_t BlockDownloadScheduler::bufferedSize() const {
+  return m_bufferedSize;
+}
+
+double BlockDownloadScheduler::peerBlocksPerSecond(const PeerId& peer) const {
+  auto it = m_peers.find(peer);
+  return it != m_peers.end() ? it->second.blocksPerSecond : 0;
+}
+
+uint32_t BlockDownloadScheduler::planEnd() const {
+  return m_planStart + static_cast<uint32_t>(m_plan.size());
+}
+
+void BlockDownloadScheduler::addIds(const std::vector<Crypto::Hash>& ids, size_t first) {
+  for (; first < ids.size(); ++first) {
+    uint32_t height = planEnd();
+    m_plan.push_back(ids[first]);
+
+    if (!m_spans.empty()) {
+      Span& last = m_spans.rbegin()->second;
+      if (last.state == SpanState::PENDING && last.count < m_spanLength) {
+        ++last.count;
+        continue;
+      }
+    }
+
+    m_spans[height].count = 1;
+  }
+}
+
+void BlockDownloadScheduler::releaseSpan(Peer& peer) {
+  if (!peer.hasSpan) {
+    return;
+  }
+
+  auto it = m_spans.find(peer.spanStart);
+  if (it != m_spans.end() && it->second.state == SpanState::REQUESTED) {
+    it->second.state = SpanState::PENDING;
+    it->second.peer = PeerId();
+  }
+
+  peer.hasSpan = false;
+}
+
+}
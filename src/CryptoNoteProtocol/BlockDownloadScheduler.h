@@ -0,0 +1,148 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
+#include "Serialization/ISerializer.h"
+#include "Serialization/SerializationOverloads.h"
+
+namespace CryptoNote {
+
+struct parsed_block_entry {
+  Block block;
+  std::vector<BinaryArray> txs;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(block);
+    KV_MEMBER(txs);
+  }
+};
+
+// Splits the blocks a node has to download during synchronization into spans of consecutive heights,
+// hands disjoint spans to the peers that announced them and buffers arrived spans until they are
+// imported in height order. A span stays in the plan while it is imported. Only used on the p2p dispatcher thread.
+class BlockDownloadScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using PeerId = boost::uuids::uuid;
+
+  enum class Delivery {
+    ACCEPTED,
+    STALE,   // the span was given to another peer meanwhile, blocks are dropped
+    INVALID  // not the blocks of the span the peer was asked for
+  };
+
+  BlockDownloadScheduler(size_t spanLength, size_t maxSpansAhead);
+
+  // Adds block ids a peer returned in NOTIFY_RESPONSE_CHAIN_ENTRY, ids.front() is at startHeight and none of them is
+  // known to the core. Returns false if they contradict the plan, such a peer is on another chain.
+  bool addChain(const PeerId& peer, uint32_t startHeight, const std::vector<Crypto::Hash>& ids);
+  void removePeer(const PeerId& peer);
+  bool isPeer(const PeerId& peer) const;
+  // neither waits for a span nor for a chain entry
+  bool isPeerIdle(const PeerId& peer) const;
+  bool hasSpansFor(const PeerId& peer) const;
+  void setChainRequested(const PeerId& peer);
+
+  // hands the lowest span the peer has announced and nobody downloads to it
+  bool assign(const PeerId& peer, Clock::time_point now, std::vector<Crypto::Hash>& blockIds);
+  Delivery deliver(const PeerId& peer, const std::vector<Crypto::Hash>& blockIds, std::vector<parsed_block_entry>&& blocks,
+    size_t size, Clock::time_point now);
+  // takes the blocks of the lowest span if it has arrived, finishImport removes the span afterwards
+  bool startImport(std::vector<parsed_block_entry>& blocks, PeerId& source);
+  void finishImport();
+  // gives spans held by peers much slower than expected back to the pool, returns their count,
+  // peers whose late response never came get spans again
+  size_t reassignSlowSpans(Clock::time_point now);
+  // drops the plan, returns the peers that took part in it, they are expected to request a new chain entry
+  std::vector<PeerId> reset(Clock::time_point now);
+
+  bool empty() const;
+  // size of the blocks that arrived and aren't imported yet
+  size_t bufferedSize() const;
+  double peerBlocksPerSecond(const PeerId& peer) const;
+
+private:
+  enum class SpanState {
+    PENDING,
+    REQUESTED,
+    ARRIVED,
+    IMPORTING
+  };
+
+  struct Span {
+    uint32_t count = 0;
+    size_t size = 0;
+    SpanState state = SpanState::PENDING;
+    PeerId peer = PeerId();
+    Clock::time_point requestTime;
+    std::vector<parsed_block_entry> blocks;
+  };
+
+  struct Peer {
+    uint32_t knownHeight = 0;
+    bool hasSpan = false;
+    uint32_t spanStart = 0;
+    // its span was reassigned, the late response is still on the way until stalledTime + timeout
+    bool stalled = false;
+    Clock::time_point stalledTime;
+    bool chainRequested = false;
+    double blocksPerSecond = 0;
+  };
+
+  uint32_t planEnd() const;
+  void addIds(const std::vector<Crypto::Hash>& ids, size_t first);
+  void releaseSpan(Peer& peer);
+
+  const size_t m_spanLength;
+  const size_t m_maxSpansAhead;
+  uint32_t m_planStart;
+  size_t m_bufferedSize;
+  std::deque<Crypto::Hash> m_plan;
+  std::map<uint32_t, Span> m_spans;
+  std::map<PeerId, Peer> m_peers;
+};
+
+}
@@ -98,6 +98,32 @@ namespace CryptoNote
     }
   };
 
+  struct TransactionCompactInfo {
+    Crypto::Hash txHash;
+    std::string txPrefix; // binary prefix without ring member offsets
+    std::vector<uint32_t> globalIndexes;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(txHash);
+      KV_MEMBER(txPrefix);
+      KV_MEMBER(globalIndexes);
+    }
+  };
+
+  struct BlockCompactInfo {
+    Crypto::Hash blockId;
+    std::string block;
+    std::vector<uint32_t> baseTransactionGlobalIndexes;
+    std::vector<TransactionCompactInfo> transactions;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(blockId);
+      KV_MEMBER(block);
+      KV_MEMBER(baseTransactionGlobalIndexes);
+      KV_MEMBER(transactions);
+    }
+  };
+
   /************************************************************************/
   /*                                                                      */
   /************************************************************************/
@@ -229,4 +255,89 @@ namespace CryptoNote
     const static int ID = BC_COMMANDS_POOL_BASE + 8;
     typedef NOTIFY_REQUEST_TX_POOL_request request;
   };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // a new block without its transaction blobs, the block blob lists the transaction hashes
+  // and the receiver takes the transactions from its pool
+  struct NOTIFY_NEW_COMPACT_BLOCK_request {
+    std::string block;
+    uint32_t current_blockchain_height;
+    uint32_t hop;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block)
+      KV_MEMBER(current_blockchain_height)
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_NEW_COMPACT_BLOCK {
+    const static int ID = BC_COMMANDS_POOL_BASE + 9;
+    typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TXS_request {
+    Crypto::Hash block_id;
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block_id)
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TXS {
+    const static int ID = BC_COMMANDS_POOL_BASE + 10;
+    typedef NOTIFY_REQUEST_BLOCK_TXS_request request;
+  };
+
+  struct NOTIFY_RESPONSE_BLOCK_TXS_request {
+    Crypto::Hash block_id;
+    std::vector<std::string> txs;
+    std::vector<Crypto::Hash> missed_ids;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block_id)
+      KV_MEMBER(txs)
+      serializeAsBinary(missed_ids, "missed_ids", s);
+    }
+  };
+
+  struct NOTIFY_RESPONSE_BLOCK_TXS {
+    const static int ID = BC_COMMANDS_POOL_BASE + 11;
+    typedef NOTIFY_RESPONSE_BLOCK_TXS_request request;
+  };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // hashes of transactions the sender has, the receiver asks for those it misses with NOTIFY_REQUEST_TXS
+  struct NOTIFY_TX_INV_request {
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_TX_INV {
+    const static int ID = BC_COMMANDS_POOL_BASE + 12;
+    typedef NOTIFY_TX_INV_request request;
+  };
+
+  // answered with NOTIFY_NEW_TRANSACTIONS
+  struct NOTIFY_REQUEST_TXS_request {
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_TXS {
+    const static int ID = BC_COMMANDS_POOL_BASE + 13;
+    typedef NOTIFY_REQUEST_TXS_request request;
+  };
 }
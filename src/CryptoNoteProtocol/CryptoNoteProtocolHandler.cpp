@@ -37,10 +37,14 @@
 
 #include "CryptoNoteProtocolHandler.h"
 
+#include <algorithm>
 #include <future>
+#include <limits>
+#include <map>
 #include <boost/scope_exit.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <System/Dispatcher.h>
+#include <System/InterruptedException.h>
 
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
@@ -56,16 +60,43 @@ namespace CryptoNote {
 
 namespace {
 
+const size_t MAX_PENDING_COMPACT_BLOCKS = 16;
+const std::chrono::seconds PENDING_COMPACT_BLOCK_TIMEOUT(30);
+const size_t MAX_KNOWN_TRANSACTIONS_PER_PEER = 16384;
+const std::chrono::seconds TRANSACTION_REQUEST_TIMEOUT(30);
+const size_t MAX_TRANSACTION_ANNOUNCERS = 8;
+
 template<class t_parametr>
 bool post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const CryptoNoteConnectionContext& context) {
   return p2p.invoke_notify_to_peer(t_parametr::ID, LevinProtocol::encode(arg), context);
 }
 
+size_t blockEntrySize(const block_complete_entry& entry) {
+  size_t size = entry.block.size();
+  for (const auto& tx : entry.txs) {
+    size += tx.size();
+  }
+
+  return size;
+}
+
 template<class t_parametr>
 void relay_post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const net_connection_id* excludeConnection = nullptr) {
   p2p.externalRelayNotifyToAll(t_parametr::ID, LevinProtocol::encode(arg), excludeConnection);
 }
 
+void addKnownTransaction(CryptoNoteConnectionContext& context, const Crypto::Hash& transactionHash) {
+  if (!context.m_known_txs.insert(transactionHash).second) {
+    return;
+  }
+
+  context.m_known_txs_order.push_back(transactionHash);
+  if (context.m_known_txs_order.size() > MAX_KNOWN_TRANSACTIONS_PER_PEER) {
+    context.m_known_txs.erase(context.m_known_txs_order.front());
+    context.m_known_txs_order.pop_front();
+  }
+}
+
 }
 
 CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& rcore, IP2pEndpoint* p_net_layout, Logging::ILogger& log) :
@@ -75,6 +106,11 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, S
   m_p2p(p_net_layout),
   m_synchronized(false),
   m_stop(false),
+  m_downloads(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, BLOCKS_SYNCHRONIZING_SPANS_AHEAD),
+  m_importBatchesSize(0),
+  m_importing(false),
+  m_importReady(dispatcher),
+  m_importProgress(dispatcher),
   m_observedHeight(0),
   m_blockchainHeight(0),  
   m_peersCount(0),
@@ -83,6 +119,8 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, S
   if (!m_p2p) {
     m_p2p = &m_p2p_stub;
   }
+
+  setValidationThreads(P2P_VALIDATION_THREADS_DEFAULT);
 }
 
 size_t CryptoNoteProtocolHandler::getPeerCount() const {
@@ -96,10 +134,42 @@ void CryptoNoteProtocolHandler::set_p2p_endpoint(IP2pEndpoint* p2p) {
     m_p2p = &m_p2p_stub;
 }
 
+void CryptoNoteProtocolHandler::setValidationThreads(size_t count) {
+  m_validationThreads.reset(count > 0 ? new System::ThreadPool(count) : nullptr);
+}
+
+void CryptoNoteProtocolHandler::validate(std::function<void()>&& procedure) {
+  if (m_validationThreads) {
+    m_validationThreads->run(m_dispatcher, std::move(procedure));
+  } else {
+    procedure();
+  }
+}
+
 void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext& context) {
 }
 
 void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext& context) {
+  m_downloads.removePeer(context.m_connection_id);
+  for (auto it = m_pendingCompactBlocks.begin(); it != m_pendingCompactBlocks.end();) {
+    if (it->second.connection == context.m_connection_id) {
+      it = m_pendingCompactBlocks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::vector<Crypto::Hash> unanswered;
+  for (auto& requested : m_requestedTransactions) {
+    auto& announcers = requested.second.announcers;
+    announcers.erase(std::remove(announcers.begin(), announcers.end(), context.m_connection_id), announcers.end());
+    if (requested.second.connection == context.m_connection_id) {
+      unanswered.push_back(requested.first);
+    }
+  }
+
+  retryTransactionRequests(unanswered, std::chrono::steady_clock::now());
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -256,6 +326,11 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
     HANDLE_NOTIFY(NOTIFY_REQUEST_CHAIN, &CryptoNoteProtocolHandler::handle_request_chain)
     HANDLE_NOTIFY(NOTIFY_RESPONSE_CHAIN_ENTRY, &CryptoNoteProtocolHandler::handle_response_chain_entry)
     HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, &CryptoNoteProtocolHandler::handleRequestTxPool)
+    HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, &CryptoNoteProtocolHandler::handle_notify_new_compact_block)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_BLOCK_TXS, &CryptoNoteProtocolHandler::handle_request_block_txs)
+    HANDLE_NOTIFY(NOTIFY_RESPONSE_BLOCK_TXS, &CryptoNoteProtocolHandler::handle_response_block_txs)
+    HANDLE_NOTIFY(NOTIFY_TX_INV, &CryptoNoteProtocolHandler::handle_notify_tx_inv)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_TXS, &CryptoNoteProtocolHandler::handle_request_txs)
 
   default:
     handled = false;
@@ -282,79 +357,441 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
     return 1;
   }
 
-  for (auto tx_blob_it = arg.b.txs.begin(); tx_blob_it != arg.b.txs.end(); tx_blob_it++) {
-    CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+  return processNewBlock(arg, context);
+}
+
+int CryptoNoteProtocolHandler::handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")";
+
+  updateObservedHeight(arg.current_blockchain_height, context);
+
+  context.m_remote_blockchain_height = arg.current_blockchain_height;
+
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
+
+  Block block;
+  BinaryArray blockBlob = asBinaryArray(arg.block);
+  if (blockBlob.size() > m_currency.maxBlockBlobSize() || !fromBinaryArray(block, blockBlob)) {
+    logger(Logging::DEBUGGING) << context << "sent wrong compact block, dropping connection";
+    m_p2p->drop_connection(context, true);
+    return 1;
+  }
+
+  Crypto::Hash blockHash = get_block_hash(block);
+  if (m_core.have_block(blockHash) || m_pendingCompactBlocks.count(blockHash) != 0) {
+    return 1;
+  }
+
+  NOTIFY_NEW_BLOCK::request fullBlock;
+  fullBlock.b.block = std::move(arg.block);
+  fullBlock.current_blockchain_height = arg.current_blockchain_height;
+  fullBlock.hop = arg.hop;
+
+  std::list<Transaction> poolTransactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(block.transactionHashes, poolTransactions, missedTransactions, true);
+  if (missedTransactions.empty()) {
+    // the core takes the transactions from the pool
+    return processNewBlock(fullBlock, context);
+  }
+
+  if (m_pendingCompactBlocks.size() >= MAX_PENDING_COMPACT_BLOCKS) {
+    logger(Logging::DEBUGGING) << context << "Too many compact blocks wait for transactions, block " << blockHash << " ignored";
+    return 1;
+  }
+
+  PendingCompactBlock& pending = m_pendingCompactBlocks[blockHash];
+  pending.block = std::move(fullBlock);
+  pending.connection = context.m_connection_id;
+  pending.missing.assign(missedTransactions.begin(), missedTransactions.end());
+  pending.time = std::chrono::steady_clock::now();
+
+  NOTIFY_REQUEST_BLOCK_TXS::request request;
+  request.block_id = blockHash;
+  request.txs = pending.missing;
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_BLOCK_TXS: txs.size()=" << request.txs.size();
+  post_notify<NOTIFY_REQUEST_BLOCK_TXS>(*m_p2p, request, context);
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_request_block_txs(int command, NOTIFY_REQUEST_BLOCK_TXS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_BLOCK_TXS: txs.size()=" << arg.txs.size();
+
+  if (arg.txs.size() > CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT) {
+    logger(Logging::ERROR) << context << "requested too many transactions (" << arg.txs.size() << "), dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  std::list<Transaction> transactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(arg.txs, transactions, missedTransactions, true);
+
+  NOTIFY_RESPONSE_BLOCK_TXS::request response;
+  response.block_id = arg.block_id;
+  for (const auto& transaction : transactions) {
+    response.txs.push_back(asString(toBinaryArray(transaction)));
+  }
+
+  response.missed_ids.assign(missedTransactions.begin(), missedTransactions.end());
+  logger(Logging::TRACE) << context << "-->>NOTIFY_RESPONSE_BLOCK_TXS: txs.size()=" << response.txs.size()
+    << ", missed_ids.size()=" << response.missed_ids.size();
+  post_notify<NOTIFY_RESPONSE_BLOCK_TXS>(*m_p2p, response, context);
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_response_block_txs(int command, NOTIFY_RESPONSE_BLOCK_TXS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_BLOCK_TXS: txs.size()=" << arg.txs.size() << ", missed_ids.size()=" << arg.missed_ids.size();
+
+  auto it = m_pendingCompactBlocks.find(arg.block_id);
+  if (it == m_pendingCompactBlocks.end() || it->second.connection != context.m_connection_id) {
+    return 1;
+  }
+
+  NOTIFY_NEW_BLOCK::request block = std::move(it->second.block);
+  std::unordered_set<Crypto::Hash> missing(it->second.missing.begin(), it->second.missing.end());
+  m_pendingCompactBlocks.erase(it);
 
-    auto transactionBinary = asBinaryArray(*tx_blob_it);
-    Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-    logger(DEBUGGING) << "transaction " << transactionHash << " came in NOTIFY_NEW_BLOCK";
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
 
-    m_core.handle_incoming_tx(transactionBinary, tvc, true);
-    if (tvc.m_verification_failed) {
-      logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
+  if (!arg.missed_ids.empty() || arg.txs.size() != missing.size()) {
+    // the block comes with the usual synchronization instead
+    logger(Logging::DEBUGGING) << context << "Transactions of compact block " << arg.block_id << " are missing, synchronizing";
+    requestChain(context);
+    return 1;
+  }
+
+  for (const auto& transaction : arg.txs) {
+    if (missing.erase(getBinaryArrayHash(asBinaryArray(transaction))) == 0) {
+      logger(Logging::DEBUGGING) << context << "sent a transaction that wasn't requested, dropping connection";
       m_p2p->drop_connection(context, true);
       return 1;
     }
   }
 
+  block.b.txs = std::move(arg.txs);
+  return processNewBlock(block, context);
+}
+
+int CryptoNoteProtocolHandler::processNewBlock(NOTIFY_NEW_BLOCK::request& arg, CryptoNoteConnectionContext& context) {
+  CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
-  m_core.handle_incoming_block_blob(asBinaryArray(arg.b.block), bvc, true, false);
+
+  // validate on the validation threads, the p2p dispatcher keeps serving other connections meanwhile
+  validate([&] {
+    for (auto tx_blob_it = arg.b.txs.begin(); tx_blob_it != arg.b.txs.end(); tx_blob_it++) {
+      auto transactionBinary = asBinaryArray(*tx_blob_it);
+      Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
+      logger(DEBUGGING) << "transaction " << transactionHash << " came in NOTIFY_NEW_BLOCK";
+
+      tvc = boost::value_initialized<decltype(tvc)>();
+      m_core.handle_incoming_tx(transactionBinary, tvc, true);
+      if (tvc.m_verification_failed) {
+        return;
+      }
+    }
+
+    m_core.handle_incoming_block_blob(asBinaryArray(arg.b.block), bvc, true, false);
+  });
+
+  if (tvc.m_verification_failed) {
+    logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
+    m_p2p->drop_connection(context, true);
+    return 1;
+  }
+
   if (bvc.m_verification_failed) {
+    // a compact block takes its transactions from the pool, they may have left it after they were looked up
+    Block block;
+    if (fromBinaryArray(block, asBinaryArray(arg.b.block)) && arg.b.txs.size() != block.transactionHashes.size()) {
+      std::list<Transaction> transactions;
+      std::list<Crypto::Hash> missedTransactions;
+      m_core.getTransactions(block.transactionHashes, transactions, missedTransactions, true);
+      if (!missedTransactions.empty()) {
+        logger(Logging::DEBUGGING) << context << "Transactions of block " << get_block_hash(block) << " left the pool, synchronizing";
+        requestChain(context);
+        return 1;
+      }
+    }
+
     logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
     m_p2p->drop_connection(context, true);
     return 1;
   }
   if (bvc.m_added_to_main_chain) {
     ++arg.hop;
-    //TODO: Add here announce protocol usage
-    relay_post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-    // relay_block(arg, context);
+    relayNewBlock(arg, &context.m_connection_id);
 
     if (bvc.m_switched_to_alt_chain) {
       requestMissingPoolTransactions(context);
     }
   } else if (bvc.m_marked_as_orphaned) {
-    context.m_state = CryptoNoteConnectionContext::state_synchronizing;
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return 1;
 }
 
+void CryptoNoteProtocolHandler::relayNewBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection) {
+  NOTIFY_NEW_COMPACT_BLOCK::request compactBlock;
+  compactBlock.block = arg.b.block;
+  compactBlock.current_blockchain_height = arg.current_blockchain_height;
+  compactBlock.hop = arg.hop;
+  m_p2p->externalRelayNotifyToPeers(NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(compactBlock), excludeConnection,
+    P2PProtocolVersion::V2, std::numeric_limits<uint8_t>::max());
+
+  // older peers need every transaction, a block rebuilt from a compact one only carries those that were missing
+  Block block;
+  if (!fromBinaryArray(block, asBinaryArray(arg.b.block))) {
+    return;
+  }
+
+  if (arg.b.txs.size() != block.transactionHashes.size()) {
+    std::list<Transaction> transactions;
+    std::list<Crypto::Hash> missedTransactions;
+    m_core.getTransactions(block.transactionHashes, transactions, missedTransactions, true);
+    if (!missedTransactions.empty()) {
+      logger(Logging::DEBUGGING) << "Transactions of block " << get_block_hash(block) << " not found, not relayed to older peers";
+      return;
+    }
+
+    arg.b.txs.clear();
+    for (const auto& transaction : transactions) {
+      arg.b.txs.push_back(asString(toBinaryArray(transaction)));
+    }
+  }
+
+  m_p2p->externalRelayNotifyToPeers(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(arg), excludeConnection,
+    P2PProtocolVersion::V0, P2PProtocolVersion::V1);
+}
+
+void CryptoNoteProtocolHandler::requestChain(CryptoNoteConnectionContext& context) {
+  context.m_state = CryptoNoteConnectionContext::state_synchronizing;
+  NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+  r.block_ids = m_core.buildSparseChain();
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+  post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+}
+
 int CryptoNoteProtocolHandler::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_NEW_TRANSACTIONS";
 
   if (context.m_state != CryptoNoteConnectionContext::state_normal)
     return 1;
 
-  for (auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();) {
-    auto transactionBinary = asBinaryArray(*tx_blob_it);
-    Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-    logger(DEBUGGING) << "transaction " << transactionHash << " came in NOTIFY_NEW_TRANSACTIONS";
+  std::vector<Crypto::Hash> transactionHashes;
+  transactionHashes.reserve(arg.txs.size());
+  for (const auto& transaction : arg.txs) {
+    Crypto::Hash transactionHash = Crypto::cn_fast_hash(transaction.data(), transaction.size());
+    addKnownTransaction(context, transactionHash);
+    m_requestedTransactions.erase(transactionHash);
+    transactionHashes.push_back(transactionHash);
+  }
 
-    CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-    m_core.handle_incoming_tx(transactionBinary, tvc, false);
-    if (tvc.m_verification_failed) {
-      logger(Logging::DEBUGGING) << context << "Tx verification failed";
-    }
-    if (!tvc.m_verification_failed && tvc.m_should_be_relayed) {
-      ++tx_blob_it;
-    } else {
-      tx_blob_it = arg.txs.erase(tx_blob_it);
+  size_t failedCount = 0;
+  std::vector<std::string> relayedTransactions;
+  validate([&] {
+    for (size_t i = 0; i < arg.txs.size(); ++i) {
+      logger(DEBUGGING) << "transaction " << transactionHashes[i] << " came in NOTIFY_NEW_TRANSACTIONS";
+
+      CryptoNote::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+      m_core.handle_incoming_tx(asBinaryArray(arg.txs[i]), tvc, false);
+      if (tvc.m_verification_failed) {
+        ++failedCount;
+      }
+      if (!tvc.m_verification_failed && tvc.m_should_be_relayed) {
+        relayedTransactions.push_back(std::move(arg.txs[i]));
+      }
     }
+  });
+
+  if (failedCount != 0) {
+    logger(Logging::DEBUGGING) << context << "Tx verification failed for " << failedCount << " transaction(s)";
   }
 
-  if (arg.txs.size()) {
-    //TODO: add announce usage here
-    relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, arg, &context.m_connection_id);
+  if (!relayedTransactions.empty()) {
+    relayTransactions(relayedTransactions, &context.m_connection_id);
   }
 
   return true;
 }
 
+int CryptoNoteProtocolHandler::handle_notify_tx_inv(int command, NOTIFY_TX_INV::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_TX_INV: txs.size()=" << arg.txs.size();
+
+  if (arg.txs.size() > CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT) {
+    logger(Logging::ERROR) << context << "announced too many transactions (" << arg.txs.size() << "), dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
+
+  std::vector<Crypto::Hash> unknownTransactions;
+  for (const auto& transactionHash : arg.txs) {
+    addKnownTransaction(context, transactionHash);
+    auto requested = m_requestedTransactions.find(transactionHash);
+    if (requested == m_requestedTransactions.end()) {
+      unknownTransactions.push_back(transactionHash);
+      continue;
+    }
+
+    // another peer was already asked for it, this one is asked if that one doesn't send it
+    auto& announcers = requested->second.announcers;
+    if (requested->second.connection != context.m_connection_id && announcers.size() < MAX_TRANSACTION_ANNOUNCERS &&
+        std::find(announcers.begin(), announcers.end(), context.m_connection_id) == announcers.end()) {
+      announcers.push_back(context.m_connection_id);
+    }
+  }
+
+  if (unknownTransactions.empty()) {
+    return 1;
+  }
+
+  std::list<Transaction> transactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(unknownTransactions, transactions, missedTransactions, true);
+  if (missedTransactions.empty()) {
+    return 1;
+  }
+
+  NOTIFY_REQUEST_TXS::request request;
+  auto now = std::chrono::steady_clock::now();
+  for (const auto& transactionHash : missedTransactions) {
+    RequestedTransaction& requested = m_requestedTransactions[transactionHash];
+    requested.connection = context.m_connection_id;
+    requested.time = now;
+    request.txs.push_back(transactionHash);
+  }
+
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_TXS: txs.size()=" << request.txs.size();
+  post_notify<NOTIFY_REQUEST_TXS>(*m_p2p, request, context);
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handle_request_txs(int command, NOTIFY_REQUEST_TXS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TXS: txs.size()=" << arg.txs.size();
+
+  if (arg.txs.size() > CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT) {
+    logger(Logging::ERROR) << context << "requested too many transactions (" << arg.txs.size() << "), dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  std::list<Transaction> transactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(arg.txs, transactions, missedTransactions, true);
+  if (transactions.empty()) {
+    return 1;
+  }
+
+  NOTIFY_NEW_TRANSACTIONS::request response;
+  for (const auto& transaction : transactions) {
+    response.txs.push_back(asString(toBinaryArray(transaction)));
+  }
+
+  logger(Logging::TRACE) << context << "-->>NOTIFY_NEW_TRANSACTIONS: txs.size()=" << response.txs.size();
+  post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, response, context);
+  return 1;
+}
+
+void CryptoNoteProtocolHandler::relayTransactions(const std::vector<std::string>& transactions, const net_connection_id* excludeConnection) {
+  std::vector<Crypto::Hash> transactionHashes;
+  transactionHashes.reserve(transactions.size());
+  for (const auto& transaction : transactions) {
+    transactionHashes.push_back(Crypto::cn_fast_hash(transaction.data(), transaction.size()));
+  }
+
+  // peers that take announcements get the hashes with the next on_idle, those they know already are skipped
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& conn, PeerIdType peerId) {
+    if (peerId == 0 || conn.version < P2PProtocolVersion::V3 ||
+        (conn.m_state != CryptoNoteConnectionContext::state_normal &&
+         conn.m_state != CryptoNoteConnectionContext::state_synchronizing)) {
+      return;
+    }
+
+    for (const auto& transactionHash : transactionHashes) {
+      if (conn.m_known_txs.count(transactionHash) == 0) {
+        addKnownTransaction(conn, transactionHash);
+        conn.m_tx_announcements.push_back(transactionHash);
+      }
+    }
+  });
+
+  NOTIFY_NEW_TRANSACTIONS::request notification;
+  notification.txs = transactions;
+  m_p2p->externalRelayNotifyToPeers(NOTIFY_NEW_TRANSACTIONS::ID, LevinProtocol::encode(notification), excludeConnection,
+    P2PProtocolVersion::V0, P2PProtocolVersion::V2);
+}
+
+void CryptoNoteProtocolHandler::retryTransactionRequests(const std::vector<Crypto::Hash>& transactionHashes,
+  std::chrono::steady_clock::time_point now) {
+  if (transactionHashes.empty()) {
+    return;
+  }
+
+  // some may have arrived with a block meanwhile
+  std::list<Transaction> transactions;
+  std::list<Crypto::Hash> missedTransactions;
+  m_core.getTransactions(transactionHashes, transactions, missedTransactions, true);
+  std::unordered_set<Crypto::Hash> missed(missedTransactions.begin(), missedTransactions.end());
+
+  std::map<boost::uuids::uuid, std::vector<Crypto::Hash>> requests;
+  for (const auto& transactionHash : transactionHashes) {
+    auto it = m_requestedTransactions.find(transactionHash);
+    if (it == m_requestedTransactions.end()) {
+      continue;
+    }
+
+    RequestedTransaction& requested = it->second;
+    if (missed.count(transactionHash) == 0 || requested.announcers.empty()) {
+      m_requestedTransactions.erase(it);
+      continue;
+    }
+
+    requested.connection = requested.announcers.front();
+    requested.announcers.erase(requested.announcers.begin());
+    requested.time = now;
+    requests[requested.connection].push_back(transactionHash);
+  }
+
+  // a peer that can't be asked now times out like one that doesn't answer
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& conn, PeerIdType peerId) {
+    auto it = requests.find(conn.m_connection_id);
+    if (it == requests.end() || conn.m_state != CryptoNoteConnectionContext::state_normal) {
+      return;
+    }
+
+    for (size_t i = 0; i < it->second.size(); i += CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT) {
+      NOTIFY_REQUEST_TXS::request request;
+      auto end = std::min(it->second.size(), i + CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT);
+      request.txs.assign(it->second.begin() + i, it->second.begin() + end);
+      logger(Logging::TRACE) << conn << "-->>NOTIFY_REQUEST_TXS: txs.size()=" << request.txs.size();
+      post_notify<NOTIFY_REQUEST_TXS>(*m_p2p, request, conn);
+    }
+  });
+}
+
+void CryptoNoteProtocolHandler::announceTransactions() {
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& conn, PeerIdType peerId) {
+    for (size_t i = 0; i < conn.m_tx_announcements.size(); i += CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT) {
+      NOTIFY_TX_INV::request notification;
+      auto end = std::min(conn.m_tx_announcements.size(), i + CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT);
+      notification.txs.assign(conn.m_tx_announcements.begin() + i, conn.m_tx_announcements.begin() + end);
+      logger(Logging::TRACE) << conn << "-->>NOTIFY_TX_INV: txs.size()=" << notification.txs.size();
+      post_notify<NOTIFY_TX_INV>(*m_p2p, notification, conn);
+    }
+
+    conn.m_tx_announcements.clear();
+  });
+}
+
 int CryptoNoteProtocolHandler::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "Received NOTIFY_REQUEST_GET_OBJECTS";
 
@@ -402,29 +839,22 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
+  if (m_downloads.isPeer(context.m_connection_id)) {
+    return handleBlockSpan(arg, context);
+  }
+
   size_t count = 0;
-  std::vector<Crypto::Hash> block_hashes;
-  block_hashes.reserve(arg.blocks.size());
   std::vector<parsed_block_entry> parsed_blocks;
   parsed_blocks.reserve(arg.blocks.size());
   for (const block_complete_entry& block_entry : arg.blocks) {
     ++count;
-    Block b;
-    BinaryArray block_blob = asBinaryArray(block_entry.block);
-    if (block_blob.size() > m_currency.maxBlockBlobSize()) {
-      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_blob.size() << ", dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    }
-    if (!fromBinaryArray(b, block_blob)) {
-      logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << toHex(block_blob) << "\r\n dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    parsed_block_entry parsedBlock;
+    Crypto::Hash blockHash;
+    if (!parseBlockEntry(block_entry, parsedBlock, blockHash, context)) {
       return 1;
     }
 
     //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    auto blockHash = get_block_hash(b);
     if (count == 2) {
       if (m_core.have_block(blockHash)) {
         context.m_state = CryptoNoteConnectionContext::state_idle;
@@ -442,24 +872,10 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
       context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     }
-    if (b.transactionHashes.size() != block_entry.txs.size()) {
-      logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << ", transactionHashes.size()=" << b.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size() << ", dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    }
 
     context.m_requested_objects.erase(req_it);
 
-    block_hashes.push_back(blockHash);
-
-    parsed_block_entry parsedBlock;
-    parsedBlock.block = b;
-    for (auto& tx_blob : block_entry.txs) {
-      auto transactionBinary = asBinaryArray(tx_blob);
-      parsedBlock.txs.push_back(transactionBinary);
-    }
-    parsed_blocks.push_back(parsedBlock);
+    parsed_blocks.push_back(std::move(parsedBlock));
   }
 
   if (context.m_requested_objects.size()) {
@@ -470,49 +886,268 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     return 1;
   }
 
-  uint32_t height;
-  Crypto::Hash top;
-  {
-    m_core.pause_mining();
+  // the blocks are validated by importLoop, the connection goes on downloading unless the queue is full
+  waitForImportRoom();
 
-    // we lock all the rest to avoid having multiple connections redo a lot
-    // of the same work, and one of them doing it for nothing: subsequent
-    // connections will wait until the current one's added its blocks, then
-    // will add any extra it has, if any
-    std::lock_guard<std::recursive_mutex> lk(m_sync_lock);
+  ImportBatch batch;
+  batch.blocks = std::move(parsed_blocks);
+  batch.source = context.m_connection_id;
+  batch.size = 0;
+  for (const block_complete_entry& block_entry : arg.blocks) {
+    batch.size += blockEntrySize(block_entry);
+  }
+
+  m_importBatchesSize += batch.size;
+  m_importBatches.push_back(std::move(batch));
+  m_importReady.set();
+
+  if (context.m_needed_objects.empty()) {
+    // a chain request is built from the blockchain top, so the queued blocks have to be imported first
+    waitForImportDrained();
+  }
+
+  if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
+    request_missing_objects(context, true);
+  }
+
+  return 1;
+}
+
+bool CryptoNoteProtocolHandler::parseBlockEntry(const block_complete_entry& entry, parsed_block_entry& parsed, Crypto::Hash& blockHash,
+  CryptoNoteConnectionContext& context) {
+  BinaryArray block_blob = asBinaryArray(entry.block);
+  if (block_blob.size() > m_currency.maxBlockBlobSize()) {
+    logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_blob.size() << ", dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return false;
+  }
+
+  if (!fromBinaryArray(parsed.block, block_blob)) {
+    logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
+      << toHex(block_blob) << "\r\n dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return false;
+  }
+
+  blockHash = get_block_hash(parsed.block);
+  if (parsed.block.transactionHashes.size() != entry.txs.size()) {
+    logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
+      << ", transactionHashes.size()=" << parsed.block.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << entry.txs.size() << ", dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return false;
+  }
+
+  parsed.txs.reserve(entry.txs.size());
+  for (auto& tx_blob : entry.txs) {
+    parsed.txs.push_back(asBinaryArray(tx_blob));
+  }
+
+  return true;
+}
+
+int CryptoNoteProtocolHandler::handleBlockSpan(NOTIFY_RESPONSE_GET_OBJECTS::request& arg, CryptoNoteConnectionContext& context) {
+  std::vector<Crypto::Hash> blockIds;
+  blockIds.reserve(arg.blocks.size());
+  std::vector<parsed_block_entry> blocks;
+  blocks.reserve(arg.blocks.size());
+  size_t size = 0;
+  for (const block_complete_entry& entry : arg.blocks) {
+    Crypto::Hash blockHash;
+    blocks.emplace_back();
+    if (!parseBlockEntry(entry, blocks.back(), blockHash, context)) {
+      return 1;
+    }
+
+    blockIds.push_back(blockHash);
+    size += blockEntrySize(entry);
+  }
 
-    // dismiss what another connection might already have done (likely everything)
-    m_core.get_blockchain_top(height, top);
-    uint64_t dismiss = 1;
-    for (const auto &h : block_hashes) {
-      if (top == h) {
-        logger(Logging::DEBUGGING) << "Found current top block in synced blocks, dismissing "
-          << dismiss << "/" << arg.blocks.size() << " blocks";
-        while (dismiss--) {
-          arg.blocks.erase(arg.blocks.begin());
-          parsed_blocks.erase(parsed_blocks.begin());
+  auto delivery = m_downloads.deliver(context.m_connection_id, blockIds, std::move(blocks), size, std::chrono::steady_clock::now());
+  switch (delivery) {
+  case BlockDownloadScheduler::Delivery::INVALID:
+    logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: " << blockIds.size()
+      << " blocks don't match the requested span, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  case BlockDownloadScheduler::Delivery::STALE:
+    logger(Logging::DEBUGGING) << context << "Blocks arrived after their span was given to another peer, ignored";
+    break;
+  case BlockDownloadScheduler::Delivery::ACCEPTED:
+    logger(Logging::TRACE) << context << "Span of " << blockIds.size() << " blocks arrived, peer speed "
+      << m_downloads.peerBlocksPerSecond(context.m_connection_id) << " blocks/s";
+    break;
+  }
+
+  if (delivery == BlockDownloadScheduler::Delivery::ACCEPTED) {
+    m_importReady.set();
+  }
+
+  requestBlockSpans();
+  return 1;
+}
+
+void CryptoNoteProtocolHandler::requestBlockSpans() {
+  if (m_stop) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  uint32_t topIndex = get_current_blockchain_height();
+  // new spans are only requested while the blocks waiting for validation fit the budget
+  bool hasRoom = importQueueSize() < BLOCKS_IMPORT_QUEUE_MAX_SIZE;
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType) {
+    if (context.m_state != CryptoNoteConnectionContext::state_synchronizing || !m_downloads.isPeerIdle(context.m_connection_id)) {
+      return;
+    }
+
+    NOTIFY_REQUEST_GET_OBJECTS::request req;
+    if (hasRoom && m_downloads.assign(context.m_connection_id, now, req.blocks)) {
+      logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size();
+      post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
+    } else if (m_downloads.hasSpansFor(context.m_connection_id)) {
+      // the spans it could download are too far ahead of the import or don't fit the queue, waits for the import
+    } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {
+      m_downloads.setChainRequested(context.m_connection_id);
+      NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+      r.block_ids = m_core.buildSparseChain();
+      logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+      post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    } else if (topIndex >= context.m_last_response_height) {
+      m_downloads.removePeer(context.m_connection_id);
+      requestMissingPoolTransactions(context);
+      context.m_state = CryptoNoteConnectionContext::state_normal;
+      logger(Logging::INFO, Logging::BRIGHT_GREEN) << context << "SYNCHRONIZED OK";
+      on_connection_synchronized();
+    }
+  });
+}
+
+void CryptoNoteProtocolHandler::importLoop() {
+  try {
+    while (!m_stop) {
+      std::vector<parsed_block_entry> blocks;
+      boost::uuids::uuid source;
+      size_t batchSize = 0;
+      bool scheduled = m_downloads.startImport(blocks, source);
+      if (!scheduled) {
+        if (m_importBatches.empty()) {
+          m_importReady.clear();
+          m_importReady.wait();
+          continue;
         }
-        break;
+
+        blocks = std::move(m_importBatches.front().blocks);
+        source = m_importBatches.front().source;
+        batchSize = m_importBatches.front().size;
+        m_importBatches.pop_front();
       }
-      ++dismiss;
+
+      m_importing = true;
+      importBlocks(blocks, source, scheduled);
+      m_importing = false;
+
+      if (scheduled) {
+        m_downloads.finishImport();
+      } else {
+        m_importBatchesSize -= batchSize;
+      }
+
+      m_importProgress.set();
+      requestBlockSpans();
     }
+  } catch (System::InterruptedException&) {
+    logger(DEBUGGING) << "importLoop() is interrupted";
+  } catch (std::exception& e) {
+    logger(ERROR) << "Exception in importLoop: " << e.what();
+  }
+}
+
+void CryptoNoteProtocolHandler::importBlocks(std::vector<parsed_block_entry>& blocks, const boost::uuids::uuid& source, bool scheduled) {
+  // blocks which arrived another way meanwhile
+  blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [this](const parsed_block_entry& entry) {
+    return m_core.have_block(get_block_hash(entry.block));
+  }), blocks.end());
+
+  if (blocks.empty()) {
+    return;
+  }
 
+  // the peer which sent the blocks may disconnect while they are validated, so it's only looked up again afterwards
+  CryptoNoteConnectionContext origin;
+  origin.m_connection_id = source;
+  origin.m_state = CryptoNoteConnectionContext::state_synchronizing;
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType) {
+    if (context.m_connection_id == source) {
+      origin.m_remote_ip = context.m_remote_ip;
+      origin.m_remote_port = context.m_remote_port;
+      origin.m_is_income = context.m_is_income;
+    }
+  });
+
+  {
+    m_core.pause_mining();
+    std::lock_guard<std::recursive_mutex> lk(m_sync_lock);
     BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+    processObjects(origin, blocks);
+  }
+
+  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << get_current_blockchain_height();
+  if (origin.m_state == CryptoNoteConnectionContext::state_synchronizing) {
+    return;
+  }
 
-    int result = processObjects(context, parsed_blocks);
-    if (result != 0) {
-      return result;
+  if (!scheduled) {
+    // the rest of what this peer sent is of no use either
+    for (auto it = m_importBatches.begin(); it != m_importBatches.end();) {
+      if (it->source == source) {
+        m_importBatchesSize -= it->size;
+        it = m_importBatches.erase(it);
+      } else {
+        ++it;
+      }
     }
+
+    m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType) {
+      if (context.m_connection_id == source) {
+        context.m_state = origin.m_state;
+        context.m_needed_objects.clear();
+        context.m_requested_objects.clear();
+      }
+    });
+
+    return;
   }
 
-  m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  // everything planned after a rejected block is suspect, the peers build a new plan
+  auto peers = m_downloads.reset(std::chrono::steady_clock::now());
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& context, PeerIdType) {
+    if (context.m_connection_id == source && origin.m_state == CryptoNoteConnectionContext::state_shutdown) {
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    } else if (context.m_state == CryptoNoteConnectionContext::state_synchronizing &&
+      std::find(peers.begin(), peers.end(), context.m_connection_id) != peers.end()) {
+      context.m_needed_objects.clear();
+      context.m_requested_objects.clear();
+      start_sync(context);
+    }
+  });
+}
 
-  if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
-    request_missing_objects(context, true);
+size_t CryptoNoteProtocolHandler::importQueueSize() const {
+  return m_downloads.bufferedSize() + m_importBatchesSize;
+}
+
+void CryptoNoteProtocolHandler::waitForImportRoom() {
+  while (!m_stop && importQueueSize() >= BLOCKS_IMPORT_QUEUE_MAX_SIZE) {
+    m_importProgress.clear();
+    m_importProgress.wait();
   }
+}
 
-  return 1;
+void CryptoNoteProtocolHandler::waitForImportDrained() {
+  while (!m_stop && (m_importing || !m_importBatches.empty())) {
+    m_importProgress.clear();
+    m_importProgress.wait();
+  }
 }
 
 int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<parsed_block_entry>& blocks) {
@@ -522,24 +1157,35 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
       break;
     }
 
-    //process transactions
-    for (auto& transactionBinary : block_entry.txs) {
-      Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-      logger(DEBUGGING) << "transaction " << transactionHash << " came in processObjects";
-
-      tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-      m_core.handle_incoming_tx(transactionBinary, tvc, true);
-      if (tvc.m_verification_failed) {
-        logger(Logging::DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(getBinaryArrayHash(transactionBinary)) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        return 1;
+    tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    const BinaryArray* failedTransaction = nullptr;
+
+    // validate on the validation threads, the connection context is only touched back on the p2p dispatcher
+    validate([&] {
+      //process transactions
+      for (auto& transactionBinary : block_entry.txs) {
+        Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
+        logger(DEBUGGING) << "transaction " << transactionHash << " came in processObjects";
+
+        tvc = boost::value_initialized<decltype(tvc)>();
+        m_core.handle_incoming_tx(transactionBinary, tvc, true);
+        if (tvc.m_verification_failed) {
+          failedTransaction = &transactionBinary;
+          return;
+        }
       }
-    }
 
-    // process block
-    block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block(block_entry.block, bvc, false, false);
+      // process block
+      m_core.handle_incoming_block(block_entry.block, bvc, false, false);
+    });
+
+    if (failedTransaction != nullptr) {
+      logger(Logging::DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+        << Common::podToHex(getBinaryArrayHash(*failedTransaction)) << ", dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
 
     if (bvc.m_verification_failed) {
       logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
@@ -550,14 +1196,9 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
       context.m_state = CryptoNoteConnectionContext::state_shutdown;
       return 1;
     } else if (bvc.m_already_exists) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = CryptoNoteConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+      // importBlocks() skips known blocks, this one was relayed while the previous ones were validated
+      logger(Logging::DEBUGGING) << context << "Block already exists, skipped";
     }
-
-    m_dispatcher.yield();
   }
 
   return 0;
@@ -566,6 +1207,33 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
 
 
 bool CryptoNoteProtocolHandler::on_idle() {
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = m_pendingCompactBlocks.begin(); it != m_pendingCompactBlocks.end();) {
+    if (now - it->second.time > PENDING_COMPACT_BLOCK_TIMEOUT) {
+      it = m_pendingCompactBlocks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::vector<Crypto::Hash> unanswered;
+  for (const auto& requested : m_requestedTransactions) {
+    if (now - requested.second.time > TRANSACTION_REQUEST_TIMEOUT) {
+      unanswered.push_back(requested.first);
+    }
+  }
+
+  retryTransactionRequests(unanswered, now);
+
+  // announcements collected since the last tick go out together
+  announceTransactions();
+
+  size_t reassigned = m_downloads.reassignSlowSpans(now);
+  if (reassigned != 0) {
+    logger(Logging::DEBUGGING) << reassigned << " block spans taken from slow peers";
+  }
+
+  requestBlockSpans();
   return m_core.on_idle();
 }
 
@@ -691,6 +1359,21 @@ int CryptoNoteProtocolHandler::handle_response_chain_entry(int command, NOTIFY_R
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
   }
 
+  size_t known = 0;
+  while (known < arg.m_block_ids.size() && m_core.have_block(arg.m_block_ids[known])) {
+    ++known;
+  }
+
+  // peers that agree on the chain download disjoint spans of it in parallel
+  std::vector<Crypto::Hash> neededIds(arg.m_block_ids.begin() + known, arg.m_block_ids.end());
+  if (context.m_state == CryptoNoteConnectionContext::state_synchronizing &&
+    m_downloads.addChain(context.m_connection_id, arg.start_height + static_cast<uint32_t>(known), neededIds)) {
+    requestBlockSpans();
+    return 1;
+  }
+
+  m_downloads.removePeer(context.m_connection_id);
+
   for (auto& bl_id : arg.m_block_ids) {
     if (!m_core.have_block(bl_id))
       context.m_needed_objects.push_back(bl_id);
@@ -712,6 +1395,7 @@ int CryptoNoteProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_T
     NOTIFY_NEW_TRANSACTIONS::request notification;
     for (auto& tx : addedTransactions) {
       notification.txs.push_back(asString(toBinaryArray(tx)));
+      addKnownTransaction(context, getObjectHash(tx));
     }
 
     bool ok = post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, notification, context);
@@ -725,13 +1409,15 @@ int CryptoNoteProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_T
 
 
 void CryptoNoteProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_BLOCK::ID, buf, nullptr);
+  relayNewBlock(arg, nullptr);
 }
 
 void CryptoNoteProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buf, nullptr);
+  // called from the RPC threads, the peers' inventories are only touched on the p2p dispatcher
+  std::vector<std::string> transactions = arg.txs;
+  m_dispatcher.remoteSpawn([this, transactions] {
+    relayTransactions(transactions, nullptr);
+  });
 }
 
 void CryptoNoteProtocolHandler::requestMissingPoolTransactions(const CryptoNoteConnectionContext& context) {
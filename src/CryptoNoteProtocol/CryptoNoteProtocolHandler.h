@@ -38,11 +38,18 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 
 #include <Common/ObserverManager.h>
+#include <System/Event.h>
+#include <System/ThreadPool.h>
 
 #include "CryptoNoteCore/ICore.h"
 
+#include "CryptoNoteProtocol/BlockDownloadScheduler.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandlerCommon.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolObserver.h"
@@ -70,24 +77,15 @@ namespace CryptoNote
   {
   public:
 
-
-    struct parsed_block_entry
-    {
-      Block block;
-      std::vector<BinaryArray> txs;
-
-      void serialize(ISerializer& s) {
-        KV_MEMBER(block);
-        KV_MEMBER(txs);
-      }
-    };
-
     CryptoNoteProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& rcore, IP2pEndpoint* p_net_layout, Logging::ILogger& log);
 
     virtual bool addObserver(ICryptoNoteProtocolObserver* observer) override;
     virtual bool removeObserver(ICryptoNoteProtocolObserver* observer) override;
 
     void set_p2p_endpoint(IP2pEndpoint* p2p);
+    // Blocks and transactions of peers are validated by a pool of threads while the p2p dispatcher serves other
+    // connections. Zero validates them on the p2p dispatcher itself. Must be called before the node runs.
+    void setValidationThreads(size_t count);
     // ICore& get_core() { return m_core; }
     virtual bool isSynchronized() const override { return m_synchronized; }
     void log_connections();
@@ -106,6 +104,8 @@ namespace CryptoNote
     virtual uint32_t getObservedHeight() const override;
     virtual uint32_t getBlockchainHeight() const override;    
     void requestMissingPoolTransactions(const CryptoNoteConnectionContext& context);
+    // validates downloaded blocks in height order while the connections go on downloading, runs on the p2p dispatcher
+    void importLoop();
 
   private:
     //----------------- commands handlers ----------------------------------------------
@@ -116,6 +116,11 @@ namespace CryptoNote
     int handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, CryptoNoteConnectionContext& context);
     int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, CryptoNoteConnectionContext& context);
     int handleRequestTxPool(int command, NOTIFY_REQUEST_TX_POOL::request& arg, CryptoNoteConnectionContext& context);
+    int handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, CryptoNoteConnectionContext& context);
+    int handle_request_block_txs(int command, NOTIFY_REQUEST_BLOCK_TXS::request& arg, CryptoNoteConnectionContext& context);
+    int handle_response_block_txs(int command, NOTIFY_RESPONSE_BLOCK_TXS::request& arg, CryptoNoteConnectionContext& context);
+    int handle_notify_tx_inv(int command, NOTIFY_TX_INV::request& arg, CryptoNoteConnectionContext& context);
+    int handle_request_txs(int command, NOTIFY_REQUEST_TXS::request& arg, CryptoNoteConnectionContext& context);
 
     //----------------- i_cryptonote_protocol ----------------------------------
     virtual void relay_block(NOTIFY_NEW_BLOCK::request& arg) override;
@@ -128,6 +133,21 @@ namespace CryptoNote
     void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext& context);
     void recalculateMaxObservedHeight(const CryptoNoteConnectionContext& context);
     int processObjects(CryptoNoteConnectionContext& context, const std::vector<parsed_block_entry>& blocks);
+    int processNewBlock(NOTIFY_NEW_BLOCK::request& arg, CryptoNoteConnectionContext& context);
+    void relayNewBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection);
+    void requestChain(CryptoNoteConnectionContext& context);
+    void relayTransactions(const std::vector<std::string>& transactions, const net_connection_id* excludeConnection);
+    void announceTransactions();
+    // asks the next peer that announced each transaction, for requests that timed out or whose peer disconnected
+    void retryTransactionRequests(const std::vector<Crypto::Hash>& transactionHashes, std::chrono::steady_clock::time_point now);
+    bool parseBlockEntry(const block_complete_entry& entry, parsed_block_entry& parsed, Crypto::Hash& blockHash, CryptoNoteConnectionContext& context);
+    int handleBlockSpan(NOTIFY_RESPONSE_GET_OBJECTS::request& arg, CryptoNoteConnectionContext& context);
+    void requestBlockSpans();
+    void importBlocks(std::vector<parsed_block_entry>& blocks, const boost::uuids::uuid& source, bool scheduled);
+    size_t importQueueSize() const;
+    void waitForImportRoom();
+    void waitForImportDrained();
+    void validate(std::function<void()>&& procedure);
     Logging::LoggerRef logger;
 
   private:
@@ -138,9 +158,23 @@ namespace CryptoNote
 
     p2p_endpoint_stub m_p2p_stub;
     IP2pEndpoint* m_p2p;
+    std::unique_ptr<System::ThreadPool> m_validationThreads;
     std::atomic<bool> m_synchronized;
     std::atomic<bool> m_stop;
     std::recursive_mutex m_sync_lock;
+    // blocks from peers outside the download plan, validated after the planned ones
+    struct ImportBatch {
+      std::vector<parsed_block_entry> blocks;
+      boost::uuids::uuid source;
+      size_t size;
+    };
+
+    BlockDownloadScheduler m_downloads;
+    std::deque<ImportBatch> m_importBatches;
+    size_t m_importBatchesSize;
+    bool m_importing;
+    System::Event m_importReady;
+    System::Event m_importProgress;
 
     mutable std::mutex m_observedHeightMutex;
     uint32_t m_observedHeight;
@@ -148,6 +182,26 @@ namespace CryptoNote
     mutable std::mutex m_blockchainHeightMutex;
     uint32_t m_blockchainHeight;    
 
+    // compact blocks waiting for the transactions requested from the peer that sent them
+    struct PendingCompactBlock {
+      NOTIFY_NEW_BLOCK::request block;
+      boost::uuids::uuid connection;
+      std::vector<Crypto::Hash> missing;
+      std::chrono::steady_clock::time_point time;
+    };
+
+    std::unordered_map<Crypto::Hash, PendingCompactBlock> m_pendingCompactBlocks;
+
+    // announced transactions asked from a peer, not asked from the others until it answers or times out
+    struct RequestedTransaction {
+      boost::uuids::uuid connection;
+      std::chrono::steady_clock::time_point time;
+      // other peers that announced it, in the order they are asked
+      std::vector<boost::uuids::uuid> announcers;
+    };
+
+    std::unordered_map<Crypto::Hash, RequestedTransaction> m_requestedTransactions;
+
     std::atomic<size_t> m_peersCount;
     Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
   };
@@ -103,6 +103,7 @@ namespace
   const command_line::arg_descriptor<bool>        arg_disable_checkpoints = { "without-checkpoints", "Synchronize without checkpoints" };
   const command_line::arg_descriptor<std::string> arg_rollback = { "rollback", "Rollback blockchain to <height>" };
   const command_line::arg_descriptor<bool>        arg_sync_from_zero = { "sync-from-zero", "Force sync from block 0" };  
+  const command_line::arg_descriptor<uint32_t>    arg_validation_threads = { "validation-threads", "Number of threads validating blocks and transactions from peers, 0 to validate them on the p2p thread", static_cast<uint32_t>(CryptoNote::P2P_VALIDATION_THREADS_DEFAULT) };
 
 /*
   static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
@@ -183,6 +184,7 @@ int main(int argc, char* argv[])
 	command_line::add_arg(desc_cmd_sett, arg_disable_checkpoints);
 	command_line::add_arg(desc_cmd_sett, arg_rollback);
 	command_line::add_arg(desc_cmd_sett, arg_sync_from_zero);    
+	command_line::add_arg(desc_cmd_sett, arg_validation_threads);
 	command_line::add_arg(desc_cmd_sett, arg_set_contact);
 
     RpcServerConfig::initOptions(desc_cmd_sett);
@@ -541,6 +543,16 @@ int main(int argc, char* argv[])
         {
             logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME << " removed!";
         }        
+
+        if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_PAYMENT_ID_INDEX_FILENAME))
+        {
+            logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_PAYMENT_ID_INDEX_FILENAME << " removed!";
+        }
+
+        if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_TIMESTAMP_INDEX_FILENAME))
+        {
+            logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_TIMESTAMP_INDEX_FILENAME << " removed!";
+        }
     }
  
     System::Dispatcher dispatcher;
@@ -550,6 +562,7 @@ int main(int argc, char* argv[])
     CryptoNote::RpcServer rpcServer(dispatcher, logManager, ccore, p2psrv, cprotocol);
 	
     cprotocol.set_p2p_endpoint(&p2psrv);
+    cprotocol.setValidationThreads(command_line::get_arg(vm, arg_validation_threads));
     ccore.set_cryptonote_protocol(&cprotocol);
     DaemonCommandsHandler dch(ccore, p2psrv, logManager, cprotocol, &rpcServer);
 
@@ -594,7 +607,15 @@ int main(int argc, char* argv[])
       dch.start_handling();
     }
 
-    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
+    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress() << " with " << rpcConfig.threads << " processing thread(s)";
+    rpcServer.setProcessingThreads(rpcConfig.threads);
+    rpcServer.setMaxConnections(rpcConfig.maxConnections);
+    rpcServer.setDefaultMethodLimit(rpcConfig.methodConcurrency, rpcConfig.methodQueueDepth);
+    for (const auto& limit : rpcConfig.methodLimits) {
+      rpcServer.setMethodLimit(std::get<0>(limit), std::get<1>(limit), std::get<2>(limit));
+    }
+    rpcServer.setResponseCacheSize(static_cast<size_t>(rpcConfig.cacheSize) * 1024 * 1024);
+    rpcServer.setCompression(static_cast<int>(rpcConfig.compressionLevel), rpcConfig.compressionMinSize);
     rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort);
     rpcServer.restrictRPC(command_line::get_arg(vm, arg_restricted_rpc));
     rpcServer.enableCors(command_line::get_arg(vm, arg_enable_cors));
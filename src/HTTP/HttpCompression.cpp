@@ -0,0 +1,211 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#include "HttpCompression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace {
+
+const size_t OUTPUT_CHUNK_SIZE = 64 * 1024;
+// deflate window, gzip wraps it into a gzip header and trailer, inflate detects both wrappers
+const int DEFLATE_WINDOW_BITS = 15;
+const int GZIP_WINDOW_BITS = DEFLATE_WINDOW_BITS + 16;
+const int AUTO_WINDOW_BITS = DEFLATE_WINDOW_BITS + 32;
+
+std::string trim(const std::string& str, size_t begin, size_t end) {
+  while (begin < end && std::isspace(static_cast<unsigned char>(str[begin]))) {
+    ++begin;
+  }
+
+  while (end > begin && std::isspace(static_cast<unsigned char>(str[end - 1]))) {
+    --end;
+  }
+
+  return str.substr(begin, end - begin);
+}
+
+std::string toLower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+  return str;
+}
+
+// coding without parameters and whether its quality value allows it
+std::pair<std::string, bool> parseCoding(const std::string& item) {
+  size_t semicolon = item.find(';');
+  std::string coding = toLower(trim(item, 0, std::min(semicolon, item.size())));
+  bool accepted = true;
+  while (semicolon != std::string::npos) {
+    size_t next = item.find(';', semicolon + 1);
+    std::string parameter = trim(item, semicolon + 1, std::min(next, item.size()));
+    if (parameter.size() > 2 && (parameter[0] == 'q' || parameter[0] == 'Q') && parameter[1] == '=') {
+      accepted = std::strtod(parameter.c_str() + 2, nullptr) > 0;
+    }
+
+    semicolon = next;
+  }
+
+  return std::make_pair(coding, accepted);
+}
+
+}
+
+namespace CryptoNote {
+
+std::string selectContentEncoding(const std::string& acceptEncoding) {
+  bool gzip = false;
+  bool deflate = false;
+  size_t begin = 0;
+  while (begin <= acceptEncoding.size()) {
+    size_t comma = std::min(acceptEncoding.find(',', begin), acceptEncoding.size());
+    auto coding = parseCoding(acceptEncoding.substr(begin, comma - begin));
+    if (coding.first == "gzip" || coding.first == "x-gzip") {
+      gzip = coding.second;
+    } else if (coding.first == "deflate") {
+      deflate = coding.second;
+    }
+
+    begin = comma + 1;
+  }
+
+  return gzip ? "gzip" : deflate ? "deflate" : "";
+}
+
+bool isCompressedContentEncoding(const std::string& contentEncoding) {
+  std::string coding = toLower(trim(contentEncoding, 0, contentEncoding.size()));
+  return coding == "gzip" || coding == "x-gzip" || coding == "deflate";
+}
+
+void compressBody(const std::string& data, const std::string& contentEncoding, int level, std::string& compressed) {
+  z_stream stream = {};
+  int windowBits = contentEncoding == "deflate" ? DEFLATE_WINDOW_BITS : GZIP_WINDOW_BITS;
+  if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Failed to initialize HTTP body compression");
+  }
+
+  // the output grows geometrically instead of reserving the worst case, which is larger than the data itself
+  size_t bound = deflateBound(&stream, static_cast<uLong>(data.size()));
+  compressed.resize(std::min(bound, OUTPUT_CHUNK_SIZE));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+
+  int result;
+  do {
+    if (stream.total_out == compressed.size()) {
+      compressed.resize(compressed.size() * 2);
+    }
+
+    stream.next_out = reinterpret_cast<Bytef*>(&compressed[stream.total_out]);
+    stream.avail_out = static_cast<uInt>(compressed.size() - stream.total_out);
+    result = deflate(&stream, Z_FINISH);
+  } while (result == Z_OK || (result == Z_BUF_ERROR && stream.avail_out == 0));
+
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    throw std::runtime_error("Failed to compress HTTP body");
+  }
+}
+
+HttpBodyInflater::HttpBodyInflater(size_t maxSize) : m_stream(new z_stream()), m_maxSize(maxSize), m_finished(false) {
+  if (inflateInit2(m_stream.get(), AUTO_WINDOW_BITS) != Z_OK) {
+    throw std::runtime_error("Failed to initialize HTTP body decompression");
+  }
+}
+
+HttpBodyInflater::~HttpBodyInflater() {
+  inflateEnd(m_stream.get());
+}
+
+void HttpBodyInflater::write(const char* data, size_t size, std::string& body) {
+  if (m_finished) {
+    if (size != 0) {
+      throw std::runtime_error("Unexpected data after compressed HTTP body");
+    }
+
+    return;
+  }
+
+  m_stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  m_stream->avail_in = static_cast<uInt>(size);
+  // keep inflating while the output is filled up, inflate may hold output back after taking all the input
+  bool outputFull = true;
+  while (!m_finished && (m_stream->avail_in != 0 || outputFull)) {
+    size_t offset = body.size();
+    if (offset > m_maxSize) {
+      throw std::runtime_error("Decompressed HTTP body is too large");
+    }
+
+    // one byte past the limit is enough to tell the body is too large
+    size_t chunkSize = std::min(OUTPUT_CHUNK_SIZE, m_maxSize - offset + 1);
+    body.resize(offset + chunkSize);
+    m_stream->next_out = reinterpret_cast<Bytef*>(&body[offset]);
+    m_stream->avail_out = static_cast<uInt>(chunkSize);
+    int result = inflate(m_stream.get(), Z_NO_FLUSH);
+    outputFull = m_stream->avail_out == 0;
+    body.resize(offset + chunkSize - m_stream->avail_out);
+    if (result == Z_STREAM_END) {
+      m_finished = true;
+    } else if (result == Z_BUF_ERROR) {
+      break;
+    } else if (result != Z_OK) {
+      throw std::runtime_error("Failed to decompress HTTP body");
+    }
+  }
+
+  if (body.size() > m_maxSize) {
+    throw std::runtime_error("Decompressed HTTP body is too large");
+  }
+
+  if (m_stream->avail_in != 0) {
+    throw std::runtime_error("Unexpected data after compressed HTTP body");
+  }
+}
+
+void HttpBodyInflater::finish() {
+  if (!m_finished) {
+    throw std::runtime_error("Compressed HTTP body is truncated");
+  }
+}
+
+} //namespace CryptoNote
@@ -0,0 +1,74 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+struct z_stream_s;
+
+namespace CryptoNote {
+
+// "gzip" or "deflate" taken from an Accept-Encoding header value, empty if neither is accepted.
+std::string selectContentEncoding(const std::string& acceptEncoding);
+bool isCompressedContentEncoding(const std::string& contentEncoding);
+
+// Compresses data with the given content encoding and level, 'compressed' grows as deflate produces output.
+void compressBody(const std::string& data, const std::string& contentEncoding, int level, std::string& compressed);
+
+// Decompresses a gzip or deflate encoded body piece by piece as it is received.
+class HttpBodyInflater {
+public:
+  // 'maxSize' bounds the decompressed body, a few KiB of compressed data can expand to gigabytes
+  explicit HttpBodyInflater(size_t maxSize);
+  ~HttpBodyInflater();
+
+  // Appends what the piece decompresses to, throws if the data is corrupt or the body grows past maxSize.
+  void write(const char* data, size_t size, std::string& body);
+  // Throws unless the whole compressed stream has been written.
+  void finish();
+
+private:
+  std::unique_ptr<z_stream_s> m_stream;
+  size_t m_maxSize;
+  bool m_finished;
+};
+
+} //namespace CryptoNote
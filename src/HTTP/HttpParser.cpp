@@ -39,10 +39,14 @@
 
 #include <algorithm>
 
+#include "HttpCompression.h"
 #include "HttpParserErrorCodes.h"
 
 namespace {
 
+// bounds a response body, compressed or not, well above the largest response the node sends
+const size_t MAX_BODY_SIZE = 128 * 1024 * 1024;
+
 void throwIfNotGood(std::istream& stream) {
   if (!stream.good()) {
     if (stream.eof()) {
@@ -62,6 +66,9 @@ HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::s
   else if (status.substr(0, 4) == "401 ") return CryptoNote::HttpResponse::STATUS_401;
   else if (status == "404 Not Found") return CryptoNote::HttpResponse::STATUS_404;
   else if (status == "500 Internal Server Error") return CryptoNote::HttpResponse::STATUS_500;
+  else if (status == "503 Service Unavailable") return CryptoNote::HttpResponse::STATUS_503;
+  else if (status == "400 Bad Request") return CryptoNote::HttpResponse::STATUS_400;
+  else if (status == "413 Payload Too Large") return CryptoNote::HttpResponse::STATUS_413;
   else throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL),
       "Unknown HTTP status code is given");
 
@@ -126,13 +133,22 @@ void HttpParser::receiveResponse(std::istream& stream, HttpResponse& response) {
   if (it != headers.end()) {
     length = std::stoul(it->second);
   }
+
+  if (length > MAX_BODY_SIZE) {
+    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::BODY_TOO_LARGE));
+  }
   
   std::string body;
   if (length) {
-    readBody(stream, body, length);
+    it = headers.find("content-encoding");
+    if (it != headers.end() && isCompressedContentEncoding(it->second)) {
+      readCompressedBody(stream, body, length);
+    } else {
+      readBody(stream, body, length);
+    }
   }
 
-  response.setBody(body);
+  response.setBody(std::move(body));
 }
 
 
@@ -225,6 +241,10 @@ size_t HttpParser::getBodyLen(const HttpRequest::Headers& headers) {
   auto it = headers.find("content-length");
   if (it != headers.end()) {
     size_t bytes = std::stoul(it->second);
+    if (bytes > MAX_BODY_SIZE) {
+      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::BODY_TOO_LARGE));
+    }
+
     return bytes;
   }
 
@@ -242,4 +262,19 @@ void HttpParser::readBody(std::istream& stream, std::string& body, const size_t
   throwIfNotGood(stream);
 }
 
+void HttpParser::readCompressedBody(std::istream& stream, std::string& body, const size_t bodyLen) {
+  HttpBodyInflater inflater(MAX_BODY_SIZE);
+  char buffer[16 * 1024];
+  size_t read = 0;
+
+  while (read < bodyLen) {
+    stream.read(buffer, std::min(sizeof(buffer), bodyLen - read));
+    throwIfNotGood(stream);
+    inflater.write(buffer, static_cast<size_t>(stream.gcount()), body);
+    read += static_cast<size_t>(stream.gcount());
+  }
+
+  inflater.finish();
+}
+
 }
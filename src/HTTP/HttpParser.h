@@ -60,6 +60,8 @@ private:
   bool readHeader(std::istream& stream, std::string& name, std::string& value);
   size_t getBodyLen(const HttpRequest::Headers& headers);
   void readBody(std::istream& stream, std::string& body, const size_t bodyLen);
+  // decompresses while reading, the compressed body is never held whole
+  void readCompressedBody(std::istream& stream, std::string& body, const size_t bodyLen);
 };
 
 } //namespace CryptoNote
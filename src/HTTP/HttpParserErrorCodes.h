@@ -47,7 +47,10 @@ enum HttpParserErrorCodes {
   STREAM_NOT_GOOD = 1,
   END_OF_STREAM,
   UNEXPECTED_SYMBOL,
-  EMPTY_HEADER
+  EMPTY_HEADER,
+  HEADERS_TOO_LARGE,
+  BODY_TOO_LARGE,
+  UNSUPPORTED_TRANSFER_ENCODING
 };
 
 // custom category:
@@ -69,6 +72,9 @@ public:
       case END_OF_STREAM: return "The stream is ended";
       case UNEXPECTED_SYMBOL: return "Unexpected symbol";
       case EMPTY_HEADER: return "The header name is empty";
+      case HEADERS_TOO_LARGE: return "The request headers are too large";
+      case BODY_TOO_LARGE: return "The message body is too large";
+      case UNSUPPORTED_TRANSFER_ENCODING: return "The transfer encoding is not supported";
       default: return "Unknown error";
     }
   }
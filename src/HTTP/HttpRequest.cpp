@@ -79,6 +79,11 @@ namespace CryptoNote {
       os << "Host: " << "127.0.0.1" << "\r\n";
     }
 
+    // HttpParser decompresses responses
+    if (headers.find("Accept-Encoding") == headers.end()) {
+      os << "Accept-Encoding: gzip, deflate\r\n";
+    }
+
     for (auto pair : headers) {
       os << pair.first << ": " << pair.second << "\r\n";
     }
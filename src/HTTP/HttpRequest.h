@@ -58,6 +58,7 @@ namespace CryptoNote {
 
   private:
     friend class HttpParser;
+    friend class HttpRequestParser;
 
     std::string method;
     std::string url;
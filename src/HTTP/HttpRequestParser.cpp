@@ -0,0 +1,229 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#include "HttpRequestParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+#include "HttpParserErrorCodes.h"
+
+namespace {
+
+using CryptoNote::error::HttpParserErrorCodes;
+
+void throwError(HttpParserErrorCodes code) {
+  throw std::system_error(make_error_code(code));
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t';
+}
+
+std::string toLower(const char* begin, const char* end) {
+  std::string result(begin, end);
+  std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+  return result;
+}
+
+// 'begin' is at the first character of the word, returns the character after it
+const char* readWord(const char* begin, const char* end, std::string& word) {
+  const char* wordEnd = std::find(begin, end, ' ');
+  if (wordEnd == begin) {
+    throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+  }
+
+  word.assign(begin, wordEnd);
+  return wordEnd;
+}
+
+size_t parseContentLength(const std::string& value) {
+  if (value.empty()) {
+    throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+  }
+
+  size_t length = 0;
+  for (char c : value) {
+    if (c < '0' || c > '9') {
+      throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+    }
+
+    if (length > (std::numeric_limits<size_t>::max() - (c - '0')) / 10) {
+      throwError(HttpParserErrorCodes::BODY_TOO_LARGE);
+    }
+
+    length = length * 10 + (c - '0');
+  }
+
+  return length;
+}
+
+}
+
+namespace CryptoNote {
+
+HttpRequestParser::HttpRequestParser(size_t maxHeadersSize, size_t maxBodySize) :
+  m_maxHeadersSize(maxHeadersSize), m_maxBodySize(maxBodySize), m_keepAlive(true) {
+  reset();
+}
+
+void HttpRequestParser::reset() {
+  m_scanned = 0;
+  m_headersSize = 0;
+  m_bodySize = 0;
+}
+
+size_t HttpRequestParser::parse(const char* data, size_t size, HttpRequest& request) {
+  if (m_headersSize == 0) {
+    // the last 3 bytes searched may start the empty line
+    size_t from = m_scanned < 3 ? 0 : m_scanned - 3;
+    size_t limit = std::min(size, m_maxHeadersSize);
+    const char* end = nullptr;
+    for (const char* c = data + from; c + 3 < data + limit; ++c) {
+      c = static_cast<const char*>(memchr(c, '\r', data + limit - 3 - c));
+      if (c == nullptr) {
+        break;
+      }
+
+      if (c[1] == '\n' && c[2] == '\r' && c[3] == '\n') {
+        end = c + 4;
+        break;
+      }
+    }
+
+    if (end == nullptr) {
+      if (size >= m_maxHeadersSize) {
+        throwError(HttpParserErrorCodes::HEADERS_TOO_LARGE);
+      }
+
+      m_scanned = size;
+      return 0;
+    }
+
+    parseHeaders(data, end - data, request);
+    m_headersSize = end - data;
+  }
+
+  if (size - m_headersSize < m_bodySize) {
+    return 0;
+  }
+
+  request.body.assign(data + m_headersSize, m_bodySize);
+  size_t requestSize = m_headersSize + m_bodySize;
+  reset();
+  return requestSize;
+}
+
+void HttpRequestParser::parseHeaders(const char* data, size_t size, HttpRequest& request) {
+  // the empty line ending the headers
+  const char* end = data + size - 2;
+  const char* lineEnd = std::search(data, end, "\r\n", "\r\n" + 2);
+
+  // request line: method url version
+  std::string version;
+  const char* c = readWord(data, lineEnd, request.method);
+  if (c == lineEnd) {
+    throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+  }
+
+  c = readWord(c + 1, lineEnd, request.url);
+  if (c == lineEnd) {
+    throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+  }
+
+  version.assign(c + 1, lineEnd);
+  if (version != "HTTP/1.1" && version != "HTTP/1.0") {
+    throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+  }
+
+  request.headers.clear();
+  while (lineEnd + 2 != end) {
+    const char* line = lineEnd + 2;
+    lineEnd = std::search(line, end, "\r\n", "\r\n" + 2);
+    const char* colon = std::find(line, lineEnd, ':');
+    if (colon == lineEnd) {
+      throwError(HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+    }
+
+    if (colon == line) {
+      throwError(HttpParserErrorCodes::EMPTY_HEADER);
+    }
+
+    const char* valueBegin = colon + 1;
+    const char* valueEnd = lineEnd;
+    while (valueBegin != valueEnd && isSpace(*valueBegin)) {
+      ++valueBegin;
+    }
+
+    while (valueEnd != valueBegin && isSpace(valueEnd[-1])) {
+      --valueEnd;
+    }
+
+    request.headers[toLower(line, colon)].assign(valueBegin, valueEnd);
+  }
+
+  auto it = request.headers.find("transfer-encoding");
+  if (it != request.headers.end() && toLower(it->second.data(), it->second.data() + it->second.size()) != "identity") {
+    throwError(HttpParserErrorCodes::UNSUPPORTED_TRANSFER_ENCODING);
+  }
+
+  m_bodySize = 0;
+  it = request.headers.find("content-length");
+  if (it != request.headers.end()) {
+    m_bodySize = parseContentLength(it->second);
+    if (m_bodySize > m_maxBodySize) {
+      throwError(HttpParserErrorCodes::BODY_TOO_LARGE);
+    }
+  }
+
+  std::string connection;
+  it = request.headers.find("connection");
+  if (it != request.headers.end()) {
+    connection = toLower(it->second.data(), it->second.data() + it->second.size());
+  }
+
+  if (version == "HTTP/1.1") {
+    m_keepAlive = connection.find("close") == std::string::npos;
+  } else {
+    m_keepAlive = connection.find("keep-alive") != std::string::npos;
+  }
+}
+
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#pragma once
+
+#include <cstddef>
+#include "HttpRequest.h"
+
+namespace CryptoNote {
+
+// Incremental HTTP/1.1 request parser over a buffer owned by the caller. The buffer has to start at the request,
+// it may be moved between calls as long as the bytes already passed stay the same. Errors are thrown as
+// std::system_error with HttpParserErrorCodes.
+class HttpRequestParser {
+public:
+  HttpRequestParser(size_t maxHeadersSize, size_t maxBodySize);
+
+  // Returns the size of the request once all of it is in the buffer, 0 while more data is needed.
+  // 'request' is filled once the headers are complete, keep passing the same one until then.
+  size_t parse(const char* data, size_t size, HttpRequest& request);
+  // Whether the connection stays open after the last complete request
+  bool keepAlive() const { return m_keepAlive; }
+  // Drops the state of a partially received request
+  void reset();
+
+private:
+  void parseHeaders(const char* data, size_t size, HttpRequest& request);
+
+  const size_t m_maxHeadersSize;
+  const size_t m_maxBodySize;
+  // bytes already searched for the end of the headers
+  size_t m_scanned;
+  // zero until the headers are complete
+  size_t m_headersSize;
+  size_t m_bodySize;
+  bool m_keepAlive;
+};
+
+}
@@ -51,6 +51,12 @@ const char* getStatusString(CryptoNote::HttpResponse::HTTP_STATUS status) {
     return "404 Not Found";
   case CryptoNote::HttpResponse::STATUS_500:
     return "500 Internal Server Error";
+  case CryptoNote::HttpResponse::STATUS_503:
+    return "503 Service Unavailable";
+  case CryptoNote::HttpResponse::STATUS_400:
+    return "400 Bad Request";
+  case CryptoNote::HttpResponse::STATUS_413:
+    return "413 Payload Too Large";
   default:
     throw std::runtime_error("Unknown HTTP status code is given");
   }
@@ -66,6 +72,12 @@ const char* getErrorBody(CryptoNote::HttpResponse::HTTP_STATUS status) {
     return "Requested url is not found\n";
   case CryptoNote::HttpResponse::STATUS_500:
     return "Internal server error is occurred\n";
+  case CryptoNote::HttpResponse::STATUS_503:
+    return "Server is busy\n";
+  case CryptoNote::HttpResponse::STATUS_400:
+    return "Bad request\n";
+  case CryptoNote::HttpResponse::STATUS_413:
+    return "Request is too large\n";
   default:
     throw std::runtime_error("Error body for given status is not available");
   }
@@ -96,7 +108,11 @@ void HttpResponse::addHeader(const std::string& name, const std::string& value)
 }
 
 void HttpResponse::setBody(const std::string& b) {
-  body = b;
+  setBody(std::string(b));
+}
+
+void HttpResponse::setBody(std::string&& b) {
+  body = std::move(b);
   if (!body.empty()) {
     headers["Content-Length"] = std::to_string(body.size());
   } else {
@@ -104,13 +120,26 @@ void HttpResponse::setBody(const std::string& b) {
   }
 }
 
-std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
-  os << "HTTP/1.1 " << getStatusString(status) << "\r\n";
-
-  for (auto pair: headers) {
-    os << pair.first << ": " << pair.second << "\r\n";
+std::string HttpResponse::getHead() const {
+  std::string head;
+  head.reserve(256);
+  head += "HTTP/1.1 ";
+  head += getStatusString(status);
+  head += "\r\n";
+
+  for (const auto& pair: headers) {
+    head += pair.first;
+    head += ": ";
+    head += pair.second;
+    head += "\r\n";
   }
-  os << "\r\n";
+
+  head += "\r\n";
+  return head;
+}
+
+std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
+  os << getHead();
 
   if (!body.empty()) {
     os << body;
@@ -263,6 +263,56 @@ std::error_code InProcessNode::doGetTransactionOutsGlobalIndices(const Crypto::H
   return std::error_code();
 }
 
+void InProcessNode::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (state != INITIALIZED) {
+    lock.unlock();
+    callback(make_error_code(CryptoNote::error::NOT_INITIALIZED));
+    return;
+  }
+
+  ioService.post(
+    std::bind(&InProcessNode::getTransactionsOutsGlobalIndicesAsync,
+      this,
+      std::cref(transactionHashes),
+      std::ref(outsGlobalIndices),
+      callback
+    )
+  );
+}
+
+void InProcessNode::getTransactionsOutsGlobalIndicesAsync(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback)
+{
+  std::error_code ec = doGetTransactionsOutsGlobalIndices(transactionHashes, outsGlobalIndices);
+  callback(ec);
+}
+
+std::error_code InProcessNode::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (state != INITIALIZED) {
+      return make_error_code(CryptoNote::error::NOT_INITIALIZED);
+    }
+  }
+
+  try {
+    bool r = core.get_tx_outputs_gindexs(transactionHashes, outsGlobalIndices);
+    if(!r) {
+      return make_error_code(CryptoNote::error::REQUEST_ERROR);
+    }
+  } catch (std::system_error& e) {
+    return e.code();
+  } catch (std::exception&) {
+    return make_error_code(CryptoNote::error::INTERNAL_NODE_ERROR);
+  }
+
+  return std::error_code();
+}
+
 void InProcessNode::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
     std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback)
 {
@@ -547,7 +597,7 @@ void InProcessNode::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint6
   }
 
   ioService.post(
-          std::bind(&InProcessNode::queryBlocksLiteAsync,
+          std::bind(&InProcessNode::queryBlocksCompactAsync,
                   this,
                   std::move(knownBlockIds),
                   timestamp,
@@ -558,21 +608,21 @@ void InProcessNode::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint6
   );
 }
 
-void InProcessNode::queryBlocksLiteAsync(std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight,
+void InProcessNode::queryBlocksCompactAsync(std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight,
                          const Callback& callback) {
-  std::error_code ec = doQueryBlocksLite(std::move(knownBlockIds), timestamp, newBlocks, startHeight);
+  std::error_code ec = doQueryBlocksCompact(std::move(knownBlockIds), timestamp, newBlocks, startHeight);
   callback(ec);
 }
 
-std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight) {
+std::error_code InProcessNode::doQueryBlocksCompact(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   uint32_t currentHeight, fullOffset;
-  std::vector<CryptoNote::BlockShortInfo> entries;
+  std::vector<CryptoNote::BlockCompactInfo> entries;
 
-  if (!core.queryBlocksLite(knownBlockIds, timestamp, startHeight, currentHeight, fullOffset, entries)) {
+  if (!core.queryBlocksCompact(knownBlockIds, timestamp, startHeight, currentHeight, fullOffset, entries)) {
     return make_error_code(CryptoNote::error::INTERNAL_NODE_ERROR);
   }
 
-  for (const auto& entry: entries) {
+  for (auto& entry: entries) {
     BlockShortEntry bse;
     bse.blockHash = entry.blockId;
     bse.hasBlock = false;
@@ -582,13 +632,18 @@ std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& kno
       if (!fromBinaryArray(bse.block, asBinaryArray(entry.block))) {
         return std::make_error_code(std::errc::invalid_argument);
       }
+
+      bse.baseTransactionGlobalIndexes = std::move(entry.baseTransactionGlobalIndexes);
     }
 
-    for (const auto& tsi: entry.txPrefixes) {
+    for (auto& tci: entry.transactions) {
       TransactionShortInfo tpi;
-      tpi.txId = tsi.txHash;
-      tpi.txPrefix = tsi.txPrefix;
+      tpi.txId = tci.txHash;
+      if (!fromBinaryArray(tpi.txPrefix, asBinaryArray(tci.txPrefix))) {
+        return std::make_error_code(std::errc::invalid_argument);
+      }
 
+      tpi.globalIndexes = std::move(tci.globalIndexes);
       bse.txsShortInfo.push_back(std::move(tpi));
     }
 
@@ -596,7 +651,6 @@ std::error_code InProcessNode::doQueryBlocksLite(std::vector<Crypto::Hash>&& kno
   }
 
   return std::error_code();
-
 }
 
 void InProcessNode::getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
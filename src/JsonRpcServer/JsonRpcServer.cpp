@@ -52,6 +52,7 @@
 #include "HTTP/HttpResponse.h"
 #include "Rpc/JsonRpc.h"
 #include "Common/JsonValue.h"
+#include "Serialization/JsonInputBufferSerializer.h"
 #include "Serialization/JsonInputValueSerializer.h"
 #include "Serialization/JsonOutputStreamSerializer.h"
 
@@ -76,12 +77,11 @@ void JsonRpcServer::processRequest(const CryptoNote::HttpRequest& req, CryptoNot
     logger(Logging::TRACE) << "HTTP request came: \n" << req;
 
     if (req.getUrl() == "/json_rpc") {
-      std::istringstream jsonInputStream(req.getBody());
-      Common::JsonValue jsonRpcRequest;
+      std::unique_ptr<JsonInputBufferSerializer> jsonRpcRequest;
       Common::JsonValue jsonRpcResponse(Common::JsonValue::OBJECT);
 
       try {
-        jsonInputStream >> jsonRpcRequest;
+        jsonRpcRequest.reset(new JsonInputBufferSerializer(req.getBody().data(), req.getBody().size()));
       } catch (std::runtime_error&) {
         logger(Logging::DEBUGGING) << "Couldn't parse request: \"" << req.getBody() << "\"";
         makeJsonParsingErrorResponse(jsonRpcResponse);
@@ -90,7 +90,7 @@ void JsonRpcServer::processRequest(const CryptoNote::HttpRequest& req, CryptoNot
         return;
       }
 
-      processJsonRpcRequest(jsonRpcRequest, jsonRpcResponse);
+      processJsonRpcRequest(*jsonRpcRequest, jsonRpcResponse);
 
       std::ostringstream jsonOutputStream;
       jsonOutputStream << jsonRpcResponse;
@@ -109,11 +109,12 @@ void JsonRpcServer::processRequest(const CryptoNote::HttpRequest& req, CryptoNot
   }
 }
 
-void JsonRpcServer::prepareJsonResponse(const Common::JsonValue& req, Common::JsonValue& resp) {
+void JsonRpcServer::prepareJsonResponse(JsonInputBufferSerializer& req, Common::JsonValue& resp) {
   using Common::JsonValue;
 
-  if (req.contains("id")) {
-    resp.insert("id", req("id"));
+  std::string id;
+  if (req.raw(id, "id")) {
+    resp.insert("id", JsonValue::fromString(id));
   }
   
   resp.insert("jsonrpc", "2.0");
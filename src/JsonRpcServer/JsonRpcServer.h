@@ -49,6 +49,7 @@
 namespace CryptoNote {
 class HttpResponse;
 class HttpRequest;
+class JsonInputBufferSerializer;
 }
 
 namespace Common {
@@ -73,10 +74,10 @@ protected:
   static void makeMethodNotFoundResponse(Common::JsonValue& resp);
   static void makeGenericErrorReponse(Common::JsonValue& resp, const char* what, int errorCode = -32001);
   static void fillJsonResponse(const Common::JsonValue& v, Common::JsonValue& resp);
-  static void prepareJsonResponse(const Common::JsonValue& req, Common::JsonValue& resp);
+  static void prepareJsonResponse(JsonInputBufferSerializer& req, Common::JsonValue& resp);
   static void makeJsonParsingErrorResponse(Common::JsonValue& resp);
 
-  virtual void processJsonRpcRequest(const Common::JsonValue& req, Common::JsonValue& resp) = 0;
+  virtual void processJsonRpcRequest(JsonInputBufferSerializer& req, Common::JsonValue& resp) = 0;
 
 private:
   // HttpServer
@@ -51,7 +51,8 @@ enum NodeErrorCodes {
   NODE_BUSY,
   INTERNAL_NODE_ERROR,
   REQUEST_ERROR,
-  CONNECT_ERROR
+  CONNECT_ERROR,
+  NOT_SUPPORTED
 };
 
 // custom category:
@@ -76,6 +77,7 @@ public:
     case INTERNAL_NODE_ERROR: return "Internal node error";
     case REQUEST_ERROR:       return "Error in request parameters";
     case CONNECT_ERROR:       return "Can't connect to daemon";
+    case NOT_SUPPORTED:       return "Request is not supported by the node";
     default:                  return "Unknown error";
     }
   }
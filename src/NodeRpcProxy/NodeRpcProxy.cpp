@@ -38,6 +38,7 @@
 #include "NodeRpcProxy.h"
 #include "NodeErrors.h"
 
+#include <algorithm>
 #include <atomic>
 #include <system_error>
 #include <thread>
@@ -47,7 +48,7 @@
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
 #include <System/Event.h>
-#include <System/EventLock.h>
+#include <System/InterruptedException.h>
 #include <System/Timer.h>
 #include <CryptoNoteCore/TransactionApi.h>
 
@@ -56,6 +57,7 @@
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Rpc/HttpClient.h"
+#include "Rpc/HttpClientPool.h"
 #include "Rpc/JsonRpc.h"
 
 #ifndef AUTO_VAL_INIT
@@ -70,6 +72,11 @@ namespace CryptoNote {
 
 namespace {
 
+// seconds the node holds a notifications request, below the client request timeout
+const uint32_t NOTIFICATIONS_WAIT_TIMEOUT = 20;
+// bursts of notifications, like while the node syncs, don't refresh the status more often than this
+const std::chrono::milliseconds NOTIFICATIONS_MIN_UPDATE_INTERVAL(1000);
+
 std::error_code interpretResponseStatus(const std::string& status) {
   if (CORE_RPC_STATUS_BUSY == status) {
     return make_error_code(error::NODE_BUSY);
@@ -83,6 +90,7 @@ std::error_code interpretResponseStatus(const std::string& status) {
 
 NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort) :
     m_rpcTimeout(10000),
+    m_syncTimeout(120000),
     m_pullInterval(5000),
     m_nodeHost(nodeHost),
     m_nodePort(nodePort),
@@ -117,6 +125,9 @@ void NodeRpcProxy::resetInternalState() {
   lastLocalBlockHeaderInfo.difficulty = 0;
   lastLocalBlockHeaderInfo.reward = 0;
   m_knownTxs.clear();
+  m_notificationsSupported = true;
+  m_notificationEpoch = 0;
+  m_lastNotificationId = 0;
 }
 
 void NodeRpcProxy::init(const INode::Callback& callback) {
@@ -151,6 +162,10 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    // don't wait for a pending notifications request to time out
+    if (m_pullContextGroup != nullptr) {
+      m_pullContextGroup->interrupt();
+    }
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -169,11 +184,12 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     m_dispatcher = &dispatcher;
     ContextGroup contextGroup(dispatcher);
     m_context_group = &contextGroup;
-    HttpClient httpClient(dispatcher, m_nodeHost, m_nodePort);
+    ContextGroup pullContextGroup(dispatcher);
+    m_pullContextGroup = &pullContextGroup;
+    // requests run in contexts of their own, a pool of connections lets them proceed side by side
+    HttpClientPool httpClient(dispatcher, m_nodeHost, m_nodePort);
+    httpClient.setRequestTimeout(std::chrono::milliseconds(m_rpcTimeout));
     m_httpClient = &httpClient;
-    Event httpEvent(dispatcher);
-    m_httpEvent = &httpEvent;
-    m_httpEvent->set();
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -186,16 +202,30 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
-    contextGroup.spawn([this]() {
-      Timer pullTimer(*m_dispatcher);
-      while (!m_stop) {
-        updateNodeStatus();
-        if (!m_stop) {
-          pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+    pullContextGroup.spawn([this]() {
+      try {
+        Timer pullTimer(*m_dispatcher);
+        while (!m_stop) {
+          auto updateTime = std::chrono::steady_clock::now();
+          updateNodeStatus();
+          if (m_stop) {
+            break;
+          }
+
+          if (waitForNotifications()) {
+            auto elapsed = std::chrono::steady_clock::now() - updateTime;
+            if (elapsed < NOTIFICATIONS_MIN_UPDATE_INTERVAL) {
+              pullTimer.sleep(std::chrono::duration_cast<std::chrono::milliseconds>(NOTIFICATIONS_MIN_UPDATE_INTERVAL - elapsed));
+            }
+          } else if (!m_stop) {
+            pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+          }
         }
+      } catch (InterruptedException&) {
       }
     });
 
+    pullContextGroup.wait();
     contextGroup.wait();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
@@ -204,12 +234,51 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
   m_dispatcher = nullptr;
   m_context_group = nullptr;
+  m_pullContextGroup = nullptr;
   m_httpClient = nullptr;
-  m_httpEvent = nullptr;
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
 
+// Waits until the node reports a change or the wait times out, false when the status has to be polled instead.
+bool NodeRpcProxy::waitForNotifications() {
+  if (!m_notificationsSupported) {
+    return false;
+  }
+
+  COMMAND_RPC_GET_NOTIFICATIONS::request req;
+  req.epoch = m_notificationEpoch;
+  req.since = m_lastNotificationId;
+  req.timeout = NOTIFICATIONS_WAIT_TIMEOUT;
+
+  COMMAND_RPC_GET_NOTIFICATIONS::response rsp;
+  HttpRequest httpReq;
+  HttpResponse httpRes;
+  httpReq.setUrl("/getnotifications.bin");
+  httpReq.setBody(storeToBinaryKeyValue(req));
+  try {
+    // the node holds the request for up to the wait timeout before answering
+    m_httpClient->request(httpReq, httpRes, std::chrono::seconds(NOTIFICATIONS_WAIT_TIMEOUT) + std::chrono::milliseconds(m_rpcTimeout));
+    if (httpRes.getStatus() == HttpResponse::STATUS_404) {
+      m_notificationsSupported = false;
+      return false;
+    }
+
+    // a busy node holds as many requests as it can, poll it instead
+    if (httpRes.getStatus() != HttpResponse::STATUS_200 || !loadFromBinaryKeyValue(rsp, httpRes.getBody()) ||
+        rsp.status != CORE_RPC_STATUS_OK) {
+      return false;
+    }
+  } catch (std::exception&) {
+    return false;
+  }
+
+  // the notifications themselves aren't needed, updateNodeStatus() catches up with whatever changed
+  m_notificationEpoch = rsp.epoch;
+  m_lastNotificationId = rsp.lastId;
+  return true;
+}
+
 void NodeRpcProxy::updateNodeStatus() {
   bool updateBlockchain = true;
   while (updateBlockchain) {
@@ -447,6 +516,18 @@ void NodeRpcProxy::getTransactionOutsGlobalIndices(const Crypto::Hash& transacti
     std::ref(outsGlobalIndices)), callback);
 }
 
+void NodeRpcProxy::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doGetTransactionsOutsGlobalIndices, this, transactionHashes,
+    std::ref(outsGlobalIndices)), callback);
+}
+
 void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
   uint32_t& startHeight, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
@@ -455,7 +536,7 @@ void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64
     return;
   }
 
-  scheduleRequest(std::bind(&NodeRpcProxy::doQueryBlocksLite, this, std::move(knownBlockIds), timestamp,
+  scheduleRequest(std::bind(&NodeRpcProxy::doQueryBlocks, this, std::move(knownBlockIds), timestamp,
           std::ref(newBlocks), std::ref(startHeight)), callback);
 }
 
@@ -595,7 +676,7 @@ std::error_code NodeRpcProxy::doGetNewBlocks(std::vector<Crypto::Hash>& knownBlo
   CryptoNote::COMMAND_RPC_GET_BLOCKS_FAST::response rsp = AUTO_VAL_INIT(rsp);
   req.block_ids = std::move(knownBlockIds);
 
-  std::error_code ec = binaryCommand("/getblocks.bin", req, rsp);
+  std::error_code ec = binaryCommand("/getblocks.bin", req, rsp, m_syncTimeout);
   if (!ec) {
     newBlocks = std::move(rsp.blocks);
     startHeight = static_cast<uint32_t>(rsp.start_height);
@@ -621,6 +702,114 @@ std::error_code NodeRpcProxy::doGetTransactionOutsGlobalIndices(const Crypto::Ha
   return ec;
 }
 
+std::error_code NodeRpcProxy::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                                 std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  outsGlobalIndices.resize(transactionHashes.size());
+
+  if (!m_batchIndicesUnsupported) {
+    // the daemon refuses batches longer than a block query
+    std::error_code ec;
+    for (size_t offset = 0; offset < transactionHashes.size(); offset += COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT) {
+      size_t count = std::min(transactionHashes.size() - offset, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT);
+
+      CryptoNote::COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH::request req = AUTO_VAL_INIT(req);
+      CryptoNote::COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH::response rsp = AUTO_VAL_INIT(rsp);
+      req.txids.assign(transactionHashes.begin() + offset, transactionHashes.begin() + offset + count);
+
+      ec = binaryCommand("/get_o_indexes_batch.bin", req, rsp, m_syncTimeout);
+      if (ec) {
+        break;
+      }
+
+      if (rsp.txs.size() != count) {
+        return make_error_code(error::INTERNAL_NODE_ERROR);
+      }
+
+      for (size_t i = 0; i < count; ++i) {
+        outsGlobalIndices[offset + i] = std::move(rsp.txs[i].o_indexes);
+      }
+    }
+
+    if (ec != make_error_code(error::NOT_SUPPORTED)) {
+      return ec;
+    }
+
+    m_batchIndicesUnsupported = true;
+  }
+
+  // an older daemon doesn't know the batch url, fall back to one request per transaction
+  for (size_t i = 0; i < transactionHashes.size(); ++i) {
+    std::error_code ec = doGetTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices[i]);
+    if (ec) {
+      return ec;
+    }
+  }
+
+  return std::error_code();
+}
+
+std::error_code NodeRpcProxy::doQueryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+        std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
+  if (m_compactSyncUnsupported) {
+    return doQueryBlocksLite(knownBlockIds, timestamp, newBlocks, startHeight);
+  }
+
+  std::error_code ec = doQueryBlocksCompact(knownBlockIds, timestamp, newBlocks, startHeight);
+  if (ec != make_error_code(error::NOT_SUPPORTED)) {
+    return ec;
+  }
+
+  // only an older daemon not knowing the url switches to the lite query, other failures are retried
+  m_compactSyncUnsupported = true;
+  return doQueryBlocksLite(knownBlockIds, timestamp, newBlocks, startHeight);
+}
+
+std::error_code NodeRpcProxy::doQueryBlocksCompact(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+        std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
+  CryptoNote::COMMAND_RPC_QUERY_BLOCKS_COMPACT::request req = AUTO_VAL_INIT(req);
+  CryptoNote::COMMAND_RPC_QUERY_BLOCKS_COMPACT::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.blockIds = knownBlockIds;
+  req.timestamp = timestamp;
+
+  std::error_code ec = binaryCommand("/queryblockscompact.bin", req, rsp, m_syncTimeout);
+  if (ec) {
+    return ec;
+  }
+
+  startHeight = static_cast<uint32_t>(rsp.startHeight);
+
+  for (auto& item: rsp.items) {
+    BlockShortEntry bse;
+    bse.hasBlock = false;
+
+    bse.blockHash = std::move(item.blockId);
+    if (!item.block.empty()) {
+      if (!fromBinaryArray(bse.block, asBinaryArray(item.block))) {
+        return std::make_error_code(std::errc::invalid_argument);
+      }
+
+      bse.hasBlock = true;
+      bse.baseTransactionGlobalIndexes = std::move(item.baseTransactionGlobalIndexes);
+    }
+
+    for (auto& tci: item.transactions) {
+      TransactionShortInfo tsi;
+      tsi.txId = tci.txHash;
+      if (!fromBinaryArray(tsi.txPrefix, asBinaryArray(tci.txPrefix))) {
+        return std::make_error_code(std::errc::invalid_argument);
+      }
+
+      tsi.globalIndexes = std::move(tci.globalIndexes);
+      bse.txsShortInfo.push_back(std::move(tsi));
+    }
+
+    newBlocks.push_back(std::move(bse));
+  }
+
+  return std::error_code();
+}
+
 std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
         std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   CryptoNote::COMMAND_RPC_QUERY_BLOCKS_LITE::request req = AUTO_VAL_INIT(req);
@@ -629,7 +818,7 @@ std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>&
   req.blockIds = knownBlockIds;
   req.timestamp = timestamp;
 
-  std::error_code ec = binaryCommand("/queryblockslite.bin", req, rsp);
+  std::error_code ec = binaryCommand("/queryblockslite.bin", req, rsp, m_syncTimeout);
   if (ec) {
     return ec;
   }
@@ -670,7 +859,7 @@ std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<Crypto::H
   req.tailBlockId = knownBlockId;
   req.knownTxsIds = knownPoolTxIds;
 
-  std::error_code ec = binaryCommand("/get_pool_changes_lite.bin", req, rsp);
+  std::error_code ec = binaryCommand("/get_pool_changes_lite.bin", req, rsp, m_syncTimeout);
 
   if (ec) {
     return ec;
@@ -693,7 +882,7 @@ std::error_code NodeRpcProxy::doGetBlocksByHeight(const std::vector<uint32_t>& b
 
   req.blockHeights = blockHeights;
 
-  std::error_code ec = jsonCommand("/get_blocks_details_by_heights", req, resp);
+  std::error_code ec = jsonCommand("/get_blocks_details_by_heights", req, resp, m_syncTimeout);
   if (ec) {
     return ec;
   }
@@ -710,7 +899,7 @@ std::error_code NodeRpcProxy::doGetBlocksByHash(const std::vector<Crypto::Hash>&
 
   req.blockHashes = blockHashes;
 
-  std::error_code ec = jsonCommand("/get_blocks_details_by_hashes", req, resp);
+  std::error_code ec = jsonCommand("/get_blocks_details_by_hashes", req, resp, m_syncTimeout);
   if (ec) {
     return ec;
   }
@@ -755,7 +944,7 @@ std::error_code NodeRpcProxy::doGetTransactions(const std::vector<Crypto::Hash>&
   COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES::response resp = AUTO_VAL_INIT(resp);
 
   req.transactionHashes = transactionHashes;
-  std::error_code ec = jsonCommand("/get_transaction_details_by_hashes", req, resp);
+  std::error_code ec = jsonCommand("/get_transaction_details_by_hashes", req, resp, m_syncTimeout);
   if (ec) {
     return ec;
   }
@@ -805,12 +994,30 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
 
 template <typename Request, typename Response>
 std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res) {
+  return binaryCommand(url, req, res, m_rpcTimeout);
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res, unsigned int timeout) {
   std::error_code ec;
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeBinaryCommand(*m_httpClient, url, req, res);
-    ec = interpretResponseStatus(res.status);
+    HttpRequest httpReq;
+    HttpResponse httpRes;
+
+    httpReq.setUrl(url);
+    httpReq.setBody(storeToBinaryKeyValue(req));
+
+    m_httpClient->request(httpReq, httpRes, std::chrono::milliseconds(timeout));
+
+    // the daemon answers urls it doesn't know with 404
+    if (httpRes.getStatus() == HttpResponse::STATUS_404) {
+      ec = make_error_code(error::NOT_SUPPORTED);
+    } else if (!loadFromBinaryKeyValue(res, httpRes.getBody())) {
+      ec = make_error_code(error::NETWORK_ERROR);
+    } else {
+      ec = interpretResponseStatus(res.status);
+    }
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
   } catch (const std::exception&) {
@@ -822,11 +1029,31 @@ std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Reques
 
 template <typename Request, typename Response>
 std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res) {
+  return jsonCommand(url, req, res, m_rpcTimeout);
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res, unsigned int timeout) {
   std::error_code ec;
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeJsonCommand(*m_httpClient, url, req, res);
+    HttpRequest httpReq;
+    HttpResponse httpRes;
+
+    httpReq.addHeader("Content-Type", "application/json");
+    httpReq.setUrl(url);
+    httpReq.setBody(storeToJson(req));
+
+    m_httpClient->request(httpReq, httpRes, std::chrono::milliseconds(timeout));
+
+    if (httpRes.getStatus() != HttpResponse::STATUS_200) {
+      throw std::runtime_error("HTTP status: " + std::to_string(httpRes.getStatus()));
+    }
+
+    if (!loadFromJson(res, httpRes.getBody())) {
+      throw std::runtime_error("Failed to parse JSON response");
+    }
+
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
@@ -842,8 +1069,6 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
   std::error_code ec = make_error_code(error::INTERNAL_NODE_ERROR);
 
   try {
-    EventLock eventLock(*m_httpEvent);
-
     JsonRpc::JsonRpcRequest jsReq;
 
     jsReq.setMethod(method);
@@ -862,8 +1087,11 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
 
     if (httpRes.getStatus() == HttpResponse::STATUS_200) {
       jsRes.parse(httpRes.getBody());
+      JsonRpc::JsonRpcError jsError;
       if (jsRes.getResult(res)) {
         ec = interpretResponseStatus(res.status);
+      } else if (jsRes.getError(jsError) && jsError.code == JsonRpc::errMethodNotFound) {
+        ec = make_error_code(error::NOT_SUPPORTED);
       }
     }
   } catch (const ConnectException&) {
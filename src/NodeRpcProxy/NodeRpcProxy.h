@@ -57,7 +57,7 @@ namespace System {
 
 namespace CryptoNote {
 
-class HttpClient;
+class HttpClientPool;
 
 class INodeRpcProxyObserver {
 public:
@@ -94,6 +94,7 @@ public:
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override;
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<CryptoNote::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override;
@@ -111,6 +112,9 @@ public:
 
   unsigned int rpcTimeout() const { return m_rpcTimeout; }
   void rpcTimeout(unsigned int val) { m_rpcTimeout = val; }
+  // timeout of the bulk calls the wallet syncs with, their responses can be much larger than the others
+  unsigned int syncTimeout() const { return m_syncTimeout; }
+  void syncTimeout(unsigned int val) { m_syncTimeout = val; }
 
   const std::string m_nodeHost;
   const unsigned short m_nodePort;
@@ -122,6 +126,7 @@ private:
   std::vector<Crypto::Hash> getKnownTxsVector() const;
   void pullNodeStatusAndScheduleTheNext();
   void updateNodeStatus();
+  bool waitForNotifications();
   void updateBlockchainStatus();
   bool updatePoolStatus();
   void updatePeerCount(size_t peerCount);
@@ -134,6 +139,12 @@ private:
     std::vector<CryptoNote::block_complete_entry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash,
                                                     std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                     std::vector<std::vector<uint32_t>>& outsGlobalIndices);
+  std::error_code doQueryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+    std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight);
+  std::error_code doQueryBlocksCompact(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
+    std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight);
   std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
     std::vector<CryptoNote::BlockShortEntry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
@@ -148,8 +159,12 @@ private:
   template <typename Request, typename Response>
   std::error_code binaryCommand(const std::string& url, const Request& req, Response& res);
   template <typename Request, typename Response>
+  std::error_code binaryCommand(const std::string& url, const Request& req, Response& res, unsigned int timeout);
+  template <typename Request, typename Response>
   std::error_code jsonCommand(const std::string& url, const Request& req, Response& res);
   template <typename Request, typename Response>
+  std::error_code jsonCommand(const std::string& url, const Request& req, Response& res, unsigned int timeout);
+  template <typename Request, typename Response>
   std::error_code jsonRpcCommand(const std::string& method, const Request& req, Response& res);
 
   enum State {
@@ -165,12 +180,13 @@ private:
   std::thread m_workerThread;
   System::Dispatcher* m_dispatcher = nullptr;
   System::ContextGroup* m_context_group = nullptr;
+  System::ContextGroup* m_pullContextGroup = nullptr;
   Tools::ObserverManager<CryptoNote::INodeObserver> m_observerManager;
   Tools::ObserverManager<CryptoNote::INodeRpcProxyObserver> m_rpcProxyObserverManager;
 
   unsigned int m_rpcTimeout;
-  HttpClient* m_httpClient = nullptr;
-  System::Event* m_httpEvent = nullptr;
+  unsigned int m_syncTimeout;
+  HttpClientPool* m_httpClient = nullptr;
 
   uint64_t m_pullInterval;
 
@@ -187,6 +203,15 @@ private:
 
   bool m_connected;
   std::string m_fee_address;
+
+  // daemons without /queryblockscompact.bin are synced through /queryblockslite.bin
+  bool m_compactSyncUnsupported = false;
+  // status is refreshed on node notifications, polled every m_pullInterval from daemons without them
+  bool m_notificationsSupported = true;
+  uint64_t m_notificationEpoch = 0;
+  uint64_t m_lastNotificationId = 0;
+  // daemons without /get_o_indexes_batch.bin are asked one transaction at a time
+  bool m_batchIndicesUnsupported = false;
 };
 
 }
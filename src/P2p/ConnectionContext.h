@@ -37,9 +37,11 @@
 
 #pragma once
 
+#include <deque>
 #include <list>
 #include <ostream>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/uuid/uuid.hpp>
 #include "Common/StringTools.h"
@@ -70,6 +72,11 @@ struct CryptoNoteConnectionContext {
   std::unordered_set<Crypto::Hash> m_requested_objects;
   uint32_t m_remote_blockchain_height = 0;
   uint32_t m_last_response_height = 0;
+  // transactions the peer is known to have, oldest first in m_known_txs_order
+  std::unordered_set<Crypto::Hash> m_known_txs;
+  std::deque<Crypto::Hash> m_known_txs_order;
+  // transactions announced to the peer with the next NOTIFY_TX_INV
+  std::vector<Crypto::Hash> m_tx_announcements;
 // by CROAT
   uint32_t msg2006 = 0;
   uint32_t msg2007 = 0;
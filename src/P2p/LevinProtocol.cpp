@@ -36,6 +36,8 @@
 
 
 #include "LevinProtocol.h"
+#include <algorithm>
+#include <cassert>
 #include <System/TcpConnection.h>
 
 using namespace CryptoNote;
@@ -47,6 +49,9 @@ const uint32_t LEVIN_PACKET_REQUEST = 0x00000001;
 const uint32_t LEVIN_PACKET_RESPONSE = 0x00000002;
 const uint32_t LEVIN_DEFAULT_MAX_PACKET_SIZE = 100000000;      //100MB by default
 const uint32_t LEVIN_PROTOCOL_VER_1 = 1;
+const size_t LEVIN_READ_BUFFER_SIZE = 64 * 1024;
+// a body buffer grown past this by a big message is released once a small one follows
+const size_t LEVIN_MAX_RETAINED_BODY_SIZE = 1024 * 1024;
 
 #pragma pack(push)
 #pragma pack(1)
@@ -68,10 +73,43 @@ bool LevinProtocol::Command::needReply() const {
   return !(isNotify || isResponse);
 }
 
-LevinProtocol::LevinProtocol(System::TcpConnection& connection) 
-  : m_conn(connection) {}
+LevinProtocol::LevinProtocol(System::TcpConnection& connection, ReadBuffer* readBuffer)
+  : m_conn(connection), m_readBuffer(readBuffer) {}
 
 void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
+  // write header and body in one operation
+  sendFrame(encodeMessage(command, out, needResponse));
+}
+
+void LevinProtocol::sendFrame(const BinaryArray& frame) {
+  writeStrict(frame.data(), frame.size());
+}
+
+void LevinProtocol::sendFrames(const std::vector<const BinaryArray*>& frames) {
+  std::vector<System::ConstIoBuffer> buffers;
+  buffers.reserve(frames.size());
+  for (auto frame : frames) {
+    if (!frame->empty()) {
+      buffers.push_back({ frame->data(), frame->size() });
+    }
+  }
+
+  size_t first = 0;
+  while (first < buffers.size()) {
+    size_t written = m_conn.write(&buffers[first], buffers.size() - first);
+    while (first < buffers.size() && written >= buffers[first].size) {
+      written -= buffers[first].size;
+      ++first;
+    }
+
+    if (written != 0) {
+      buffers[first].data += written;
+      buffers[first].size -= written;
+    }
+  }
+}
+
+BinaryArray LevinProtocol::encodeMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
   bucket_head2 head = { 0 };
   head.m_signature = LEVIN_SIGNATURE;
   head.m_cb = out.size();
@@ -80,21 +118,42 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
+  BinaryArray frame;
+  frame.reserve(sizeof(head) + out.size());
 
-  Common::VectorOutputStream stream(writeBuffer);
+  Common::VectorOutputStream stream(frame);
   stream.writeSome(&head, sizeof(head));
   stream.writeSome(out.data(), out.size());
+  return frame;
+}
 
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+BinaryArray LevinProtocol::encodeReply(uint32_t command, const BinaryArray& out, int32_t returnCode) {
+  bucket_head2 head = { 0 };
+  head.m_signature = LEVIN_SIGNATURE;
+  head.m_cb = out.size();
+  head.m_have_to_return_data = false;
+  head.m_command = command;
+  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
+  head.m_flags = LEVIN_PACKET_RESPONSE;
+  head.m_return_code = returnCode;
+
+  BinaryArray frame;
+  frame.reserve(sizeof(head) + out.size());
+
+  Common::VectorOutputStream stream(frame);
+  stream.writeSome(&head, sizeof(head));
+  stream.writeSome(out.data(), out.size());
+  return frame;
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
   bucket_head2 head = { 0 };
 
-  if (!readStrict(reinterpret_cast<uint8_t*>(&head), sizeof(head))) {
+  if (m_readBuffer != nullptr) {
+    if (!readBuffered(reinterpret_cast<uint8_t*>(&head), sizeof(head))) {
+      return false;
+    }
+  } else if (!readStrict(reinterpret_cast<uint8_t*>(&head), sizeof(head))) {
     return false;
   }
 
@@ -106,17 +165,20 @@ bool LevinProtocol::readCommand(Command& cmd) {
     throw std::runtime_error("Levin packet size is too big");
   }
 
-  BinaryArray buf;
+  // the body reuses the storage of the previous command
+  if (cmd.buf.capacity() > LEVIN_MAX_RETAINED_BODY_SIZE && head.m_cb <= LEVIN_MAX_RETAINED_BODY_SIZE) {
+    BinaryArray().swap(cmd.buf);
+  }
 
+  cmd.buf.resize(head.m_cb);
   if (head.m_cb != 0) {
-    buf.resize(head.m_cb);
-    if (!readStrict(&buf[0], head.m_cb)) {
+    bool read = m_readBuffer != nullptr ? readBuffered(&cmd.buf[0], head.m_cb) : readStrict(&cmd.buf[0], head.m_cb);
+    if (!read) {
       return false;
     }
   }
 
   cmd.command = head.m_command;
-  cmd.buf = std::move(buf);
   cmd.isNotify = !head.m_have_to_return_data;
   cmd.isResponse = (head.m_flags & LEVIN_PACKET_RESPONSE) == LEVIN_PACKET_RESPONSE;
 
@@ -124,23 +186,7 @@ bool LevinProtocol::readCommand(Command& cmd) {
 }
 
 void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode) {
-  bucket_head2 head = { 0 };
-  head.m_signature = LEVIN_SIGNATURE;
-  head.m_cb = out.size();
-  head.m_have_to_return_data = false;
-  head.m_command = command;
-  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-  head.m_flags = LEVIN_PACKET_RESPONSE;
-  head.m_return_code = returnCode;
-
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  sendFrame(encodeReply(command, out, returnCode));
 }
 
 void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
@@ -150,6 +196,44 @@ void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
   }
 }
 
+bool LevinProtocol::readBuffered(uint8_t* ptr, size_t size) {
+  ReadBuffer& buffer = *m_readBuffer;
+  if (buffer.data.size() != LEVIN_READ_BUFFER_SIZE) {
+    buffer.data.resize(LEVIN_READ_BUFFER_SIZE);
+  }
+
+  size_t offset = std::min(size, buffer.end - buffer.begin);
+  std::copy(buffer.data.begin() + buffer.begin, buffer.data.begin() + buffer.begin + offset, ptr);
+  buffer.begin += offset;
+  if (buffer.begin == buffer.end) {
+    buffer.begin = 0;
+    buffer.end = 0;
+  }
+
+  // read the rest straight into the destination and whatever follows it into the buffer, in one call
+  while (offset < size) {
+    assert(buffer.begin == 0 && buffer.end == 0);
+    System::IoBuffer buffers[] = {
+      { ptr + offset, size - offset },
+      { buffer.data.data(), buffer.data.size() }
+    };
+
+    size_t read = m_conn.read(buffers, 2);
+    if (read == 0) {
+      return false;
+    }
+
+    if (read > size - offset) {
+      buffer.end = read - (size - offset);
+      read = size - offset;
+    }
+
+    offset += read;
+  }
+
+  return true;
+}
+
 bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
   size_t offset = 0;
   while (offset < size) {
@@ -37,6 +37,7 @@
 
 #pragma once
 
+#include <vector>
 #include "CryptoNote.h"
 #include <Common/MemoryInputStream.h>
 #include <Common/VectorOutputStream.h>
@@ -65,7 +66,16 @@ const int32_t LEVIN_PROTOCOL_RETCODE_SUCCESS = 1;
 class LevinProtocol {
 public:
 
-  LevinProtocol(System::TcpConnection& connection);
+  // Bytes read ahead from a connection. It belongs to the connection, so every LevinProtocol used on it
+  // sees them, and is reused for all of its messages.
+  struct ReadBuffer {
+    BinaryArray data;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  // without a read buffer exactly one message is read at a time
+  LevinProtocol(System::TcpConnection& connection, ReadBuffer* readBuffer = nullptr);
 
   template <typename Request, typename Response>
   bool invoke(uint32_t command, const Request& request, Response& response) {
@@ -99,12 +109,19 @@ public:
 
   void sendMessage(uint32_t command, const BinaryArray& out, bool needResponse);
   void sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
+  // writes a frame built by encodeMessage or encodeReply
+  void sendFrame(const BinaryArray& frame);
+  // writes several frames with as few system calls as possible
+  void sendFrames(const std::vector<const BinaryArray*>& frames);
+
+  // header and body of a message, ready to be written to any number of connections
+  static BinaryArray encodeMessage(uint32_t command, const BinaryArray& out, bool needResponse);
+  static BinaryArray encodeReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
 
   template <typename T>
   static bool decode(const BinaryArray& buf, T& value) {
     try {
-      Common::MemoryInputStream stream(buf.data(), buf.size());
-      KVBinaryInputStreamSerializer serializer(stream);
+      KVBinaryInputStreamSerializer serializer(buf.data(), buf.size());
       serialize(value, serializer);
     } catch (std::exception&) {
       return false;
@@ -118,16 +135,17 @@ public:
     BinaryArray result;
     KVBinaryOutputStreamSerializer serializer;
     serialize(const_cast<T&>(value), serializer);
-    Common::VectorOutputStream stream(result);
-    serializer.dump(stream);
+    serializer.dump(result);
     return result;
   }
 
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
+  bool readBuffered(uint8_t* ptr, size_t size);
   void writeStrict(const uint8_t* ptr, size_t size);
   System::TcpConnection& m_conn;
+  ReadBuffer* m_readBuffer;
 };
 
 }
@@ -41,6 +41,7 @@
 #include <fstream>
 #include <ctime>
 
+#include <boost/bind/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -169,52 +170,6 @@ namespace CryptoNote
   }
 
 
-  //-----------------------------------------------------------------------------------
-  // P2pConnectionContext implementation
-  //-----------------------------------------------------------------------------------
-
-  bool P2pConnectionContext::pushMessage(P2pMessage&& msg) {
-    writeQueueSize += msg.size();
-
-    if (writeQueueSize > P2P_CONNECTION_MAX_WRITE_BUFFER_SIZE) {
-      logger(DEBUGGING) << *this << "Write queue overflows. Interrupt connection";
-      interrupt();
-      return false;
-    }
-
-    writeQueue.push_back(std::move(msg));
-    queueEvent.set();
-    return true;
-  }
-
-  std::vector<P2pMessage> P2pConnectionContext::popBuffer() {
-    writeOperationStartTime = TimePoint();
-
-    while (writeQueue.empty() && !stopped) {
-      queueEvent.wait();
-    }
-
-    std::vector<P2pMessage> msgs(std::move(writeQueue));
-    writeQueue.clear();
-    writeQueueSize = 0;
-    writeOperationStartTime = Clock::now();
-    queueEvent.clear();
-    return msgs;
-  }
-
-  uint64_t P2pConnectionContext::writeDuration(TimePoint now) const { // in milliseconds
-    return writeOperationStartTime == TimePoint() ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(now - writeOperationStartTime).count();
-  }
-
-  void P2pConnectionContext::interrupt() {
-    logger(DEBUGGING) << *this << "Interrupt connection";
-    assert(context != nullptr);
-    stopped = true;
-    queueEvent.set();
-    context->interrupt();
-  }
-
-
   template <typename Command, typename Handler>
   int invokeAdaptor(const BinaryArray& reqBuf, BinaryArray& resBuf, P2pConnectionContext& ctx, Handler handler) {
     typedef typename Command::request Request;
@@ -249,7 +204,8 @@ namespace CryptoNote
     // intervals
     // m_peer_handshake_idle_maker_interval(CryptoNote::P2P_DEFAULT_HANDSHAKE_INTERVAL),
     m_connections_maker_interval(1),
-    m_peerlist_store_interval(60*30, false) {
+    m_peerlist_store_interval(60*30, false),
+    m_peerlist_refresh_interval(60) {
   }
 
   void NodeServer::serialize(ISerializer& s) {
@@ -364,8 +320,20 @@ namespace CryptoNote
 
   //----------------------------------------------------------------------------------- 
   void NodeServer::externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
-    m_dispatcher.remoteSpawn([this, command, data_buff, excludeConnection] {
-      relay_notify_to_all(command, data_buff, excludeConnection);
+    // the frame is encoded once on the calling thread and shared by every connection's write queue
+    auto frame = std::make_shared<const BinaryArray>(LevinProtocol::encodeMessage(command, data_buff, false));
+    net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    m_dispatcher.remoteSpawn([this, command, frame, excludeId] {
+      relayFrameToAll(command, frame, excludeId);
+    });
+  }
+
+  void NodeServer::externalRelayNotifyToPeers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+    uint8_t minVersion, uint8_t maxVersion) {
+    auto frame = std::make_shared<const BinaryArray>(LevinProtocol::encodeMessage(command, data_buff, false));
+    net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    m_dispatcher.remoteSpawn([this, command, frame, excludeId, minVersion, maxVersion] {
+      relayFrameToAll(command, frame, excludeId, minVersion, maxVersion);
     });
   }
 
@@ -621,6 +589,7 @@ namespace CryptoNote
     m_workingContextGroup.spawn(std::bind(&NodeServer::onIdle, this));
     m_workingContextGroup.spawn(std::bind(&NodeServer::timedSyncLoop, this));
     m_workingContextGroup.spawn(std::bind(&NodeServer::timeoutLoop, this));
+    m_workingContextGroup.spawn(std::bind(&CryptoNoteProtocolHandler::importLoop, &m_payload_handler));
 
     m_stopEvent.wait();
 
@@ -920,7 +889,7 @@ namespace CryptoNote
 
       try {
         System::Context<bool> handshakeContext(m_dispatcher, [&] {
-          CryptoNote::LevinProtocol proto(ctx.connection);
+          CryptoNote::LevinProtocol proto(ctx.connection, &ctx.readBuffer);
           return handshake(proto, ctx, just_take_peerlist);
         });
 
@@ -995,8 +964,10 @@ namespace CryptoNote
 
       tried_peers.insert(random_index);
       PeerlistEntry pe = boost::value_initialized<PeerlistEntry>();
+      // false for a peer removed since the last peerlist refresh
       bool r = use_white_list ? m_peerlist.get_white_peer_by_index(pe, random_index):m_peerlist.get_gray_peer_by_index(pe, random_index);
-      if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to get random peer from peerlist(white:" << use_white_list << ")"; return false; }
+      if (!r)
+        continue;
 
       ++try_count;
 
@@ -1107,6 +1078,7 @@ namespace CryptoNote
     try {
       m_connections_maker_interval.call(std::bind(&NodeServer::connections_maker, this));
       m_peerlist_store_interval.call(std::bind(&NodeServer::store_config, this));
+      m_peerlist_refresh_interval.call([this] { m_peerlist.refresh(); return true; });
     } catch (std::exception& e) {
       logger(DEBUGGING) << "exception in idle_worker: " << e.what();
     }
@@ -1252,12 +1224,16 @@ namespace CryptoNote
   
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    relayFrameToAll(command, std::make_shared<const BinaryArray>(LevinProtocol::encodeMessage(command, data_buff, false)), excludeId);
+  }
 
+  void NodeServer::relayFrameToAll(int command, const std::shared_ptr<const BinaryArray>& frame, net_connection_id excludeId,
+    uint8_t minVersion, uint8_t maxVersion) {
     forEachConnection([&](P2pConnectionContext& conn) {
-      if (conn.peerId && conn.m_connection_id != excludeId &&
+      if (conn.peerId && conn.m_connection_id != excludeId && conn.version >= minVersion && conn.version <= maxVersion &&
           (conn.m_state == CryptoNoteConnectionContext::state_normal ||
            conn.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, frame));
       }
     });
   }
@@ -1330,7 +1306,7 @@ namespace CryptoNote
 
     //fill response
     rsp.local_time = time(NULL);
-    m_peerlist.get_peerlist_head(rsp.local_peerlist);
+    rsp.local_peerlist_blob = m_peerlist.get_peerlist_head_blob();
     m_payload_handler.get_payload_sync_data(rsp.payload_data);
     logger(Logging::TRACE) << context << "COMMAND_TIMED_SYNC";
     return 1;
@@ -1436,7 +1412,7 @@ namespace CryptoNote
     }
 
     //fill response
-    m_peerlist.get_peerlist_head(rsp.local_peerlist);
+    rsp.local_peerlist_blob = m_peerlist.get_peerlist_head_blob();
     get_local_node_data(rsp.node_data);
     m_payload_handler.get_payload_sync_data(rsp.payload_data);
 
@@ -1630,7 +1606,7 @@ namespace CryptoNote
       try {
         on_connection_new(ctx);
 
-        LevinProtocol proto(ctx.connection);
+        LevinProtocol proto(ctx.connection, &ctx.readBuffer);
         LevinProtocol::Command cmd;
 
         for (;;) {
@@ -1693,28 +1669,7 @@ namespace CryptoNote
     try {
       LevinProtocol proto(ctx.connection);
 
-      for (;;) {
-        auto msgs = ctx.popBuffer();
-        if (msgs.empty()) {
-          break;
-        }
-
-        for (const auto& msg : msgs) {
-          logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
-          switch (msg.type) {
-          case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
-            break;
-          case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
-            break;
-          case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
-            break;
-          default:
-            assert(false);
-          }
-        }
+      while (ctx.sendQueuedMessages(proto)) {
       }
     } catch (System::InterruptedException&) {
       // connection stopped
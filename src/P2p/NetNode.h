@@ -38,6 +38,8 @@
 #pragma once
 
 #include <functional>
+#include <limits>
+#include <memory>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
@@ -59,6 +61,7 @@
 #include "LevinProtocol.h"
 #include "NetNodeCommon.h"
 #include "NetNodeConfig.h"
+#include "P2pConnectionContext.h"
 #include "P2pProtocolDefinitions.h"
 #include "P2pNetworks.h"
 #include "PeerListManager.h"
@@ -72,74 +75,6 @@ namespace CryptoNote
   class LevinProtocol;
   class ISerializer;
 
-  struct P2pMessage {
-    enum Type {
-      COMMAND,
-      REPLY,
-      NOTIFY
-    };
-
-    P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
-      type(type), command(command), buffer(buffer), returnCode(returnCode) {
-    }
-
-    P2pMessage(P2pMessage&& msg) :
-      type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
-    }
-
-    size_t size() {
-      return buffer.size();
-    }
-
-    Type type;
-    uint32_t command;
-    const BinaryArray buffer;
-    int32_t returnCode;
-  };
-
-  struct P2pConnectionContext : public CryptoNoteConnectionContext {
-  public:
-    using Clock = std::chrono::steady_clock;
-    using TimePoint = Clock::time_point;
-
-    System::Context<void>* context;
-    PeerIdType peerId;
-    System::TcpConnection connection;
-
-    P2pConnectionContext(System::Dispatcher& dispatcher, Logging::ILogger& log, System::TcpConnection&& conn) :
-      context(nullptr),
-      peerId(0),
-      connection(std::move(conn)),
-      logger(log, "node_server"),
-      queueEvent(dispatcher),
-      stopped(false) {
-    }
-
-    P2pConnectionContext(P2pConnectionContext&& ctx) : 
-      CryptoNoteConnectionContext(std::move(ctx)),
-      context(ctx.context),
-      peerId(ctx.peerId),
-      connection(std::move(ctx.connection)),
-      logger(ctx.logger.getLogger(), "node_server"),
-      queueEvent(std::move(ctx.queueEvent)),
-      stopped(std::move(ctx.stopped)) {
-    }
-
-    bool pushMessage(P2pMessage&& msg);
-    std::vector<P2pMessage> popBuffer();
-    void interrupt();
-
-    uint64_t writeDuration(TimePoint now) const;
-
-  private:
-    Logging::LoggerRef logger;
-    TimePoint writeOperationStartTime;
-    System::Event queueEvent;
-    std::vector<P2pMessage> writeQueue;
-    size_t writeQueueSize = 0;
-    bool stopped;
-  };
-
   class NodeServer :  public IP2pEndpoint
   {
   public:
@@ -196,6 +131,9 @@ namespace CryptoNote
     bool handleTimedSyncResponse(const BinaryArray& in, P2pConnectionContext& context);
     void forEachConnection(std::function<void(P2pConnectionContext&)> action);
 
+    void relayFrameToAll(int command, const std::shared_ptr<const BinaryArray>& frame, net_connection_id excludeId,
+      uint8_t minVersion = 0, uint8_t maxVersion = std::numeric_limits<uint8_t>::max());
+
     void on_connection_new(P2pConnectionContext& context);
     void on_connection_close(P2pConnectionContext& context);
 
@@ -205,6 +143,8 @@ namespace CryptoNote
     virtual void drop_connection(CryptoNoteConnectionContext& context, bool add_fail) override;
     virtual void for_each_connection(std::function<void(CryptoNote::CryptoNoteConnectionContext&, PeerIdType)> f) override;
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
+    virtual void externalRelayNotifyToPeers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+      uint8_t minVersion, uint8_t maxVersion) override;
 
     //-----------------------------------------------------------------------------------------------
     bool add_host_fail(const uint32_t address_ip);
@@ -287,6 +227,7 @@ namespace CryptoNote
     // OnceInInterval m_peer_handshake_idle_maker_interval;
     OnceInInterval m_connections_maker_interval;
     OnceInInterval m_peerlist_store_interval;
+    OnceInInterval m_peerlist_refresh_interval;
     System::Timer m_timedSyncTimer;
 
     std::string m_bind_ip;
@@ -56,6 +56,9 @@ namespace CryptoNote {
     virtual void for_each_connection(std::function<void(CryptoNote::CryptoNoteConnectionContext&, PeerIdType)> f) = 0;
     // can be called from external threads
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) = 0;
+    // relays only to peers whose protocol version is in [minVersion, maxVersion], can be called from external threads
+    virtual void externalRelayNotifyToPeers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+      uint8_t minVersion, uint8_t maxVersion) = 0;
   };
 
   struct p2p_endpoint_stub: public IP2pEndpoint {
@@ -68,5 +71,7 @@ namespace CryptoNote {
     virtual void for_each_connection(std::function<void(CryptoNote::CryptoNoteConnectionContext&, PeerIdType)> f) override {}
     virtual uint64_t get_connections_count() override { return 0; }   
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override {}
+    virtual void externalRelayNotifyToPeers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+      uint8_t minVersion, uint8_t maxVersion) override {}
   };
 }
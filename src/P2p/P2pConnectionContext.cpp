@@ -0,0 +1,107 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "P2pConnectionContext.h"
+
+#include <cassert>
+
+#include "CryptoNoteConfig.h"
+
+using namespace Logging;
+
+namespace CryptoNote
+{
+  bool P2pConnectionContext::pushMessage(P2pMessage&& msg) {
+    writeQueueSize += msg.size();
+
+    if (writeQueueSize > P2P_CONNECTION_MAX_WRITE_BUFFER_SIZE) {
+      logger(DEBUGGING) << *this << "Write queue overflows. Interrupt connection";
+      interrupt();
+      return false;
+    }
+
+    writeQueue.push_back(std::move(msg));
+    queueEvent.set();
+    return true;
+  }
+
+  std::vector<P2pMessage> P2pConnectionContext::popBuffer() {
+    writeOperationStartTime = TimePoint();
+
+    while (writeQueue.empty() && !stopped) {
+      queueEvent.wait();
+    }
+
+    std::vector<P2pMessage> msgs(std::move(writeQueue));
+    writeQueue.clear();
+    writeQueueSize = 0;
+    writeOperationStartTime = Clock::now();
+    queueEvent.clear();
+    return msgs;
+  }
+
+  bool P2pConnectionContext::sendQueuedMessages(LevinProtocol& proto) {
+    auto msgs = popBuffer();
+    if (msgs.empty()) {
+      return false;
+    }
+
+    // everything queued so far goes out in one write
+    std::vector<const BinaryArray*> frames;
+    frames.reserve(msgs.size());
+    for (const auto& msg : msgs) {
+      logger(DEBUGGING) << *this << "msg " << msg.type << ':' << msg.command;
+      frames.push_back(msg.frame.get());
+    }
+
+    proto.sendFrames(frames);
+    return true;
+  }
+
+  uint64_t P2pConnectionContext::writeDuration(TimePoint now) const { // in milliseconds
+    return writeOperationStartTime == TimePoint() ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(now - writeOperationStartTime).count();
+  }
+
+  void P2pConnectionContext::interrupt() {
+    logger(DEBUGGING) << *this << "Interrupt connection";
+    assert(context != nullptr);
+    stopped = true;
+    queueEvent.set();
+    context->interrupt();
+  }
+
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <System/Context.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/TcpConnection.h>
+
+#include "Logging/LoggerRef.h"
+
+#include "ConnectionContext.h"
+#include "LevinProtocol.h"
+#include "P2pProtocolTypes.h"
+
+namespace CryptoNote
+{
+  struct P2pMessage {
+    enum Type {
+      COMMAND,
+      REPLY,
+      NOTIFY
+    };
+
+    P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
+      type(type), command(command), frame(std::make_shared<const BinaryArray>(type == REPLY ?
+        LevinProtocol::encodeReply(command, buffer, returnCode) :
+        LevinProtocol::encodeMessage(command, buffer, type == COMMAND))) {
+    }
+
+    // frame is shared between all connections a message is relayed to
+    P2pMessage(Type type, uint32_t command, const std::shared_ptr<const BinaryArray>& frame) :
+      type(type), command(command), frame(frame) {
+    }
+
+    size_t size() {
+      return frame->size();
+    }
+
+    Type type;
+    uint32_t command;
+    std::shared_ptr<const BinaryArray> frame;
+  };
+
+  struct P2pConnectionContext : public CryptoNoteConnectionContext {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    System::Context<void>* context;
+    PeerIdType peerId;
+    System::TcpConnection connection;
+    LevinProtocol::ReadBuffer readBuffer;
+
+    P2pConnectionContext(System::Dispatcher& dispatcher, Logging::ILogger& log, System::TcpConnection&& conn) :
+      context(nullptr),
+      peerId(0),
+      connection(std::move(conn)),
+      logger(log, "node_server"),
+      queueEvent(dispatcher),
+      stopped(false) {
+    }
+
+    P2pConnectionContext(P2pConnectionContext&& ctx) : 
+      CryptoNoteConnectionContext(std::move(ctx)),
+      context(ctx.context),
+      peerId(ctx.peerId),
+      connection(std::move(ctx.connection)),
+      readBuffer(std::move(ctx.readBuffer)),
+      logger(ctx.logger.getLogger(), "node_server"),
+      queueEvent(std::move(ctx.queueEvent)),
+      stopped(std::move(ctx.stopped)) {
+    }
+
+    bool pushMessage(P2pMessage&& msg);
+    std::vector<P2pMessage> popBuffer();
+    // waits for queued messages and writes all of them at once, false once the connection is stopped
+    bool sendQueuedMessages(LevinProtocol& proto);
+    void interrupt();
+
+    uint64_t writeDuration(TimePoint now) const;
+
+  private:
+    Logging::LoggerRef logger;
+    TimePoint writeOperationStartTime;
+    System::Event queueEvent;
+    std::vector<P2pMessage> writeQueue;
+    size_t writeQueueSize = 0;
+    bool stopped;
+  };
+
+}
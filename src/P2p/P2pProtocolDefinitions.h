@@ -75,7 +75,9 @@ namespace CryptoNote
   enum P2PProtocolVersion : uint8_t {
     V0 = 0,
     V1 = 1,
-    CURRENT = V1
+    V2 = 2,  // takes NOTIFY_NEW_COMPACT_BLOCK
+    V3 = 3,  // takes NOTIFY_TX_INV instead of NOTIFY_NEW_TRANSACTIONS for relayed transactions
+    CURRENT = V3
   };
 
   struct basic_node_data
@@ -136,12 +138,18 @@ namespace CryptoNote
     {
       basic_node_data node_data;
       CORE_SYNC_DATA payload_data;
-      std::list<PeerlistEntry> local_peerlist; 
+      std::list<PeerlistEntry> local_peerlist;
+      // if set, sent instead of local_peerlist
+      std::string local_peerlist_blob;
 
       void serialize(ISerializer& s) {
         KV_MEMBER(node_data)
         KV_MEMBER(payload_data)
-        serializeAsBinary(local_peerlist, "local_peerlist", s);
+        if (s.type() == ISerializer::OUTPUT && !local_peerlist_blob.empty()) {
+          s.binary(local_peerlist_blob, "local_peerlist");
+        } else {
+          serializeAsBinary(local_peerlist, "local_peerlist", s);
+        }
       }
     };
   };
@@ -169,11 +177,17 @@ namespace CryptoNote
       uint64_t local_time;
       CORE_SYNC_DATA payload_data;
       std::list<PeerlistEntry> local_peerlist;
+      // if set, sent instead of local_peerlist
+      std::string local_peerlist_blob;
 
       void serialize(ISerializer& s) {
         KV_MEMBER(local_time)
         KV_MEMBER(payload_data)
-        serializeAsBinary(local_peerlist, "local_peerlist", s);
+        if (s.type() == ISerializer::OUTPUT && !local_peerlist_blob.empty()) {
+          s.binary(local_peerlist_blob, "local_peerlist");
+        } else {
+          serializeAsBinary(local_peerlist, "local_peerlist", s);
+        }
       }
     };
   };
@@ -38,6 +38,7 @@
 #pragma once
 
 #include <string.h>
+#include <functional>
 #include <tuple>
 #include <boost/uuid/uuid.hpp>
 #include "android.h"
@@ -94,3 +95,14 @@ namespace CryptoNote
   }
 
 }
+
+namespace std {
+
+template<>
+struct hash<CryptoNote::NetworkAddress> {
+  size_t operator()(const CryptoNote::NetworkAddress& na) const {
+    return hash<uint64_t>()(static_cast<uint64_t>(na.ip) << 32 | na.port);
+  }
+};
+
+}
@@ -37,8 +37,8 @@
 
 #include "PeerListManager.h"
 
+#include <algorithm>
 #include <time.h>
-#include <boost/foreach.hpp>
 #include <System/Ipv4Address.h>
 
 #include "Serialization/SerializationOverloads.h"
@@ -46,17 +46,6 @@
 using namespace CryptoNote;
 
 namespace CryptoNote {
-  template <typename T, typename Indexes>
-  bool serialize(boost::multi_index_container<T, Indexes>& value, Common::StringView name, ISerializer& s) {
-    if (s.type() == ISerializer::INPUT) {
-      readSequence<T>(std::inserter(value, value.end()), name, s);
-    } else {
-      writeSequence<T>(value.begin(), value.end(), name, s);
-    }
-
-    return true;
-  }
-
   void serialize(NetworkAddress& na, ISerializer& s) {
     s(na.ip, "ip");
     s(na.port, "port");
@@ -70,8 +59,8 @@ namespace CryptoNote {
 
 }
 
-PeerlistManager::Peerlist::Peerlist(peers_indexed& peers, size_t maxSize) :
-  m_peers(peers), m_maxSize(maxSize) {
+PeerlistManager::Peerlist::Peerlist(size_t maxSize) :
+  m_maxSize(maxSize) {
 }
 
 void PeerlistManager::serialize(ISerializer& s) {
@@ -84,8 +73,12 @@ void PeerlistManager::serialize(ISerializer& s) {
     return;
   }
 
-  s(m_peers_white, "whitelist");
-  s(m_peers_gray, "graylist");
+  m_whitePeerlist.serialize("whitelist", s);
+  m_grayPeerlist.serialize("graylist", s);
+
+  if (s.type() == ISerializer::INPUT) {
+    refresh();
+  }
 }
 
 size_t PeerlistManager::Peerlist::count() const {
@@ -93,28 +86,118 @@ size_t PeerlistManager::Peerlist::count() const {
 }
 
 bool PeerlistManager::Peerlist::get(PeerlistEntry& entry, size_t i) const {
-  if (i >= m_peers.size())
+  if (i >= m_byTime.size())
     return false;
 
-  peers_indexed::index<by_time>::type& by_time_index = m_peers.get<by_time>();
-
-  auto it = by_time_index.rbegin();
-  std::advance(it, i);
-  entry = *it;
+  auto it = m_index.find(m_byTime[i]);
+  if (it == m_index.end())
+    return false;
 
+  entry = m_peers[it->second];
   return true;
 }
 
 void PeerlistManager::Peerlist::trim() {
-  peers_indexed::index<by_time>::type& sorted_index = m_peers.get<by_time>();
-  while (m_peers.size() > m_maxSize) {
-    sorted_index.erase(sorted_index.begin());
+  if (m_peers.size() <= m_maxSize) {
+    return;
+  }
+
+  std::nth_element(m_peers.begin(), m_peers.begin() + m_maxSize, m_peers.end(), [](const PeerlistEntry& a, const PeerlistEntry& b) {
+    return a.last_seen > b.last_seen;
+  });
+
+  m_peers.resize(m_maxSize);
+  refresh();
+}
+
+const PeerlistEntry* PeerlistManager::Peerlist::find(const NetworkAddress& address) const {
+  auto it = m_index.find(address);
+  return it == m_index.end() ? nullptr : &m_peers[it->second];
+}
+
+void PeerlistManager::Peerlist::put(const PeerlistEntry& entry) {
+  auto result = m_index.emplace(entry.adr, m_peers.size());
+  if (result.second) {
+    m_peers.push_back(entry);
+    m_byTime.push_back(entry.adr);
+  } else {
+    m_peers[result.first->second] = entry;
+  }
+}
+
+void PeerlistManager::Peerlist::remove(const NetworkAddress& address) {
+  auto it = m_index.find(address);
+  if (it == m_index.end()) {
+    return;
+  }
+
+  size_t index = it->second;
+  m_index.erase(it);
+  if (index != m_peers.size() - 1) {
+    m_peers[index] = m_peers.back();
+    m_index[m_peers[index].adr] = index;
+  }
+
+  m_peers.pop_back();
+
+  // removed addresses stay in m_byTime until the next refresh, don't let them pile up
+  if (m_byTime.size() > 2 * m_peers.size() + P2P_DEFAULT_PEERS_IN_HANDSHAKE) {
+    refresh();
+  }
+}
+
+void PeerlistManager::Peerlist::refresh() {
+  std::sort(m_peers.begin(), m_peers.end(), [](const PeerlistEntry& a, const PeerlistEntry& b) {
+    return a.last_seen > b.last_seen;
+  });
+
+  m_index.clear();
+  m_byTime.clear();
+  m_byTime.reserve(m_peers.size());
+  for (size_t i = 0; i < m_peers.size(); ++i) {
+    m_index[m_peers[i].adr] = i;
+    m_byTime.push_back(m_peers[i].adr);
+  }
+}
+
+void PeerlistManager::Peerlist::copyByTime(std::list<PeerlistEntry>& entries) const {
+  std::vector<PeerlistEntry> sorted(m_peers);
+  std::sort(sorted.begin(), sorted.end(), [](const PeerlistEntry& a, const PeerlistEntry& b) {
+    return a.last_seen > b.last_seen;
+  });
+
+  entries.insert(entries.end(), sorted.begin(), sorted.end());
+}
+
+void PeerlistManager::Peerlist::copyHead(std::list<PeerlistEntry>& entries, size_t depth) const {
+  PeerlistEntry entry;
+  for (size_t i = 0; i < m_byTime.size() && entries.size() < depth; ++i) {
+    if (get(entry, i) && entry.last_seen != 0) {
+      entries.push_back(entry);
+    }
+  }
+}
+
+void PeerlistManager::Peerlist::serialize(Common::StringView name, ISerializer& s) {
+  if (s.type() == ISerializer::INPUT) {
+    std::vector<PeerlistEntry> peers;
+    readSequence<PeerlistEntry>(std::back_inserter(peers), name, s);
+    m_peers.clear();
+    m_index.clear();
+    m_byTime.clear();
+    for (const auto& peer : peers) {
+      put(peer);
+    }
+
+    trim();
+  } else {
+    writeSequence<PeerlistEntry>(m_peers.begin(), m_peers.end(), name, s);
   }
 }
 
 PeerlistManager::PeerlistManager() : 
-  m_whitePeerlist(m_peers_white, CryptoNote::P2P_LOCAL_WHITE_PEERLIST_LIMIT),
-  m_grayPeerlist(m_peers_gray, CryptoNote::P2P_LOCAL_GRAY_PEERLIST_LIMIT) {}
+  m_whitePeerlist(CryptoNote::P2P_LOCAL_WHITE_PEERLIST_LIMIT),
+  m_grayPeerlist(CryptoNote::P2P_LOCAL_GRAY_PEERLIST_LIMIT) {}
 
 //--------------------------------------------------------------------------------------------------
 bool PeerlistManager::init(bool allow_local_ip)
@@ -132,11 +215,25 @@ void PeerlistManager::trim_gray_peerlist() {
   m_grayPeerlist.trim();
 }
 
+//--------------------------------------------------------------------------------------------------
+void PeerlistManager::refresh() {
+  m_whitePeerlist.refresh();
+  m_grayPeerlist.refresh();
+
+  std::list<PeerlistEntry> head;
+  get_peerlist_head(head);
+  m_headBlob.clear();
+  m_headBlob.reserve(head.size() * sizeof(PeerlistEntry));
+  for (const auto& entry : head) {
+    m_headBlob.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+  }
+}
+
 //--------------------------------------------------------------------------------------------------
 bool PeerlistManager::merge_peerlist(const std::list<PeerlistEntry>& outer_bs)
 { 
   for(const PeerlistEntry& be : outer_bs) {
-    append_with_peer_gray(be);
+    appendGray(be);
   }
 
   // delete extra elements
@@ -176,28 +273,15 @@ bool PeerlistManager::is_ip_allowed(uint32_t ip) const
 
 bool PeerlistManager::get_peerlist_head(std::list<PeerlistEntry>& bs_head, uint32_t depth) const
 {
-  const peers_indexed::index<by_time>::type& by_time_index = m_peers_white.get<by_time>();
-  uint32_t cnt = 0;
-
-  BOOST_REVERSE_FOREACH(const peers_indexed::value_type& vl, by_time_index)
-  {
-    if (!vl.last_seen)
-      continue;
-    bs_head.push_back(vl);
-    if (cnt++ > depth)
-      break;
-  }
+  m_whitePeerlist.copyHead(bs_head, depth);
   return true;
 }
 //--------------------------------------------------------------------------------------------------
 
 bool PeerlistManager::get_peerlist_full(std::list<PeerlistEntry>& pl_gray, std::list<PeerlistEntry>& pl_white) const
 {
-  const peers_indexed::index<by_time>::type& by_time_index_gr = m_peers_gray.get<by_time>();
-  const peers_indexed::index<by_time>::type& by_time_index_wt = m_peers_white.get<by_time>();
-
-  std::copy(by_time_index_gr.rbegin(), by_time_index_gr.rend(), std::back_inserter(pl_gray));
-  std::copy(by_time_index_wt.rbegin(), by_time_index_wt.rend(), std::back_inserter(pl_white));
+  m_grayPeerlist.copyByTime(pl_gray);
+  m_whitePeerlist.copyByTime(pl_white);
 
   return true;
 }
@@ -234,21 +318,11 @@ bool PeerlistManager::append_with_peer_white(const PeerlistEntry& ple)
     if (!is_ip_allowed(ple.adr.ip))
       return true;
 
-    //find in white list
-    auto by_addr_it_wt = m_peers_white.get<by_addr>().find(ple.adr);
-    if (by_addr_it_wt == m_peers_white.get<by_addr>().end()) {
-      //put new record into white list
-      m_peers_white.insert(ple);
-      trim_white_peerlist();
-    } else {
-      //update record in white list 
-      m_peers_white.replace(by_addr_it_wt, ple);
-    }
+    //put new record into white list or update it
+    m_whitePeerlist.put(ple);
+    trim_white_peerlist();
     //remove from gray list, if need
-    auto by_addr_it_gr = m_peers_gray.get<by_addr>().find(ple.adr);
-    if (by_addr_it_gr != m_peers_gray.get<by_addr>().end()) {
-      m_peers_gray.erase(by_addr_it_gr);
-    }
+    m_grayPeerlist.remove(ple.adr);
     return true;
   } catch (std::exception&) {
   }
@@ -257,28 +331,25 @@ bool PeerlistManager::append_with_peer_white(const PeerlistEntry& ple)
 //--------------------------------------------------------------------------------------------------
 
 bool PeerlistManager::append_with_peer_gray(const PeerlistEntry& ple)
+{
+  bool r = appendGray(ple);
+  trim_gray_peerlist();
+  return r;
+}
+//--------------------------------------------------------------------------------------------------
+
+bool PeerlistManager::appendGray(const PeerlistEntry& ple)
 {
   try {
     if (!is_ip_allowed(ple.adr.ip))
       return true;
 
     //find in white list
-    auto by_addr_it_wt = m_peers_white.get<by_addr>().find(ple.adr);
-    if (by_addr_it_wt != m_peers_white.get<by_addr>().end())
+    if (m_whitePeerlist.find(ple.adr) != nullptr)
       return true;
 
-    //update gray list
-    auto by_addr_it_gr = m_peers_gray.get<by_addr>().find(ple.adr);
-    if (by_addr_it_gr == m_peers_gray.get<by_addr>().end())
-    {
-      //put new record into white list
-      m_peers_gray.insert(ple);
-      trim_gray_peerlist();
-    } else
-    {
-      //update record in white list 
-      m_peers_gray.replace(by_addr_it_gr, ple);
-    }
+    //put new record into gray list or update it
+    m_grayPeerlist.put(ple);
     return true;
   } catch (std::exception&) {
   }
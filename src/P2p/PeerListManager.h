@@ -38,12 +38,11 @@
 #pragma once
 
 #include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
-
+#include "Common/StringView.h"
 #include "P2pProtocolTypes.h"
 #include "CryptoNoteConfig.h"
 
@@ -54,41 +53,42 @@ class ISerializer;
 /*                                                                      */
 /************************************************************************/
 class PeerlistManager {
-  struct by_time{};
-  struct by_id{};
-  struct by_addr{};
-
-  typedef boost::multi_index_container<
-    PeerlistEntry,
-    boost::multi_index::indexed_by<
-    // access by peerlist_entry::net_adress
-    boost::multi_index::ordered_unique<boost::multi_index::tag<by_addr>, boost::multi_index::member<PeerlistEntry, NetworkAddress, &PeerlistEntry::adr> >,
-    // sort by peerlist_entry::last_seen<
-    boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_time>, boost::multi_index::member<PeerlistEntry, uint64_t, &PeerlistEntry::last_seen> >
-    >
-  > peers_indexed;
-
 public:
 
+  // peers in a flat table indexed by address, the order by last_seen is only rebuilt by refresh()
   class Peerlist {
   public:
-    Peerlist(peers_indexed& peers, size_t maxSize);
+    Peerlist(size_t maxSize);
     size_t count() const;
+    // index-th most recently seen peer as of the last refresh, peers added since come last;
+    // returns false for a peer removed since the last refresh
     bool get(PeerlistEntry& entry, size_t index) const;
     void trim();
 
+    const PeerlistEntry* find(const NetworkAddress& address) const;
+    void put(const PeerlistEntry& entry);
+    void remove(const NetworkAddress& address);
+    void refresh();
+    void copyByTime(std::list<PeerlistEntry>& entries) const;
+    void copyHead(std::list<PeerlistEntry>& entries, size_t depth) const;
+    void serialize(Common::StringView name, ISerializer& s);
+
   private:
-    peers_indexed& m_peers;
+    std::vector<PeerlistEntry> m_peers;
+    std::unordered_map<NetworkAddress, size_t> m_index;
+    std::vector<NetworkAddress> m_byTime;
     const size_t m_maxSize;
   };
 
   PeerlistManager();
 
   bool init(bool allow_local_ip);
-  size_t get_white_peers_count() const { return m_peers_white.size(); }
-  size_t get_gray_peers_count() const { return m_peers_gray.size(); }
+  size_t get_white_peers_count() const { return m_whitePeerlist.count(); }
+  size_t get_gray_peers_count() const { return m_grayPeerlist.count(); }
   bool merge_peerlist(const std::list<PeerlistEntry>& outer_bs);
   bool get_peerlist_head(std::list<PeerlistEntry>& bs_head, uint32_t depth = CryptoNote::P2P_DEFAULT_PEERS_IN_HANDSHAKE) const;
+  // the same peers as get_peerlist_head, packed as serializeAsBinary writes them, rebuilt by refresh()
+  const std::string& get_peerlist_head_blob() const { return m_headBlob; }
   bool get_peerlist_full(std::list<PeerlistEntry>& pl_gray, std::list<PeerlistEntry>& pl_white) const;
   bool get_white_peer_by_index(PeerlistEntry& p, size_t i) const;
   bool get_gray_peer_by_index(PeerlistEntry& p, size_t i) const;
@@ -100,6 +100,8 @@ public:
   bool is_ip_allowed(uint32_t ip) const;
   void trim_white_peerlist();
   void trim_gray_peerlist();
+  // sorts both lists by last_seen and rebuilds the handshake blob
+  void refresh();
 
   void serialize(ISerializer& s);
 
@@ -107,12 +109,13 @@ public:
   Peerlist& getGray();
 
 private:
+  bool appendGray(const PeerlistEntry& ple);
+
   std::string m_config_folder;
   bool m_allow_local_ip;
-  peers_indexed m_peers_gray;
-  peers_indexed m_peers_white;
   Peerlist m_whitePeerlist;
   Peerlist m_grayPeerlist;
+  std::string m_headBlob;
 };
 
 }
@@ -42,6 +42,7 @@
 #include "Common/JsonValue.h"
 #include "JsonRpcServer/JsonRpcServer.h"
 #include "PaymentServiceJsonRpcMessages.h"
+#include "Serialization/JsonInputBufferSerializer.h"
 #include "Serialization/JsonInputValueSerializer.h"
 #include "Serialization/JsonOutputStreamSerializer.h"
 
@@ -55,23 +56,28 @@ public:
   PaymentServiceJsonRpcServer(const PaymentServiceJsonRpcServer&) = delete;
 
 protected:
-  virtual void processJsonRpcRequest(const Common::JsonValue& req, Common::JsonValue& resp) override;
+  virtual void processJsonRpcRequest(CryptoNote::JsonInputBufferSerializer& req, Common::JsonValue& resp) override;
 
 private:
   WalletService& service;
   Logging::LoggerRef logger;
 
-  typedef std::function<void (const Common::JsonValue& jsonRpcParams, Common::JsonValue& jsonResponse)> HandlerFunction;
+  typedef std::function<void (CryptoNote::JsonInputBufferSerializer& jsonRpcRequest, Common::JsonValue& jsonResponse)> HandlerFunction;
 
   template <typename RequestType, typename ResponseType, typename RequestHandler>
   HandlerFunction jsonHandler(RequestHandler handler) {
-    return [handler] (const Common::JsonValue& jsonRpcParams, Common::JsonValue& jsonResponse) mutable {
+    return [handler] (CryptoNote::JsonInputBufferSerializer& jsonRpcRequest, Common::JsonValue& jsonResponse) mutable {
       RequestType request;
       ResponseType response;
 
       try {
-        CryptoNote::JsonInputValueSerializer inputSerializer(const_cast<Common::JsonValue&>(jsonRpcParams));
-        serialize(request, inputSerializer);
+        if (jsonRpcRequest.beginObject("params")) {
+          serialize(request, jsonRpcRequest);
+          jsonRpcRequest.endObject();
+        } else {
+          CryptoNote::JsonInputValueSerializer inputSerializer(Common::JsonValue(Common::JsonValue::OBJECT));
+          serialize(request, inputSerializer);
+        }
       } catch (std::exception&) {
         makeGenericErrorReponse(jsonResponse, "Invalid Request", -32600);
         return;
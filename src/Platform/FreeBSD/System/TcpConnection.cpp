@@ -221,6 +221,27 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
   return transferred;
 }
 
+// no native scatter/gather here, transfer the first non-empty buffer
+size_t TcpConnection::read(const IoBuffer* buffers, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    if (buffers[i].size != 0) {
+      return read(buffers[i].data, buffers[i].size);
+    }
+  }
+
+  return 0;
+}
+
+size_t TcpConnection::write(const ConstIoBuffer* buffers, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    if (buffers[i].size != 0) {
+      return write(buffers[i].data, buffers[i].size);
+    }
+  }
+
+  return 0;
+}
+
 std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
   sockaddr_in addr;
   socklen_t size = sizeof(addr);
@@ -31,6 +31,15 @@
 #include <unistd.h>
 #include "ErrorMessage.h"
 
+#ifdef USE_IO_URING
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
 namespace System {
 
 namespace {
@@ -62,9 +71,155 @@ static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "in
 //const size_t STACK_SIZE = 64 * 1024;
 const size_t STACK_SIZE = 512 * 1024;
 
+const int MAX_EVENTS = 64;
+
+#ifdef USE_IO_URING
+const unsigned RING_ENTRIES = 256;
+// completions of every operation in flight have to fit, one read and one write per connection
+const unsigned RING_COMPLETION_ENTRIES = 16384;
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+bool supportsRingOperations(int fd) {
+  const uint8_t operations[] = { IORING_OP_ACCEPT, IORING_OP_CONNECT, IORING_OP_RECVMSG, IORING_OP_SENDMSG,
+    IORING_OP_TIMEOUT, IORING_OP_TIMEOUT_REMOVE, IORING_OP_ASYNC_CANCEL };
+  const unsigned probeOperations = 256;
+  std::vector<uint8_t> buffer(sizeof(io_uring_probe) + probeOperations * sizeof(io_uring_probe_op), 0);
+  io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+  if (ioUringRegister(fd, IORING_REGISTER_PROBE, probe, probeOperations) == -1) {
+    return false;
+  }
+
+  for (uint8_t operation : operations) {
+    if (operation > probe->last_op || (probe->ops[operation].flags & IO_URING_OP_SUPPORTED) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+#endif
+
 };
 
-Dispatcher::Dispatcher() {
+#ifdef USE_IO_URING
+struct DispatcherRing {
+  int fd = -1;
+  void* sqMemory = MAP_FAILED;
+  size_t sqSize = 0;
+  void* cqMemory = MAP_FAILED;
+  size_t cqSize = 0;
+  io_uring_sqe* entries = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t entriesSize = 0;
+  unsigned* sqHead;
+  unsigned* sqTail;
+  unsigned* sqArray;
+  unsigned sqMask;
+  unsigned sqEntries;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  io_uring_cqe* completions;
+  unsigned cqMask;
+  // entries queued since the last io_uring_enter, published to the kernel by moving sqTail to tail
+  unsigned tail;
+  unsigned pending = 0;
+  ContextPair eventContext;
+
+  ~DispatcherRing() {
+    if (entries != MAP_FAILED) {
+      munmap(entries, entriesSize);
+    }
+
+    if (cqMemory != MAP_FAILED && cqMemory != sqMemory) {
+      munmap(cqMemory, cqSize);
+    }
+
+    if (sqMemory != MAP_FAILED) {
+      munmap(sqMemory, sqSize);
+    }
+
+    if (fd != -1) {
+      auto result = close(fd);
+      assert(result == 0);
+    }
+  }
+};
+
+namespace {
+
+// returns nullptr when the kernel lacks io_uring or any of the operations used, the dispatcher then stays on epoll
+DispatcherRing* createRing() {
+  io_uring_params params;
+  memset(&params, 0, sizeof params);
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = RING_COMPLETION_ENTRIES;
+  std::unique_ptr<DispatcherRing> ring(new DispatcherRing);
+  ring->fd = ioUringSetup(RING_ENTRIES, &params);
+  if (ring->fd == -1 || (params.features & IORING_FEAT_NODROP) == 0 || !supportsRingOperations(ring->fd)) {
+    return nullptr;
+  }
+
+  ring->sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMap) {
+    ring->sqSize = ring->cqSize = std::max(ring->sqSize, ring->cqSize);
+  }
+
+  ring->sqMemory = mmap(nullptr, ring->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sqMemory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  if (singleMap) {
+    ring->cqMemory = ring->sqMemory;
+  } else {
+    ring->cqMemory = mmap(nullptr, ring->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cqMemory == MAP_FAILED) {
+      return nullptr;
+    }
+  }
+
+  ring->entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+  ring->entries = static_cast<io_uring_sqe*>(mmap(nullptr, ring->entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+  if (ring->entries == MAP_FAILED) {
+    return nullptr;
+  }
+
+  uint8_t* sq = static_cast<uint8_t*>(ring->sqMemory);
+  ring->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  ring->sqEntries = params.sq_entries;
+  uint8_t* cq = static_cast<uint8_t*>(ring->cqMemory);
+  ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  ring->completions = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  ring->tail = *ring->sqTail;
+  ring->eventContext.readContext = nullptr;
+  ring->eventContext.writeContext = nullptr;
+  return ring.release();
+}
+
+}
+#endif
+
+Dispatcher::Dispatcher() : Dispatcher(true) {
+}
+
+Dispatcher::Dispatcher(bool allowRing) : ring(nullptr) {
   std::string message;
   epoll = ::epoll_create1(0);
   if (epoll == -1) {
@@ -103,6 +258,19 @@ Dispatcher::Dispatcher() {
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
           runningContextCount = 0;
+#ifdef USE_IO_URING
+          ring = allowRing ? createRing() : nullptr;
+          if (ring != nullptr) {
+            // the ring descriptor is readable while completions are pending
+            epoll_event ringEvent;
+            ringEvent.events = EPOLLIN;
+            ringEvent.data.ptr = &ring->eventContext;
+            if (epoll_ctl(epoll, EPOLL_CTL_ADD, ring->fd, &ringEvent) == -1) {
+              delete ring;
+              ring = nullptr;
+            }
+          }
+#endif
           return;
         }
 
@@ -142,6 +310,9 @@ Dispatcher::~Dispatcher() {
     timers.pop();
   }
 
+#ifdef USE_IO_URING
+  delete ring;
+#endif
   auto result = close(epoll);
   assert(result == 0);
   result = close(remoteSpawnEvent);
@@ -180,38 +351,20 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
+#ifdef USE_IO_URING
+    if (ring != nullptr) {
+      submitRingEntries();
+    }
+#endif
 
-        continue;
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll, events, MAX_EVENTS, -1);
+    if (count > 0) {
+      for (int i = 0; i < count; ++i) {
+        processEvent(events[i]);
       }
 
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
-        continue;
-      }
-
-      assert(context != nullptr);
-      break;
+      continue;
     }
 
     if (errno != EINTR) {
@@ -306,53 +459,22 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
 }
 
 void Dispatcher::yield() {
+#ifdef USE_IO_URING
+  if (ring != nullptr) {
+    submitRingEntries();
+  }
+#endif
+
   for(;;){
-    epoll_event events[16];
-    int count = epoll_wait(epoll, events, 16, 0);
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll, events, MAX_EVENTS, 0);
     if (count == 0) {
       break;
     }
 
     if(count > 0) {
       for(int i = 0; i < count; ++i) {
-        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          if(contextPair->writeContext != nullptr) {
-            if(contextPair->writeContext->context != nullptr) {
-              contextPair->writeContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          if(contextPair->readContext != nullptr) {
-            if(contextPair->readContext->context != nullptr) {
-              contextPair->readContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("Dispatcher::dispatch, events & (EPOLLERR | EPOLLHUP) != 0");
-        } else {
-          continue;
-        }
+        processEvent(events[i]);
       }
     } else {
       if (errno != EINTR) {
@@ -371,6 +493,93 @@ int Dispatcher::getEpoll() const {
   return epoll;
 }
 
+bool Dispatcher::hasRing() const {
+  return ring != nullptr;
+}
+
+#ifdef USE_IO_URING
+io_uring_sqe& Dispatcher::getRingEntry(RingOperation* operation) {
+  assert(ring != nullptr);
+  if (ring->tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) == ring->sqEntries) {
+    submitRingEntries();
+  }
+
+  unsigned index = ring->tail & ring->sqMask;
+  io_uring_sqe& entry = ring->entries[index];
+  memset(&entry, 0, sizeof entry);
+  entry.user_data = reinterpret_cast<uint64_t>(operation);
+  ring->sqArray[index] = index;
+  ++ring->tail;
+  ++ring->pending;
+  if (operation != nullptr) {
+    operation->context = currentContext;
+    operation->result = 0;
+    operation->completed = false;
+    operation->interrupted = false;
+  }
+
+  return entry;
+}
+
+void Dispatcher::waitRingOperation(RingOperation& operation, uint8_t cancelOpcode) {
+  assert(ring != nullptr);
+  assert(operation.context == currentContext);
+  currentContext->interruptProcedure = [this, &operation, cancelOpcode]() {
+    if (!operation.completed && !operation.interrupted) {
+      // the operation still owns its buffers, the context resumes with the completion of the cancelled operation
+      operation.interrupted = true;
+      io_uring_sqe& entry = getRingEntry(nullptr);
+      entry.opcode = cancelOpcode;
+      entry.addr = reinterpret_cast<uint64_t>(&operation);
+    }
+  };
+
+  while (!operation.completed) {
+    dispatch();
+  }
+
+  currentContext->interruptProcedure = nullptr;
+}
+
+void Dispatcher::submitRingEntries() {
+  if (ring->pending == 0) {
+    return;
+  }
+
+  __atomic_store_n(ring->sqTail, ring->tail, __ATOMIC_RELEASE);
+  while (ring->pending != 0) {
+    int submitted = ioUringEnter(ring->fd, ring->pending, 0, 0);
+    if (submitted == -1) {
+      if (errno == EAGAIN || errno == EBUSY) {
+        // completion queue is full, make room before retrying
+        completeRingOperations();
+      } else if (errno != EINTR) {
+        throw std::runtime_error("Dispatcher::submitRingEntries, io_uring_enter failed, " + lastErrorMessage());
+      }
+    } else {
+      ring->pending -= static_cast<unsigned>(submitted);
+    }
+  }
+}
+
+void Dispatcher::completeRingOperations() {
+  unsigned head = *ring->cqHead;
+  unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const io_uring_cqe& completion = ring->completions[head & ring->cqMask];
+    RingOperation* operation = reinterpret_cast<RingOperation*>(completion.user_data);
+    if (operation != nullptr) {
+      operation->result = completion.res;
+      operation->completed = true;
+      operation->context->interruptProcedure = nullptr;
+      pushContext(operation->context);
+    }
+  }
+
+  __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+}
+#endif
+
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
     ucontext_t* newlyCreatedContext = new ucontext_t;
@@ -429,6 +638,56 @@ void Dispatcher::pushTimer(int timer) {
   timers.push(timer);
 }
 
+void Dispatcher::processEvent(const epoll_event& event) {
+  ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
+  if (contextPair == &remoteSpawnEventContext) {
+    uint64_t buf;
+    auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+    if(transferred == -1) {
+      throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+    }
+
+    MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+    while (!remoteSpawningProcedures.empty()) {
+      spawn(std::move(remoteSpawningProcedures.front()));
+      remoteSpawningProcedures.pop();
+    }
+
+    return;
+  }
+
+#ifdef USE_IO_URING
+  if (ring != nullptr && contextPair == &ring->eventContext) {
+    completeRingOperations();
+    return;
+  }
+#endif
+
+  if (contextPair == nullptr) {
+    return;
+  }
+
+  // edge-triggered descriptors report readiness whether an operation waits or not; errors wake both sides,
+  // which then learn the failure from their next system call
+  if ((event.events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0 && contextPair->writeContext != nullptr) {
+    OperationContext* writeContext = contextPair->writeContext;
+    writeContext->events = event.events;
+    if (writeContext->context != nullptr) {
+      writeContext->context->interruptProcedure = nullptr;
+      pushContext(writeContext->context);
+    }
+  }
+
+  if ((event.events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) != 0 && contextPair->readContext != nullptr) {
+    OperationContext* readContext = contextPair->readContext;
+    readContext->events = event.events;
+    if (readContext->context != nullptr) {
+      readContext->context->interruptProcedure = nullptr;
+      pushContext(readContext->context);
+    }
+  }
+}
+
 void Dispatcher::contextProcedure(void* ucontext) {
   assert(firstReusableContext == nullptr);
   NativeContext context;
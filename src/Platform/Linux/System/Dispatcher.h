@@ -27,8 +27,12 @@
 #include <bits/reg.h>
 #endif
 
+struct epoll_event;
+struct io_uring_sqe;
+
 namespace System {
 
+struct DispatcherRing;
 struct NativeContextGroup;
 
 struct NativeContext {
@@ -62,9 +66,19 @@ struct ContextPair {
   OperationContext *writeContext;
 };
 
+// an operation submitted to the io_uring backend, completed by the dispatcher
+struct RingOperation {
+  NativeContext *context;
+  int32_t result;
+  bool completed;
+  bool interrupted;
+};
+
 class Dispatcher {
 public:
   Dispatcher();
+  // With 'allowRing' false the dispatcher stays on epoll even when built with USE_IO_URING, e.g. to compare the two.
+  explicit Dispatcher(bool allowRing);
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -84,6 +98,15 @@ public:
   void pushReusableContext(NativeContext&);
   int getTimer();
   void pushTimer(int timer);
+  // true when socket and timer operations go through io_uring instead of epoll
+  bool hasRing() const;
+#ifdef USE_IO_URING
+  // returns a cleared submission entry completing 'operation' (nullptr to ignore the completion), submitted
+  // together with all others queued before the dispatcher blocks
+  io_uring_sqe& getRingEntry(RingOperation* operation);
+  // suspends the current context until 'operation' completes, an interrupt submits 'cancelOpcode' for it
+  void waitRingOperation(RingOperation& operation, uint8_t cancelOpcode);
+#endif
 
 #ifdef __x86_64__
 # if __WORDSIZE == 64
@@ -99,7 +122,13 @@ public:
 
 private:
   void spawn(std::function<void()>&& procedure);
+  void processEvent(const epoll_event& event);
+#ifdef USE_IO_URING
+  void submitRingEntries();
+  void completeRingOperations();
+#endif
   int epoll;
+  DispatcherRing* ring;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
   ContextPair remoteSpawnEventContext;
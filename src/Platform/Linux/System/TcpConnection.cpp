@@ -17,25 +17,67 @@
 // along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "TcpConnection.h"
+#include <algorithm>
 #include <stdexcept>
 #include <arpa/inet.h>
 #include <cassert>
+#include <cerrno>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
 #include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
 #include <System/Ipv4Address.h>
 
 namespace System {
 
+namespace {
+
+#ifdef USE_IO_URING
+// returns the bytes transferred or -errno
+int32_t transferOnRing(Dispatcher& dispatcher, uint8_t opcode, int connection, msghdr& header, uint32_t flags) {
+  // a socket with data or room is served by the system call right away, the ring only waits for the others
+  ssize_t transferred = opcode == IORING_OP_RECVMSG ? ::recvmsg(connection, &header, flags | MSG_DONTWAIT) :
+    ::sendmsg(connection, &header, flags | MSG_DONTWAIT);
+  if (transferred != -1) {
+    return static_cast<int32_t>(transferred);
+  }
+
+  if (errno != EAGAIN && errno != EWOULDBLOCK) {
+    return -errno;
+  }
+
+  RingOperation operation;
+  io_uring_sqe& entry = dispatcher.getRingEntry(&operation);
+  entry.opcode = opcode;
+  entry.fd = connection;
+  entry.addr = reinterpret_cast<uint64_t>(&header);
+  entry.len = 1;
+  entry.msg_flags = flags;
+  dispatcher.waitRingOperation(operation, IORING_OP_ASYNC_CANCEL);
+  if (operation.result < 0 && operation.interrupted) {
+    throw InterruptedException();
+  }
+
+  return operation.result;
+}
+#endif
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
 TcpConnection::TcpConnection(TcpConnection&& other) : dispatcher(other.dispatcher) {
   if (other.dispatcher != nullptr) {
-    assert(other.contextPair.writeContext == nullptr);
-    assert(other.contextPair.readContext == nullptr);
+    assert(other.contextPair == nullptr || other.contextPair->writeContext == nullptr);
+    assert(other.contextPair == nullptr || other.contextPair->readContext == nullptr);
     connection = other.connection;
     contextPair = other.contextPair;
     other.dispatcher = nullptr;
@@ -44,17 +86,19 @@ TcpConnection::TcpConnection(TcpConnection&& other) : dispatcher(other.dispatche
 
 TcpConnection::~TcpConnection() {
   if (dispatcher != nullptr) {
-    assert(contextPair.readContext == nullptr);
-    assert(contextPair.writeContext == nullptr);
+    assert(contextPair == nullptr || contextPair->readContext == nullptr);
+    assert(contextPair == nullptr || contextPair->writeContext == nullptr);
     int result = close(connection);
     assert(result != -1);
+    delete contextPair;
   }
 }
 
 TcpConnection& TcpConnection::operator=(TcpConnection&& other) {
   if (dispatcher != nullptr) {
-    assert(contextPair.readContext == nullptr);
-    assert(contextPair.writeContext == nullptr);
+    assert(contextPair == nullptr || contextPair->readContext == nullptr);
+    assert(contextPair == nullptr || contextPair->writeContext == nullptr);
+    delete contextPair;
     if (close(connection) == -1) {
       throw std::runtime_error("TcpConnection::operator=, close failed, " + lastErrorMessage());
     }
@@ -62,8 +106,8 @@ TcpConnection& TcpConnection::operator=(TcpConnection&& other) {
 
   dispatcher = other.dispatcher;
   if (other.dispatcher != nullptr) {
-    assert(other.contextPair.readContext == nullptr);
-    assert(other.contextPair.writeContext == nullptr);
+    assert(other.contextPair == nullptr || other.contextPair->readContext == nullptr);
+    assert(other.contextPair == nullptr || other.contextPair->writeContext == nullptr);
     connection = other.connection;
     contextPair = other.contextPair;
     other.dispatcher = nullptr;
@@ -73,96 +117,79 @@ TcpConnection& TcpConnection::operator=(TcpConnection&& other) {
 }
 
 size_t TcpConnection::read(uint8_t* data, size_t size) {
+  IoBuffer buffer = { data, size };
+  return read(&buffer, 1);
+}
+
+size_t TcpConnection::read(const IoBuffer* buffers, size_t count) {
   assert(dispatcher != nullptr);
-  assert(contextPair.readContext == nullptr);
+  assert(contextPair == nullptr || contextPair->readContext == nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
 
-  std::string message;
-  ssize_t transferred = ::recv(connection, (void *)data, size, 0);
-  if (transferred == -1) {
-    if (errno != EAGAIN) {
-      message = "recv failed, " + lastErrorMessage();
-    } else {
-      epoll_event connectionEvent;
-      OperationContext operationContext;
-      operationContext.interrupted = false;
-      operationContext.context = dispatcher->getCurrentContext();
-      contextPair.readContext = &operationContext;
-      connectionEvent.data.ptr = &contextPair;
-
-      if(contextPair.writeContext != nullptr) {
-        connectionEvent.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
-      } else {
-        connectionEvent.events = EPOLLIN | EPOLLONESHOT;
-      }
-
-      if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-        message = "epoll_ctl failed, " + lastErrorMessage();
-      } else {
-        dispatcher->getCurrentContext()->interruptProcedure = [&]() {
-            assert(dispatcher != nullptr);
-            assert(contextPair.readContext != nullptr);
-            epoll_event connectionEvent;
-            connectionEvent.events = 0;
-            connectionEvent.data.ptr = nullptr;
-
-            if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-              throw std::runtime_error("TcpConnection::stop, epoll_ctl failed, " + lastErrorMessage());
-            }
-
-            contextPair.readContext->interrupted = true;
-            dispatcher->pushContext(contextPair.readContext->context);
-        };
-
-        dispatcher->dispatch();
-        dispatcher->getCurrentContext()->interruptProcedure = nullptr;
-        assert(dispatcher != nullptr);
-        assert(operationContext.context == dispatcher->getCurrentContext());
-        assert(contextPair.readContext == &operationContext);
-
-        if (operationContext.interrupted) {
-          contextPair.readContext = nullptr;
-          throw InterruptedException();
-        }
-
-        contextPair.readContext = nullptr;
-        if(contextPair.writeContext != nullptr) { //write is presented, rearm
-          epoll_event connectionEvent;
-          connectionEvent.events = EPOLLOUT | EPOLLONESHOT;
-          connectionEvent.data.ptr = &contextPair;
-
-          if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-            message = "epoll_ctl failed, " + lastErrorMessage();
-            throw std::runtime_error("TcpConnection::read");
-          }
-        }
-
-        if((operationContext.events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("TcpConnection::read");
-        }
-
-        ssize_t transferred = ::recv(connection, (void *)data, size, 0);
-        if (transferred == -1) {
-          message = "recv failed, " + lastErrorMessage();
-        } else {
-          assert(transferred <= static_cast<ssize_t>(size));
-          return transferred;
-        }
-      }
+  iovec vectors[MAX_IO_BUFFERS];
+  count = std::min(count, MAX_IO_BUFFERS);
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    vectors[i].iov_base = buffers[i].data;
+    vectors[i].iov_len = buffers[i].size;
+    size += buffers[i].size;
+  }
+
+#ifdef USE_IO_URING
+  if (dispatcher->hasRing()) {
+    msghdr header = {};
+    header.msg_iov = vectors;
+    header.msg_iovlen = count;
+    int32_t transferred = transferOnRing(*dispatcher, IORING_OP_RECVMSG, connection, header, 0);
+    if (transferred < 0) {
+      throw std::runtime_error("TcpConnection::read, recv failed, " + errorMessage(-transferred));
     }
 
-    throw std::runtime_error("TcpConnection::read, "+ message);
+    assert(transferred <= static_cast<ssize_t>(size));
+    return transferred;
   }
+#endif
 
-  assert(transferred <= static_cast<ssize_t>(size));
-  return transferred;
+  for (;;) {
+    ssize_t transferred = ::readv(connection, vectors, static_cast<int>(count));
+    if (transferred != -1) {
+      assert(transferred <= static_cast<ssize_t>(size));
+      return transferred;
+    }
+
+    if (errno != EAGAIN) {
+      throw std::runtime_error("TcpConnection::read, recv failed, " + lastErrorMessage());
+    }
+
+    // the socket is registered edge-triggered, wait for the next readiness edge and retry
+    OperationContext operationContext;
+    operationContext.interrupted = false;
+    operationContext.context = dispatcher->getCurrentContext();
+    contextPair->readContext = &operationContext;
+    dispatcher->getCurrentContext()->interruptProcedure = [&]() {
+        assert(dispatcher != nullptr);
+        assert(contextPair->readContext != nullptr);
+        contextPair->readContext->interrupted = true;
+        dispatcher->pushContext(contextPair->readContext->context);
+    };
+
+    dispatcher->dispatch();
+    dispatcher->getCurrentContext()->interruptProcedure = nullptr;
+    assert(dispatcher != nullptr);
+    assert(operationContext.context == dispatcher->getCurrentContext());
+    assert(contextPair->readContext == &operationContext);
+    contextPair->readContext = nullptr;
+    if (operationContext.interrupted) {
+      throw InterruptedException();
+    }
+  }
 }
 
 std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
   assert(dispatcher != nullptr);
-  assert(contextPair.writeContext == nullptr);
+  assert(contextPair == nullptr || contextPair->writeContext == nullptr);
   if (dispatcher->interrupted()) {
     throw InterruptedException();
   }
@@ -176,84 +203,74 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
-  if (transferred == -1) {
-    if (errno != EAGAIN) {
-      message = "send failed, " + lastErrorMessage();
-    } else {
-      epoll_event connectionEvent;
-      OperationContext operationContext;
-      operationContext.interrupted = false;
-      operationContext.context = dispatcher->getCurrentContext();
-      contextPair.writeContext = &operationContext;
-      connectionEvent.data.ptr = &contextPair;
-
-      if(contextPair.readContext != nullptr) {
-        connectionEvent.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
-      } else {
-        connectionEvent.events = EPOLLOUT | EPOLLONESHOT;
-      }
-
-      if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-        message = "epoll_ctl failed, " + lastErrorMessage();
-      } else {
-        dispatcher->getCurrentContext()->interruptProcedure = [&]() {
-            assert(dispatcher != nullptr);
-            assert(contextPair.writeContext != nullptr);
-            epoll_event connectionEvent;
-            connectionEvent.events = 0;
-            connectionEvent.data.ptr = nullptr;
-
-            if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-              throw std::runtime_error("TcpConnection::stop, epoll_ctl failed, " + lastErrorMessage());
-            }
-
-            contextPair.writeContext->interrupted = true;
-            dispatcher->pushContext(contextPair.writeContext->context);
-        };
-
-        dispatcher->dispatch();
-        dispatcher->getCurrentContext()->interruptProcedure = nullptr;
-        assert(dispatcher != nullptr);
-        assert(operationContext.context == dispatcher->getCurrentContext());
-        assert(contextPair.writeContext == &operationContext);
-
-        if (operationContext.interrupted) {
-          contextPair.writeContext = nullptr;
-          throw InterruptedException();
-        }
-
-        contextPair.writeContext = nullptr;
-        if(contextPair.readContext != nullptr) { //read is presented, rearm
-          epoll_event connectionEvent;
-          connectionEvent.events = EPOLLIN | EPOLLONESHOT;
-          connectionEvent.data.ptr = &contextPair;
-
-          if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, connection, &connectionEvent) == -1) {
-            message = "epoll_ctl failed, " + lastErrorMessage();
-            throw std::runtime_error("TcpConnection::write, " + message);
-          }
-        }
-
-        if((operationContext.events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
-        }
-
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
-        if (transferred == -1) {
-          message = "send failed, "  + lastErrorMessage();
-        } else {
-          assert(transferred <= static_cast<ssize_t>(size));
-          return transferred;
-        }
-      }
+  ConstIoBuffer buffer = { data, size };
+  return write(&buffer, 1);
+}
+
+size_t TcpConnection::write(const ConstIoBuffer* buffers, size_t count) {
+  assert(dispatcher != nullptr);
+  assert(contextPair == nullptr || contextPair->writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec vectors[MAX_IO_BUFFERS];
+  count = std::min(count, MAX_IO_BUFFERS);
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    vectors[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+    vectors[i].iov_len = buffers[i].size;
+    size += buffers[i].size;
+  }
+
+  msghdr header = {};
+  header.msg_iov = vectors;
+  header.msg_iovlen = count;
+
+#ifdef USE_IO_URING
+  if (dispatcher->hasRing()) {
+    int32_t transferred = transferOnRing(*dispatcher, IORING_OP_SENDMSG, connection, header, MSG_NOSIGNAL);
+    if (transferred < 0) {
+      throw std::runtime_error("TcpConnection::write, send failed, " + errorMessage(-transferred));
     }
 
-    throw std::runtime_error("TcpConnection::write, " + message);
+    assert(transferred <= static_cast<ssize_t>(size));
+    return transferred;
   }
+#endif
+
+  for (;;) {
+    ssize_t transferred = ::sendmsg(connection, &header, MSG_NOSIGNAL);
+    if (transferred != -1) {
+      assert(transferred <= static_cast<ssize_t>(size));
+      return transferred;
+    }
+
+    if (errno != EAGAIN) {
+      throw std::runtime_error("TcpConnection::write, send failed, " + lastErrorMessage());
+    }
 
-  assert(transferred <= static_cast<ssize_t>(size));
-  return transferred;
+    OperationContext operationContext;
+    operationContext.interrupted = false;
+    operationContext.context = dispatcher->getCurrentContext();
+    contextPair->writeContext = &operationContext;
+    dispatcher->getCurrentContext()->interruptProcedure = [&]() {
+        assert(dispatcher != nullptr);
+        assert(contextPair->writeContext != nullptr);
+        contextPair->writeContext->interrupted = true;
+        dispatcher->pushContext(contextPair->writeContext->context);
+    };
+
+    dispatcher->dispatch();
+    dispatcher->getCurrentContext()->interruptProcedure = nullptr;
+    assert(dispatcher != nullptr);
+    assert(operationContext.context == dispatcher->getCurrentContext());
+    assert(contextPair->writeContext == &operationContext);
+    contextPair->writeContext = nullptr;
+    if (operationContext.interrupted) {
+      throw InterruptedException();
+    }
+  }
 }
 
 std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
@@ -267,14 +284,17 @@ std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
   return std::make_pair(Ipv4Address(htonl(addr.sin_addr.s_addr)), htons(addr.sin_port));
 }
 
-TcpConnection::TcpConnection(Dispatcher& dispatcher, int socket) : dispatcher(&dispatcher), connection(socket) {
-  contextPair.readContext = nullptr;
-  contextPair.writeContext = nullptr;
-  epoll_event connectionEvent;
-  connectionEvent.events = EPOLLONESHOT;
-  connectionEvent.data.ptr = nullptr;
+TcpConnection::TcpConnection(Dispatcher& dispatcher, int socket) : dispatcher(&dispatcher), connection(socket), contextPair(nullptr) {
+  if (dispatcher.hasRing()) {
+    return;
+  }
 
+  // registered once for both directions, read and write only wait when a system call returns EAGAIN
+  epoll_event connectionEvent;
+  connectionEvent.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  connectionEvent.data.ptr = contextPair = new ContextPair{ nullptr, nullptr };
   if (epoll_ctl(dispatcher.getEpoll(), EPOLL_CTL_ADD, socket, &connectionEvent) == -1) {
+    delete contextPair;
     throw std::runtime_error("TcpConnection::TcpConnection, epoll_ctl failed, " + lastErrorMessage());
   }
 }
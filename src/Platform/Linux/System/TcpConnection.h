@@ -21,6 +21,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <System/IoBuffer.h>
 #include "Dispatcher.h"
 
 namespace System {
@@ -37,6 +38,9 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // scatter/gather versions, transfer as much as one system call does
+  std::size_t read(const IoBuffer* buffers, std::size_t count);
+  std::size_t write(const ConstIoBuffer* buffers, std::size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -45,7 +49,8 @@ private:
   
   Dispatcher* dispatcher;
   int connection;
-  ContextPair contextPair;
+  // heap allocated, its address is registered with epoll for the lifetime of the socket
+  ContextPair* contextPair;
 
   TcpConnection(Dispatcher& dispatcher, int socket);
 };
@@ -25,6 +25,10 @@
 #include <unistd.h>
 #include <sys/epoll.h>
 
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
 #include <System/InterruptedException.h>
 #include <System/Ipv4Address.h>
 #include "Dispatcher.h"
@@ -85,17 +89,41 @@ TcpConnection TcpConnector::connect(const Ipv4Address& address, uint16_t port) {
     bindAddress.sin_family = AF_INET;
     bindAddress.sin_port = 0;
     bindAddress.sin_addr.s_addr = INADDR_ANY;
+    sockaddr_in addressData;
+    addressData.sin_family = AF_INET;
+    addressData.sin_port = htons(port);
+    addressData.sin_addr.s_addr = htonl(address.getValue());
     if (bind(connection, reinterpret_cast<sockaddr*>(&bindAddress), sizeof bindAddress) != 0) {
       message = "bind failed, " + lastErrorMessage();
+#ifdef USE_IO_URING
+    } else if (dispatcher->hasRing()) {
+      // the socket stays blocking, io_uring waits for it without a worker thread
+      RingOperation operation;
+      io_uring_sqe& entry = dispatcher->getRingEntry(&operation);
+      entry.opcode = IORING_OP_CONNECT;
+      entry.fd = connection;
+      entry.addr = reinterpret_cast<uint64_t>(&addressData);
+      entry.off = sizeof addressData;
+      context = &operation;
+      dispatcher->waitRingOperation(operation, IORING_OP_ASYNC_CANCEL);
+      context = nullptr;
+      if (operation.result == 0) {
+        return TcpConnection(*dispatcher, connection);
+      }
+
+      if (operation.interrupted) {
+        int result = close(connection);
+        assert(result != -1);
+        throw InterruptedException();
+      }
+
+      message = "connect failed, " + errorMessage(-operation.result);
+#endif
     } else {
       int flags = fcntl(connection, F_GETFL, 0);
       if (flags == -1 || fcntl(connection, F_SETFL, flags | O_NONBLOCK) == -1) {
         message = "fcntl failed, " + lastErrorMessage();
       } else {
-        sockaddr_in addressData;
-        addressData.sin_family = AF_INET;
-        addressData.sin_port = htons(port);
-        addressData.sin_addr.s_addr = htonl(address.getValue());
         int result = ::connect(connection, reinterpret_cast<sockaddr *>(&addressData), sizeof addressData);
         if (result == -1) {
           if (errno == EINPROGRESS) {
@@ -26,6 +26,10 @@
 #include <unistd.h>
 #include <string.h>
 
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
 #include "Dispatcher.h"
 #include "TcpConnection.h"
 #include <System/ErrorMessage.h>
@@ -43,8 +47,9 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
   if (listener == -1) {
     message = "socket failed, " + lastErrorMessage();
   } else {
+    // io_uring waits for blocking sockets itself and hands O_NONBLOCK ones back with EAGAIN
     int flags = fcntl(listener, F_GETFL, 0);
-    if (flags == -1 || fcntl(listener, F_SETFL, flags | O_NONBLOCK) == -1) {
+    if (flags == -1 || (!dispatcher.hasRing() && fcntl(listener, F_SETFL, flags | O_NONBLOCK) == -1)) {
       message = "fcntl failed, " + lastErrorMessage();
     } else {
       int on = 1;
@@ -59,6 +64,9 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
           message = "bind failed, " + lastErrorMessage();
         } else if (listen(listener, SOMAXCONN) != 0) {
           message = "listen failed, " + lastErrorMessage();
+        } else if (dispatcher.hasRing()) {
+          context = nullptr;
+          return;
         } else {
           epoll_event listenEvent;
           listenEvent.events = 0;
@@ -124,6 +132,27 @@ TcpConnection TcpListener::accept() {
     throw InterruptedException();
   }
 
+#ifdef USE_IO_URING
+  if (dispatcher->hasRing()) {
+    RingOperation operation;
+    io_uring_sqe& entry = dispatcher->getRingEntry(&operation);
+    entry.opcode = IORING_OP_ACCEPT;
+    entry.fd = listener;
+    context = &operation;
+    dispatcher->waitRingOperation(operation, IORING_OP_ASYNC_CANCEL);
+    context = nullptr;
+    if (operation.result < 0) {
+      if (operation.interrupted) {
+        throw InterruptedException();
+      }
+
+      throw std::runtime_error("TcpListener::accept, accept failed, " + errorMessage(-operation.result));
+    }
+
+    return TcpConnection(*dispatcher, operation.result);
+  }
+#endif
+
   ContextPair contextPair;
   OperationContext listenerContext;
   listenerContext.interrupted = false;
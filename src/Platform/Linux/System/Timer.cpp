@@ -24,6 +24,10 @@
 #include <sys/epoll.h>
 #include <unistd.h>
 
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
 #include "Dispatcher.h"
 #include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
@@ -72,6 +76,31 @@ void Timer::sleep(std::chrono::nanoseconds duration) {
 
   if(duration.count() == 0 ) {
     dispatcher->yield();
+#ifdef USE_IO_URING
+  } else if (dispatcher->hasRing()) {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    __kernel_timespec expires;
+    expires.tv_sec = seconds.count();
+    expires.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - seconds).count();
+
+    RingOperation timerOperation;
+    io_uring_sqe& entry = dispatcher->getRingEntry(&timerOperation);
+    entry.opcode = IORING_OP_TIMEOUT;
+    entry.addr = reinterpret_cast<uint64_t>(&expires);
+    entry.len = 1;
+
+    context = &timerOperation;
+    dispatcher->waitRingOperation(timerOperation, IORING_OP_TIMEOUT_REMOVE);
+    context = nullptr;
+    // an expired timeout completes with -ETIME, even when the interrupt came too late to remove it
+    if (timerOperation.result != -ETIME) {
+      if (timerOperation.interrupted) {
+        throw InterruptedException();
+      }
+
+      throw std::runtime_error("Timer::sleep, timeout failed, " + errorMessage(-timerOperation.result));
+    }
+#endif
   } else {
     timer = dispatcher->getTimer();
 
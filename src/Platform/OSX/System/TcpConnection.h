@@ -21,6 +21,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <utility>
+#include <System/IoBuffer.h>
 
 namespace System {
 
@@ -37,6 +38,9 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // scatter/gather versions, transfer as much as one system call does
+  std::size_t read(const IoBuffer* buffers, std::size_t count);
+  std::size_t write(const ConstIoBuffer* buffers, std::size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <System/IoBuffer.h>
 
 namespace System {
 
@@ -36,6 +37,9 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // scatter/gather versions, transfer as much as one system call does
+  size_t read(const IoBuffer* buffers, size_t count);
+  size_t write(const ConstIoBuffer* buffers, size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -196,6 +196,35 @@ struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES {
     }
   };
 };
+
+struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH {
+
+  struct request {
+    std::vector<Crypto::Hash> txids;
+
+    void serialize(ISerializer &s) {
+      serializeAsBinary(txids, "txids", s);
+    }
+  };
+
+  struct tx_outputs_indexes {
+    std::vector<uint32_t> o_indexes;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(o_indexes)
+    }
+  };
+
+  struct response {
+    std::vector<tx_outputs_indexes> txs; // in the order of request txids
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(txs)
+      KV_MEMBER(status)
+    }
+  };
+};
 //-----------------------------------------------
 struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request {
   std::vector<uint64_t> amounts;
@@ -294,6 +323,9 @@ struct COMMAND_RPC_GET_INFO {
     uint8_t block_major_version;
     std::string already_generated_coins;
     std::string contact;   
+    uint64_t response_cache_hits;
+    uint64_t response_cache_misses;
+    uint64_t response_cache_size;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(status)
@@ -322,6 +354,9 @@ struct COMMAND_RPC_GET_INFO {
       KV_MEMBER(block_major_version)
       KV_MEMBER(already_generated_coins)
       KV_MEMBER(contact)      
+      KV_MEMBER(response_cache_hits)
+      KV_MEMBER(response_cache_misses)
+      KV_MEMBER(response_cache_size)
     }
   };
 };
@@ -845,6 +880,26 @@ struct COMMAND_RPC_QUERY_BLOCKS_LITE {
   };
 };
 
+struct COMMAND_RPC_QUERY_BLOCKS_COMPACT {
+  typedef COMMAND_RPC_QUERY_BLOCKS_LITE::request request;
+
+  struct response {
+    std::string status;
+    uint32_t startHeight;
+    uint32_t currentHeight;
+    uint64_t fullOffset;
+    std::vector<BlockCompactInfo> items;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(startHeight)
+      KV_MEMBER(currentHeight)
+      KV_MEMBER(fullOffset)
+      KV_MEMBER(items)
+    }
+  };
+};
+
 struct COMMAND_RPC_GEN_PAYMENT_ID {
   typedef EMPTY_STRUCT request;
   
@@ -1109,6 +1164,113 @@ struct COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES {
   };
 };
 
+struct COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH {
+  struct height_range {
+    uint32_t firstHeight;
+    uint32_t count;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(firstHeight)
+      KV_MEMBER(count)
+    }
+  };
+
+  struct request {
+    std::vector<uint32_t> blockHeights;
+    // filled after the listed heights, cut at the top of the chain
+    std::vector<height_range> heightRanges;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(blockHeights)
+      KV_MEMBER(heightRanges)
+    }
+  };
+
+  struct response {
+    std::vector<BlockDetails> blocks;
+    std::string status;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(status)
+      KV_MEMBER(blocks)
+    }
+  };
+};
+
+struct COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH {
+  struct request {
+    std::vector<Crypto::Hash> transactionHashes;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(transactionHashes)
+    }
+  };
+
+  struct response {
+    std::vector<TransactionDetails> transactions;
+    std::vector<Crypto::Hash> missedTransactions;
+    std::string status;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(status)
+      KV_MEMBER(transactions)
+      KV_MEMBER(missedTransactions)
+    }
+  };
+};
+
+struct COMMAND_RPC_GET_NOTIFICATIONS {
+  struct notification {
+    uint64_t id;
+    // "new_tip", "reorg" (a block left the main chain), "pool_add" or "pool_remove"
+    std::string type;
+    uint32_t height;
+    // of the block or of the transaction
+    Crypto::Hash hash;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(id)
+      KV_MEMBER(type)
+      KV_MEMBER(height)
+      KV_MEMBER(hash)
+    }
+  };
+
+  struct request {
+    // epoch of the previous response, 0 on the first request
+    uint64_t epoch = 0;
+    // id of the last notification seen, 0 on the first request, which is answered at once with missed set
+    uint64_t since = 0;
+    // seconds to wait when there is nothing newer, 0 to answer at once
+    uint32_t timeout = 0;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(epoch)
+      KV_MEMBER(since)
+      KV_MEMBER(timeout)
+    }
+  };
+
+  struct response {
+    std::vector<notification> notifications;
+    // picked at random on every node start, passed back with the next request
+    uint64_t epoch;
+    // passed as since with the next request
+    uint64_t lastId;
+    // notifications after since were dropped or the node restarted, the client has to refresh its state
+    bool missed;
+    std::string status;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(status)
+      KV_MEMBER(notifications)
+      KV_MEMBER(epoch)
+      KV_MEMBER(lastId)
+      KV_MEMBER(missed)
+    }
+  };
+};
+
 struct COMMAND_RPC_GET_TRANSACTION_DETAILS_BY_HASH {
 	struct request {
 		Crypto::Hash hash;
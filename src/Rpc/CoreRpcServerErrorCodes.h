@@ -46,3 +46,4 @@
 #define CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB       -6
 #define CORE_RPC_ERROR_CODE_BLOCK_NOT_ACCEPTED    -7
 #define CORE_RPC_ERROR_CODE_CORE_BUSY             -9
+#define CORE_RPC_ERROR_CODE_SERVER_BUSY           -10
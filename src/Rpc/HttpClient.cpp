@@ -89,7 +89,7 @@ bool HttpClient::isConnected() const {
 void HttpClient::disconnect() {
   m_streamBuf.reset();
   try {
-    m_connection.write(nullptr, 0); //Socket shutdown.
+    m_connection.write(static_cast<const uint8_t*>(nullptr), 0); //Socket shutdown.
   } catch (std::exception&) {
     //Ignoring possible exception.
   }
@@ -77,8 +77,9 @@ private:
   std::unique_ptr<System::TcpStreambuf> m_streamBuf;
 };
 
-template <typename Request, typename Response>
-  void invokeJsonCommand(HttpClient& client, const std::string& url, const Request& req, Response& res, const std::string& user = "", const std::string& password = "") {
+// Client is HttpClient or HttpClientPool
+template <typename Request, typename Response, typename Client>
+  void invokeJsonCommand(Client& client, const std::string& url, const Request& req, Response& res, const std::string& user = "", const std::string& password = "") {
 //  void invokeJsonCommand(HttpClient& client, const std::string& url, const Request& req, Response& res) {    
   HttpRequest hreq;
   HttpResponse hres;
@@ -102,8 +103,8 @@ template <typename Request, typename Response>
   }
 }
 
-template <typename Request, typename Response>
-void invokeJsonRpcCommand(HttpClient& client, const std::string& method, const Request& req, Response& res, const std::string& user = "", const std::string& password = "") {
+template <typename Request, typename Response, typename Client>
+void invokeJsonRpcCommand(Client& client, const std::string& method, const Request& req, Response& res, const std::string& user = "", const std::string& password = "") {
   try {
 
     JsonRpc::JsonRpcRequest jsReq;
@@ -139,10 +140,10 @@ void invokeJsonRpcCommand(HttpClient& client, const std::string& method, const R
   }
 }
 
-template <typename Request, typename Response>
+template <typename Request, typename Response, typename Client>
 
 //void invokeBinaryCommand(HttpClient& client, const std::string& url, const Request& req, Response& res, const std::string& user = "", const std::string& password = "") {
-void invokeBinaryCommand(HttpClient& client, const std::string& url, const Request& req, Response& res) {
+void invokeBinaryCommand(Client& client, const std::string& url, const Request& req, Response& res) {
   HttpRequest hreq;
   HttpResponse hres;
 
@@ -0,0 +1,339 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#include "HttpClientPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <boost/scope_exit.hpp>
+
+#include <HTTP/HttpParser.h>
+#include <System/Context.h>
+#include <System/InterruptedException.h>
+#include <System/Ipv4Resolver.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnector.h>
+#include <System/Timer.h>
+
+#include "HttpClient.h"
+
+namespace {
+
+const size_t DEFAULT_MAX_CONNECTIONS = 4;
+const size_t DEFAULT_PIPELINING_DEPTH = 1;
+const std::chrono::milliseconds DEFAULT_REQUEST_TIMEOUT(60000);
+// below the idle timeout of HttpServer
+const std::chrono::milliseconds DEFAULT_IDLE_TIMEOUT(30000);
+const std::chrono::milliseconds DEFAULT_MIN_RECONNECT_DELAY(500);
+const std::chrono::milliseconds DEFAULT_MAX_RECONNECT_DELAY(30000);
+
+}
+
+namespace CryptoNote {
+
+HttpClientPool::HttpClientPool(System::Dispatcher& dispatcher, const std::string& address, uint16_t port) :
+  m_dispatcher(dispatcher), m_address(address), m_port(port), m_maxConnections(DEFAULT_MAX_CONNECTIONS),
+  m_pipeliningDepth(DEFAULT_PIPELINING_DEPTH), m_requestTimeout(DEFAULT_REQUEST_TIMEOUT), m_idleTimeout(DEFAULT_IDLE_TIMEOUT),
+  m_minReconnectDelay(DEFAULT_MIN_RECONNECT_DELAY), m_maxReconnectDelay(DEFAULT_MAX_RECONNECT_DELAY), m_connectionReleased(dispatcher),
+  m_connected(false), m_connectFailures(0) {
+}
+
+HttpClientPool::~HttpClientPool() {
+  for (auto& connection : m_connections) {
+    assert(connection->requests == 0);
+    closeConnection(*connection);
+  }
+}
+
+void HttpClientPool::setMaxConnections(size_t count) {
+  m_maxConnections = std::max<size_t>(count, 1);
+}
+
+void HttpClientPool::setPipelining(size_t depth) {
+  m_pipeliningDepth = std::max<size_t>(depth, 1);
+}
+
+void HttpClientPool::setRequestTimeout(std::chrono::milliseconds timeout) {
+  m_requestTimeout = timeout;
+}
+
+void HttpClientPool::setIdleTimeout(std::chrono::milliseconds timeout) {
+  m_idleTimeout = timeout;
+}
+
+void HttpClientPool::setReconnectDelay(std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay) {
+  m_minReconnectDelay = minDelay;
+  m_maxReconnectDelay = std::max(minDelay, maxDelay);
+}
+
+void HttpClientPool::request(const HttpRequest& req, HttpResponse& res) {
+  request(req, res, m_requestTimeout);
+}
+
+void HttpClientPool::request(const HttpRequest& req, HttpResponse& res, std::chrono::milliseconds timeout) {
+  if (timeout.count() == 0) {
+    doRequest(req, res);
+    return;
+  }
+
+  // the watchdog interrupts the request, which makes its connection fail
+  bool timedOut = false;
+  System::NativeContext* requestContext = m_dispatcher.getCurrentContext();
+  System::Timer timer(m_dispatcher);
+  System::Context<> watchdog(m_dispatcher, [&] {
+    try {
+      timer.sleep(timeout);
+      timedOut = true;
+      m_dispatcher.interrupt(requestContext);
+    } catch (System::InterruptedException&) {
+    }
+  });
+
+  try {
+    doRequest(req, res);
+  } catch (std::exception&) {
+    if (timedOut) {
+      m_dispatcher.interrupted();
+      throw std::runtime_error("HTTP request to " + m_address + " timed out");
+    }
+
+    throw;
+  }
+
+  watchdog.interrupt();
+  watchdog.wait();
+  if (timedOut) {
+    // the response came just before the interrupt, which is left pending
+    m_dispatcher.interrupted();
+  }
+}
+
+bool HttpClientPool::isConnected() const {
+  return m_connected;
+}
+
+void HttpClientPool::doRequest(const HttpRequest& req, HttpResponse& res) {
+  Connection& connection = acquireConnection();
+  bool succeeded = false;
+  BOOST_SCOPE_EXIT_ALL(this, &connection, &succeeded) {
+    releaseConnection(connection, succeeded);
+  };
+
+  // requests are written one at a time, which gives them their place in the order of responses
+  while (connection.writing && !connection.broken) {
+    connection.writeFree.wait();
+  }
+
+  if (connection.broken) {
+    throw std::runtime_error("HTTP connection to " + m_address + " is closed");
+  }
+
+  uint64_t sequence = connection.nextSent++;
+  {
+    connection.writing = true;
+    BOOST_SCOPE_EXIT_ALL(&connection) {
+      connection.writing = false;
+      notifyAll(connection.writeFree);
+    };
+
+    std::ostream stream(connection.streamBuf.get());
+    stream << req;
+    stream.flush();
+    if (!stream.good()) {
+      throw std::runtime_error("Failed to send HTTP request to " + m_address);
+    }
+  }
+
+  while (connection.nextReceived != sequence && !connection.broken) {
+    connection.readTurn.wait();
+  }
+
+  if (connection.broken) {
+    throw std::runtime_error("HTTP connection to " + m_address + " is closed");
+  }
+
+  std::istream stream(connection.streamBuf.get());
+  HttpParser parser;
+  parser.receiveResponse(stream, res);
+
+  auto headerIt = res.getHeaders().find("connection");
+  if (headerIt != res.getHeaders().end() && headerIt->second == "close") {
+    connection.broken = true;
+  }
+
+  ++connection.nextReceived;
+  notifyAll(connection.readTurn);
+  succeeded = true;
+}
+
+HttpClientPool::Connection& HttpClientPool::acquireConnection() {
+  for (;;) {
+    closeIdleConnections();
+
+    Connection* leastBusy = nullptr;
+    size_t open = 0;
+    for (auto& connection : m_connections) {
+      if (connection->broken) {
+        continue;
+      }
+
+      ++open;
+      if (connection->connected && connection->requests < m_pipeliningDepth &&
+        (leastBusy == nullptr || connection->requests < leastBusy->requests)) {
+        leastBusy = connection.get();
+      }
+    }
+
+    // an idle connection first, then a new one, then a busy one if it takes pipelined requests
+    if (leastBusy != nullptr && (leastBusy->requests == 0 || open >= m_maxConnections)) {
+      ++leastBusy->requests;
+      return *leastBusy;
+    }
+
+    if (open < m_maxConnections) {
+      if (Clock::now() < m_nextConnectTime) {
+        throw ConnectException("Connecting to " + m_address + " failed, retrying later");
+      }
+
+      m_connections.emplace_back(new Connection(m_dispatcher));
+      Connection& connection = *m_connections.back();
+      connection.requests = 1;
+      try {
+        connect(connection);
+      } catch (...) {
+        releaseConnection(connection, false);
+        throw;
+      }
+
+      // requests waiting for it while it was connecting can be pipelined now
+      notifyAll(m_connectionReleased);
+      return connection;
+    }
+
+    m_connectionReleased.wait();
+  }
+}
+
+void HttpClientPool::connect(Connection& connection) {
+  try {
+    auto ipAddr = System::Ipv4Resolver(m_dispatcher).resolve(m_address);
+    connection.connection = System::TcpConnector(m_dispatcher).connect(ipAddr, m_port);
+  } catch (System::InterruptedException&) {
+    throw;
+  } catch (std::exception& e) {
+    ++m_connectFailures;
+    std::chrono::milliseconds delay = m_minReconnectDelay;
+    for (size_t i = 1; i < m_connectFailures && delay < m_maxReconnectDelay; ++i) {
+      delay *= 2;
+    }
+
+    m_nextConnectTime = Clock::now() + std::min(delay, m_maxReconnectDelay);
+    throw ConnectException(e.what());
+  }
+
+  connection.streamBuf.reset(new System::TcpStreambuf(connection.connection));
+  connection.connected = true;
+  connection.lastUsed = Clock::now();
+  m_connectFailures = 0;
+  m_connected = true;
+}
+
+void HttpClientPool::releaseConnection(Connection& connection, bool succeeded) {
+  if (!succeeded) {
+    connection.broken = true;
+    notifyAll(connection.writeFree);
+    notifyAll(connection.readTurn);
+  }
+
+  connection.lastUsed = Clock::now();
+  if (--connection.requests == 0 && connection.broken) {
+    for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+      if (it->get() == &connection) {
+        closeConnection(connection);
+        m_connections.erase(it);
+        break;
+      }
+    }
+
+    if (!succeeded) {
+      m_connected = false;
+      for (auto& other : m_connections) {
+        m_connected = m_connected || (other->connected && !other->broken);
+      }
+    }
+  }
+
+  notifyAll(m_connectionReleased);
+}
+
+void HttpClientPool::closeIdleConnections() {
+  if (m_idleTimeout.count() == 0) {
+    return;
+  }
+
+  Clock::time_point idleSince = Clock::now() - m_idleTimeout;
+  for (auto it = m_connections.begin(); it != m_connections.end();) {
+    if ((*it)->requests == 0 && (*it)->lastUsed < idleSince) {
+      closeConnection(**it);
+      it = m_connections.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void HttpClientPool::closeConnection(Connection& connection) {
+  connection.streamBuf.reset();
+  if (connection.connected) {
+    try {
+      connection.connection.write(static_cast<const uint8_t*>(nullptr), 0); //Socket shutdown.
+    } catch (std::exception&) {
+      //Ignoring possible exception.
+    }
+  }
+
+  connection.connected = false;
+}
+
+void HttpClientPool::notifyAll(System::Event& event) {
+  // waiters are resumed and check what they wait for themselves
+  event.set();
+  event.clear();
+}
+
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+
+#include <HTTP/HttpRequest.h>
+#include <HTTP/HttpResponse.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/TcpConnection.h>
+#include <System/TcpStream.h>
+
+namespace CryptoNote {
+
+// HTTP client for a single server keeping several connections open, so requests of different contexts
+// of the dispatcher don't wait for each other. Connections are opened on demand, up to the limit.
+class HttpClientPool {
+public:
+
+  HttpClientPool(System::Dispatcher& dispatcher, const std::string& address, uint16_t port);
+  HttpClientPool(const HttpClientPool&) = delete;
+  ~HttpClientPool();
+  HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+  void setMaxConnections(size_t count);
+  // Up to 'depth' requests are sent over a connection before their responses come, one sends them one by one.
+  void setPipelining(size_t depth);
+  // A request taking longer, including waiting for a connection, fails and its connection is closed. Zero doesn't limit it.
+  void setRequestTimeout(std::chrono::milliseconds timeout);
+  // Connections idle for longer are closed instead of reused, before the server closes them.
+  void setIdleTimeout(std::chrono::milliseconds timeout);
+  // After failing to connect, requests fail right away until the delay passes, it doubles with each failure up to the maximum.
+  void setReconnectDelay(std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay);
+
+  // Throws ConnectException if the server can't be connected.
+  void request(const HttpRequest& req, HttpResponse& res);
+  // Same as above with a timeout of its own, for requests the server is expected to hold.
+  void request(const HttpRequest& req, HttpResponse& res, std::chrono::milliseconds timeout);
+
+  bool isConnected() const;
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Connection {
+    explicit Connection(System::Dispatcher& dispatcher) : writeFree(dispatcher), readTurn(dispatcher) {
+    }
+
+    System::TcpConnection connection;
+    std::unique_ptr<System::TcpStreambuf> streamBuf;
+    // requests holding the connection, sending or waiting for their responses
+    size_t requests = 0;
+    bool connected = false;
+    bool writing = false;
+    // broken connections take no more requests and are closed once the last one leaves
+    bool broken = false;
+    // responses come in the order requests were sent
+    uint64_t nextSent = 0;
+    uint64_t nextReceived = 0;
+    Clock::time_point lastUsed;
+    System::Event writeFree;
+    System::Event readTurn;
+  };
+
+  void doRequest(const HttpRequest& req, HttpResponse& res);
+  Connection& acquireConnection();
+  void connect(Connection& connection);
+  void releaseConnection(Connection& connection, bool succeeded);
+  void closeIdleConnections();
+  void closeConnection(Connection& connection);
+  static void notifyAll(System::Event& event);
+
+  System::Dispatcher& m_dispatcher;
+  const std::string m_address;
+  const uint16_t m_port;
+  size_t m_maxConnections;
+  size_t m_pipeliningDepth;
+  std::chrono::milliseconds m_requestTimeout;
+  std::chrono::milliseconds m_idleTimeout;
+  std::chrono::milliseconds m_minReconnectDelay;
+  std::chrono::milliseconds m_maxReconnectDelay;
+  std::list<std::unique_ptr<Connection>> m_connections;
+  System::Event m_connectionReleased;
+  bool m_connected;
+  size_t m_connectFailures;
+  Clock::time_point m_nextConnectTime;
+};
+
+}
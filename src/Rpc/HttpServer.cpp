@@ -36,35 +36,121 @@
 
 
 #include "HttpServer.h"
+#include <cassert>
+#include <cstring>
+#include <future>
 #include <boost/scope_exit.hpp>
 
 #include <Common/Base64.h>
-#include <HTTP/HttpParser.h>
+#include <HTTP/HttpCompression.h>
+#include <HTTP/HttpParserErrorCodes.h>
+#include <HTTP/HttpRequestParser.h>
 #include <System/InterruptedException.h>
-#include <System/TcpStream.h>
+#include <System/IoBuffer.h>
 #include <System/Ipv4Address.h>
 
 using namespace Logging;
 
 namespace {
+	const size_t READ_BUFFER_SIZE = 64 * 1024;
+	const size_t DEFAULT_MAX_HEADERS_SIZE = 16 * 1024;
+	const size_t DEFAULT_MAX_BODY_SIZE = 32 * 1024 * 1024;
+	const std::chrono::seconds DEFAULT_IDLE_TIMEOUT(60);
+	const std::chrono::seconds DEFAULT_REQUEST_TIMEOUT(30);
+	const size_t DEFAULT_MAX_CONNECTIONS = 256;
+	const int DEFAULT_COMPRESSION_LEVEL = 6;
+	const size_t DEFAULT_COMPRESSION_MIN_SIZE = 1024;
+
 	void fillUnauthorizedResponse(CryptoNote::HttpResponse& response) {
 		response.setStatus(CryptoNote::HttpResponse::STATUS_401);
 		response.addHeader("WWW-Authenticate", "Basic realm=\"RPC\"");
 		response.addHeader("Content-Type", "text/plain");
 		response.setBody("Authorization required");
 	}
+
+	void fillBadRequestResponse(const std::system_error& error, CryptoNote::HttpResponse& response) {
+		using CryptoNote::error::HttpParserErrorCodes;
+
+		if (error.code() == make_error_code(HttpParserErrorCodes::HEADERS_TOO_LARGE) ||
+			error.code() == make_error_code(HttpParserErrorCodes::BODY_TOO_LARGE)) {
+			response.setStatus(CryptoNote::HttpResponse::STATUS_413);
+		} else {
+			response.setStatus(CryptoNote::HttpResponse::STATUS_400);
+		}
+
+		response.addHeader("Content-Type", "text/plain");
+	}
 }
 
 namespace CryptoNote {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer"), m_timeoutTimer(dispatcher),
+  m_maxHeadersSize(DEFAULT_MAX_HEADERS_SIZE), m_maxBodySize(DEFAULT_MAX_BODY_SIZE), m_idleTimeout(DEFAULT_IDLE_TIMEOUT),
+  m_requestTimeout(DEFAULT_REQUEST_TIMEOUT), m_maxConnections(DEFAULT_MAX_CONNECTIONS), m_compressionLevel(DEFAULT_COMPRESSION_LEVEL),
+  m_compressionMinSize(DEFAULT_COMPRESSION_MIN_SIZE) {
+
+}
+
+HttpServer::~HttpServer() {
+  stopProcessingThreads();
+}
+
+void HttpServer::setProcessingThreads(size_t count) {
+  assert(m_processingThreads.empty());
+
+  for (size_t i = 0; i < count; ++i) {
+    std::unique_ptr<ProcessingThread> processingThread(new ProcessingThread());
+    ProcessingThread* worker = processingThread.get();
+    std::promise<void> started;
+    std::future<void> startedFuture = started.get_future();
+
+    worker->thread = std::thread([worker, &started] {
+      System::Dispatcher dispatcher;
+      System::Event stopEvent(dispatcher);
+      worker->dispatcher = &dispatcher;
+      worker->stopEvent = &stopEvent;
+      started.set_value();
+
+      stopEvent.wait();
+    });
+
+    startedFuture.wait();
+    m_processingThreads.push_back(std::move(processingThread));
+  }
+}
 
+void HttpServer::setDefaultMethodLimit(size_t concurrency, size_t queueDepth) {
+  m_defaultMethodLimit = { concurrency, queueDepth };
+}
+
+void HttpServer::setMethodLimit(const std::string& method, size_t concurrency, size_t queueDepth) {
+  m_methodLimits[method] = { concurrency, queueDepth };
+}
+
+void HttpServer::setRequestLimits(size_t maxHeadersSize, size_t maxBodySize) {
+  m_maxHeadersSize = maxHeadersSize;
+  m_maxBodySize = maxBodySize;
+}
+
+void HttpServer::setTimeouts(std::chrono::seconds idleTimeout, std::chrono::seconds requestTimeout) {
+  m_idleTimeout = idleTimeout;
+  m_requestTimeout = requestTimeout;
+}
+
+void HttpServer::setMaxConnections(size_t count) {
+  m_maxConnections = count;
+}
+
+void HttpServer::setCompression(int level, size_t minSize) {
+  m_compressionLevel = level;
+  m_compressionMinSize = minSize;
 }
 
 void HttpServer::start(const std::string& address, uint16_t port, const std::string& user, const std::string& password) {
   m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
   workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+  workingContextGroup.spawn(std::bind(&HttpServer::timeoutLoop, this));
   
   		if (!user.empty() || !password.empty()) {
 			m_credentials = Tools::Base64::encode(user + ":" + password);
@@ -74,16 +160,187 @@ void HttpServer::start(const std::string& address, uint16_t port, const std::str
 void HttpServer::stop() {
   workingContextGroup.interrupt();
   workingContextGroup.wait();
+  stopProcessingThreads();
+}
+
+void HttpServer::stopProcessingThreads() {
+  for (auto& worker : m_processingThreads) {
+    System::Event* stopEvent = worker->stopEvent;
+    worker->dispatcher->remoteSpawn([stopEvent] { stopEvent->set(); });
+    worker->thread.join();
+  }
+
+  m_processingThreads.clear();
+}
+
+std::string HttpServer::getMethodName(const HttpRequest& request) const {
+  return request.getUrl();
+}
+
+void HttpServer::fillBusyResponse(const HttpRequest& request, HttpResponse& response) {
+  response.setStatus(HttpResponse::STATUS_503);
+  response.addHeader("Retry-After", "1");
+  response.setBody("Server is busy");
+}
+
+bool HttpServer::isProcessedOnServerDispatcher(const HttpRequest& request) const {
+  return false;
+}
+
+void HttpServer::handleRequest(const HttpRequest& request, HttpResponse& response) {
+  std::string method = getMethodName(request);
+  if (!acquireMethodSlot(method)) {
+    logger(DEBUGGING) << "Too many requests of " << method << ", answering busy";
+    fillBusyResponse(request, response);
+    return;
+  }
+
+  BOOST_SCOPE_EXIT_ALL(this, &method) {
+    releaseMethodSlot(method);
+  };
+
+  if (m_processingThreads.empty() || isProcessedOnServerDispatcher(request)) {
+    processAndCompress(request, response);
+  } else {
+    processOnWorker(request, response);
+  }
+}
+
+void HttpServer::processAndCompress(const HttpRequest& request, HttpResponse& response) {
+  processRequest(request, response);
+  compressResponse(request, response);
+}
+
+void HttpServer::compressResponse(const HttpRequest& request, HttpResponse& response) const {
+  if (m_compressionLevel == 0 || response.getStatus() != HttpResponse::STATUS_200 ||
+    response.getBody().size() < m_compressionMinSize || response.getHeaders().count("Content-Encoding") != 0) {
+    return;
+  }
+
+  auto headerIt = request.getHeaders().find("accept-encoding");
+  if (headerIt == request.getHeaders().end()) {
+    return;
+  }
+
+  std::string contentEncoding = selectContentEncoding(headerIt->second);
+  if (contentEncoding.empty()) {
+    return;
+  }
+
+  std::string body;
+  compressBody(response.getBody(), contentEncoding, m_compressionLevel, body);
+  response.setBody(std::move(body));
+  response.addHeader("Content-Encoding", contentEncoding);
+  response.addHeader("Vary", "Accept-Encoding");
+}
+
+bool HttpServer::acquireMethodSlot(const std::string& method) {
+  auto limitIt = m_methodLimits.find(method);
+  const MethodLimit& limit = limitIt != m_methodLimits.end() ? limitIt->second : m_defaultMethodLimit;
+  MethodState& state = m_methodStates[method];
+  if (limit.concurrency == 0 || state.running < limit.concurrency) {
+    ++state.running;
+    return true;
+  }
+
+  if (state.waiting.size() >= limit.queueDepth) {
+    return false;
+  }
+
+  // releaseMethodSlot hands its slot over by setting the event, running stays the same
+  System::Event slotFree(m_dispatcher);
+  auto waitingIt = state.waiting.insert(state.waiting.end(), &slotFree);
+  try {
+    slotFree.wait();
+  } catch (System::InterruptedException&) {
+    if (slotFree.get()) {
+      releaseMethodSlot(method);
+    } else {
+      state.waiting.erase(waitingIt);
+    }
+
+    throw;
+  }
+
+  return true;
+}
+
+void HttpServer::releaseMethodSlot(const std::string& method) {
+  auto stateIt = m_methodStates.find(method);
+  assert(stateIt != m_methodStates.end());
+  MethodState& state = stateIt->second;
+  if (!state.waiting.empty()) {
+    state.waiting.front()->set();
+    state.waiting.pop_front();
+  } else if (--state.running == 0) {
+    m_methodStates.erase(stateIt);
+  }
+}
+
+void HttpServer::processOnWorker(const HttpRequest& request, HttpResponse& response) {
+  ProcessingThread& worker = *m_processingThreads[m_nextProcessingThread++ % m_processingThreads.size()];
+
+  System::Dispatcher& serverDispatcher = m_dispatcher;
+  System::Event done(m_dispatcher);
+  std::exception_ptr error;
+  worker.dispatcher->remoteSpawn([&] {
+    try {
+      processAndCompress(request, response);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    System::Event* doneEvent = &done;
+    serverDispatcher.remoteSpawn([doneEvent] { doneEvent->set(); });
+  });
+
+  // request and response live on this stack, so wait for the worker even if interrupted
+  bool interrupted = false;
+  while (!done.get()) {
+    try {
+      done.wait();
+    } catch (System::InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    throw System::InterruptedException();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void HttpServer::runOnServerDispatcher(const std::function<void()>& procedure) {
+  if (m_processingThreads.empty()) {
+    procedure();
+    return;
+  }
+
+  std::promise<void> promise;
+  std::future<void> future = promise.get_future();
+  m_dispatcher.remoteSpawn([&procedure, &promise] {
+    try {
+      procedure();
+      promise.set_value();
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  });
+
+  future.get();
 }
 
 void HttpServer::acceptLoop() {
   try {
-    System::TcpConnection connection; 
+    Connection connection;
     bool accepted = false;
 
     while (!accepted) {
       try {
-        connection = m_listener.accept();
+        connection.connection = m_listener.accept();
         accepted = true;
       } catch (System::InterruptedException&) {
         throw;
@@ -92,54 +349,181 @@ void HttpServer::acceptLoop() {
       }
     }
 
-    m_connections.insert(&connection);
-    BOOST_SCOPE_EXIT_ALL(this, &connection) { 
+    workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+
+    auto addr = std::pair<System::Ipv4Address, uint16_t>(static_cast<System::Ipv4Address>(0), 0);
+    try {
+      addr = connection.connection.getPeerAddressAndPort();
+    } catch (std::runtime_error&) {
+      logger(WARNING) << "Could not get IP of connection";
+    }
+
+    if (m_maxConnections != 0 && get_connections_count() >= m_maxConnections) {
+      logger(DEBUGGING) << "Too many connections, closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second;
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
+      m_connections.insert(&connection);
+    }
+    BOOST_SCOPE_EXIT_ALL(this, &connection) {
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
       m_connections.erase(&connection); };
 
-	workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
+    std::string peer = addr.first.toDottedDecimal() + ":" + std::to_string(addr.second);
+    logger(DEBUGGING) << "Incoming connection from " << peer;
 
-	//auto addr = connection.getPeerAddressAndPort();
-	auto addr = std::pair<System::Ipv4Address, uint16_t>(static_cast<System::Ipv4Address>(0), 0);
-	try {
-		addr = connection.getPeerAddressAndPort();
-	} catch (std::runtime_error&) {
-		logger(WARNING) << "Could not get IP of connection";
-	}
+    // a separate context, so timeoutLoop can interrupt it
+    System::Context<> context(m_dispatcher, [this, &connection, &peer] { serveConnection(connection, peer); });
+    connection.context = &context;
+    context.get();
 
-    logger(DEBUGGING) << "Incoming connection from " << addr.first.toDottedDecimal() << ":" << addr.second;
+    logger(DEBUGGING) << "Closing connection from " << peer << " total=" << get_connections_count();
 
-    System::TcpStreambuf streambuf(connection);
-    std::iostream stream(&streambuf);
-    HttpParser parser;
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    logger(DEBUGGING) << "Connection error: " << e.what();
+  }
+}
 
+void HttpServer::timeoutLoop() {
+  try {
     for (;;) {
-      HttpRequest req;
-      HttpResponse resp;
-	  resp.addHeader("Access-Control-Allow-Origin", "*");
-	  resp.addHeader("content-type", "application/json");
-	
-      parser.receiveRequest(stream, req);
-				if (authenticate(req)) {
-					processRequest(req, resp);
-				}
-				else {
-					logger(WARNING) << "Authorization required " << addr.first.toDottedDecimal() << ":" << addr.second;
-					fillUnauthorizedResponse(resp);
-				}
-
-      stream << resp;
-      stream.flush();
-
-      if (stream.peek() == std::iostream::traits_type::eof()) {
+      m_timeoutTimer.sleep(std::chrono::seconds(1));
+      auto now = Clock::now();
+
+      std::lock_guard<std::mutex> lock(m_connectionsMutex);
+      for (Connection* connection : m_connections) {
+        if (connection->deadline < now && connection->context != nullptr) {
+          logger(DEBUGGING) << "Connection timed out, closing it";
+          connection->deadline = Clock::time_point::max();
+          connection->context->interrupt();
+        }
+      }
+    }
+  } catch (System::InterruptedException&) {
+  }
+}
+
+void HttpServer::serveConnection(Connection& connection, const std::string& peer) {
+  HttpRequestParser parser(m_maxHeadersSize, m_maxBodySize);
+  std::vector<char> buffer(READ_BUFFER_SIZE);
+  // received bytes not taken by complete requests yet
+  size_t begin = 0;
+  size_t end = 0;
+  HttpRequest request;
+  std::vector<HttpResponse> responses;
+  bool keepAlive = true;
+
+  while (keepAlive) {
+    // answer every complete request received so far, pipelined responses are written together
+    for (;;) {
+      size_t requestSize;
+      try {
+        requestSize = parser.parse(buffer.data() + begin, end - begin, request);
+      } catch (std::system_error& e) {
+        logger(DEBUGGING) << "Bad request from " << peer << ": " << e.what();
+        responses.emplace_back();
+        fillBadRequestResponse(e, responses.back());
+        responses.back().addHeader("Connection", "close");
+        keepAlive = false;
+        break;
+      }
+
+      if (requestSize == 0) {
+        break;
+      }
+
+      begin += requestSize;
+      keepAlive = parser.keepAlive();
+      connection.deadline = Clock::time_point::max();
+
+      responses.emplace_back();
+      HttpResponse& response = responses.back();
+      response.addHeader("Access-Control-Allow-Origin", "*");
+      response.addHeader("content-type", "application/json");
+      if (authenticate(request)) {
+        handleRequest(request, response);
+      } else {
+        logger(WARNING) << "Authorization required " << peer;
+        fillUnauthorizedResponse(response);
+      }
+
+      response.addHeader("Connection", keepAlive ? "keep-alive" : "close");
+      request = HttpRequest();
+      if (!keepAlive) {
         break;
       }
     }
 
-    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connections.size();
+    if (!responses.empty()) {
+      connection.deadline = Clock::now() + m_requestTimeout;
+      writeResponses(connection.connection, responses);
+      responses.clear();
+    }
 
-  } catch (System::InterruptedException&) {
-  } catch (std::exception& e) {
-    logger(DEBUGGING) << "Connection error: " << e.what();
+    if (!keepAlive) {
+      break;
+    }
+
+    if (begin == end) {
+      begin = end = 0;
+      if (buffer.size() > READ_BUFFER_SIZE) {
+        std::vector<char>(READ_BUFFER_SIZE).swap(buffer);
+      }
+
+      connection.deadline = Clock::now() + m_idleTimeout;
+    } else if (end == buffer.size()) {
+      if (begin != 0) {
+        memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+      } else {
+        // the parser limits how large a request can grow
+        buffer.resize(buffer.size() * 2);
+      }
+    }
+
+    bool newRequest = begin == end;
+    size_t read = connection.connection.read(reinterpret_cast<uint8_t*>(buffer.data() + end), buffer.size() - end);
+    if (read == 0) {
+      break;
+    }
+
+    if (newRequest) {
+      connection.deadline = Clock::now() + m_requestTimeout;
+    }
+
+    end += read;
+  }
+}
+
+void HttpServer::writeResponses(System::TcpConnection& connection, const std::vector<HttpResponse>& responses) {
+  std::vector<std::string> heads;
+  heads.reserve(responses.size());
+  std::vector<System::ConstIoBuffer> buffers;
+  buffers.reserve(responses.size() * 2);
+  for (const HttpResponse& response : responses) {
+    heads.push_back(response.getHead());
+    buffers.push_back({ reinterpret_cast<const uint8_t*>(heads.back().data()), heads.back().size() });
+    if (!response.getBody().empty()) {
+      buffers.push_back({ reinterpret_cast<const uint8_t*>(response.getBody().data()), response.getBody().size() });
+    }
+  }
+
+  size_t first = 0;
+  while (first < buffers.size()) {
+    size_t written = connection.write(&buffers[first], buffers.size() - first);
+    while (first < buffers.size() && written >= buffers[first].size) {
+      written -= buffers[first].size;
+      ++first;
+    }
+
+    if (written != 0) {
+      buffers[first].data += written;
+      buffers[first].size -= written;
+    }
   }
 }
 
@@ -163,6 +547,7 @@ bool HttpServer::authenticate(const HttpRequest& request) const {
 }
 
 size_t HttpServer::get_connections_count() const {
+	std::lock_guard<std::mutex> lock(m_connectionsMutex);
 	return m_connections.size();
 }
 
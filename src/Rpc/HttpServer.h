@@ -37,16 +37,25 @@
 
 #pragma once 
 
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
 
+#include <System/Context.h>
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
 #include <System/TcpListener.h>
 #include <System/TcpConnection.h>
 #include <System/Event.h>
+#include <System/Timer.h>
 
 #include <Logging/LoggerRef.h>
 
@@ -57,7 +66,25 @@ class HttpServer {
 public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
-
+  virtual ~HttpServer();
+
+  // Requests are processed by a pool of dispatchers on their own threads, connections stay on the server dispatcher.
+  // Zero processes requests on the server dispatcher itself. Must be called before start.
+  void setProcessingThreads(size_t count);
+  // At most 'concurrency' requests of a method are processed at once, up to 'queueDepth' more wait for a slot
+  // and the rest are answered as busy. Zero concurrency doesn't limit the method. Must be called before start.
+  void setDefaultMethodLimit(size_t concurrency, size_t queueDepth);
+  void setMethodLimit(const std::string& method, size_t concurrency, size_t queueDepth);
+  // Requests with larger headers or body are answered with an error and their connection is closed.
+  void setRequestLimits(size_t maxHeadersSize, size_t maxBodySize);
+  // Connections are closed when idle for longer than 'idleTimeout' between requests, or when receiving a request
+  // or sending responses takes longer than 'requestTimeout'.
+  void setTimeouts(std::chrono::seconds idleTimeout, std::chrono::seconds requestTimeout);
+  // Connections accepted over the limit are closed right away, zero doesn't limit them.
+  void setMaxConnections(size_t count);
+  // Responses of at least 'minSize' bytes are compressed with gzip or deflate when the request accepts it.
+  // Level is zlib's, from 1 to 9, zero disables compression.
+  void setCompression(int level, size_t minSize);
   void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "");
   void stop();
 
@@ -66,18 +93,79 @@ public:
 
 protected:
 
+  // Name the request is limited by, the url by default.
+  virtual std::string getMethodName(const HttpRequest& request) const;
+  // Answers a request rejected by its method limit, with 503 by default.
+  virtual void fillBusyResponse(const HttpRequest& request, HttpResponse& response);
+  // Requests that mostly wait, like long polls, are processed on the server dispatcher instead of
+  // holding a processing thread; such handlers must not block the thread. False by default.
+  virtual bool isProcessedOnServerDispatcher(const HttpRequest& request) const;
+
+  // Runs procedure on the server dispatcher, blocking the calling processing thread until it is done.
+  // Use it for objects shared with the server dispatcher that aren't thread safe.
+  void runOnServerDispatcher(const std::function<void()>& procedure);
+
   System::Dispatcher& m_dispatcher;
 
 private:
 
+  struct ProcessingThread {
+    std::thread thread;
+    System::Dispatcher* dispatcher = nullptr;
+    System::Event* stopEvent = nullptr;
+  };
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Connection {
+    System::TcpConnection connection;
+    System::Context<>* context = nullptr;
+    // the connection is interrupted once it passes, max while a request is processed
+    Clock::time_point deadline = Clock::time_point::max();
+  };
+
+  struct MethodLimit {
+    size_t concurrency;
+    size_t queueDepth;
+  };
+
+  // only used on the server dispatcher, kept while the method has requests in flight
+  struct MethodState {
+    size_t running = 0;
+    std::list<System::Event*> waiting;
+  };
+
   void acceptLoop();
-  void connectionHandler(System::TcpConnection&& conn);
+  void timeoutLoop();
+  void serveConnection(Connection& connection, const std::string& peer);
+  void writeResponses(System::TcpConnection& connection, const std::vector<HttpResponse>& responses);
+  void handleRequest(const HttpRequest& request, HttpResponse& response);
+  void processAndCompress(const HttpRequest& request, HttpResponse& response);
+  void compressResponse(const HttpRequest& request, HttpResponse& response) const;
+  bool acquireMethodSlot(const std::string& method);
+  void releaseMethodSlot(const std::string& method);
+  void processOnWorker(const HttpRequest& request, HttpResponse& response);
+  void stopProcessingThreads();
   bool authenticate(const HttpRequest& request) const;
 
   System::ContextGroup workingContextGroup;
   Logging::LoggerRef logger;
   System::TcpListener m_listener;
-  std::unordered_set<System::TcpConnection*> m_connections;
+  System::Timer m_timeoutTimer;
+  std::unordered_set<Connection*> m_connections;
+  mutable std::mutex m_connectionsMutex;
+  std::vector<std::unique_ptr<ProcessingThread>> m_processingThreads;
+  size_t m_nextProcessingThread = 0;
+  size_t m_maxHeadersSize;
+  size_t m_maxBodySize;
+  std::chrono::seconds m_idleTimeout;
+  std::chrono::seconds m_requestTimeout;
+  size_t m_maxConnections;
+  int m_compressionLevel;
+  size_t m_compressionMinSize;
+  MethodLimit m_defaultMethodLimit = { 0, 0 };
+  std::unordered_map<std::string, MethodLimit> m_methodLimits;
+  std::unordered_map<std::string, MethodState> m_methodStates;
   std::string m_credentials;
 };
 
@@ -40,6 +40,7 @@
 #include <boost/optional.hpp>
 #include <boost/foreach.hpp>
 #include <functional>
+#include <memory>
 
 #include "CoreRpcServerCommandsDefinitions.h"
 #include <Common/JsonValue.h>
@@ -90,28 +91,49 @@ public:
 
   bool parseRequest(const std::string& requestBody) {
     try {
-      psReq = Common::JsonValue::fromString(requestBody);
+      request.reset(new JsonInputBufferSerializer(std::string(requestBody)));
     } catch (std::exception&) {
       throw JsonRpcError(errParseError);
     }
 
-    if (!psReq.contains("method")) {
+    if (!(*request)(method, "method")) {
       throw JsonRpcError(errInvalidRequest);
     }
 
-    method = psReq("method").getString();
-
-    if (psReq.contains("id")) {
-      id = psReq("id");
+    std::string idText;
+    if (request->raw(idText, "id")) {
+      id = Common::JsonValue::fromString(idText);
     }
 
     return true;
   }
 
+  // params are read from the request text directly, only arrays still go through JsonValue
   template <typename T>
   bool loadParams(T& v) const {
-    loadFromJsonValue(v, psReq.contains("params") ? 
-      psReq("params") : Common::JsonValue(Common::JsonValue::NIL));
+    if (!request) {
+      loadFromJsonValue(v, getParams());
+      return true;
+    }
+
+    if (!request->beginObject("params")) {
+      throw std::runtime_error("Serializer doesn't support this type of serialization: Object expected.");
+    }
+
+    serialize(v, *request);
+    request->endObject();
+    return true;
+  }
+
+  template <typename T>
+  bool loadParams(std::vector<T>& v) const {
+    loadFromJsonValue(v, getParams());
+    return true;
+  }
+
+  template <typename T>
+  bool loadParams(std::list<T>& v) const {
+    loadFromJsonValue(v, getParams());
     return true;
   }
 
@@ -141,7 +163,18 @@ public:
 
 private:
 
+  Common::JsonValue getParams() const {
+    if (!request) {
+      return psReq.contains("params") ? psReq("params") : Common::JsonValue(Common::JsonValue::NIL);
+    }
+
+    std::string params;
+    return request->raw(params, "params") ? Common::JsonValue::fromString(params) : Common::JsonValue(Common::JsonValue::NIL);
+  }
+
+  // client side requests are built in psReq, parsed ones are read through 'request'
   Common::JsonValue psReq;
+  std::unique_ptr<JsonInputBufferSerializer> request;
   OptionalId id;
   std::string method;
 };
@@ -168,6 +201,7 @@ public:
 
   void setError(const JsonRpcError& err) {
     psResp.set("error", storeToJsonValue(err));
+    result.clear();
   }
 
   bool getError(JsonRpcError& err) const {
@@ -181,12 +215,23 @@ public:
 
   std::string getBody() {
     psResp.set("jsonrpc", std::string("2.0"));
-    return psResp.toString();
+    if (result.empty()) {
+      return psResp.toString();
+    }
+
+    // the result is already JSON text, written around instead of being parsed into psResp
+    JsonOutputBufferSerializer s;
+    for (const auto& member : psResp.getObject()) {
+      s.raw(member.second.toString(), member.first);
+    }
+
+    s.raw(result, "result");
+    return s.release();
   }
 
   template <typename T>
   bool setResult(const T& v) {
-    psResp.set("result", storeToJsonValue(v));
+    result = storeToJsonBuffer(v);
     return true;
   }
 
@@ -202,6 +247,8 @@ public:
 
 private:
   Common::JsonValue psResp;
+  // serialized result on the server side, the client reads it from psResp
+  std::string result;
 };
 
 
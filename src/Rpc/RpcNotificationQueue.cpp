@@ -0,0 +1,102 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "RpcNotificationQueue.h"
+
+#include <algorithm>
+
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+namespace {
+
+// 0 is what clients send before they know the epoch
+uint64_t generateEpoch() {
+  uint64_t epoch;
+  do {
+    epoch = Crypto::rand<uint64_t>();
+  } while (epoch == 0);
+
+  return epoch;
+}
+
+}
+
+RpcNotificationQueue::RpcNotificationQueue(size_t maxSize) : m_maxSize(maxSize), m_epoch(generateEpoch()), m_lastId(0) {
+}
+
+void RpcNotificationQueue::push(const std::string& type, uint32_t height, const Crypto::Hash& hash) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Notification notification;
+  notification.id = ++m_lastId;
+  notification.type = type;
+  notification.height = height;
+  notification.hash = hash;
+  m_notifications.push_back(std::move(notification));
+  if (m_notifications.size() > m_maxSize) {
+    m_notifications.pop_front();
+  }
+}
+
+bool RpcNotificationQueue::getSince(uint64_t epoch, uint64_t since, size_t maxCount, std::vector<Notification>& notifications, uint64_t& lastId) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  notifications.clear();
+  lastId = m_lastId;
+
+  // a new subscriber starts from now, replaying old events would only make it refresh its state several times;
+  // ids of a previous run say nothing about this one, even when they happen to be in range
+  if (since == 0 || epoch != m_epoch) {
+    return false;
+  }
+
+  uint64_t firstId = m_notifications.empty() ? m_lastId + 1 : m_notifications.front().id;
+  if (since > m_lastId || since + 1 < firstId) {
+    return false;
+  }
+
+  size_t count = std::min(static_cast<size_t>(m_lastId - since), maxCount);
+  auto begin = m_notifications.begin() + static_cast<size_t>(since + 1 - firstId);
+  notifications.assign(begin, begin + count);
+  if (!notifications.empty()) {
+    lastId = notifications.back().id;
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CoreRpcServerCommandsDefinitions.h"
+
+namespace CryptoNote {
+
+// Chain and pool events kept for RPC subscribers, numbered from 1 without gaps and dropped oldest first.
+// The ids are only meaningful within the epoch, a random value picked anew on every start.
+// Filled from whichever thread changed the core, read on the RPC server dispatcher.
+class RpcNotificationQueue {
+public:
+  typedef COMMAND_RPC_GET_NOTIFICATIONS::notification Notification;
+
+  explicit RpcNotificationQueue(size_t maxSize);
+
+  void push(const std::string& type, uint32_t height, const Crypto::Hash& hash);
+  // up to maxCount notifications with ids above since and the id to continue from, false if some of them
+  // were dropped already, since is ahead of the queue or it was taken from another epoch, also for since 0 which
+  // only asks for the id to start from
+  bool getSince(uint64_t epoch, uint64_t since, size_t maxCount, std::vector<Notification>& notifications, uint64_t& lastId) const;
+  uint64_t getEpoch() const { return m_epoch; }
+
+private:
+  mutable std::mutex m_mutex;
+  std::deque<Notification> m_notifications;
+  size_t m_maxSize;
+  const uint64_t m_epoch;
+  uint64_t m_lastId;
+};
+
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+#include "RpcResponseCache.h"
+
+namespace CryptoNote {
+
+RpcResponseCache::RpcResponseCache(size_t maxSize) : m_maxSize(maxSize), m_size(0), m_generation(0), m_hits(0), m_misses(0) {
+}
+
+void RpcResponseCache::setMaxSize(size_t maxSize) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxSize = maxSize;
+  shrink();
+}
+
+uint64_t RpcResponseCache::getGeneration() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_generation;
+}
+
+bool RpcResponseCache::get(const std::string& method, const Crypto::Hash& hash, std::string& response) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(makeKey(method, hash));
+  if (it == m_index.end()) {
+    ++m_misses;
+    return false;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  response = it->second->response;
+  ++m_hits;
+  return true;
+}
+
+void RpcResponseCache::put(const std::string& method, const Crypto::Hash& hash, uint64_t generation, std::string&& response) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (generation != m_generation || response.size() > m_maxSize) {
+    return;
+  }
+
+  std::string key = makeKey(method, hash);
+  auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_size -= it->second->key.size() + it->second->response.size();
+    m_entries.erase(it->second);
+    m_index.erase(it);
+  }
+
+  m_size += key.size() + response.size();
+  m_entries.push_front(Entry{ key, std::move(response) });
+  m_index.emplace(std::move(key), m_entries.begin());
+  shrink();
+}
+
+void RpcResponseCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_generation;
+  m_index.clear();
+  m_entries.clear();
+  m_size = 0;
+}
+
+uint64_t RpcResponseCache::getHits() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hits;
+}
+
+uint64_t RpcResponseCache::getMisses() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_misses;
+}
+
+size_t RpcResponseCache::getSize() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_size;
+}
+
+std::string RpcResponseCache::makeKey(const std::string& method, const Crypto::Hash& hash) {
+  std::string key(method);
+  key.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+  return key;
+}
+
+void RpcResponseCache::shrink() {
+  while (m_size > m_maxSize) {
+    const Entry& entry = m_entries.back();
+    m_size -= entry.key.size() + entry.response.size();
+    m_index.erase(entry.key);
+    m_entries.pop_back();
+  }
+}
+
+}
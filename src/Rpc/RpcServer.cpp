@@ -38,9 +38,12 @@
 #include "RpcServer.h"
 #include "version.h"
 
+#include <cctype>
 #include <future>
 #include <unordered_map>
 
+#include <boost/scope_exit.hpp>
+
 // CryptoNote
 #include "BlockchainExplorerData.h"
 #include "Common/StringTools.h"
@@ -56,6 +59,10 @@
 
 #include "P2p/NetNode.h"
 
+#include "System/Context.h"
+#include "System/Event.h"
+#include "System/Timer.h"
+
 #include "CoreRpcServerErrorCodes.h"
 #include "JsonRpc.h"
 
@@ -107,11 +114,142 @@ RpcServer::HandlerFunction jsonMethod(bool (RpcServer::*handler)(typename Comman
       response.addHeader("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
     }
     response.addHeader("Content-Type", "application/json");
-    response.setBody(storeToJson(res.data()));
+    response.setBody(storeToJsonBuffer(res.data()));
     return result;
   };
 }
 
+const size_t DEFAULT_RESPONSE_CACHE_SIZE = 32 * 1024 * 1024;
+
+const char NOTIFICATION_NEW_TIP[] = "new_tip";
+const char NOTIFICATION_REORG[] = "reorg";
+const char NOTIFICATION_POOL_ADD[] = "pool_add";
+const char NOTIFICATION_POOL_REMOVE[] = "pool_remove";
+
+size_t skipJsonSpaces(const std::string& text, size_t pos) {
+  while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+    ++pos;
+  }
+
+  return pos;
+}
+
+// 'pos' is at the opening quote, returns the position after the closing one or npos
+size_t skipJsonString(const std::string& text, size_t pos) {
+  for (++pos; pos < text.size(); ++pos) {
+    if (text[pos] == '\\') {
+      ++pos;
+    } else if (text[pos] == '"') {
+      return pos + 1;
+    }
+  }
+
+  return std::string::npos;
+}
+
+// Returns the position after the value starting at 'pos' or npos. Only strings and brackets are tracked,
+// the value itself isn't validated.
+size_t skipJsonValue(const std::string& text, size_t pos) {
+  size_t depth = 0;
+  while (pos < text.size()) {
+    char c = text[pos];
+    if (c == '"') {
+      pos = skipJsonString(text, pos);
+      if (pos == std::string::npos || depth == 0) {
+        return pos;
+      }
+
+      continue;
+    }
+
+    if (c == '{' || c == '[') {
+      ++depth;
+    } else if (c == '}' || c == ']') {
+      if (depth == 0) {
+        return pos;
+      }
+
+      if (--depth == 0) {
+        return pos + 1;
+      }
+    } else if (depth == 0 && (c == ',' || std::isspace(static_cast<unsigned char>(c)))) {
+      return pos;
+    }
+
+    ++pos;
+  }
+
+  return depth == 0 ? pos : std::string::npos;
+}
+
+// Finds a member of the top level JSON object without parsing the rest of the text, requests are routed
+// and refused on the server dispatcher and a full parse of a large body would hold up every connection.
+bool findJsonMember(const std::string& text, const std::string& name, size_t& valueBegin, size_t& valueEnd) {
+  size_t pos = skipJsonSpaces(text, 0);
+  if (pos == text.size() || text[pos] != '{') {
+    return false;
+  }
+
+  pos = skipJsonSpaces(text, pos + 1);
+  while (pos < text.size() && text[pos] == '"') {
+    size_t keyEnd = skipJsonString(text, pos);
+    if (keyEnd == std::string::npos) {
+      return false;
+    }
+
+    bool found = text.compare(pos + 1, keyEnd - pos - 2, name) == 0;
+    pos = skipJsonSpaces(text, keyEnd);
+    if (pos == text.size() || text[pos] != ':') {
+      return false;
+    }
+
+    pos = skipJsonSpaces(text, pos + 1);
+    size_t end = skipJsonValue(text, pos);
+    if (end == std::string::npos || end == pos) {
+      return false;
+    }
+
+    if (found) {
+      valueBegin = pos;
+      valueEnd = end;
+      return true;
+    }
+
+    pos = skipJsonSpaces(text, end);
+    if (pos == text.size() || text[pos] != ',') {
+      return false;
+    }
+
+    pos = skipJsonSpaces(text, pos + 1);
+  }
+
+  return false;
+}
+
+template <typename T>
+bool loadCachedResponse(RpcResponseCache& cache, const std::string& method, const Crypto::Hash& hash, T& response) {
+  std::string blob;
+  return cache.get(method, hash, blob) && loadFromBinaryKeyValue(response, blob);
+}
+
+// key-value storage has no arrays of arrays, so the transaction with its signatures is kept as a blob
+struct CachedTransactionDetails {
+  std::string tx;
+  f_transaction_details_response txDetails;
+  block_short_response block;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(tx)
+    KV_MEMBER(txDetails)
+    KV_MEMBER(block)
+  }
+};
+
+template <typename T>
+void storeCachedResponse(RpcResponseCache& cache, const std::string& method, const Crypto::Hash& hash, uint64_t generation, const T& response) {
+  cache.put(method, hash, generation, storeToBinaryKeyValue(response));
+}
+
 }
 
 std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction>> RpcServer::s_handlers = {
@@ -120,10 +258,13 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false } },
   { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
   { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
+  { "/queryblockscompact.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_COMPACT>(&RpcServer::on_query_blocks_compact), false } },
   { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
+  { "/get_o_indexes_batch.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH>(&RpcServer::on_get_indexes_batch), false } },
   { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
   { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
   { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
+  { "/getnotifications.bin", { binMethod<COMMAND_RPC_GET_NOTIFICATIONS>(&RpcServer::onGetNotifications), true } },
 
   // http get json handlers
   { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true } },
@@ -132,6 +273,7 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } }, // deprecated
   { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
   { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true } },
+  { "/getnotifications", { jsonMethod<COMMAND_RPC_GET_NOTIFICATIONS>(&RpcServer::onGetNotifications), true } },
 
   // rpc post json handlers
   { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
@@ -140,6 +282,7 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/queryblocks", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
   { "/queryblockslite", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
   { "/get_o_indexes", { jsonMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
+  { "/get_o_indexes_batch", { jsonMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH>(&RpcServer::on_get_indexes_batch), false } },
   { "/getrandom_outs", { jsonMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
   { "/get_pool_changes", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
   { "/get_pool_changes_lite", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
@@ -148,6 +291,10 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/get_blocks_details_by_hashes", { jsonMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HASHES>(&RpcServer::onGetBlocksDetailsByHashes), false } },
   { "/get_blocks_hashes_by_timestamps", { jsonMethod<COMMAND_RPC_GET_BLOCKS_HASHES_BY_TIMESTAMPS>(&RpcServer::onGetBlocksHashesByTimestamps), false } },
   { "/get_transaction_details_by_hashes", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES>(&RpcServer::onGetTransactionsDetailsByHashes), false } },
+  { "/getblocksdetailsbyheights", { jsonMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH>(&RpcServer::onGetBlocksDetailsBatch), false } },
+  { "/getblocksdetailsbyheights.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH>(&RpcServer::onGetBlocksDetailsBatch), false } },
+  { "/gettransactionsdetailsbyhashes", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH>(&RpcServer::onGetTransactionsDetailsBatch), false } },
+  { "/gettransactionsdetailsbyhashes.bin", { binMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH>(&RpcServer::onGetTransactionsDetailsBatch), false } },
   { "/get_transaction_hashes_by_payment_id", { jsonMethod<COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID>(&RpcServer::onGetTransactionHashesByPaymentId), false } },
 
   // json rpc
@@ -155,7 +302,27 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, ICryptoNoteProtocolQuery& protocolQuery) :
-  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery), blockchainExplorerDataBuilder(c, protocolQuery) {
+  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery), blockchainExplorerDataBuilder(c, protocolQuery),
+  m_responseCache(DEFAULT_RESPONSE_CACHE_SIZE), m_notifications(RPC_NOTIFICATIONS_QUEUE_SIZE), m_notificationWakePending(false) {
+  // explorer queries walk many blocks or transactions, one at a time so they can't take every processing thread
+  for (const char* method : { "getblockslist", "f_blocks_list_json", "f_block_json", "f_transaction_json",
+      "gettransactionsbypaymentid", "k_transactions_by_payment_id", "getblocksbyheights", "getblocksbyhashes",
+      "get_blocks_details_by_heights", "get_blocks_details_by_hashes", "/get_blocks_details_by_heights",
+      "/get_blocks_details_by_hashes", "/get_transaction_hashes_by_payment_id", "getblocksdetailsbyheights",
+      "/getblocksdetailsbyheights", "/getblocksdetailsbyheights.bin", "gettransactionsdetailsbyhashes",
+      "/gettransactionsdetailsbyhashes", "/gettransactionsdetailsbyhashes.bin" }) {
+    setMethodLimit(method, 1, 16);
+  }
+
+  // subscribers hold their request until something happens, they only wait on the server dispatcher
+  setMethodLimit("/getnotifications", 0, 0);
+  setMethodLimit("/getnotifications.bin", 0, 0);
+
+  m_core.addObserver(this);
+}
+
+RpcServer::~RpcServer() {
+  m_core.removeObserver(this);
 }
 
 void RpcServer::processRequest(const HttpRequest& request, HttpResponse& response) {
@@ -178,6 +345,44 @@ void RpcServer::processRequest(const HttpRequest& request, HttpResponse& respons
   it->second.handler(this, request, response);
 }
 
+std::string RpcServer::getMethodName(const HttpRequest& request) const {
+  if (request.getUrl() != "/json_rpc") {
+    return request.getUrl();
+  }
+
+  // JSON-RPC methods are limited by their name, urls all start with '/'
+  const std::string& body = request.getBody();
+  size_t begin;
+  size_t end;
+  if (!findJsonMember(body, "method", begin, end) || body[begin] != '"' || end - begin <= 2) {
+    return request.getUrl();
+  }
+
+  return body.substr(begin + 1, end - begin - 2);
+}
+
+void RpcServer::fillBusyResponse(const HttpRequest& request, HttpResponse& response) {
+  if (request.getUrl() != "/json_rpc") {
+    HttpServer::fillBusyResponse(request, response);
+    return;
+  }
+
+  JsonRpc::JsonRpcResponse jsonResponse;
+  const std::string& body = request.getBody();
+  size_t begin;
+  size_t end;
+  if (findJsonMember(body, "id", begin, end)) {
+    try {
+      jsonResponse.setId(JsonValue::fromString(body.substr(begin, end - begin)));
+    } catch (std::exception&) {
+    }
+  }
+
+  jsonResponse.setError(JsonRpc::JsonRpcError(CORE_RPC_ERROR_CODE_SERVER_BUSY, "Server is busy"));
+  response.addHeader("Content-Type", "application/json");
+  response.setBody(jsonResponse.getBody());
+}
+
 bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse& response) {
 
   using namespace JsonRpc;
@@ -208,6 +413,7 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       { "getblockbyhash", { makeMemberMethod(&RpcServer::onGetBlockDetailsByHash), false } },
       { "getblocksbyheights", { makeMemberMethod(&RpcServer::onGetBlocksDetailsByHeights), false } },
       { "getblocksbyhashes", { makeMemberMethod(&RpcServer::onGetBlocksDetailsByHashes), false } },
+      { "getblocksdetailsbyheights", { makeMemberMethod(&RpcServer::onGetBlocksDetailsBatch), false } },
       { "getblockshashesbytimestamps", { makeMemberMethod(&RpcServer::onGetBlocksHashesByTimestamps), false } },
       { "getblockslist", { makeMemberMethod(&RpcServer::on_blocks_list_json), false } },
       { "getlastblockheader", { makeMemberMethod(&RpcServer::on_get_last_block_header), false } },
@@ -216,6 +422,7 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       { "gettransactionsbypaymentid", { makeMemberMethod(&RpcServer::on_get_transactions_by_payment_id), false } },
       { "gettransactionhashesbypaymentid", { makeMemberMethod(&RpcServer::onGetTransactionHashesByPaymentId), false } },
       { "gettransactionsbyhashes", { makeMemberMethod(&RpcServer::onGetTransactionsDetailsByHashes), false } },
+      { "gettransactionsdetailsbyhashes", { makeMemberMethod(&RpcServer::onGetTransactionsDetailsBatch), false } },
       { "getcurrencyid", { makeMemberMethod(&RpcServer::on_get_currency_id), true } },
       { "checktransactionkey", { makeMemberMethod(&RpcServer::on_check_tx_key), false } },
       { "checktransactionbyviewkey", { makeMemberMethod(&RpcServer::on_check_tx_with_view_key), false } },
@@ -268,8 +475,9 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
     jsonResponse.setError(JsonRpcError(JsonRpc::errInternalError, e.what()));
   }
 
-  response.setBody(jsonResponse.getBody());
-  logger(TRACE) << "JSON-RPC response: " << jsonResponse.getBody();
+  std::string body = jsonResponse.getBody();
+  logger(TRACE) << "JSON-RPC response: " << body;
+  response.setBody(std::move(body));
   return true;
 }
 
@@ -309,10 +517,51 @@ bool RpcServer::setContactInfo(const std::string& contact) {
   return true;
 }
 
+void RpcServer::setResponseCacheSize(size_t size) {
+  m_responseCache.setMaxSize(size);
+}
+
 bool RpcServer::isCoreReady() {
   return m_core.currency().isTestnet() || m_p2p.get_payload_object().isSynchronized();
 }
 
+bool RpcServer::isProcessedOnServerDispatcher(const HttpRequest& request) const {
+  return request.getUrl() == "/getnotifications" || request.getUrl() == "/getnotifications.bin";
+}
+
+void RpcServer::blockAdded(uint32_t height, const Crypto::Hash& blockHash) {
+  pushNotification(NOTIFICATION_NEW_TIP, height, blockHash);
+}
+
+void RpcServer::blockPopped(uint32_t height, const Crypto::Hash& blockHash) {
+  // cached responses may describe the popped block or count depth from it
+  m_responseCache.clear();
+  pushNotification(NOTIFICATION_REORG, height, blockHash);
+}
+
+void RpcServer::txAddedToPool(const Crypto::Hash& transactionHash) {
+  pushNotification(NOTIFICATION_POOL_ADD, 0, transactionHash);
+}
+
+void RpcServer::txRemovedFromPool(const Crypto::Hash& transactionHash) {
+  pushNotification(NOTIFICATION_POOL_REMOVE, 0, transactionHash);
+}
+
+void RpcServer::pushNotification(const char* type, uint32_t height, const Crypto::Hash& hash) {
+  m_notifications.push(type, height, hash);
+  // called from whichever thread changed the core, waiters are woken once per burst
+  if (!m_notificationWakePending.exchange(true)) {
+    m_dispatcher.remoteSpawn([this] { wakeNotificationWaiters(); });
+  }
+}
+
+void RpcServer::wakeNotificationWaiters() {
+  m_notificationWakePending = false;
+  for (System::Event* waiter : m_notificationWaiters) {
+    waiter->set();
+  }
+}
+
 bool RpcServer::masternode_check_incoming_tx(const BinaryArray& tx_blob) {
 	Crypto::Hash tx_hash = NULL_HASH;
 	Crypto::Hash tx_prefixt_hash = NULL_HASH;
@@ -374,18 +623,9 @@ bool RpcServer::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, C
   res.current_height = totalBlockCount;
   res.start_height = startBlockIndex;
 
-  for (const auto& blockId : supplement) {
-    assert(m_core.have_block(blockId));
-    auto completeBlock = m_core.getBlock(blockId);
-    assert(completeBlock != nullptr);
-
-    res.blocks.resize(res.blocks.size() + 1);
-    res.blocks.back().block = asString(toBinaryArray(completeBlock->getBlock()));
-
-    res.blocks.back().txs.reserve(completeBlock->getTransactionCount());
-    for (size_t i = 0; i < completeBlock->getTransactionCount(); ++i) {
-      res.blocks.back().txs.push_back(asString(toBinaryArray(completeBlock->getTransaction(i))));
-    }
+  if (!m_core.getBlockEntries(supplement, res.blocks)) {
+    res.status = "Failed";
+    return false;
   }
 
   res.status = CORE_RPC_STATUS_OK;
@@ -425,6 +665,22 @@ bool RpcServer::on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::reques
   return true;
 }
 
+bool RpcServer::on_query_blocks_compact(const COMMAND_RPC_QUERY_BLOCKS_COMPACT::request& req, COMMAND_RPC_QUERY_BLOCKS_COMPACT::response& res) {
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  if (!m_core.queryBlocksCompact(req.blockIds, req.timestamp, startHeight, currentHeight, fullOffset, res.items)) {
+    res.status = "Failed to perform query";
+    return false;
+  }
+
+  res.startHeight = startHeight;
+  res.currentHeight = currentHeight;
+  res.fullOffset = fullOffset;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res) {
   std::vector<uint32_t> outputIndexes;
   if (!m_core.get_tx_outputs_gindexs(req.txid, outputIndexes)) {
@@ -438,6 +694,28 @@ bool RpcServer::on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::
   return true;
 }
 
+bool RpcServer::on_get_indexes_batch(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH::response& res) {
+  if (req.txids.size() > COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT) {
+    res.status = "Too many transactions requested";
+    return true;
+  }
+
+  std::vector<std::vector<uint32_t>> outputIndexes;
+  if (!m_core.get_tx_outputs_gindexs(req.txids, outputIndexes)) {
+    res.status = "Failed";
+    return true;
+  }
+
+  res.txs.resize(outputIndexes.size());
+  for (size_t i = 0; i < outputIndexes.size(); ++i) {
+    res.txs[i].o_indexes = std::move(outputIndexes[i]);
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  logger(TRACE) << "COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH: [" << res.txs.size() << "]";
+  return true;
+}
+
 bool RpcServer::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
   res.status = "Failed";
   if (!m_core.get_random_outs_for_amounts(req, res)) {
@@ -651,6 +929,77 @@ bool RpcServer::onGetTransactionDetailsByHash(const COMMAND_RPC_GET_TRANSACTION_
   return true;
 }
 
+bool RpcServer::onGetBlocksDetailsBatch(const COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH::response& rsp) {
+  if (req.blockHeights.size() > COMMAND_RPC_GET_BLOCKS_DETAILS_MAX_COUNT) {
+    rsp.status = "Too many blocks requested";
+    return true;
+  }
+
+  // a consistent view of the chain for the whole batch, fill calls relock recursively without waiting
+  LockedCore lockedCore(m_core);
+  uint32_t currentHeight = m_core.get_current_blockchain_height();
+  std::vector<uint32_t> heights(req.blockHeights);
+  for (uint32_t height : heights) {
+    if (height >= currentHeight) {
+      rsp.status = "Too big height: " + std::to_string(height) + ", current blockchain height = " + std::to_string(currentHeight - 1);
+      return true;
+    }
+  }
+
+  for (const auto& range : req.heightRanges) {
+    uint64_t end = std::min<uint64_t>(static_cast<uint64_t>(range.firstHeight) + range.count, currentHeight);
+    for (uint64_t height = range.firstHeight; height < end; ++height) {
+      if (heights.size() == COMMAND_RPC_GET_BLOCKS_DETAILS_MAX_COUNT) {
+        rsp.status = "Too many blocks requested";
+        return true;
+      }
+
+      heights.push_back(static_cast<uint32_t>(height));
+    }
+  }
+
+  rsp.blocks.resize(heights.size());
+  for (size_t i = 0; i < heights.size(); ++i) {
+    Block block;
+    if (!m_core.getBlockByHash(m_core.getBlockIdByHeight(heights[i]), block) ||
+      !blockchainExplorerDataBuilder.fillBlockDetails(block, rsp.blocks[i])) {
+      rsp.blocks.clear();
+      rsp.status = "Internal error: can't fill details of block " + std::to_string(heights[i]);
+      return true;
+    }
+  }
+
+  rsp.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::onGetTransactionsDetailsBatch(const COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH::request& req, COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH::response& rsp) {
+  if (req.transactionHashes.size() > COMMAND_RPC_GET_TRANSACTIONS_DETAILS_MAX_COUNT) {
+    rsp.status = "Too many transactions requested";
+    return true;
+  }
+
+  LockedCore lockedCore(m_core);
+  std::list<Transaction> txs;
+  std::list<Crypto::Hash> missedTxs;
+  m_core.getTransactions(req.transactionHashes, txs, missedTxs, true);
+
+  // blockchain transactions come before pool ones, each carries its hash
+  rsp.transactions.resize(txs.size());
+  size_t i = 0;
+  for (const Transaction& tx : txs) {
+    if (!blockchainExplorerDataBuilder.fillTransactionDetails(tx, rsp.transactions[i++])) {
+      rsp.transactions.clear();
+      rsp.status = "Internal error: can't fill transaction details";
+      return true;
+    }
+  }
+
+  rsp.missedTransactions.assign(missedTxs.begin(), missedTxs.end());
+  rsp.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::onGetTransactionHashesByPaymentId(const COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID::request& req, COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID::response& rsp) {
   rsp.transactionHashes = m_core.getTransactionHashesByPaymentId(req.paymentId);
 
@@ -658,6 +1007,37 @@ bool RpcServer::onGetTransactionHashesByPaymentId(const COMMAND_RPC_GET_TRANSACT
   return true;
 }
 
+bool RpcServer::onGetNotifications(const COMMAND_RPC_GET_NOTIFICATIONS::request& req, COMMAND_RPC_GET_NOTIFICATIONS::response& rsp) {
+  // processed on the server dispatcher, see isProcessedOnServerDispatcher()
+  rsp.epoch = m_notifications.getEpoch();
+  rsp.missed = !m_notifications.getSince(req.epoch, req.since, COMMAND_RPC_GET_NOTIFICATIONS_MAX_COUNT, rsp.notifications, rsp.lastId);
+  if (rsp.notifications.empty() && !rsp.missed && req.timeout != 0) {
+    // held requests keep their connections open, leave most of the server connections to other requests
+    if (m_notificationWaiters.size() >= RPC_NOTIFICATIONS_MAX_WAITERS) {
+      rsp.status = CORE_RPC_STATUS_BUSY;
+      return true;
+    }
+
+    System::Event notified(m_dispatcher);
+    auto waiter = m_notificationWaiters.insert(m_notificationWaiters.end(), &notified);
+    BOOST_SCOPE_EXIT_ALL(this, waiter) {
+      m_notificationWaiters.erase(waiter);
+    };
+
+    uint32_t timeout = std::min(req.timeout, COMMAND_RPC_GET_NOTIFICATIONS_MAX_WAIT);
+    System::Context<> timeoutContext(m_dispatcher, [this, timeout, &notified] {
+      System::Timer(m_dispatcher).sleep(std::chrono::seconds(timeout));
+      notified.set();
+    });
+
+    notified.wait();
+    rsp.missed = !m_notifications.getSince(req.epoch, req.since, COMMAND_RPC_GET_NOTIFICATIONS_MAX_COUNT, rsp.notifications, rsp.lastId);
+  }
+
+  rsp.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 //
 // JSON handlers
 //
@@ -668,12 +1048,15 @@ bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RP
   res.tx_count = m_core.get_blockchain_total_transactions() - res.height; //without coinbase
   res.tx_pool_size = m_core.get_pool_transactions_count();
   res.alt_blocks_count = m_core.get_alternative_blocks_count();
-  uint64_t total_conn = m_p2p.get_connections_count();
-  res.outgoing_connections_count = m_p2p.get_outgoing_connections_count();
+  uint64_t total_conn = 0;
+  runOnServerDispatcher([&] {
+    total_conn = m_p2p.get_connections_count();
+    res.outgoing_connections_count = m_p2p.get_outgoing_connections_count();
+    res.white_peerlist_size = m_p2p.getPeerlistManager().get_white_peers_count();
+    res.grey_peerlist_size = m_p2p.getPeerlistManager().get_gray_peers_count();
+  });
   res.incoming_connections_count = total_conn - res.outgoing_connections_count;
   res.rpc_connections_count = get_connections_count();
-  res.white_peerlist_size = m_p2p.getPeerlistManager().get_white_peers_count();
-  res.grey_peerlist_size = m_p2p.getPeerlistManager().get_gray_peers_count();
   res.last_known_block_index = std::max(static_cast<uint32_t>(1), m_protocolQuery.getObservedHeight()) - 1;
   Crypto::Hash last_block_hash = m_core.getBlockIdByHeight(res.height - 1);
   res.top_block_hash = Common::podToHex(last_block_hash);
@@ -709,6 +1092,10 @@ bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RP
       CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: can't get last cumulative difficulty." };
   }
 
+  res.response_cache_hits = m_responseCache.getHits();
+  res.response_cache_misses = m_responseCache.getMisses();
+  res.response_cache_size = m_responseCache.getSize();
+
   res.status = CORE_RPC_STATUS_OK;
   return true;
 }
@@ -806,7 +1193,7 @@ bool RpcServer::on_stop_daemon(const COMMAND_RPC_STOP_DAEMON::request& req, COMM
 	return false;
   }
   if (m_core.currency().isTestnet()) {
-    m_p2p.sendStopSignal();
+    runOnServerDispatcher([this] { m_p2p.sendStopSignal(); });
     res.status = CORE_RPC_STATUS_OK;
   } else {
     res.status = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -828,7 +1215,7 @@ bool RpcServer::on_get_fee_address(const COMMAND_RPC_GET_FEE_ADDRESS::request& r
 bool RpcServer::on_get_peer_list(const COMMAND_RPC_GET_PEER_LIST::request& req, COMMAND_RPC_GET_PEER_LIST::response& res) {
 	std::list<PeerlistEntry> pl_wite;
 	std::list<PeerlistEntry> pl_gray;
-	m_p2p.getPeerlistManager().get_peerlist_full(pl_gray, pl_wite);
+	runOnServerDispatcher([&] { m_p2p.getPeerlistManager().get_peerlist_full(pl_gray, pl_wite); });
 	for (const auto& pe : pl_wite) {
 		std::stringstream ss;
 		ss << pe.adr;
@@ -862,8 +1249,17 @@ bool RpcServer::on_blocks_list_json(const COMMAND_RPC_GET_BLOCKS_LIST::request&
     last_height = 0;
   }
 
+  uint64_t generation = m_responseCache.getGeneration();
   for (uint32_t i = req.height; i >= last_height; i--) {
     Hash block_hash = m_core.getBlockIdByHeight(i);
+    block_short_response block_short;
+    if (loadCachedResponse(m_responseCache, "getblockslist", block_hash, block_short)) {
+      res.blocks.push_back(block_short);
+      if (i == 0)
+        break;
+      continue;
+    }
+
     Block blk;
     if (!m_core.getBlockByHash(block_hash, blk)) {
       throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
@@ -877,7 +1273,6 @@ bool RpcServer::on_blocks_list_json(const COMMAND_RPC_GET_BLOCKS_LIST::request&
     difficulty_type blockDiff;
     m_core.getBlockDifficulty(static_cast<uint32_t>(i), blockDiff);
 
-    block_short_response block_short;
     block_short.timestamp = blk.timestamp;
     block_short.height = i;
     block_short.hash = Common::podToHex(block_hash);
@@ -886,6 +1281,7 @@ bool RpcServer::on_blocks_list_json(const COMMAND_RPC_GET_BLOCKS_LIST::request&
     block_short.difficulty = blockDiff;
     block_short.min_tx_fee = m_core.getMinimalFeeForHeight(i);
 
+    storeCachedResponse(m_responseCache, "getblockslist", block_hash, generation, block_short);
     res.blocks.push_back(block_short);
 
     if (i == 0)
@@ -897,6 +1293,7 @@ bool RpcServer::on_blocks_list_json(const COMMAND_RPC_GET_BLOCKS_LIST::request&
 }
 
 bool RpcServer::f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request& req, F_COMMAND_RPC_GET_BLOCK_DETAILS::response& res) {
+  uint64_t generation = m_responseCache.getGeneration();
   Hash hash;
 
   try {
@@ -910,6 +1307,14 @@ bool RpcServer::f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request&
     }
   }
 
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response cached;
+  if (loadCachedResponse(m_responseCache, "f_block_json", hash, cached)) {
+    res = std::move(cached);
+    // only main chain blocks are cached, their depth grows with the chain
+    res.block.depth = m_core.get_current_blockchain_height() - res.block.height - 1;
+    return true;
+  }
+
   Block blk;
   if (!m_core.getBlockByHash(hash, blk)) {
     throw JsonRpc::JsonRpcError{
@@ -1029,6 +1434,9 @@ bool RpcServer::f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request&
   }
 
   res.status = CORE_RPC_STATUS_OK;
+  if (!is_orphaned && missed_txs.empty()) {
+    storeCachedResponse(m_responseCache, "f_block_json", hash, generation, res);
+  }
   return true;
 }
 
@@ -1041,6 +1449,17 @@ bool RpcServer::f_on_transaction_json(const F_COMMAND_RPC_GET_TRANSACTION_DETAIL
       "Failed to parse hex representation of transaction hash. Hex = " + req.hash + '.' };
   }
 
+  uint64_t generation = m_responseCache.getGeneration();
+  CachedTransactionDetails cached;
+  if (loadCachedResponse(m_responseCache, "f_transaction_json", hash, cached) && fromBinaryArray(res.tx, Common::asBinaryArray(cached.tx))) {
+    res.txDetails = std::move(cached.txDetails);
+    res.block = std::move(cached.block);
+    // only transactions already in a block are cached, their confirmations grow with the chain
+    res.txDetails.confirmations = m_protocolQuery.getObservedHeight() - res.block.height;
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+
   std::vector<Crypto::Hash> tx_ids;
   tx_ids.push_back(hash);
 
@@ -1058,9 +1477,11 @@ bool RpcServer::f_on_transaction_json(const F_COMMAND_RPC_GET_TRANSACTION_DETAIL
 
   Crypto::Hash blockHash;
   uint32_t blockHeight;
+  bool inBlock = false;
   if (m_core.getBlockContainingTx(hash, blockHash, blockHeight)) {
     Block blk;
     if (m_core.getBlockByHash(blockHash, blk)) {
+      inBlock = true;
       size_t tx_cumulative_block_size;
       m_core.getBlockSize(blockHash, tx_cumulative_block_size);
       size_t blokBlobSize = getObjectBinarySize(blk);
@@ -1118,6 +1539,12 @@ bool RpcServer::f_on_transaction_json(const F_COMMAND_RPC_GET_TRANSACTION_DETAIL
   }
 
   res.status = CORE_RPC_STATUS_OK;
+  if (inBlock) {
+    cached.tx = Common::asString(toBinaryArray(res.tx));
+    cached.txDetails = res.txDetails;
+    cached.block = res.block;
+    storeCachedResponse(m_responseCache, "f_transaction_json", hash, generation, cached);
+  }
   return true;
 }
 
@@ -39,13 +39,18 @@
 
 #include "HttpServer.h"
 
+#include <atomic>
 #include <functional>
+#include <list>
 #include <unordered_map>
 
 #include <Logging/LoggerRef.h>
 #include "ITransaction.h"
 #include "CoreRpcServerCommandsDefinitions.h"
 #include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
+#include "CryptoNoteCore/ICoreObserver.h"
+#include "RpcNotificationQueue.h"
+#include "RpcResponseCache.h"
 
 #include "Common/Math.h"
 
@@ -56,9 +61,10 @@ class NodeServer;
 class BlockchainExplorer;
 class ICryptoNoteProtocolQuery;
 
-class RpcServer : public HttpServer {
+class RpcServer : public HttpServer, public ICoreObserver {
 public:
   RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, ICryptoNoteProtocolQuery& protocolQuery);
+  virtual ~RpcServer();
 
   typedef std::function<bool(RpcServer*, const HttpRequest& request, HttpResponse& response)> HandlerFunction;
   bool restrictRPC(const bool is_resctricted);
@@ -68,6 +74,8 @@ public:
   bool setContactInfo(const std::string& contact);
   bool masternode_check_incoming_tx(const BinaryArray& tx_blob);
   std::string getCorsDomain();
+  // bytes of explorer responses kept, 0 disables the cache
+  void setResponseCacheSize(size_t size);
 
 private:
 
@@ -81,17 +89,32 @@ private:
   static std::unordered_map<std::string, RpcHandler<HandlerFunction>> s_handlers;
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) override;
+  virtual std::string getMethodName(const HttpRequest& request) const override;
+  virtual void fillBusyResponse(const HttpRequest& request, HttpResponse& response) override;
+  virtual bool isProcessedOnServerDispatcher(const HttpRequest& request) const override;
   bool processJsonRpcRequest(const HttpRequest& request, HttpResponse& response);
   bool isCoreReady();
 
+  // ICoreObserver
+  virtual void blockAdded(uint32_t height, const Crypto::Hash& blockHash) override;
+  virtual void blockPopped(uint32_t height, const Crypto::Hash& blockHash) override;
+  virtual void txAddedToPool(const Crypto::Hash& transactionHash) override;
+  virtual void txRemovedFromPool(const Crypto::Hash& transactionHash) override;
+
+  void pushNotification(const char* type, uint32_t height, const Crypto::Hash& hash);
+  void wakeNotificationWaiters();
+
   // binary handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
   bool on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, COMMAND_RPC_QUERY_BLOCKS::response& res);
   bool on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::request& req, COMMAND_RPC_QUERY_BLOCKS_LITE::response& res);
+  bool on_query_blocks_compact(const COMMAND_RPC_QUERY_BLOCKS_COMPACT::request& req, COMMAND_RPC_QUERY_BLOCKS_COMPACT::response& res);
+  bool on_get_indexes_batch(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BATCH::response& res);
   bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
   bool on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
   bool onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp);
   bool onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::request& req, COMMAND_RPC_GET_POOL_CHANGES_LITE::response& rsp);
+  bool onGetNotifications(const COMMAND_RPC_GET_NOTIFICATIONS::request& req, COMMAND_RPC_GET_NOTIFICATIONS::response& rsp);
 
   // json handlers
   bool on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res);
@@ -109,6 +132,8 @@ private:
   bool onGetBlocksHashesByTimestamps(const COMMAND_RPC_GET_BLOCKS_HASHES_BY_TIMESTAMPS::request& req, COMMAND_RPC_GET_BLOCKS_HASHES_BY_TIMESTAMPS::response& rsp);
   bool onGetTransactionsDetailsByHashes(const COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES::request& req, COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES::response& rsp);
   bool onGetTransactionDetailsByHash(const COMMAND_RPC_GET_TRANSACTION_DETAILS_BY_HASH::request& req, COMMAND_RPC_GET_TRANSACTION_DETAILS_BY_HASH::response& rsp);
+  bool onGetBlocksDetailsBatch(const COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS_BATCH::response& rsp);
+  bool onGetTransactionsDetailsBatch(const COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH::request& req, COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BATCH::response& rsp);
   bool onGetTransactionHashesByPaymentId(const COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID::request& req, COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID::response& rsp);
   bool on_get_peers(const COMMAND_RPC_GET_PEER_LIST::request& req, COMMAND_RPC_GET_PEER_LIST::response& res);
 
@@ -150,6 +175,11 @@ private:
   std::string m_contact_info;
   Crypto::SecretKey m_view_key = NULL_SECRET_KEY;
   AccountPublicAddress m_fee_acc;
+  RpcResponseCache m_responseCache;
+  RpcNotificationQueue m_notifications;
+  // requests waiting for notifications, only used on the server dispatcher
+  std::list<System::Event*> m_notificationWaiters;
+  std::atomic<bool> m_notificationWakePending;
 };
 
 }
@@ -36,6 +36,8 @@
 
 
 #include "RpcServerConfig.h"
+
+#include <stdexcept>
 #include "Common/CommandLine.h"
 #include "CryptoNoteConfig.h"
 #include "android.h"
@@ -46,13 +48,46 @@ namespace CryptoNote {
 
     const std::string DEFAULT_RPC_IP = "127.0.0.1";
     const uint16_t DEFAULT_RPC_PORT = RPC_DEFAULT_PORT;
+    const uint32_t DEFAULT_RPC_THREADS = 2;
+    const uint32_t DEFAULT_RPC_MAX_CONNECTIONS = 256;
+    const uint32_t DEFAULT_RPC_METHOD_CONCURRENCY = 4;
+    const uint32_t DEFAULT_RPC_METHOD_QUEUE_DEPTH = 64;
+    const uint32_t DEFAULT_RPC_CACHE_SIZE = 32;
+    const uint32_t DEFAULT_RPC_COMPRESSION_LEVEL = 6;
+    const uint32_t DEFAULT_RPC_COMPRESSION_MIN_SIZE = 1024;
 
     const command_line::arg_descriptor<std::string> arg_rpc_bind_ip = { "rpc-bind-ip", "", DEFAULT_RPC_IP };
     const command_line::arg_descriptor<uint16_t> arg_rpc_bind_port = { "rpc-bind-port", "", DEFAULT_RPC_PORT };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_threads = { "rpc-threads", "Number of threads processing RPC requests, 0 to process them on the p2p thread", DEFAULT_RPC_THREADS };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_max_connections = { "rpc-max-connections", "Maximum number of open RPC connections, 0 for no limit", DEFAULT_RPC_MAX_CONNECTIONS };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_method_concurrency = { "rpc-method-concurrency", "Requests of one RPC method processed at once, 0 for no limit", DEFAULT_RPC_METHOD_CONCURRENCY };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_method_queue = { "rpc-method-queue", "Requests of one RPC method waiting to be processed before the server answers busy", DEFAULT_RPC_METHOD_QUEUE_DEPTH };
+    const command_line::arg_descriptor<std::vector<std::string>> arg_rpc_method_limit = { "rpc-method-limit", "Limit of a single RPC method or url: <method>=<concurrency>:<queue>" };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_cache_size = { "rpc-cache-size", "Megabytes of cached block and transaction explorer responses, 0 to disable", DEFAULT_RPC_CACHE_SIZE };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_compression_level = { "rpc-compression-level", "Compression level of RPC responses from 1 to 9, 0 to disable", DEFAULT_RPC_COMPRESSION_LEVEL };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_compression_min_size = { "rpc-compression-min-size", "Bytes an RPC response has to reach to be compressed", DEFAULT_RPC_COMPRESSION_MIN_SIZE };
+
+    std::tuple<std::string, uint32_t, uint32_t> parseMethodLimit(const std::string& limit) {
+      size_t equals = limit.find('=');
+      size_t colon = limit.find(':', equals);
+      if (equals == 0 || equals == std::string::npos || colon == std::string::npos) {
+        throw std::runtime_error("Wrong RPC method limit: " + limit + ", expected <method>=<concurrency>:<queue>");
+      }
+
+      try {
+        return std::make_tuple(limit.substr(0, equals),
+          static_cast<uint32_t>(std::stoul(limit.substr(equals + 1, colon - equals - 1))),
+          static_cast<uint32_t>(std::stoul(limit.substr(colon + 1))));
+      } catch (std::logic_error&) {
+        throw std::runtime_error("Wrong RPC method limit: " + limit + ", expected <method>=<concurrency>:<queue>");
+      }
+    }
   }
 
 
-  RpcServerConfig::RpcServerConfig() : bindIp(DEFAULT_RPC_IP), bindPort(DEFAULT_RPC_PORT) {
+  RpcServerConfig::RpcServerConfig() : bindIp(DEFAULT_RPC_IP), bindPort(DEFAULT_RPC_PORT), threads(DEFAULT_RPC_THREADS), maxConnections(DEFAULT_RPC_MAX_CONNECTIONS),
+    methodConcurrency(DEFAULT_RPC_METHOD_CONCURRENCY), methodQueueDepth(DEFAULT_RPC_METHOD_QUEUE_DEPTH), cacheSize(DEFAULT_RPC_CACHE_SIZE),
+    compressionLevel(DEFAULT_RPC_COMPRESSION_LEVEL), compressionMinSize(DEFAULT_RPC_COMPRESSION_MIN_SIZE) {
   }
 
   std::string RpcServerConfig::getBindAddress() const {
@@ -62,11 +97,35 @@ namespace CryptoNote {
   void RpcServerConfig::initOptions(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_rpc_bind_ip);
     command_line::add_arg(desc, arg_rpc_bind_port);
+    command_line::add_arg(desc, arg_rpc_threads);
+    command_line::add_arg(desc, arg_rpc_max_connections);
+    command_line::add_arg(desc, arg_rpc_method_concurrency);
+    command_line::add_arg(desc, arg_rpc_method_queue);
+    command_line::add_arg(desc, arg_rpc_method_limit);
+    command_line::add_arg(desc, arg_rpc_cache_size);
+    command_line::add_arg(desc, arg_rpc_compression_level);
+    command_line::add_arg(desc, arg_rpc_compression_min_size);
   }
 
   void RpcServerConfig::init(const boost::program_options::variables_map& vm)  {
     bindIp = command_line::get_arg(vm, arg_rpc_bind_ip);
     bindPort = command_line::get_arg(vm, arg_rpc_bind_port);
+    threads = command_line::get_arg(vm, arg_rpc_threads);
+    maxConnections = command_line::get_arg(vm, arg_rpc_max_connections);
+    methodConcurrency = command_line::get_arg(vm, arg_rpc_method_concurrency);
+    methodQueueDepth = command_line::get_arg(vm, arg_rpc_method_queue);
+    cacheSize = command_line::get_arg(vm, arg_rpc_cache_size);
+    compressionLevel = command_line::get_arg(vm, arg_rpc_compression_level);
+    if (compressionLevel > 9) {
+      throw std::runtime_error("Wrong RPC compression level: " + std::to_string(compressionLevel) + ", expected 0 to 9");
+    }
+
+    compressionMinSize = command_line::get_arg(vm, arg_rpc_compression_min_size);
+    if (command_line::has_arg(vm, arg_rpc_method_limit)) {
+      for (const std::string& limit : command_line::get_arg(vm, arg_rpc_method_limit)) {
+        methodLimits.push_back(parseMethodLimit(limit));
+      }
+    }
   }
 
 }
@@ -37,6 +37,10 @@
 
 #pragma once
 
+#include <string>
+#include <tuple>
+#include <vector>
+
 #include <boost/program_options.hpp>
 
 namespace CryptoNote {
@@ -53,6 +57,17 @@ public:
 
   std::string bindIp;
   uint16_t bindPort;
+  uint32_t threads;
+  uint32_t maxConnections;
+  uint32_t methodConcurrency;
+  uint32_t methodQueueDepth;
+  // method, or url of plain HTTP handlers, with its concurrency and queue depth
+  std::vector<std::tuple<std::string, uint32_t, uint32_t>> methodLimits;
+  // megabytes
+  uint32_t cacheSize;
+  // zlib level, zero disables compression
+  uint32_t compressionLevel;
+  uint32_t compressionMinSize;
 };
 
 }
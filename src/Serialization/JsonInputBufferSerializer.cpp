@@ -0,0 +1,455 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "JsonInputBufferSerializer.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "Common/StringTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+// requests are parsed before anything validates them, these bound what a single one may cost
+// the size matches the HTTP server body limit
+const size_t MAX_JSON_SIZE = 32 * 1024 * 1024;
+const size_t MAX_NESTING_DEPTH = 100;
+// dense text like "[0,0,0" makes a 16 byte token of every two bytes, this keeps the tokens
+// of the largest text within 4 times its size
+const size_t MAX_TOKENS = MAX_JSON_SIZE / 4;
+
+const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+}
+
+JsonInputBufferSerializer::JsonInputBufferSerializer(const char* data, size_t size) : data(data), size(size) {
+  parse();
+}
+
+JsonInputBufferSerializer::JsonInputBufferSerializer(std::string&& text) : text(std::move(text)) {
+  data = this->text.data();
+  size = this->text.size();
+  parse();
+}
+
+JsonInputBufferSerializer::~JsonInputBufferSerializer() {
+}
+
+ISerializer::SerializerType JsonInputBufferSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool JsonInputBufferSerializer::beginObject(Common::StringView name) {
+  const Token* token = getToken(name, OBJECT);
+  if (token == nullptr) {
+    return false;
+  }
+
+  size_t index = token - tokens.data();
+  scopes.push_back({ index, index + 1 });
+  return true;
+}
+
+void JsonInputBufferSerializer::endObject() {
+  assert(scopes.size() > 1);
+  scopes.pop_back();
+}
+
+bool JsonInputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  const Token* token = getToken(name, ARRAY);
+  if (token == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  size_t index = token - tokens.data();
+  size = 0;
+  for (size_t item = index + 1; item != token->next; item = tokens[item].next) {
+    ++size;
+  }
+
+  scopes.push_back({ index, index + 1 });
+  return true;
+}
+
+void JsonInputBufferSerializer::endArray() {
+  assert(scopes.size() > 1);
+  scopes.pop_back();
+}
+
+bool JsonInputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return readInteger(name, value);
+}
+
+bool JsonInputBufferSerializer::operator()(double& value, Common::StringView name) {
+  const Token* token = getToken(name, NUMBER);
+  if (token == nullptr) {
+    return false;
+  }
+
+  std::string number(data + token->offset, token->size);
+  value = strtod(number.c_str(), nullptr);
+  return true;
+}
+
+bool JsonInputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  size_t index = findValue(name);
+  if (index == NOT_FOUND) {
+    return false;
+  }
+
+  if (tokens[index].type != TRUE_VALUE && tokens[index].type != FALSE_VALUE) {
+    throw std::runtime_error("JSON value is not a boolean");
+  }
+
+  value = tokens[index].type == TRUE_VALUE;
+  return true;
+}
+
+bool JsonInputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  const Token* token = getToken(name, STRING);
+  if (token == nullptr) {
+    return false;
+  }
+
+  value.assign(data + token->offset + 1, token->size - 2);
+  return true;
+}
+
+bool JsonInputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  std::string hex;
+  if (!(*this)(hex, name)) {
+    return false;
+  }
+
+  Common::fromHex(hex, value, size);
+  return true;
+}
+
+bool JsonInputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  std::string hex;
+  if (!(*this)(hex, name)) {
+    return false;
+  }
+
+  value = Common::asString(Common::fromHex(hex));
+  return true;
+}
+
+bool JsonInputBufferSerializer::raw(std::string& json, Common::StringView name) {
+  size_t index = findValue(name);
+  if (index == NOT_FOUND) {
+    return false;
+  }
+
+  json.assign(data + tokens[index].offset, tokens[index].size);
+  return true;
+}
+
+void JsonInputBufferSerializer::parse() {
+  if (size > MAX_JSON_SIZE) {
+    throw std::runtime_error("JSON text is too large");
+  }
+
+  // containers still open, innermost last
+  std::vector<size_t> open;
+  size_t offset = skipSpace(0);
+  if (offset == size || data[offset] != '{') {
+    throw std::runtime_error("Serializer doesn't support this type of serialization: Object expected.");
+  }
+
+  for (;;) {
+    // every pass adds at most a member name and a value
+    if (tokens.size() >= MAX_TOKENS) {
+      throw std::runtime_error("JSON text has too many values");
+    }
+
+    // a value starts at 'offset'
+    bool opened = false;
+    bool closed = false;
+    if (data[offset] == '{' || data[offset] == '[') {
+      if (open.size() == MAX_NESTING_DEPTH) {
+        throw std::runtime_error("JSON nesting is too deep");
+      }
+
+      tokens.push_back({ data[offset] == '{' ? OBJECT : ARRAY, static_cast<uint32_t>(offset), 0, 0 });
+      open.push_back(tokens.size() - 1);
+      offset = skipSpace(offset + 1);
+      if (offset == size) {
+        throw std::runtime_error("Unexpected end of JSON text");
+      }
+
+      if (data[offset] == (tokens[open.back()].type == OBJECT ? '}' : ']')) {
+        closed = true;
+      } else {
+        opened = true;
+      }
+    } else {
+      offset = parseScalar(offset);
+    }
+
+    // after a value: close finished containers, then find where the next value starts
+    while (!opened) {
+      if (open.empty()) {
+        // like JsonValue, whatever follows the root object is ignored
+        scopes.push_back({ 0, 1 });
+        return;
+      }
+
+      Token& container = tokens[open.back()];
+      if (!closed) {
+        offset = skipSpace(offset);
+        if (offset == size) {
+          throw std::runtime_error("Unexpected end of JSON text");
+        }
+
+        if (data[offset] == ',') {
+          offset = skipSpace(offset + 1);
+          if (offset == size) {
+            throw std::runtime_error("Unexpected end of JSON text");
+          }
+
+          break;
+        }
+
+        if (data[offset] != (container.type == OBJECT ? '}' : ']')) {
+          throw std::runtime_error("Unexpected character in JSON text");
+        }
+      }
+
+      container.size = static_cast<uint32_t>(offset + 1 - container.offset);
+      container.next = static_cast<uint32_t>(tokens.size());
+      open.pop_back();
+      ++offset;
+      closed = false;
+    }
+
+    if (tokens[open.back()].type == OBJECT) {
+      // member name, then the value after the colon
+      if (data[offset] != '"') {
+        throw std::runtime_error("Expected member name in JSON text");
+      }
+
+      offset = skipSpace(parseScalar(offset));
+      if (offset == size || data[offset] != ':') {
+        throw std::runtime_error("Expected ':' in JSON text");
+      }
+
+      offset = skipSpace(offset + 1);
+      if (offset == size) {
+        throw std::runtime_error("Unexpected end of JSON text");
+      }
+    }
+  }
+}
+
+size_t JsonInputBufferSerializer::parseScalar(size_t offset) {
+  size_t begin = offset;
+  TokenType type;
+  char c = data[offset];
+  if (c == '"') {
+    type = STRING;
+    ++offset;
+    while (offset < size && data[offset] != '"') {
+      offset += data[offset] == '\\' ? 2 : 1;
+    }
+
+    if (offset >= size) {
+      throw std::runtime_error("Unterminated string in JSON text");
+    }
+
+    ++offset;
+  } else if (c == '-' || (c >= '0' && c <= '9')) {
+    type = NUMBER;
+    ++offset;
+    while (offset < size && ((data[offset] >= '0' && data[offset] <= '9') || data[offset] == '.' || data[offset] == 'e' ||
+      data[offset] == 'E' || data[offset] == '+' || data[offset] == '-')) {
+      ++offset;
+    }
+  } else {
+    const char* literal;
+    if (c == 't') {
+      type = TRUE_VALUE;
+      literal = "true";
+    } else if (c == 'f') {
+      type = FALSE_VALUE;
+      literal = "false";
+    } else if (c == 'n') {
+      type = NIL;
+      literal = "null";
+    } else {
+      throw std::runtime_error("Unexpected character in JSON text");
+    }
+
+    size_t length = strlen(literal);
+    if (size - offset < length || memcmp(data + offset, literal, length) != 0) {
+      throw std::runtime_error("Unexpected character in JSON text");
+    }
+
+    offset += length;
+  }
+
+  tokens.push_back({ type, static_cast<uint32_t>(begin), static_cast<uint32_t>(offset - begin), static_cast<uint32_t>(tokens.size() + 1) });
+  return offset;
+}
+
+size_t JsonInputBufferSerializer::skipSpace(size_t offset) const {
+  while (offset < size && isSpace(data[offset])) {
+    ++offset;
+  }
+
+  return offset;
+}
+
+size_t JsonInputBufferSerializer::findValue(Common::StringView name) {
+  assert(!scopes.empty());
+  Scope& scope = scopes.back();
+  const Token& container = tokens[scope.token];
+  if (container.type == ARRAY) {
+    if (scope.cursor == container.next) {
+      return NOT_FOUND;
+    }
+
+    size_t index = scope.cursor;
+    scope.cursor = tokens[index].next;
+    return index;
+  }
+
+  // members are usually read in the order they were written, so the search starts after the last one found
+  size_t first = scope.token + 1;
+  size_t member = scope.cursor;
+  do {
+    if (member == container.next) {
+      member = first;
+      if (member == scope.cursor) {
+        break;
+      }
+    }
+
+    const Token& key = tokens[member];
+    size_t after = tokens[member + 1].next;
+    if (key.size - 2 == name.getSize() && memcmp(data + key.offset + 1, name.getData(), name.getSize()) == 0) {
+      scope.cursor = after;
+      return member + 1;
+    }
+
+    member = after;
+  } while (member != scope.cursor);
+
+  return NOT_FOUND;
+}
+
+const JsonInputBufferSerializer::Token* JsonInputBufferSerializer::getToken(Common::StringView name, TokenType type) {
+  size_t index = findValue(name);
+  if (index == NOT_FOUND) {
+    return nullptr;
+  }
+
+  if (tokens[index].type != type) {
+    static const char* const TYPE_NAMES[] = { "an object", "an array", "a string", "a number" };
+    throw std::runtime_error(std::string("JSON value is not ") + TYPE_NAMES[type]);
+  }
+
+  return &tokens[index];
+}
+
+template <typename T>
+bool JsonInputBufferSerializer::readInteger(Common::StringView name, T& value) {
+  const Token* token = getToken(name, NUMBER);
+  if (token == nullptr) {
+    return false;
+  }
+
+  const char* digit = data + token->offset;
+  const char* end = digit + token->size;
+  bool negative = *digit == '-';
+  if (negative) {
+    ++digit;
+  }
+
+  if (digit == end) {
+    throw std::runtime_error("JSON value is not an integer");
+  }
+
+  uint64_t magnitude = 0;
+  for (; digit != end; ++digit) {
+    if (*digit < '0' || *digit > '9') {
+      throw std::runtime_error("JSON value is not an integer");
+    }
+
+    uint64_t next = magnitude * 10 + static_cast<uint64_t>(*digit - '0');
+    if (magnitude > UINT64_MAX / 10 || next < magnitude * 10) {
+      throw std::runtime_error("JSON integer is out of range");
+    }
+
+    magnitude = next;
+  }
+
+  // same truncating conversion as JsonInputValueSerializer applies to JsonValue integers
+  value = static_cast<T>(negative ? 0 - magnitude : magnitude);
+  return true;
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ISerializer.h"
+
+namespace CryptoNote {
+
+// Reads JSON text straight into the deserialized objects. The text is tokenized once into a flat list, fields are
+// then looked up in it without building a JsonValue. Strings keep their escape sequences, like JsonValue does.
+class JsonInputBufferSerializer : public ISerializer {
+public:
+  // 'data' has to outlive the serializer
+  JsonInputBufferSerializer(const char* data, size_t size);
+  explicit JsonInputBufferSerializer(std::string&& text);
+  JsonInputBufferSerializer(const JsonInputBufferSerializer&) = delete;
+  virtual ~JsonInputBufferSerializer();
+  JsonInputBufferSerializer& operator=(const JsonInputBufferSerializer&) = delete;
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
+  virtual bool binary(void* value, size_t size, Common::StringView name) override;
+  virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+  // assigns the JSON text of the value, whatever its type
+  bool raw(std::string& json, Common::StringView name);
+
+private:
+  enum TokenType : uint8_t { OBJECT, ARRAY, STRING, NUMBER, TRUE_VALUE, FALSE_VALUE, NIL };
+
+  struct Token {
+    TokenType type;
+    // text of the value, quotes and brackets included
+    uint32_t offset;
+    uint32_t size;
+    // index of the token after the value and everything nested in it
+    uint32_t next;
+  };
+
+  struct Scope {
+    size_t token;
+    // token of the next array item, or of the object member after the last one found
+    size_t cursor;
+  };
+
+  void parse();
+  size_t parseScalar(size_t offset);
+  size_t skipSpace(size_t offset) const;
+  size_t findValue(Common::StringView name);
+  const Token* getToken(Common::StringView name, TokenType type);
+
+  template <typename T>
+  bool readInteger(Common::StringView name, T& value);
+
+  std::string text;
+  const char* data;
+  size_t size;
+  std::vector<Token> tokens;
+  std::vector<Scope> scopes;
+};
+
+}
@@ -0,0 +1,230 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "JsonOutputBufferSerializer.h"
+#include <cassert>
+#include <cstdio>
+
+using namespace CryptoNote;
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+}
+
+JsonOutputBufferSerializer::JsonOutputBufferSerializer() : buffer(1, '{'), scopes(1, false), first(true) {
+}
+
+JsonOutputBufferSerializer::~JsonOutputBufferSerializer() {
+}
+
+ISerializer::SerializerType JsonOutputBufferSerializer::type() const {
+  return ISerializer::OUTPUT;
+}
+
+bool JsonOutputBufferSerializer::beginObject(Common::StringView name) {
+  writeName(name);
+  buffer += '{';
+  scopes.push_back(false);
+  first = true;
+  return true;
+}
+
+void JsonOutputBufferSerializer::endObject() {
+  assert(scopes.size() > 1 && !scopes.back());
+  buffer += '}';
+  scopes.pop_back();
+  first = false;
+}
+
+bool JsonOutputBufferSerializer::beginArray(size_t& size, Common::StringView name) {
+  writeName(name);
+  buffer += '[';
+  scopes.push_back(true);
+  first = true;
+  return true;
+}
+
+void JsonOutputBufferSerializer::endArray() {
+  assert(scopes.size() > 1 && scopes.back());
+  buffer += ']';
+  scopes.pop_back();
+  first = false;
+}
+
+// unsigned values are written as their signed reinterpretation, like JsonOutputStreamSerializer does,
+// so readers that parse int64 keep working
+bool JsonOutputBufferSerializer::operator()(uint64_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(static_cast<int64_t>(value));
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint16_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int16_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint32_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int32_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(int64_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(double& value, Common::StringView name) {
+  writeName(name);
+  // same text as JsonValue: fixed with 11 decimals, trailing zeros dropped down to one
+  char text[352];
+  int length = snprintf(text, sizeof(text), "%.11f", value);
+  assert(length > 0 && length < static_cast<int>(sizeof(text)));
+  while (length > 1 && text[length - 2] != '.' && text[length - 1] == '0') {
+    --length;
+  }
+
+  buffer.append(text, length);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(std::string& value, Common::StringView name) {
+  writeName(name);
+  writeString(value.data(), value.size());
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(uint8_t& value, Common::StringView name) {
+  writeName(name);
+  writeInteger(value);
+  return true;
+}
+
+bool JsonOutputBufferSerializer::operator()(bool& value, Common::StringView name) {
+  writeName(name);
+  buffer += value ? "true" : "false";
+  return true;
+}
+
+bool JsonOutputBufferSerializer::binary(void* value, size_t size, Common::StringView name) {
+  writeName(name);
+  size_t offset = buffer.size();
+  buffer.resize(offset + size * 2 + 2);
+  char* out = &buffer[offset];
+  *out++ = '"';
+  const uint8_t* data = static_cast<const uint8_t*>(value);
+  for (size_t i = 0; i < size; ++i) {
+    *out++ = HEX_DIGITS[data[i] >> 4];
+    *out++ = HEX_DIGITS[data[i] & 15];
+  }
+
+  *out = '"';
+  return true;
+}
+
+bool JsonOutputBufferSerializer::binary(std::string& value, Common::StringView name) {
+  return binary(const_cast<char*>(value.data()), value.size(), name);
+}
+
+void JsonOutputBufferSerializer::raw(const std::string& json, Common::StringView name) {
+  writeName(name);
+  buffer += json;
+}
+
+std::string JsonOutputBufferSerializer::release() {
+  assert(scopes.size() == 1);
+  buffer += '}';
+  scopes.clear();
+  return std::move(buffer);
+}
+
+void JsonOutputBufferSerializer::writeName(Common::StringView name) {
+  assert(!scopes.empty());
+  if (!first) {
+    buffer += ',';
+  }
+
+  first = false;
+  if (!scopes.back()) {
+    writeString(name.getData(), name.getSize());
+    buffer += ':';
+  }
+}
+
+// written unescaped like JsonValue does, the JSON readers in the tree keep escape sequences as they are,
+// so escaping here would change the strings they read
+void JsonOutputBufferSerializer::writeString(const char* data, size_t size) {
+  buffer.reserve(buffer.size() + size + 2);
+  buffer += '"';
+  buffer.append(data, size);
+  buffer += '"';
+}
+
+void JsonOutputBufferSerializer::writeInteger(int64_t value) {
+  char text[20];
+  char* end = text + sizeof(text);
+  char* begin = end;
+  // negate in unsigned arithmetic, INT64_MIN has no positive counterpart
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  do {
+    *--begin = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (value < 0) {
+    *--begin = '-';
+  }
+
+  buffer.append(begin, end - begin);
+}
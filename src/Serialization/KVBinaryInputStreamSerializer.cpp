@@ -11,7 +11,7 @@
 #include <cassert>
 #include <cstring>
 #include <stdexcept>
-#include <Common/StreamTools.h>
+#include <type_traits>
 #include "KVBinaryCommon.h"
 
 using namespace Common;
@@ -19,144 +19,217 @@ using namespace CryptoNote;
 
 namespace {
 
+const size_t MAX_NESTING_DEPTH = 100;
+
+size_t fixedValueSize(uint8_t type) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:
+  case BIN_KV_SERIALIZE_TYPE_UINT64:
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE:
+    return 8;
+  case BIN_KV_SERIALIZE_TYPE_INT32:
+  case BIN_KV_SERIALIZE_TYPE_UINT32:
+    return 4;
+  case BIN_KV_SERIALIZE_TYPE_INT16:
+  case BIN_KV_SERIALIZE_TYPE_UINT16:
+    return 2;
+  case BIN_KV_SERIALIZE_TYPE_INT8:
+  case BIN_KV_SERIALIZE_TYPE_UINT8:
+  case BIN_KV_SERIALIZE_TYPE_BOOL:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
 template <typename T>
-T readPod(Common::IInputStream& s) {
+T readPod(const uint8_t* data) {
   T v;
-  read(s, &v, sizeof(T));
+  memcpy(&v, data, sizeof(T));
   return v;
 }
 
-template <typename T, typename JsonT = T>
-JsonValue readPodJson(Common::IInputStream& s) {
-  JsonValue jv;
-  jv = static_cast<JsonT>(readPod<T>(s));
-  return jv;
 }
 
-template <typename T>
-JsonValue readIntegerJson(Common::IInputStream& s) {
-  return readPodJson<T, int64_t>(s);
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) {
+  const size_t chunkSize = 4096;
+  size_t readSize;
+  do {
+    size_t size = m_storage.size();
+    m_storage.resize(size + chunkSize);
+    readSize = strm.readSome(&m_storage[size], chunkSize);
+    m_storage.resize(size + readSize);
+  } while (readSize != 0);
+
+  m_begin = reinterpret_cast<const uint8_t*>(m_storage.data());
+  m_end = m_begin + m_storage.size();
+  parseHeader();
 }
 
-size_t readVarint(Common::IInputStream& s) {
-  uint8_t b = read<uint8_t>(s);
-  uint8_t size_mask = b & PORTABLE_RAW_SIZE_MARK_MASK;
-  size_t bytesLeft = 0;
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(const void* data, size_t size) :
+  m_begin(static_cast<const uint8_t*>(data)), m_end(static_cast<const uint8_t*>(data) + size) {
+  parseHeader();
+}
 
-  switch (size_mask){
-  case PORTABLE_RAW_SIZE_MARK_BYTE:
-    bytesLeft = 0;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_WORD:
-    bytesLeft = 1;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_DWORD:
-    bytesLeft = 3;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_INT64:
-    bytesLeft = 7;
-    break;
+ISerializer::SerializerType KVBinaryInputStreamSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool KVBinaryInputStreamSerializer::beginObject(Common::StringView name) {
+  uint8_t type;
+  const uint8_t* value = findValue(name, type);
+  if (value == nullptr) {
+    return false;
   }
 
-  size_t value = b;
+  if (type != BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    throw std::runtime_error("Object expected");
+  }
 
-  for (size_t i = 1; i <= bytesLeft; ++i) {
-    size_t n = read<uint8_t>(s);
-    value |= n << (i * 8);
+  size_t parent = m_levels.size() - 1;
+  const uint8_t* end = openSection(value);
+  if (m_levels[parent].isArray) {
+    m_levels[parent].cursor = end;
   }
 
-  value >>= 2;
-  return value;
+  return true;
 }
 
-std::string readString(Common::IInputStream& s) {
-  auto size = readVarint(s);
+void KVBinaryInputStreamSerializer::endObject() {
+  assert(!m_levels.empty() && !m_levels.back().isArray);
+  m_entries.erase(m_entries.begin() + m_levels.back().firstEntry, m_entries.end());
+  m_levels.pop_back();
+}
 
-  std::string str;
-  str.resize(size);
-  if (size) {
-    read(s, &str[0], size);
+bool KVBinaryInputStreamSerializer::beginArray(size_t& size, Common::StringView name) {
+  if (m_levels.back().isArray) {
+    throw std::runtime_error("Arrays of arrays are not supported");
   }
-  return str;
+
+  uint8_t type;
+  const uint8_t* value = findValue(name, type);
+  if (value == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  if ((type & BIN_KV_SERIALIZE_FLAG_ARRAY) == 0) {
+    throw std::runtime_error("Array expected");
+  }
+
+  Level level = {};
+  level.isArray = true;
+  level.itemType = type & ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+  level.cursor = readVarint(value, level.itemsLeft);
+  m_levels.push_back(level);
+
+  size = level.itemsLeft;
+  return true;
 }
 
-JsonValue readStringJson(Common::IInputStream& s) {
-  return JsonValue(readString(s));
+void KVBinaryInputStreamSerializer::endArray() {
+  assert(!m_levels.empty() && m_levels.back().isArray);
+  m_levels.pop_back();
 }
 
-void readName(Common::IInputStream& s, std::string& name) {
-  uint8_t len = readPod<uint8_t>(s);
-  if (len) {
-    name.resize(len);
-    read(s, &name[0], len);
-  }
+bool KVBinaryInputStreamSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return readNumber(name, value);
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type);
-JsonValue loadSection(Common::IInputStream& stream);
-JsonValue loadEntry(Common::IInputStream& stream);
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType);
+bool KVBinaryInputStreamSerializer::operator()(int16_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
 
+bool KVBinaryInputStreamSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
 
-JsonValue loadSection(Common::IInputStream& stream) {
-  JsonValue sec(JsonValue::OBJECT);
-  size_t count = readVarint(stream);
-  std::string name;
+bool KVBinaryInputStreamSerializer::operator()(int32_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
 
-  while (count--) {
-    readName(stream, name);
-    sec.insert(name, loadEntry(stream));
-  }
+bool KVBinaryInputStreamSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
 
-  return sec;
+bool KVBinaryInputStreamSerializer::operator()(int64_t& value, Common::StringView name) {
+  return readNumber(name, value);
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type) {
-  switch (type) {
-  case BIN_KV_SERIALIZE_TYPE_INT64:  return readIntegerJson<int64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT32:  return readIntegerJson<int32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT16:  return readIntegerJson<int16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT8:   return readIntegerJson<int8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT64: return readIntegerJson<uint64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT32: return readIntegerJson<uint32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT16: return readIntegerJson<uint16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readIntegerJson<uint8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return readPodJson<double>(stream);
-  case BIN_KV_SERIALIZE_TYPE_BOOL:   return JsonValue(read<uint8_t>(stream) != 0);
-  case BIN_KV_SERIALIZE_TYPE_STRING: return readStringJson(stream);
-  case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(stream);
-  case BIN_KV_SERIALIZE_TYPE_ARRAY:  return loadArray(stream, type);
-  default:
-    throw std::runtime_error("Unknown data type");
-    break;
+bool KVBinaryInputStreamSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(double& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(bool& value, Common::StringView name) {
+  uint8_t type;
+  const uint8_t* data = findValue(name, type);
+  if (data == nullptr) {
+    return false;
   }
+
+  if (type != BIN_KV_SERIALIZE_TYPE_BOOL) {
+    throw std::runtime_error("Bool expected");
+  }
+
+  checkAvailable(data, 1);
+  value = *data != 0;
+  valueRead(data + 1);
+  return true;
 }
 
-JsonValue loadEntry(Common::IInputStream& stream) {
-  uint8_t type = readPod<uint8_t>(stream);
+bool KVBinaryInputStreamSerializer::operator()(std::string& value, Common::StringView name) {
+  uint8_t type;
+  const uint8_t* data = findValue(name, type);
+  if (data == nullptr) {
+    return false;
+  }
 
-  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
-    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
-    return loadArray(stream, type);
+  if (type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("String expected");
   }
 
-  return loadValue(stream, type);
+  size_t size;
+  data = readVarint(data, size);
+  checkAvailable(data, size);
+  value.assign(reinterpret_cast<const char*>(data), size);
+  valueRead(data + size);
+  return true;
 }
 
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType) {
-  JsonValue arr(JsonValue::ARRAY);
-  size_t count = readVarint(stream);
+bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
+  uint8_t type;
+  const uint8_t* data = findValue(name, type);
+  if (data == nullptr) {
+    return false;
+  }
 
-  while (count--) {
-    arr.pushBack(loadValue(stream, itemType));
+  if (type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("String expected");
+  }
+
+  size_t blobSize;
+  data = readVarint(data, blobSize);
+  if (blobSize != size) {
+    throw std::runtime_error("Binary block size mismatch");
   }
 
-  return arr;
+  checkAvailable(data, size);
+  memcpy(value, data, size);
+  valueRead(data + size);
+  return true;
 }
 
+bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
+  return (*this)(value, name); // load as string
+}
 
-JsonValue parseBinary(Common::IInputStream& stream) {
-  auto hdr = readPod<KVBinaryStorageBlockHeader>(stream);
+void KVBinaryInputStreamSerializer::parseHeader() {
+  checkAvailable(m_begin, sizeof(KVBinaryStorageBlockHeader));
+  auto hdr = readPod<KVBinaryStorageBlockHeader>(m_begin);
 
   if (
     hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
@@ -168,30 +241,193 @@ JsonValue parseBinary(Common::IInputStream& stream) {
     throw std::runtime_error("Unknown binary storage format version");
   }
 
-  return loadSection(stream);
+  openSection(m_begin + sizeof(KVBinaryStorageBlockHeader));
 }
 
+const uint8_t* KVBinaryInputStreamSerializer::openSection(const uint8_t* data) {
+  if (m_levels.size() >= MAX_NESTING_DEPTH) {
+    throw std::runtime_error("Too deeply nested data");
+  }
+
+  Level level = {};
+  level.firstEntry = m_entries.size();
+  data = readVarint(data, level.entryCount);
+
+  for (size_t i = 0; i < level.entryCount; ++i) {
+    checkAvailable(data, 1);
+    uint8_t nameSize = *data++;
+    checkAvailable(data, nameSize + 1);
+    Entry entry;
+    entry.name = Common::StringView(reinterpret_cast<const char*>(data), nameSize);
+    entry.type = data[nameSize];
+    entry.value = data + nameSize + 1;
+    m_entries.push_back(entry);
+    data = skipValue(entry.value, entry.type, m_levels.size());
+  }
+
+  level.end = data;
+  m_levels.push_back(level);
+  return data;
 }
 
-KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) : JsonInputValueSerializer(parseBinary(strm)) {
+const uint8_t* KVBinaryInputStreamSerializer::findValue(Common::StringView name, uint8_t& type) {
+  Level& level = m_levels.back();
+  if (level.isArray) {
+    if (level.itemsLeft == 0) {
+      throw std::runtime_error("Array index out of range");
+    }
+
+    --level.itemsLeft;
+    type = level.itemType;
+    return level.cursor;
+  }
+
+  // the values are mostly read in the order they were written, start after the last one found
+  for (size_t i = 0; i < level.entryCount; ++i) {
+    size_t index = (level.nextEntry + i) % level.entryCount;
+    const Entry& entry = m_entries[level.firstEntry + index];
+    if (entry.name == name) {
+      level.nextEntry = index + 1;
+      type = entry.type;
+      return entry.value;
+    }
+  }
+
+  return nullptr;
 }
 
-bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
-  std::string str;
+void KVBinaryInputStreamSerializer::valueRead(const uint8_t* end) {
+  if (m_levels.back().isArray) {
+    m_levels.back().cursor = end;
+  }
+}
 
-  if (!(*this)(str, name)) {
-    return false;
+const uint8_t* KVBinaryInputStreamSerializer::readVarint(const uint8_t* data, size_t& value) const {
+  checkAvailable(data, 1);
+  size_t size = 0;
+  switch (*data & PORTABLE_RAW_SIZE_MARK_MASK) {
+  case PORTABLE_RAW_SIZE_MARK_BYTE:
+    size = 1;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_WORD:
+    size = 2;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_DWORD:
+    size = 4;
+    break;
+  case PORTABLE_RAW_SIZE_MARK_INT64:
+    size = 8;
+    break;
   }
 
-  if (str.size() != size) {
-    throw std::runtime_error("Binary block size mismatch");
+  checkAvailable(data, size);
+  uint64_t v = 0;
+  for (size_t i = 0; i < size; ++i) {
+    v |= static_cast<uint64_t>(data[i]) << (i * 8);
   }
 
-  memcpy(value, str.data(), size);
-  return true;
+  value = static_cast<size_t>(v >> 2);
+  return data + size;
 }
 
-bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
-  return (*this)(value, name); // load as string
+const uint8_t* KVBinaryInputStreamSerializer::skipValue(const uint8_t* data, uint8_t type, size_t depth) const {
+  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
+    uint8_t itemType = type & ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    if (itemType == BIN_KV_SERIALIZE_TYPE_ARRAY || (itemType & BIN_KV_SERIALIZE_FLAG_ARRAY)) {
+      throw std::runtime_error("Arrays of arrays are not supported");
+    }
+
+    size_t count;
+    data = readVarint(data, count);
+    size_t itemSize = fixedValueSize(itemType);
+    if (itemSize != 0) {
+      if (count > static_cast<size_t>(m_end - data) / itemSize) {
+        throw std::runtime_error("Unexpected end of data");
+      }
+
+      return data + count * itemSize;
+    }
+
+    while (count--) {
+      data = skipValue(data, itemType, depth);
+    }
+
+    return data;
+  }
+
+  size_t size = fixedValueSize(type);
+  if (size != 0) {
+    checkAvailable(data, size);
+    return data + size;
+  }
+
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_STRING:
+    data = readVarint(data, size);
+    checkAvailable(data, size);
+    return data + size;
+  case BIN_KV_SERIALIZE_TYPE_OBJECT:
+    return skipSection(data, depth + 1);
+  default:
+    throw std::runtime_error("Unknown data type");
+  }
+}
+
+const uint8_t* KVBinaryInputStreamSerializer::skipSection(const uint8_t* data, size_t depth) const {
+  if (depth >= MAX_NESTING_DEPTH) {
+    throw std::runtime_error("Too deeply nested data");
+  }
+
+  size_t count;
+  data = readVarint(data, count);
+  while (count--) {
+    checkAvailable(data, 1);
+    uint8_t nameSize = *data++;
+    checkAvailable(data, nameSize + 1);
+    uint8_t type = data[nameSize];
+    data = skipValue(data + nameSize + 1, type, depth);
+  }
+
+  return data;
+}
+
+void KVBinaryInputStreamSerializer::checkAvailable(const uint8_t* data, size_t size) const {
+  if (size > static_cast<size_t>(m_end - data)) {
+    throw std::runtime_error("Unexpected end of data");
+  }
 }
 
+template <typename T>
+bool KVBinaryInputStreamSerializer::readNumber(Common::StringView name, T& value) {
+  uint8_t type;
+  const uint8_t* data = findValue(name, type);
+  if (data == nullptr) {
+    return false;
+  }
+
+  size_t size = fixedValueSize(type);
+  if (size == 0 || type == BIN_KV_SERIALIZE_TYPE_BOOL) {
+    throw std::runtime_error("Number expected");
+  }
+
+  // a double cast to an integer it does not fit is undefined, and integers were never read into doubles
+  if ((type == BIN_KV_SERIALIZE_TYPE_DOUBLE) != std::is_floating_point<T>::value) {
+    throw std::runtime_error(type == BIN_KV_SERIALIZE_TYPE_DOUBLE ? "Integer expected" : "Double expected");
+  }
+
+  checkAvailable(data, size);
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  value = static_cast<T>(readPod<int64_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_INT32:  value = static_cast<T>(readPod<int32_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_INT16:  value = static_cast<T>(readPod<int16_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_INT8:   value = static_cast<T>(readPod<int8_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT64: value = static_cast<T>(readPod<uint64_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT32: value = static_cast<T>(readPod<uint32_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT16: value = static_cast<T>(readPod<uint16_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  value = static_cast<T>(readPod<uint8_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE: value = static_cast<T>(readPod<double>(data)); break;
+  }
+
+  valueRead(data + size);
+  return true;
+}
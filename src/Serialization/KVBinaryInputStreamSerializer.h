@@ -18,18 +18,84 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <Common/IInputStream.h>
 #include "ISerializer.h"
-#include "JsonInputValueSerializer.h"
 
 namespace CryptoNote {
 
-class KVBinaryInputStreamSerializer : public JsonInputValueSerializer {
+// reads the values straight from the serialized data, only the entries of the open sections are indexed
+class KVBinaryInputStreamSerializer : public ISerializer {
 public:
   KVBinaryInputStreamSerializer(Common::IInputStream& strm);
+  // the data must outlive the serializer
+  KVBinaryInputStreamSerializer(const void* data, size_t size);
+
+  virtual ISerializer::SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
 
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  struct Entry {
+    Common::StringView name;
+    uint8_t type;
+    const uint8_t* value;
+  };
+
+  struct Level {
+    bool isArray;
+    // section: its entries in m_entries and the one after the last found
+    size_t firstEntry;
+    size_t entryCount;
+    size_t nextEntry;
+    const uint8_t* end;
+    // array: type and position of the items not read yet
+    uint8_t itemType;
+    size_t itemsLeft;
+    const uint8_t* cursor;
+  };
+
+  void parseHeader();
+  const uint8_t* openSection(const uint8_t* data);
+  const uint8_t* findValue(Common::StringView name, uint8_t& type);
+  void valueRead(const uint8_t* end);
+  const uint8_t* readVarint(const uint8_t* data, size_t& value) const;
+  const uint8_t* skipValue(const uint8_t* data, uint8_t type, size_t depth) const;
+  const uint8_t* skipSection(const uint8_t* data, size_t depth) const;
+  void checkAvailable(const uint8_t* data, size_t size) const;
+
+  template <typename T>
+  bool readNumber(Common::StringView name, T& value);
+
+  std::string m_storage;
+  const uint8_t* m_begin;
+  const uint8_t* m_end;
+  std::vector<Entry> m_entries;
+  std::vector<Level> m_levels;
 };
 
 }
@@ -18,10 +18,10 @@
 
 #include "KVBinaryOutputStreamSerializer.h"
 #include "KVBinaryCommon.h"
-#include <stdexcept> 
-#include <limits> 
 
 #include <cassert>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
 #include <Common/StreamTools.h>
 
@@ -30,41 +30,28 @@ using namespace CryptoNote;
 
 namespace {
 
-template <typename T>
-void writePod(IOutputStream& s, const T& value) {
-  write(s, &value, sizeof(T));
-}
-
-template<class T>
-size_t packVarint(IOutputStream& s, uint8_t type_or, size_t pv) {
-  T v = static_cast<T>(pv << 2);
-  v |= type_or;
-  write(s, &v, sizeof(T));
-  return sizeof(T);
-}
-
-void writeElementName(IOutputStream& s, Common::StringView name) {
-  if (name.getSize() > std::numeric_limits<uint8_t>::max()) {
-    throw std::runtime_error("Element name is too long");
-  }
-
-  uint8_t len = static_cast<uint8_t>(name.getSize());
-  write(s, &len, sizeof(len));
-  write(s, name.getData(), len);
-}
-
-size_t writeArraySize(IOutputStream& s, size_t val) {
+size_t varintSize(size_t val) {
   if (val <= 63) {
-    return packVarint<uint8_t>(s, PORTABLE_RAW_SIZE_MARK_BYTE, val);
+    return 1;
   } else if (val <= 16383) {
-    return packVarint<uint16_t>(s, PORTABLE_RAW_SIZE_MARK_WORD, val);
+    return 2;
   } else if (val <= 1073741823) {
-    return packVarint<uint32_t>(s, PORTABLE_RAW_SIZE_MARK_DWORD, val);
+    return 4;
   } else {
     if (val > 4611686018427387903) {
       throw std::runtime_error("failed to pack varint - too big amount");
     }
-    return packVarint<uint64_t>(s, PORTABLE_RAW_SIZE_MARK_INT64, val);
+    return 8;
+  }
+}
+
+void packVarint(uint8_t* data, size_t size, size_t val) {
+  uint8_t mark = size == 1 ? PORTABLE_RAW_SIZE_MARK_BYTE :
+                 size == 2 ? PORTABLE_RAW_SIZE_MARK_WORD :
+                 size == 4 ? PORTABLE_RAW_SIZE_MARK_DWORD : PORTABLE_RAW_SIZE_MARK_INT64;
+  uint64_t v = (static_cast<uint64_t>(val) << 2) | mark;
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(v >> (i * 8));
   }
 }
 
@@ -73,21 +60,28 @@ size_t writeArraySize(IOutputStream& s, size_t val) {
 namespace CryptoNote {
 
 KVBinaryOutputStreamSerializer::KVBinaryOutputStreamSerializer() {
+  KVBinaryStorageBlockHeader hdr;
+  hdr.m_signature_a = PORTABLE_STORAGE_SIGNATUREA;
+  hdr.m_signature_b = PORTABLE_STORAGE_SIGNATUREB;
+  hdr.m_ver = PORTABLE_STORAGE_FORMAT_VER;
+  writePod(hdr);
+
   beginObject(std::string());
 }
 
 void KVBinaryOutputStreamSerializer::dump(IOutputStream& target) {
-  assert(m_objectsStack.size() == 1);
   assert(m_stack.size() == 1);
 
-  KVBinaryStorageBlockHeader hdr;
-  hdr.m_signature_a = PORTABLE_STORAGE_SIGNATUREA;
-  hdr.m_signature_b = PORTABLE_STORAGE_SIGNATUREB;
-  hdr.m_ver = PORTABLE_STORAGE_FORMAT_VER;
+  writeSectionSize(0);
+  Common::write(target, m_buffer.data(), m_buffer.size());
+}
 
-  Common::write(target, &hdr, sizeof(hdr));
-  writeArraySize(target, m_stack.front().count);
-  write(target, stream().data(), stream().size());
+void KVBinaryOutputStreamSerializer::dump(std::vector<uint8_t>& target) {
+  assert(m_stack.size() == 1);
+
+  writeSectionSize(0);
+  target = std::move(m_buffer);
+  m_buffer.clear();
 }
 
 ISerializer::SerializerType KVBinaryOutputStreamSerializer::type() const {
@@ -95,33 +89,25 @@ ISerializer::SerializerType KVBinaryOutputStreamSerializer::type() const {
 }
 
 bool KVBinaryOutputStreamSerializer::beginObject(Common::StringView name) {
-  checkArrayPreamble(BIN_KV_SERIALIZE_TYPE_OBJECT);
- 
-  m_stack.push_back(Level(name));
-  m_objectsStack.push_back(MemoryStream());
+  if (!m_stack.empty()) {
+    writeElementPrefix(BIN_KV_SERIALIZE_TYPE_OBJECT, name);
+  }
+
+  m_stack.push_back(Level(name, m_buffer.size()));
+  m_buffer.push_back(0);
 
   return true;
 }
 
 void KVBinaryOutputStreamSerializer::endObject() {
-  assert(m_objectsStack.size());
+  assert(m_stack.size() > 1);
 
-  auto level = std::move(m_stack.back());
+  writeSectionSize(m_stack.size() - 1);
   m_stack.pop_back();
-
-  auto objStream = std::move(m_objectsStack.back());
-  m_objectsStack.pop_back();
-
-  auto& out = stream();
-
-  writeElementPrefix(BIN_KV_SERIALIZE_TYPE_OBJECT, level.name);
-
-  writeArraySize(out, level.count);
-  write(out, objStream.data(), objStream.size());
 }
 
 bool KVBinaryOutputStreamSerializer::beginArray(size_t& size, Common::StringView name) {
-  m_stack.push_back(Level(name, size));
+  m_stack.push_back(Level(name, size, 0));
   return true;
 }
 
@@ -136,73 +122,75 @@ void KVBinaryOutputStreamSerializer::endArray() {
 
 bool KVBinaryOutputStreamSerializer::operator()(uint8_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_UINT8, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(uint16_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_UINT16, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(int16_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_INT16, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(uint32_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_UINT32, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(int32_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_INT32, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(int64_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_INT64, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(uint64_t& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_UINT64, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(bool& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_BOOL, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(double& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_DOUBLE, name);
-  writePod(stream(), value);
+  writePod(value);
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::operator()(std::string& value, Common::StringView name) {
   writeElementPrefix(BIN_KV_SERIALIZE_TYPE_STRING, name);
 
-  auto& out = stream();
-  writeArraySize(out, value.size());
-  write(out, value.data(), value.size());
+  size_t sizeSize = varintSize(value.size());
+  m_buffer.resize(m_buffer.size() + sizeSize);
+  packVarint(&m_buffer[m_buffer.size() - sizeSize], sizeSize, value.size());
+  write(value.data(), value.size());
   return true;
 }
 
 bool KVBinaryOutputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
   if (size > 0) {
     writeElementPrefix(BIN_KV_SERIALIZE_TYPE_STRING, name);
-    auto& out = stream();
-    writeArraySize(out, size);
-    write(out, value, size);
+    size_t sizeSize = varintSize(size);
+    m_buffer.resize(m_buffer.size() + sizeSize);
+    packVarint(&m_buffer[m_buffer.size() - sizeSize], sizeSize, size);
+    write(value, size);
   }
   return true;
 }
@@ -219,9 +207,14 @@ void KVBinaryOutputStreamSerializer::writeElementPrefix(uint8_t type, Common::St
   
   if (level.state != State::Array) {
     if (!name.isEmpty()) {
-      auto& s = stream();
-      writeElementName(s, name);
-      write(s, &type, 1);
+      if (name.getSize() > std::numeric_limits<uint8_t>::max()) {
+        throw std::runtime_error("Element name is too long");
+      }
+
+      uint8_t len = static_cast<uint8_t>(name.getSize());
+      writePod(len);
+      write(name.getData(), len);
+      writePod(type);
     }
     ++level.count;
   }
@@ -235,19 +228,37 @@ void KVBinaryOutputStreamSerializer::checkArrayPreamble(uint8_t type) {
   Level& level = m_stack.back();
 
   if (level.state == State::ArrayPrefix) {
-    auto& s = stream();
-    writeElementName(s, level.name);
-    char c = BIN_KV_SERIALIZE_FLAG_ARRAY | type;
-    write(s, &c, 1);
-    writeArraySize(s, level.count);
+    if (level.name.size() > std::numeric_limits<uint8_t>::max()) {
+      throw std::runtime_error("Element name is too long");
+    }
+
+    uint8_t len = static_cast<uint8_t>(level.name.size());
+    writePod(len);
+    write(level.name.data(), len);
+    uint8_t c = BIN_KV_SERIALIZE_FLAG_ARRAY | type;
+    writePod(c);
+    size_t sizeSize = varintSize(level.count);
+    m_buffer.resize(m_buffer.size() + sizeSize);
+    packVarint(&m_buffer[m_buffer.size() - sizeSize], sizeSize, level.count);
     level.state = State::Array;
   }
 }
 
+void KVBinaryOutputStreamSerializer::writeSectionSize(size_t levelIndex) {
+  Level& level = m_stack[levelIndex];
+  size_t size = varintSize(level.count);
+  if (size != level.countSize) {
+    // rare, a section of more than 63 entries
+    m_buffer.insert(m_buffer.begin() + level.countOffset + level.countSize, size - level.countSize, 0);
+    level.countSize = size;
+  }
+
+  packVarint(&m_buffer[level.countOffset], size, level.count);
+}
 
-MemoryStream& KVBinaryOutputStreamSerializer::stream() {
-  assert(m_objectsStack.size());
-  return m_objectsStack.back();
+void KVBinaryOutputStreamSerializer::write(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  m_buffer.insert(m_buffer.end(), bytes, bytes + size);
 }
 
 }
@@ -18,13 +18,14 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 #include <Common/IOutputStream.h>
 #include "ISerializer.h"
-#include "MemoryStream.h"
 
 namespace CryptoNote {
 
+// writes every value straight into one buffer, section sizes are patched in when the section ends
 class KVBinaryOutputStreamSerializer : public ISerializer {
 public:
 
@@ -32,6 +33,8 @@ public:
   virtual ~KVBinaryOutputStreamSerializer() {}
 
   void dump(Common::IOutputStream& target);
+  // hands the buffer over to target instead of copying it, the serializer is empty afterwards
+  void dump(std::vector<uint8_t>& target);
 
   virtual ISerializer::SerializerType type() const override;
 
@@ -63,8 +66,13 @@ private:
 
   void writeElementPrefix(uint8_t type, Common::StringView name);
   void checkArrayPreamble(uint8_t type);
-  void updateState(uint8_t type);
-  MemoryStream& stream();
+  void writeSectionSize(size_t level);
+  void write(const void* data, size_t size);
+
+  template <typename T>
+  void writePod(const T& value) {
+    write(&value, sizeof(T));
+  }
 
   enum class State {
     Root,
@@ -77,22 +85,18 @@ private:
     State state;
     std::string name;
     size_t count;
+    // where the entry count of an object goes and how many bytes it takes there
+    size_t countOffset;
+    size_t countSize;
 
-    Level(Common::StringView nm) :
-      name(nm), state(State::Object), count(0) {}
-
-    Level(Common::StringView nm, size_t arraySize) :
-      name(nm), state(State::ArrayPrefix), count(arraySize) {}
-
-    Level(Level&& rv) {
-      state = rv.state;
-      name = std::move(rv.name);
-      count = rv.count;
-    }
+    Level(Common::StringView nm, size_t offset) :
+      name(nm), state(State::Object), count(0), countOffset(offset), countSize(1) {}
 
+    Level(Common::StringView nm, size_t arraySize, size_t) :
+      name(nm), state(State::ArrayPrefix), count(arraySize), countOffset(0), countSize(0) {}
   };
 
-  std::vector<MemoryStream> m_objectsStack;
+  std::vector<uint8_t> m_buffer;
   std::vector<Level> m_stack;
 };
 
@@ -22,7 +22,9 @@
 #include <vector>
 #include <Common/MemoryInputStream.h>
 #include <Common/StringOutputStream.h>
+#include "JsonInputBufferSerializer.h"
 #include "JsonInputStreamSerializer.h"
+#include "JsonOutputBufferSerializer.h"
 #include "JsonOutputStreamSerializer.h"
 #include "KVBinaryInputStreamSerializer.h"
 #include "KVBinaryOutputStreamSerializer.h"
@@ -114,8 +116,24 @@ std::string storeToJson(const T& v) {
   return storeToJsonValue(v).toString();
 }
 
+// same JSON as storeToJson without the intermediate JsonValue, for large responses
 template <typename T>
-bool loadFromJson(T& v, const std::string& buf) {
+std::string storeToJsonBuffer(const T& v) {
+  JsonOutputBufferSerializer s;
+  serialize(const_cast<T&>(v), s);
+  return s.release();
+}
+
+template <typename T>
+std::string storeToJsonBuffer(const std::vector<T>& v) { return storeToJsonValue(v).toString(); }
+
+template <typename T>
+std::string storeToJsonBuffer(const std::list<T>& v) { return storeToJsonValue(v).toString(); }
+
+inline std::string storeToJsonBuffer(const std::string& v) { return storeToJsonValue(v).toString(); }
+
+template <typename T>
+bool loadFromJsonThroughValue(T& v, const std::string& buf) {
   try {
     if (buf.empty()) {
       return true;
@@ -128,6 +146,27 @@ bool loadFromJson(T& v, const std::string& buf) {
   return true;
 }
 
+template <typename T>
+bool loadFromJson(T& v, const std::string& buf) {
+  try {
+    if (buf.empty()) {
+      return true;
+    }
+    JsonInputBufferSerializer s(buf.data(), buf.size());
+    serialize(v, s);
+  } catch (std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+// top level arrays are only read through JsonValue
+template <typename T>
+bool loadFromJson(std::vector<T>& v, const std::string& buf) { return loadFromJsonThroughValue(v, buf); }
+
+template <typename T>
+bool loadFromJson(std::list<T>& v, const std::string& buf) { return loadFromJsonThroughValue(v, buf); }
+
 template <typename T>
 std::string storeToBinaryKeyValue(const T& v) {
   KVBinaryOutputStreamSerializer s;
@@ -142,8 +181,7 @@ std::string storeToBinaryKeyValue(const T& v) {
 template <typename T>
 bool loadFromBinaryKeyValue(T& v, const std::string& buf) {
   try {
-    Common::MemoryInputStream stream(buf.data(), buf.size());
-    KVBinaryInputStreamSerializer s(stream);
+    KVBinaryInputStreamSerializer s(buf.data(), buf.size());
     serialize(v, s);
     return true;
   } catch (std::exception&) {
@@ -58,6 +58,8 @@ struct CompleteBlock {
   boost::optional<CryptoNote::Block> block;
   // first transaction is always coinbase
   std::list<std::shared_ptr<ITransactionReader>> transactions;
+  // global output indexes of transactions in the same order, empty if not supplied by the node
+  std::vector<std::vector<uint32_t>> globalIndexes;
 };
 
 }
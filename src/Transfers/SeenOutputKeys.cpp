@@ -0,0 +1,163 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "SeenOutputKeys.h"
+
+#include <algorithm>
+
+#include "IWalletLegacy.h"
+
+namespace CryptoNote {
+
+bool SeenOutputKeys::tryAdd(const Crypto::Hash& transactionHash, uint32_t height, const std::vector<Crypto::PublicKey>& keys) {
+  // shards are locked in ascending order, so concurrent claims can't deadlock
+  std::vector<size_t> shardIndices;
+  for (const auto& key : keys) {
+    shardIndices.push_back(keyShardIndex(key));
+  }
+
+  std::sort(shardIndices.begin(), shardIndices.end());
+  shardIndices.erase(std::unique(shardIndices.begin(), shardIndices.end()), shardIndices.end());
+
+  {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (auto index : shardIndices) {
+      locks.emplace_back(m_keyShards[index].mutex);
+    }
+
+    for (const auto& key : keys) {
+      const KeyShard& shard = keyShard(key);
+      auto it = shard.owners.find(key);
+      if (it != shard.owners.end() && it->second != transactionHash) {
+        return false;
+      }
+    }
+
+    for (const auto& key : keys) {
+      keyShard(key).owners.emplace(key, transactionHash);
+    }
+  }
+
+  TransactionShard& shard = transactionShard(transactionHash);
+  std::lock_guard<std::mutex> lk(shard.mutex);
+  TransactionEntry& entry = shard.transactions[transactionHash];
+  entry.height = height;
+  for (const auto& key : keys) {
+    if (std::find(entry.keys.begin(), entry.keys.end(), key) == entry.keys.end()) {
+      entry.keys.push_back(key);
+    }
+  }
+
+  return true;
+}
+
+void SeenOutputKeys::erase(const Crypto::Hash& transactionHash) {
+  std::vector<Crypto::PublicKey> keys;
+
+  {
+    TransactionShard& shard = transactionShard(transactionHash);
+    std::lock_guard<std::mutex> lk(shard.mutex);
+    auto it = shard.transactions.find(transactionHash);
+    if (it == shard.transactions.end()) {
+      return;
+    }
+
+    keys = std::move(it->second.keys);
+    shard.transactions.erase(it);
+  }
+
+  releaseKeys(transactionHash, keys);
+}
+
+void SeenOutputKeys::detach(uint32_t height) {
+  for (auto& shard : m_transactionShards) {
+    std::vector<std::pair<Crypto::Hash, std::vector<Crypto::PublicKey>>> detached;
+
+    {
+      std::lock_guard<std::mutex> lk(shard.mutex);
+      for (auto it = shard.transactions.begin(); it != shard.transactions.end();) {
+        if (it->second.height >= height && it->second.height != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+          detached.emplace_back(it->first, std::move(it->second.keys));
+          it = shard.transactions.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    for (const auto& tx : detached) {
+      releaseKeys(tx.first, tx.second);
+    }
+  }
+}
+
+void SeenOutputKeys::clear() {
+  for (auto& shard : m_transactionShards) {
+    std::lock_guard<std::mutex> lk(shard.mutex);
+    shard.transactions.clear();
+  }
+
+  for (auto& shard : m_keyShards) {
+    std::lock_guard<std::mutex> lk(shard.mutex);
+    shard.owners.clear();
+  }
+}
+
+size_t SeenOutputKeys::keyShardIndex(const Crypto::PublicKey& key) {
+  return key.data[0] % SHARD_COUNT;
+}
+
+SeenOutputKeys::KeyShard& SeenOutputKeys::keyShard(const Crypto::PublicKey& key) {
+  return m_keyShards[keyShardIndex(key)];
+}
+
+SeenOutputKeys::TransactionShard& SeenOutputKeys::transactionShard(const Crypto::Hash& transactionHash) {
+  return m_transactionShards[transactionHash.data[0] % SHARD_COUNT];
+}
+
+void SeenOutputKeys::releaseKeys(const Crypto::Hash& transactionHash, const std::vector<Crypto::PublicKey>& keys) {
+  for (const auto& key : keys) {
+    KeyShard& shard = keyShard(key);
+    std::lock_guard<std::mutex> lk(shard.mutex);
+    auto it = shard.owners.find(key);
+    if (it != shard.owners.end() && it->second == transactionHash) {
+      shard.owners.erase(it);
+    }
+  }
+}
+
+}
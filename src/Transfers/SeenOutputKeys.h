@@ -0,0 +1,91 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/hash.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+// Output keys owned by the transactions of one container. A transaction reusing a key that
+// another transaction already owns is rejected. Keys and transactions are spread over shards
+// so that concurrent preprocessing rarely contends on the same mutex.
+class SeenOutputKeys {
+public:
+  // claims all keys for the transaction at once; returns false and claims nothing
+  // if another transaction already owns any of them
+  bool tryAdd(const Crypto::Hash& transactionHash, uint32_t height, const std::vector<Crypto::PublicKey>& keys);
+
+  void erase(const Crypto::Hash& transactionHash);
+  // drops confirmed transactions at or above height
+  void detach(uint32_t height);
+  void clear();
+
+private:
+  static const size_t SHARD_COUNT = 16;
+
+  struct TransactionEntry {
+    uint32_t height;
+    std::vector<Crypto::PublicKey> keys;
+  };
+
+  struct KeyShard {
+    std::mutex mutex;
+    std::unordered_map<Crypto::PublicKey, Crypto::Hash> owners;
+  };
+
+  struct TransactionShard {
+    std::mutex mutex;
+    std::unordered_map<Crypto::Hash, TransactionEntry> transactions;
+  };
+
+  static size_t keyShardIndex(const Crypto::PublicKey& key);
+  KeyShard& keyShard(const Crypto::PublicKey& key);
+  TransactionShard& transactionShard(const Crypto::Hash& transactionHash);
+  void releaseKeys(const Crypto::Hash& transactionHash, const std::vector<Crypto::PublicKey>& keys);
+
+  std::array<KeyShard, SHARD_COUNT> m_keyShards;
+  std::array<TransactionShard, SHARD_COUNT> m_transactionShards;
+};
+
+}
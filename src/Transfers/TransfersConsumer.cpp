@@ -38,6 +38,7 @@
 #include "TransfersConsumer.h"
 
 #include <numeric>
+#include <functional>
 #include <future>
 
 #include "CommonTypes.h"
@@ -53,10 +54,6 @@ using namespace Crypto;
 using namespace Logging;
 using namespace Common;
 
-std::unordered_set<Crypto::Hash> transactions_hash_seen;
-std::unordered_set<Crypto::PublicKey> public_keys_seen;
-std::mutex seen_mutex;
-
 namespace {
 
 using namespace CryptoNote;
@@ -229,9 +226,12 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   struct Tx {
     TransactionBlockInfo blockInfo;
     const ITransactionReader* tx;
+    const std::vector<uint32_t>* knownGlobalIdxs;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
+  struct PreprocessedTx : Tx, PreprocessInfo {
+    std::unordered_map<PublicKey, std::vector<uint32_t>> myOutputs;
+  };
 
   std::vector<PreprocessedTx> preprocessedTransactions;
   std::mutex preprocessedTransactionsMutex;
@@ -270,7 +270,8 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
           continue;
         }
 
-        Tx item = { blockInfo, tx.get() };
+        const auto& globalIdxs = blocks[i].globalIndexes;
+        Tx item = { blockInfo, tx.get(), blockInfo.transactionIndex < globalIdxs.size() ? &globalIdxs[blockInfo.transactionIndex] : nullptr };
         inputQueue.push(item);
         ++blockInfo.transactionIndex;
       }
@@ -286,46 +287,104 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
       PreprocessedTx output;
       static_cast<Tx&>(output) = item;
 
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+      if (item.knownGlobalIdxs != nullptr) {
+        output.globalIdxs = *item.knownGlobalIdxs;
       }
 
+      // transfers are created once the global indexes of all matches are resolved
+      findMyOutputs(*item.tx, m_viewSecret, m_spendKeys, output.myOutputs);
+
       std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
       preprocessedTransactions.push_back(std::move(output));
     }
     return ec;
   };
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
+  auto runWorkers = [&](const std::function<std::error_code()>& function) {
+    std::vector<std::future<std::error_code>> processingThreads;
+    for (size_t i = 0; i < workers; ++i) {
+      processingThreads.push_back(std::async(std::launch::async, function));
+    }
 
-  std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
+    std::error_code error;
+    for (auto& f : processingThreads) {
+      try {
+        std::error_code ec = f.get();
+        if (!error && ec) {
+          error = ec;
+        }
+      } catch (const std::system_error& e) {
+        error = e.code();
+      } catch (const std::exception&) {
+        error = std::make_error_code(std::errc::operation_canceled);
       }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
+    }
+
+    return error;
+  };
+
+  std::error_code processingError = runWorkers(processingFunction);
+
+  if (!processingError) {
+    std::vector<Hash> unindexedHashes;
+    std::vector<PreprocessedTx*> unindexedTransactions;
+    for (auto& tx : preprocessedTransactions) {
+      if (!tx.myOutputs.empty() && tx.globalIdxs.empty()) {
+        unindexedHashes.push_back(tx.tx->getTransactionHash());
+        unindexedTransactions.push_back(&tx);
+      }
+    }
+
+    if (!unindexedHashes.empty()) {
+      std::vector<std::vector<uint32_t>> globalIndices;
+      processingError = getGlobalIndices(unindexedHashes, globalIndices);
+      if (!processingError && globalIndices.size() != unindexedHashes.size()) {
+        processingError = std::make_error_code(std::errc::argument_out_of_domain);
+      }
+
+      for (size_t i = 0; !processingError && i < unindexedTransactions.size(); ++i) {
+        unindexedTransactions[i]->globalIdxs = std::move(globalIndices[i]);
+      }
+    }
+
+    // key images are derived in parallel, output keys are claimed below in chain order
+    std::atomic<size_t> nextTransaction(0);
+    auto transfersFunction = [&] {
+      std::error_code ec;
+      for (size_t i = nextTransaction++; !stopProcessing && i < preprocessedTransactions.size(); i = nextTransaction++) {
+        auto& tx = preprocessedTransactions[i];
+        if (tx.myOutputs.empty()) {
+          continue;
+        }
+
+        ec = createTransfers(tx.blockInfo, *tx.tx, tx.myOutputs, tx);
+        if (ec) {
+          stopProcessing = true;
+          break;
+        }
+      }
+      return ec;
+    };
+
+    if (!processingError) {
+      processingError = runWorkers(transfersFunction);
     }
   }
 
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   if (!processingError) {
-    m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
-
     // sort by block height and transaction index in block
     std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
       return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
     });
 
+    // the first occurrence of a reused output key wins, whatever order the workers finished in
+    for (auto& tx : preprocessedTransactions) {
+      claimOutputKeys(tx.blockInfo, *tx.tx, tx);
+    }
+
+    m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
+
     for (const auto& tx : preprocessedTransactions) {
       processTransaction(tx.blockInfo, *tx.tx, tx);
     }
@@ -398,14 +457,15 @@ void TransfersConsumer::removeUnconfirmedTransaction(const Crypto::Hash& transac
   m_observerManager.notify(&IBlockchainConsumerObserver::onTransactionDeleteEnd, this, transactionHash);
 }
 
-void TransfersConsumer::addPublicKeysSeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey) {
-	std::lock_guard<std::mutex> lk(seen_mutex);
-    transactions_hash_seen.insert(transactionHash);
-    public_keys_seen.insert(outputKey);
+void TransfersConsumer::addPublicKeysSeen(const AccountPublicAddress& acc, const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey) {
+  auto it = m_subscriptions.find(acc.spendPublicKey);
+  if (it != m_subscriptions.end()) {
+    it->second->addPublicKeySeen(transactionHash, outputKey);
+  }
 }
 
 std::error_code TransfersConsumer::createTransfers(
-  const AccountKeys& account,
+  TransfersSubscription& sub,
   const TransactionBlockInfo& blockInfo,
   const ITransactionReader& tx,
   const std::vector<uint32_t>& outputs,
@@ -415,7 +475,6 @@ std::error_code TransfersConsumer::createTransfers(
   auto txPubKey = tx.getTransactionPublicKey();
   auto txHash = tx.getTransactionHash();
   std::vector<PublicKey> temp_keys;
-  std::lock_guard<std::mutex> lk(seen_mutex);
 
   for (auto idx : outputs) {
 
@@ -446,7 +505,7 @@ std::error_code TransfersConsumer::createTransfers(
 
       CryptoNote::KeyPair in_ephemeral;
       CryptoNote::generate_key_image_helper(
-        account,
+        sub.getKeys(),
         txPubKey,
         idx,
         in_ephemeral,
@@ -454,19 +513,11 @@ std::error_code TransfersConsumer::createTransfers(
 
       assert(out.key == reinterpret_cast<const PublicKey&>(in_ephemeral.publicKey));
 
-      std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(txHash);
-	  if (it == transactions_hash_seen.end()) {
-        std::unordered_set<Crypto::PublicKey>::iterator key_it = public_keys_seen.find(out.key);
-        if (key_it != public_keys_seen.end()) {
-          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate output key is found!";
-          return std::error_code();
-        }
-        if (std::find(temp_keys.begin(), temp_keys.end(), out.key) != temp_keys.end()) {
-          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same output key is present more than once";
-          return std::error_code();
-        }
-        temp_keys.push_back(out.key);
-	  }
+      if (std::find(temp_keys.begin(), temp_keys.end(), out.key) != temp_keys.end()) {
+        m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same output key is present more than once";
+        return std::error_code();
+      }
+      temp_keys.push_back(out.key);
       info.amount = amount;
       info.outputKey = out.key;
 
@@ -475,20 +526,12 @@ std::error_code TransfersConsumer::createTransfers(
       MultisignatureOutput out;
       tx.getOutput(idx, out, amount);
 
-	  for (const auto& key : out.keys) {
-        std::unordered_set<Crypto::Hash>::iterator it = transactions_hash_seen.find(txHash);
-        if (it == transactions_hash_seen.end()) {
-          std::unordered_set<Crypto::PublicKey>::iterator key_it = public_keys_seen.find(key);
-          if (key_it != public_keys_seen.end()) {
-			  m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate multisignature output key is found";
-            return std::error_code();
-          }
-          if (std::find(temp_keys.begin(), temp_keys.end(), key) != temp_keys.end()) {
-            m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same multisignature output key is present more than once";
-            return std::error_code();
-          }
-          temp_keys.push_back(key);
+      for (const auto& key : out.keys) {
+        if (std::find(temp_keys.begin(), temp_keys.end(), key) != temp_keys.end()) {
+          m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": the same multisignature output key is present more than once";
+          return std::error_code();
         }
+        temp_keys.push_back(key);
       }
       info.amount = amount;
       info.requiredSignatures = out.requiredSignatureCount;
@@ -497,12 +540,44 @@ std::error_code TransfersConsumer::createTransfers(
     transfers.push_back(info);
   }
 
-  transactions_hash_seen.emplace(txHash);
-  std::copy(temp_keys.begin(), temp_keys.end(), std::inserter(public_keys_seen, public_keys_seen.end()));
-
   return std::error_code();
 }
 
+void TransfersConsumer::claimOutputKeys(TransfersSubscription& sub, const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  std::vector<TransactionOutputInformationIn>& transfers) {
+  auto txHash = tx.getTransactionHash();
+  SeenOutputKeys& seenKeys = sub.getSeenOutputKeys();
+
+  // transfers are in output order; a key owned by another transaction drops the rest of this one
+  for (size_t i = 0; i < transfers.size(); ++i) {
+    const auto& info = transfers[i];
+    std::vector<PublicKey> keys;
+    if (info.type == TransactionTypes::OutputType::Key) {
+      keys.push_back(info.outputKey);
+    } else {
+      uint64_t amount;
+      MultisignatureOutput out;
+      tx.getOutput(info.outputInTransaction, out, amount);
+      keys = out.keys;
+    }
+
+    if (!seenKeys.tryAdd(txHash, blockInfo.height, keys)) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction " << Common::podToHex(txHash) << ": duplicate output key is found!";
+      transfers.resize(i);
+      break;
+    }
+  }
+}
+
+void TransfersConsumer::claimOutputKeys(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
+  for (auto& kv : info.outputs) {
+    auto it = m_subscriptions.find(kv.first);
+    if (it != m_subscriptions.end()) {
+      claimOutputKeys(*it->second, blockInfo, tx, kv.second);
+    }
+  }
+}
+
 std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
   std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
   findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
@@ -510,20 +585,34 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
     return std::error_code();
   }
 
-  std::error_code errorCode;
-  auto txHash = tx.getTransactionHash();
-  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
-    errorCode = getGlobalIndices(reinterpret_cast<const Hash&>(txHash), info.globalIdxs);
+  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT && info.globalIdxs.empty()) {
+    auto errorCode = getGlobalIndices(tx.getTransactionHash(), info.globalIdxs);
     if (errorCode) {
       return errorCode;
     }
   }
 
+  auto errorCode = createTransfers(blockInfo, tx, outputs, info);
+  if (errorCode) {
+    return errorCode;
+  }
+
+  claimOutputKeys(blockInfo, tx, info);
+  return std::error_code();
+}
+
+std::error_code TransfersConsumer::createTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  const std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info) {
+  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT && info.globalIdxs.size() != tx.getOutputCount()) {
+    return std::make_error_code(std::errc::argument_out_of_domain);
+  }
+
+  std::error_code errorCode;
   for (const auto& kv : outputs) {
     auto it = m_subscriptions.find(kv.first);
     if (it != m_subscriptions.end()) {
       auto& transfers = info.outputs[kv.first];
-      errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
+      errorCode = createTransfers(*it->second, blockInfo, tx, kv.second, info.globalIdxs, transfers);
       if (errorCode) {
         return errorCode;
       }
@@ -602,4 +691,19 @@ std::error_code TransfersConsumer::getGlobalIndices(const Hash& transactionHash,
   return f.get();
 }
 
+std::error_code TransfersConsumer::getGlobalIndices(const std::vector<Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  std::promise<std::error_code> prom;
+  std::future<std::error_code> f = prom.get_future();
+
+  INode::Callback cb = [&prom](std::error_code ec) {
+    std::promise<std::error_code> p(std::move(prom));
+    p.set_value(ec);
+  };
+
+  outsGlobalIndices.clear();
+  m_node.getTransactionsOutsGlobalIndices(transactionHashes, outsGlobalIndices, cb);
+
+  return f.get();
+}
+
 }
@@ -52,14 +52,20 @@ SynchronizationStart TransfersSubscription::getSyncStart() {
 
 void TransfersSubscription::onBlockchainDetach(uint32_t height) {
   std::vector<Hash> deletedTransactions = transfers.detach(height);
+  seenOutputKeys.detach(height);
   for (auto& hash : deletedTransactions) {
+    seenOutputKeys.erase(hash);
     m_observerManager.notify(&ITransfersObserver::onTransactionDeleted, this, hash);
   }
 }
 
 void TransfersSubscription::onError(const std::error_code& ec, uint32_t height) {
   if (height != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
-  transfers.detach(height);
+    for (auto& hash : transfers.detach(height)) {
+      seenOutputKeys.erase(hash);
+    }
+
+    seenOutputKeys.detach(height);
   }
   m_observerManager.notify(&ITransfersObserver::onError, this, height, ec);
 }
@@ -82,6 +88,20 @@ bool TransfersSubscription::addTransaction(const TransactionBlockInfo& blockInfo
   return added;
 }
 
+SeenOutputKeys& TransfersSubscription::getSeenOutputKeys() {
+  return seenOutputKeys;
+}
+
+void TransfersSubscription::addPublicKeySeen(const Hash& transactionHash, const PublicKey& outputKey) {
+  TransactionInformation info;
+  uint32_t height = WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT;
+  if (transfers.getTransactionInformation(transactionHash, info)) {
+    height = info.blockHeight;
+  }
+
+  seenOutputKeys.tryAdd(transactionHash, height, { outputKey });
+}
+
 AccountPublicAddress TransfersSubscription::getAddress() {
   return subscription.keys.address;
 }
@@ -92,6 +112,7 @@ ITransfersContainer& TransfersSubscription::getContainer() {
 
 void TransfersSubscription::deleteUnconfirmedTransaction(const Hash& transactionHash) {
   if (transfers.deleteUnconfirmedTransaction(transactionHash)) {
+    seenOutputKeys.erase(transactionHash);
     m_observerManager.notify(&ITransfersObserver::onTransactionDeleted, this, transactionHash);
   }
 }
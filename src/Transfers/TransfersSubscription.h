@@ -39,6 +39,7 @@
 
 #include "ITransfersSynchronizer.h"
 #include "TransfersContainer.h"
+#include "SeenOutputKeys.h"
 #include "IObservableImpl.h"
 
 #include "Logging/LoggerRef.h"
@@ -54,6 +55,8 @@ public:
   void onError(const std::error_code& ec, uint32_t height);
   bool advanceHeight(uint32_t height);
   const AccountKeys& getKeys() const;
+  SeenOutputKeys& getSeenOutputKeys();
+  void addPublicKeySeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
   bool addTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
                       const std::vector<TransactionOutputInformationIn>& transfers);
 
@@ -67,6 +70,7 @@ public:
 private:
   Logging::LoggerRef logger;
   TransfersContainer transfers;
+  SeenOutputKeys seenOutputKeys;
   AccountSubscription subscription;
 };
 
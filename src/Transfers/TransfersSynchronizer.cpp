@@ -112,7 +112,7 @@ ITransfersSubscription* TransfersSyncronizer::getSubscription(const AccountPubli
 void TransfersSyncronizer::addPublicKeysSeen(const AccountPublicAddress& acc, const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey) {
   auto it = m_consumers.find(acc.viewPublicKey);
   if (it != m_consumers.end()) {
-     it->second->addPublicKeysSeen(transactionHash, outputKey);
+     it->second->addPublicKeysSeen(acc, transactionHash, outputKey);
   }
 }
 
@@ -90,6 +90,9 @@ using namespace Logging;
 
 namespace {
 
+// journals smaller than this are never compacted, however small the cache is
+const uint64_t WALLET_JOURNAL_MIN_COMPACTION_SIZE = 16 * 1024 * 1024;
+
 void asyncRequestCompletion(System::Event& requestFinished) {
   requestFinished.set();
 }
@@ -166,6 +169,7 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_node(node),
   m_logger(logger, "WalletGreen/empty"),
   m_stopped(false),
+  m_journal(logger),
   m_blockchainSynchronizerStarted(false),
   m_blockchainSynchronizer(node, logger, currency.genesisBlockHash()),
   m_synchronizer(currency, logger, m_blockchainSynchronizer, node),
@@ -249,6 +253,7 @@ void WalletGreen::doShutdown() {
   stopBlockchainSynchronizer();
   m_blockchainSynchronizer.removeObserver(this);
 
+  m_journal.close();
   m_containerStorage.close();
   m_walletsContainer.clear();
   clearCaches(true, true);
@@ -408,7 +413,13 @@ void WalletGreen::save(WalletSaveLevel saveLevel, const std::string& extra) {
   stopBlockchainSynchronizer();
 
   try {
-    saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+    if (saveLevel == WalletSaveLevel::SAVE_ALL) {
+      saveWalletCacheToJournal(extra);
+    } else {
+      saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+      // the journal only applies over a full cache
+      m_journal.discard();
+    }
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
     startBlockchainSynchronizer();
@@ -504,7 +515,7 @@ void WalletGreen::load(const std::string& path, const std::string& password, std
       try {
         std::unordered_set<Crypto::PublicKey> addedSpendKeys;
         std::unordered_set<Crypto::PublicKey> deletedSpendKeys;
-        loadWalletCache(addedSpendKeys, deletedSpendKeys, extra);
+        loadWalletCache(path, addedSpendKeys, deletedSpendKeys, extra);
 
         if (!addedSpendKeys.empty()) {
           m_logger(WARNING, BRIGHT_YELLOW) << "Found addresses not saved in container cache. Resynchronize container";
@@ -519,6 +530,7 @@ void WalletGreen::load(const std::string& path, const std::string& password, std
 
         if (!addedSpendKeys.empty() || !deletedSpendKeys.empty()) {
           saveWalletCache(m_containerStorage, m_key, WalletSaveLevel::SAVE_ALL, extra);
+          m_journal.discard();
         }
       } catch (const std::exception& e) {
         m_logger(ERROR, BRIGHT_RED) << "Failed to load cache: " << e.what() << ", reset wallet data";
@@ -606,12 +618,20 @@ void WalletGreen::loadContainerStorage(const std::string& path) {
   }
 }
 
-void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra) {
+void WalletGreen::loadWalletCache(const std::string& path, std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra) {
   assert(m_containerStorage.isOpened());
 
   BinaryArray contanerData;
   loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
 
+  try {
+    // saves after the cache was last written to the container, a save torn by a crash is dropped
+    m_journal.open(WalletJournal::getPath(path), m_key, getContainerDataIv(m_containerStorage), contanerData);
+  } catch (const std::exception& e) {
+    m_logger(WARNING, BRIGHT_YELLOW) << "Failed to replay wallet journal, loading the container cache: " << e.what();
+    m_journal.close();
+  }
+
   WalletSerializerV2 s(
     *this,
     m_viewPublicKey,
@@ -639,6 +659,39 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
 void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra) {
   m_logger(DEBUGGING) << "Saving cache...";
 
+  std::string containerData;
+  serializeWalletCache(saveLevel, extra, containerData);
+
+  encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size());
+  storage.flush();
+
+  m_extra = extra;
+
+  m_logger(DEBUGGING) << "Container saving finished";
+}
+
+void WalletGreen::saveWalletCacheToJournal(const std::string& extra) {
+  m_logger(DEBUGGING) << "Saving cache to journal...";
+
+  std::string containerData;
+  serializeWalletCache(WalletSaveLevel::SAVE_ALL, extra, containerData);
+
+  if (m_journal.isOpened() && m_journal.size() <= std::max<uint64_t>(WALLET_JOURNAL_MIN_COMPACTION_SIZE, containerData.size() / 2)) {
+    m_journal.append(containerData.data(), containerData.size());
+  } else {
+    // the journal is folded into a new container cache once it gets larger than half of it
+    m_logger(DEBUGGING) << "Compacting journal into container...";
+    encryptAndSaveContainerData(m_containerStorage, m_key, containerData.data(), containerData.size());
+    m_containerStorage.flush();
+    m_journal.reset(WalletJournal::getPath(m_path), m_key, getContainerDataIv(m_containerStorage), containerData.data(), containerData.size());
+  }
+
+  m_extra = extra;
+
+  m_logger(DEBUGGING) << "Container saving finished";
+}
+
+void WalletGreen::serializeWalletCache(WalletSaveLevel saveLevel, const std::string& extra, std::string& containerData) {
   WalletTransactions transactions;
   WalletTransfers transfers;
 
@@ -659,7 +712,6 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
     });
   }
 
-  std::string containerData;
   Common::StringOutputStream containerStream(containerData);
 
   WalletSerializerV2 s(
@@ -679,13 +731,6 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
   );
 
   s.save(containerStream, saveLevel);
-
-  encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size());
-  storage.flush();
-
-  m_extra = extra;
-
-  m_logger(DEBUGGING) << "Container saving finished";
 }
 
 void WalletGreen::copyContainerStorageKeys(ContainerStorage& src, const chacha8_key& srcKey, ContainerStorage& dst, const chacha8_key& dstKey) {
@@ -760,6 +805,14 @@ void WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const C
   chacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char*>(containerData.data()));
 }
 
+Crypto::chacha8_iv WalletGreen::getContainerDataIv(ContainerStorage& storage) {
+  Common::MemoryInputStream suffixStream(storage.suffix(), storage.suffixSize());
+  BinaryInputStreamSerializer suffixSerializer(suffixStream);
+  Crypto::chacha8_iv suffixIv;
+  suffixSerializer(suffixIv, "suffixIv");
+  return suffixIv;
+}
+
 void WalletGreen::initTransactionPool() {
   std::unordered_set<Crypto::Hash> uncommitedTransactionsSet;
   std::transform(m_uncommitedTransactions.begin(), m_uncommitedTransactions.end(), std::inserter(uncommitedTransactionsSet, uncommitedTransactionsSet.end()),
@@ -946,10 +999,16 @@ void WalletGreen::changePassword(const std::string& oldPassword, const std::stri
     if (m_containerStorage.suffixSize() > 0) {
       BinaryArray containerData;
       loadAndDecryptContainerData(m_containerStorage, m_key, containerData);
+      if (m_journal.isOpened()) {
+        m_journal.read(containerData);
+      }
+
       encryptAndSaveContainerData(newStorage, newKey, containerData.data(), containerData.size());
     }
   });
 
+  // the new container holds what the journal had, under the old key
+  m_journal.discard();
   m_key = newKey;
   m_password = newPassword;
 
@@ -44,6 +44,7 @@
 
 #include "IFusionManager.h"
 #include "WalletIndices.h"
+#include "WalletJournal.h"
 
 #include "Logging/LoggerRef.h"
 #include <System/Dispatcher.h>
@@ -351,11 +352,14 @@ protected:
   void deleteOrphanTransactions(const std::unordered_set<Crypto::PublicKey>& deletedKeys);
   static void encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
   static void loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
+  static Crypto::chacha8_iv getContainerDataIv(ContainerStorage& storage);
   void initTransactionPool();
   void loadSpendKeys();
   void loadContainerStorage(const std::string& path);
-  void loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
+  void loadWalletCache(const std::string& path, std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
   void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra);
+  void saveWalletCacheToJournal(const std::string& extra);
+  void serializeWalletCache(WalletSaveLevel saveLevel, const std::string& extra, std::string& containerData);
   void subscribeWallets();
 
   std::vector<OutputToTransfer> pickRandomFusionInputs(const std::vector<std::string>& addresses,
@@ -397,6 +401,8 @@ protected:
 
   WalletsContainer m_walletsContainer;
   ContainerStorage m_containerStorage;
+  // saves since the cache was last written to m_containerStorage
+  WalletJournal m_journal;
   UnlockTransactionJobs m_unlockTransactionsJob;
   WalletTransactions m_transactions;
   WalletTransfers m_transfers; //sorted
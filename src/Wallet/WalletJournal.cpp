@@ -0,0 +1,583 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "WalletJournal.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem/operations.hpp>
+
+#include "Common/MemoryInputStream.h"
+#include "Common/StreamTools.h"
+#include "Common/StringOutputStream.h"
+#include "crypto/crypto.h"
+
+using namespace Logging;
+
+namespace CryptoNote {
+
+namespace {
+
+const char JOURNAL_SIGNATURE[8] = { 'W', 'A', 'L', 'L', 'E', 'T', 'J', '1' };
+const size_t JOURNAL_HEADER_SIZE = sizeof(JOURNAL_SIGNATURE) + sizeof(Crypto::Hash);
+// payload size, iv and checksum around every encrypted payload
+const size_t RECORD_OVERHEAD = sizeof(uint32_t) + sizeof(Crypto::chacha8_iv) + sizeof(Crypto::Hash);
+
+const uint8_t RECORD_CHUNK = 1;
+const uint8_t RECORD_COMMIT = 2;
+
+// chunks are cut where the gear hash of the last 64 bytes has its top bits clear, about 32 KiB past the minimum
+const size_t MIN_CHUNK_SIZE = 8 * 1024;
+const size_t MAX_CHUNK_SIZE = 128 * 1024;
+const unsigned CHUNK_BOUNDARY_BITS = 15;
+
+std::array<uint64_t, 256> makeGearTable() {
+  // fixed table, boundaries have to stay the same across runs
+  std::array<uint64_t, 256> table;
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (auto& value : table) {
+    state += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    value = z ^ (z >> 31);
+  }
+
+  return table;
+}
+
+const std::array<uint64_t, 256> GEAR_TABLE = makeGearTable();
+
+std::system_error journalWriteError() {
+  return std::system_error(std::make_error_code(std::errc::io_error), "Failed to write wallet journal");
+}
+
+std::system_error journalReadError() {
+  return std::system_error(std::make_error_code(std::errc::io_error), "Failed to read wallet journal");
+}
+
+}
+
+WalletJournal::WalletJournal(Logging::ILogger& logger) : m_logger(logger, "WalletJournal"), m_file(nullptr), m_size(0) {
+}
+
+WalletJournal::~WalletJournal() {
+  close();
+}
+
+std::string WalletJournal::getPath(const std::string& containerPath) {
+  return containerPath + ".journal";
+}
+
+void WalletJournal::open(const std::string& path, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& containerIv, BinaryArray& containerData) {
+  close();
+  m_path = path;
+  m_key = key;
+  m_binding = getBinding(key, containerIv);
+
+  ReplayResult result = replay(containerData);
+  std::vector<size_t> chunkEnds = splitChunks(containerData.data(), containerData.size());
+  std::vector<Crypto::Hash> hashes;
+  std::vector<uint64_t> fingerprints;
+  if (result.lastCommit.size() == chunkEnds.size()) {
+    // the replay has hashed the chunks of the cache already
+    hashes = std::move(result.lastCommit);
+    size_t offset = 0;
+    for (size_t end : chunkEnds) {
+      fingerprints.push_back(getFingerprint(containerData.data() + offset, end - offset));
+      offset = end;
+    }
+  } else {
+    hashChunks(containerData.data(), chunkEnds, hashes, fingerprints);
+  }
+
+  if (result.validSize == 0) {
+    m_logger(DEBUGGING) << "No journal over the container data, starting a new one";
+    create();
+    m_chunks.insert(hashes.begin(), hashes.end());
+    setLastCommit(containerData.data(), containerData.size(), std::move(chunkEnds), std::move(hashes), fingerprints);
+    return;
+  }
+
+  boost::system::error_code ec;
+  uint64_t fileSize = boost::filesystem::file_size(m_path, ec);
+  if (!ec && fileSize > result.validSize) {
+    m_logger(WARNING, BRIGHT_YELLOW) << "Dropping " << (fileSize - result.validSize) << " bytes of an incomplete journal save";
+    boost::filesystem::resize_file(m_path, result.validSize);
+  }
+
+  m_file = std::fopen(m_path.c_str(), "ab");
+  if (m_file == nullptr) {
+    m_path.clear();
+    throw journalWriteError();
+  }
+
+  m_size = result.validSize;
+  m_chunks = std::move(result.chunks);
+  setLastCommit(containerData.data(), containerData.size(), std::move(chunkEnds), std::move(hashes), fingerprints);
+  m_logger(DEBUGGING) << "Journal replayed, " << m_size << " bytes";
+}
+
+void WalletJournal::reset(const std::string& path, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& containerIv, const void* containerData, size_t containerDataSize) {
+  // hashed before closing, most of the compacted cache is what was committed last
+  const uint8_t* bytes = static_cast<const uint8_t*>(containerData);
+  std::vector<size_t> chunkEnds = splitChunks(bytes, containerDataSize);
+  std::vector<Crypto::Hash> hashes;
+  std::vector<uint64_t> fingerprints;
+  hashChunks(bytes, chunkEnds, hashes, fingerprints);
+
+  close();
+  m_path = path;
+  m_key = key;
+  m_binding = getBinding(key, containerIv);
+
+  create();
+  m_chunks.insert(hashes.begin(), hashes.end());
+  setLastCommit(bytes, containerDataSize, std::move(chunkEnds), std::move(hashes), fingerprints);
+}
+
+void WalletJournal::read(BinaryArray& containerData) const {
+  assert(isOpened());
+  replay(containerData);
+}
+
+void WalletJournal::append(const void* data, size_t size) {
+  assert(isOpened());
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  std::vector<size_t> chunkEnds = splitChunks(bytes, size);
+  std::vector<Crypto::Hash> commit;
+  std::vector<uint64_t> fingerprints;
+  hashChunks(bytes, chunkEnds, commit, fingerprints);
+
+  if (commit == m_lastCommit) {
+    m_logger(DEBUGGING) << "Nothing changed since the last journal commit";
+    return;
+  }
+
+  try {
+    size_t written = 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < chunkEnds.size(); ++i) {
+      if (m_chunks.insert(commit[i]).second) {
+        std::string payload(reinterpret_cast<const char*>(bytes + offset), chunkEnds[i] - offset);
+        writeRecord(RECORD_CHUNK, payload);
+        ++written;
+      }
+
+      offset = chunkEnds[i];
+    }
+
+    std::string payload;
+    Common::StringOutputStream payloadStream(payload);
+    Common::write(payloadStream, static_cast<uint64_t>(size));
+    Common::write(payloadStream, commit.data(), commit.size() * sizeof(Crypto::Hash));
+    writeRecord(RECORD_COMMIT, payload);
+    // the journal is the only copy of the save, it has to be on the disk before the save counts as done
+    sync();
+
+    m_logger(DEBUGGING) << "Journal commit of " << size << " bytes, " << written << " of " << commit.size() << " chunks written";
+  } catch (std::exception&) {
+    // the file may end with a torn save now, the owner starts the journal over
+    close();
+    throw;
+  }
+
+  setLastCommit(bytes, size, std::move(chunkEnds), std::move(commit), fingerprints);
+}
+
+void WalletJournal::discard() {
+  std::string path = m_path;
+  close();
+
+  if (!path.empty()) {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(path, ignore);
+  }
+}
+
+void WalletJournal::close() {
+  if (m_file != nullptr) {
+    std::fclose(m_file);
+    m_file = nullptr;
+  }
+
+  m_path.clear();
+  m_size = 0;
+  m_chunks.clear();
+  m_lastData.clear();
+  m_lastChunkEnds.clear();
+  m_lastCommit.clear();
+  m_lastChunkIndex.clear();
+}
+
+bool WalletJournal::isOpened() const {
+  return m_file != nullptr;
+}
+
+uint64_t WalletJournal::size() const {
+  return m_size;
+}
+
+Crypto::Hash WalletJournal::getBinding(const Crypto::chacha8_key& key, const Crypto::chacha8_iv& containerIv) {
+  std::string binding(JOURNAL_SIGNATURE, sizeof(JOURNAL_SIGNATURE));
+  binding.append(reinterpret_cast<const char*>(&key), sizeof(key));
+  binding.append(reinterpret_cast<const char*>(&containerIv), sizeof(containerIv));
+  return Crypto::cn_fast_hash(binding.data(), binding.size());
+}
+
+std::vector<size_t> WalletJournal::splitChunks(const uint8_t* data, size_t size) {
+  std::vector<size_t> ends;
+  size_t start = 0;
+  while (start < size) {
+    size_t end = std::min(size, start + MAX_CHUNK_SIZE);
+    if (end - start > MIN_CHUNK_SIZE) {
+      // the hash only depends on the last 64 bytes, no need to roll it from the chunk start
+      uint64_t hash = 0;
+      for (size_t i = start + MIN_CHUNK_SIZE - 64; i < end; ++i) {
+        hash = (hash << 1) + GEAR_TABLE[data[i]];
+        if (i >= start + MIN_CHUNK_SIZE && (hash >> (64 - CHUNK_BOUNDARY_BITS)) == 0) {
+          end = i + 1;
+          break;
+        }
+      }
+    }
+
+    ends.push_back(end);
+    start = end;
+  }
+
+  return ends;
+}
+
+uint64_t WalletJournal::getFingerprint(const uint8_t* data, size_t size) {
+  // only finds the previous copy of a chunk, a match is confirmed by comparing the bytes
+  uint64_t fingerprint = size;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    fingerprint = (fingerprint ^ word) * 0x9e3779b97f4a7c15ULL;
+    fingerprint ^= fingerprint >> 29;
+  }
+
+  for (; i < size; ++i) {
+    fingerprint = (fingerprint ^ data[i]) * 0x9e3779b97f4a7c15ULL;
+  }
+
+  return fingerprint;
+}
+
+WalletJournal::ReplayResult WalletJournal::replay(BinaryArray& containerData) const {
+  ReplayResult result;
+
+  std::ifstream file(m_path, std::ios_base::binary);
+  if (!file) {
+    return result;
+  }
+
+  file.seekg(0, std::ios_base::end);
+  uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+  file.seekg(0, std::ios_base::beg);
+
+  char header[JOURNAL_HEADER_SIZE];
+  if (fileSize < JOURNAL_HEADER_SIZE || !file.read(header, sizeof(header)) ||
+      std::memcmp(header, JOURNAL_SIGNATURE, sizeof(JOURNAL_SIGNATURE)) != 0 ||
+      std::memcmp(header + sizeof(JOURNAL_SIGNATURE), &m_binding, sizeof(m_binding)) != 0) {
+    return result;
+  }
+
+  struct ChunkLocation {
+    uint64_t offset;
+    size_t size;
+  };
+
+  // chunks are located in the container data or in the journal file, only those of the last commit are read back
+  std::unordered_map<Crypto::Hash, ChunkLocation> containerChunks;
+  std::vector<Crypto::Hash> containerCommit;
+  size_t offset = 0;
+  for (size_t end : splitChunks(containerData.data(), containerData.size())) {
+    containerCommit.push_back(Crypto::cn_fast_hash(containerData.data() + offset, end - offset));
+    containerChunks.emplace(containerCommit.back(), ChunkLocation{ offset, end - offset });
+    offset = end;
+  }
+
+  std::unordered_map<Crypto::Hash, ChunkLocation> committedChunks;
+  std::unordered_map<Crypto::Hash, ChunkLocation> pendingChunks;
+  std::vector<Crypto::Hash> lastCommit;
+  uint64_t lastCommitSize = 0;
+  bool committed = false;
+
+  uint64_t position = JOURNAL_HEADER_SIZE;
+  result.validSize = position;
+  std::string payload;
+  while (readRecord(file, fileSize - position, payload)) {
+    uint64_t recordPosition = position;
+    position += RECORD_OVERHEAD + payload.size();
+
+    uint8_t type = static_cast<uint8_t>(payload[0]);
+    if (type == RECORD_CHUNK) {
+      pendingChunks[Crypto::cn_fast_hash(payload.data() + 1, payload.size() - 1)] = ChunkLocation{ recordPosition, payload.size() - 1 };
+    } else if (type == RECORD_COMMIT) {
+      if (payload.size() < 1 + sizeof(uint64_t) || (payload.size() - 1 - sizeof(uint64_t)) % sizeof(Crypto::Hash) != 0) {
+        break;
+      }
+
+      Common::MemoryInputStream commitStream(payload.data() + 1, payload.size() - 1);
+      uint64_t commitSize = Common::read<uint64_t>(commitStream);
+      std::vector<Crypto::Hash> commit((payload.size() - 1 - sizeof(uint64_t)) / sizeof(Crypto::Hash));
+      Common::read(commitStream, commit.data(), commit.size() * sizeof(Crypto::Hash));
+
+      uint64_t chunksSize = 0;
+      bool complete = true;
+      for (const auto& hash : commit) {
+        auto containerIt = containerChunks.find(hash);
+        auto committedIt = committedChunks.find(hash);
+        auto pendingIt = pendingChunks.find(hash);
+        if (containerIt != containerChunks.end()) {
+          chunksSize += containerIt->second.size;
+        } else if (committedIt != committedChunks.end()) {
+          chunksSize += committedIt->second.size;
+        } else if (pendingIt != pendingChunks.end()) {
+          chunksSize += pendingIt->second.size;
+        } else {
+          complete = false;
+          break;
+        }
+      }
+
+      if (!complete || chunksSize != commitSize) {
+        m_logger(WARNING, BRIGHT_YELLOW) << "Journal commit refers to missing data, replay stopped";
+        break;
+      }
+
+      committedChunks.insert(pendingChunks.begin(), pendingChunks.end());
+      pendingChunks.clear();
+      lastCommit.swap(commit);
+      lastCommitSize = commitSize;
+      committed = true;
+      result.validSize = position;
+    } else {
+      break;
+    }
+  }
+
+  if (file.bad()) {
+    throw journalReadError();
+  }
+
+  for (const auto& chunk : containerChunks) {
+    result.chunks.insert(chunk.first);
+  }
+
+  for (const auto& chunk : committedChunks) {
+    result.chunks.insert(chunk.first);
+  }
+
+  if (!committed) {
+    result.lastCommit.swap(containerCommit);
+    return result;
+  }
+
+  BinaryArray data;
+  data.reserve(lastCommitSize);
+  for (const auto& hash : lastCommit) {
+    auto containerIt = containerChunks.find(hash);
+    if (containerIt != containerChunks.end()) {
+      auto begin = containerData.begin() + containerIt->second.offset;
+      data.insert(data.end(), begin, begin + containerIt->second.size);
+      continue;
+    }
+
+    const ChunkLocation& location = committedChunks.at(hash);
+    file.clear();
+    file.seekg(location.offset);
+    if (!readRecord(file, fileSize - location.offset, payload) || payload.size() - 1 != location.size ||
+        Crypto::cn_fast_hash(payload.data() + 1, payload.size() - 1) != hash) {
+      throw journalReadError();
+    }
+
+    data.insert(data.end(), payload.begin() + 1, payload.end());
+  }
+
+  containerData.swap(data);
+  result.lastCommit.swap(lastCommit);
+  return result;
+}
+
+bool WalletJournal::readRecord(std::istream& file, uint64_t available, std::string& payload) const {
+  if (available < RECORD_OVERHEAD) {
+    return false;
+  }
+
+  uint32_t payloadSize;
+  if (!file.read(reinterpret_cast<char*>(&payloadSize), sizeof(payloadSize)) || payloadSize == 0 || available - RECORD_OVERHEAD < payloadSize) {
+    return false;
+  }
+
+  std::string ivAndCipher(sizeof(Crypto::chacha8_iv) + payloadSize, '\0');
+  Crypto::Hash checksum;
+  if (!file.read(&ivAndCipher[0], ivAndCipher.size()) || !file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum)) ||
+      Crypto::cn_fast_hash(ivAndCipher.data(), ivAndCipher.size()) != checksum) {
+    return false;
+  }
+
+  Crypto::chacha8_iv iv;
+  std::memcpy(&iv, ivAndCipher.data(), sizeof(iv));
+  payload.resize(payloadSize);
+  Crypto::chacha8(ivAndCipher.data() + sizeof(iv), payloadSize, m_key, iv, &payload[0]);
+  return true;
+}
+
+void WalletJournal::create() {
+  m_file = std::fopen(m_path.c_str(), "wb");
+  if (m_file == nullptr) {
+    m_path.clear();
+    throw journalWriteError();
+  }
+
+  if (std::fwrite(JOURNAL_SIGNATURE, sizeof(JOURNAL_SIGNATURE), 1, m_file) != 1 ||
+      std::fwrite(&m_binding, sizeof(m_binding), 1, m_file) != 1) {
+    close();
+    throw journalWriteError();
+  }
+
+  m_size = JOURNAL_HEADER_SIZE;
+  try {
+    sync();
+  } catch (std::exception&) {
+    close();
+    throw;
+  }
+}
+
+void WalletJournal::hashChunks(const uint8_t* data, const std::vector<size_t>& chunkEnds, std::vector<Crypto::Hash>& hashes,
+  std::vector<uint64_t>& fingerprints) const {
+  hashes.clear();
+  hashes.reserve(chunkEnds.size());
+  fingerprints.clear();
+  fingerprints.reserve(chunkEnds.size());
+
+  size_t offset = 0;
+  for (size_t end : chunkEnds) {
+    const uint8_t* chunk = data + offset;
+    size_t size = end - offset;
+    fingerprints.push_back(getFingerprint(chunk, size));
+
+    bool found = false;
+    auto range = m_lastChunkIndex.equal_range(fingerprints.back());
+    for (auto it = range.first; it != range.second; ++it) {
+      size_t lastOffset = it->second == 0 ? 0 : m_lastChunkEnds[it->second - 1];
+      if (m_lastChunkEnds[it->second] - lastOffset == size && std::memcmp(m_lastData.data() + lastOffset, chunk, size) == 0) {
+        hashes.push_back(m_lastCommit[it->second]);
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      hashes.push_back(Crypto::cn_fast_hash(chunk, size));
+    }
+
+    offset = end;
+  }
+}
+
+void WalletJournal::setLastCommit(const uint8_t* data, size_t size, std::vector<size_t> chunkEnds, std::vector<Crypto::Hash> hashes,
+  const std::vector<uint64_t>& fingerprints) {
+  assert(chunkEnds.size() == hashes.size() && fingerprints.size() == hashes.size());
+
+  m_lastData.assign(data, data + size);
+  m_lastChunkEnds = std::move(chunkEnds);
+  m_lastCommit = std::move(hashes);
+  m_lastChunkIndex.clear();
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    m_lastChunkIndex.emplace(fingerprints[i], i);
+  }
+}
+
+void WalletJournal::writeRecord(uint8_t type, const std::string& payload) {
+  std::string plain;
+  plain.reserve(payload.size() + 1);
+  plain.push_back(static_cast<char>(type));
+  plain.append(payload);
+
+  Crypto::chacha8_iv iv = Crypto::rand<Crypto::chacha8_iv>();
+  std::string record(RECORD_OVERHEAD + plain.size(), '\0');
+  uint32_t payloadSize = static_cast<uint32_t>(plain.size());
+  std::memcpy(&record[0], &payloadSize, sizeof(payloadSize));
+  std::memcpy(&record[sizeof(uint32_t)], &iv, sizeof(iv));
+  Crypto::chacha8(plain.data(), plain.size(), m_key, iv, &record[sizeof(uint32_t) + sizeof(iv)]);
+
+  size_t checkedSize = sizeof(iv) + plain.size();
+  Crypto::Hash checksum = Crypto::cn_fast_hash(record.data() + sizeof(uint32_t), checkedSize);
+  std::memcpy(&record[sizeof(uint32_t) + checkedSize], &checksum, sizeof(checksum));
+
+  if (std::fwrite(record.data(), record.size(), 1, m_file) != 1) {
+    throw journalWriteError();
+  }
+
+  m_size += record.size();
+}
+
+void WalletJournal::sync() {
+  if (std::fflush(m_file) != 0) {
+    throw journalWriteError();
+  }
+
+#ifdef _WIN32
+  int result = ::_commit(::_fileno(m_file));
+#else
+  int result = ::fsync(::fileno(m_file));
+#endif
+  if (result != 0) {
+    throw journalWriteError();
+  }
+}
+
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CryptoNote.h"
+#include "crypto/chacha8.h"
+#include "crypto/hash.h"
+#include "Logging/LoggerRef.h"
+
+namespace CryptoNote {
+
+// Append-only journal of wallet cache saves, kept next to the container file.
+// The serialized cache is cut into content defined chunks. A save appends the chunks neither the container nor the
+// journal hold yet, then a commit listing the chunks of the whole cache, so it costs about what changed since the
+// last save. Records are encrypted with the container key and checksummed; a replay stops at the first record that
+// isn't complete and goes back to the last commit before it, dropping a save torn by a crash.
+class WalletJournal {
+public:
+  explicit WalletJournal(Logging::ILogger& logger);
+  WalletJournal(const WalletJournal&) = delete;
+  ~WalletJournal();
+  WalletJournal& operator=(const WalletJournal&) = delete;
+
+  static std::string getPath(const std::string& containerPath);
+
+  // Replays the journal over the cache read from the container and keeps it open for appends.
+  // A missing journal, or one written over other container data or with another key, is started over.
+  void open(const std::string& path, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& containerIv, BinaryArray& containerData);
+  // Starts an empty journal after the whole cache was written to the container.
+  void reset(const std::string& path, const Crypto::chacha8_key& key, const Crypto::chacha8_iv& containerIv, const void* containerData, size_t containerDataSize);
+  // Replays the open journal over the cache read from the container again.
+  void read(BinaryArray& containerData) const;
+  // Appends the cache unless it is the one committed last.
+  void append(const void* data, size_t size);
+  // Closes the journal and removes its file, once the container holds what it had.
+  void discard();
+  void close();
+
+  bool isOpened() const;
+  // Bytes in the journal, the owner compacts it into the container once it grows too large.
+  uint64_t size() const;
+
+private:
+  struct ReplayResult {
+    // end of the last complete commit, zero when the file isn't a journal over this container data
+    uint64_t validSize = 0;
+    std::unordered_set<Crypto::Hash> chunks;
+    std::vector<Crypto::Hash> lastCommit;
+  };
+
+  static Crypto::Hash getBinding(const Crypto::chacha8_key& key, const Crypto::chacha8_iv& containerIv);
+  static std::vector<size_t> splitChunks(const uint8_t* data, size_t size);
+  static uint64_t getFingerprint(const uint8_t* data, size_t size);
+
+  ReplayResult replay(BinaryArray& containerData) const;
+  // reads and decrypts the record at the stream position, false if it is incomplete or damaged
+  bool readRecord(std::istream& file, uint64_t available, std::string& payload) const;
+  void create();
+  // hashes the chunks, those of the last commit are found by their fingerprint and bytes instead
+  void hashChunks(const uint8_t* data, const std::vector<size_t>& chunkEnds, std::vector<Crypto::Hash>& hashes, std::vector<uint64_t>& fingerprints) const;
+  void setLastCommit(const uint8_t* data, size_t size, std::vector<size_t> chunkEnds, std::vector<Crypto::Hash> hashes, const std::vector<uint64_t>& fingerprints);
+  void writeRecord(uint8_t type, const std::string& payload);
+  // writes buffered records through to the disk
+  void sync();
+
+  Logging::LoggerRef m_logger;
+  std::string m_path;
+  Crypto::chacha8_key m_key;
+  Crypto::Hash m_binding;
+  FILE* m_file;
+  uint64_t m_size;
+  // chunks held by the container or committed to the journal
+  std::unordered_set<Crypto::Hash> m_chunks;
+  // the cache of the last commit is kept, so a save only hashes the chunks that changed
+  BinaryArray m_lastData;
+  std::vector<size_t> m_lastChunkEnds;
+  std::vector<Crypto::Hash> m_lastCommit;
+  std::unordered_multimap<uint64_t, size_t> m_lastChunkIndex;
+};
+
+}
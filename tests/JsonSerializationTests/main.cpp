@@ -0,0 +1,279 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Common/JsonValue.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/SerializationTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+      ++failures; \
+    } \
+  } while (false)
+
+struct Item {
+  uint32_t index;
+  std::string name;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(index)
+    KV_MEMBER(name)
+  }
+};
+
+// every kind of value ISerializer writes, in an order the tree writer would sort differently
+struct Record {
+  uint8_t u8;
+  int16_t i16;
+  uint16_t u16;
+  int32_t i32;
+  uint32_t u32;
+  int64_t i64;
+  uint64_t u64;
+  double real;
+  bool flag;
+  std::string text;
+  std::string blob;
+  uint8_t hash[32];
+  Item item;
+  std::vector<Item> items;
+  std::vector<uint64_t> amounts;
+  std::vector<std::string> empty;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(u8)
+    KV_MEMBER(i16)
+    KV_MEMBER(u16)
+    KV_MEMBER(i32)
+    KV_MEMBER(u32)
+    KV_MEMBER(i64)
+    KV_MEMBER(u64)
+    KV_MEMBER(real)
+    KV_MEMBER(flag)
+    KV_MEMBER(text)
+    s.binary(blob, "blob");
+    s.binary(hash, sizeof(hash), "hash");
+    KV_MEMBER(item)
+    KV_MEMBER(items)
+    KV_MEMBER(amounts)
+    KV_MEMBER(empty)
+  }
+};
+
+Record makeRecord(int64_t integer, double real) {
+  Record record;
+  record.u8 = static_cast<uint8_t>(integer);
+  record.i16 = static_cast<int16_t>(integer);
+  record.u16 = static_cast<uint16_t>(integer);
+  record.i32 = static_cast<int32_t>(integer);
+  record.u32 = static_cast<uint32_t>(integer);
+  record.i64 = integer;
+  record.u64 = static_cast<uint64_t>(integer);
+  record.real = real;
+  record.flag = integer % 2 != 0;
+  record.text = "record " + std::to_string(integer);
+  record.blob = std::string("\x00\x01\xfe\xff", 4);
+  for (size_t i = 0; i < sizeof(record.hash); ++i) {
+    record.hash[i] = static_cast<uint8_t>(integer + i);
+  }
+
+  record.item = Item{ 1, "one" };
+  record.items = { Item{ 2, "two" }, Item{ 3, "" } };
+  record.amounts = { 0, 1, std::numeric_limits<uint64_t>::max() };
+  return record;
+}
+
+// storeToJsonBuffer keeps serialization order, so the texts are compared once both went through a JsonValue
+template <typename T>
+void checkSameAsTree(const T& value) {
+  std::string buffer = storeToJsonBuffer(value);
+  std::string tree = storeToJson(value);
+  CHECK(Common::JsonValue::fromString(buffer).toString() == tree);
+}
+
+void testValues() {
+  const int64_t integers[] = { 0, 1, -1, 255, 65535, -32768, 2147483647, std::numeric_limits<int64_t>::min(),
+    std::numeric_limits<int64_t>::max() };
+  const double reals[] = { 0.0, -2.5, 0.1, 1e15, 123456.00000000001, -0.00000000001 };
+  for (int64_t integer : integers) {
+    for (double real : reals) {
+      checkSameAsTree(makeRecord(integer, real));
+    }
+  }
+}
+
+void testRpcResponse() {
+  f_block_details_response block = f_block_details_response();
+  block.major_version = 5;
+  block.timestamp = 1650000000;
+  block.prev_hash = std::string(64, 'a');
+  block.hash = std::string(64, 'b');
+  block.height = 123456;
+  block.difficulty = 987654321;
+  block.cumulativeDifficulty = 98765432100000;
+  block.reward = 1000000000;
+  block.alreadyGeneratedCoins = "12345678901234567";
+  block.penalty = 0.25;
+  for (uint64_t i = 0; i < 3; ++i) {
+    f_transaction_short_response transaction;
+    transaction.hash = std::string(64, static_cast<char>('c' + i));
+    transaction.fee = 1000 * i;
+    transaction.amount_out = 50000000 + i;
+    transaction.size = 300 + i;
+    block.transactions.push_back(transaction);
+  }
+
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response response;
+  response.block = block;
+  response.status = CORE_RPC_STATUS_OK;
+  checkSameAsTree(response);
+}
+
+// strings go out as they are, like the tree writer, so escape sequences survive a round trip through either reader
+void testStrings() {
+  Item item{ 7, "C:\\wallets\\u00e9t\\u00e9 \\n \xc3\xa9" };
+  checkSameAsTree(item);
+  std::string buffer = storeToJsonBuffer(item);
+  CHECK(buffer.find(item.name) != std::string::npos);
+
+  Item loaded;
+  CHECK(loadFromJson(loaded, buffer));
+  CHECK(loaded.index == item.index);
+  CHECK(loaded.name == item.name);
+  CHECK(Common::JsonValue::fromString(buffer)("name").getString() == item.name);
+}
+
+void testInputValues() {
+  Record record = makeRecord(-12345, -2.5);
+  Record loaded;
+  CHECK(loadFromJson(loaded, storeToJsonBuffer(record)));
+  CHECK(loaded.u8 == record.u8 && loaded.i16 == record.i16 && loaded.u16 == record.u16);
+  CHECK(loaded.i32 == record.i32 && loaded.u32 == record.u32 && loaded.i64 == record.i64 && loaded.u64 == record.u64);
+  CHECK(loaded.real == record.real && loaded.flag == record.flag && loaded.text == record.text && loaded.blob == record.blob);
+  CHECK(memcmp(loaded.hash, record.hash, sizeof(record.hash)) == 0);
+  CHECK(loaded.item.index == 1 && loaded.item.name == "one");
+  CHECK(loaded.items.size() == 2 && loaded.items[1].index == 3 && loaded.items[1].name.empty());
+  CHECK(loaded.amounts == record.amounts && loaded.empty.empty());
+
+  // members in any order, spaces around everything, unknown members skipped
+  Item item;
+  CHECK(loadFromJson(item, " { \"extra\" : [ { \"name\" : \"no\" } , null , true ] , \"name\" : \"x\" , \"index\" : 9 } "));
+  CHECK(item.index == 9 && item.name == "x");
+
+  CHECK(!loadFromJson(item, "{\"index\":\"9\"}"));
+  CHECK(!loadFromJson(item, "{\"index\":1.5}"));
+  CHECK(!loadFromJson(item, "{\"index\":18446744073709551616}"));
+  CHECK(!loadFromJson(item, "{\"index\":9,\"name\":1}"));
+}
+
+struct Heights {
+  std::vector<uint32_t> heights;
+
+  void serialize(ISerializer& s) {
+    KV_MEMBER(heights)
+  }
+};
+
+void testInputLimits() {
+  // a token for every two bytes is fine as long as the text isn't huge
+  Heights heights;
+  for (uint32_t i = 1; i <= 1000; ++i) {
+    heights.heights.push_back(i % 10);
+  }
+
+  Heights loaded;
+  CHECK(loadFromJson(loaded, storeToJsonBuffer(heights)));
+  CHECK(loaded.heights == heights.heights);
+
+  std::string nested = "{\"heights\":[]}";
+  for (size_t depth = 2; depth < 100; ++depth) {
+    nested = "{\"a\":" + nested + "}";
+  }
+
+  CHECK(loadFromJson(loaded, nested));
+  CHECK(!loadFromJson(loaded, "{\"a\":" + nested + "}"));
+
+  // 16 million values in the largest text allowed
+  std::string dense = "{\"heights\":[";
+  while (dense.size() < 32 * 1024 * 1024 - 8) {
+    dense += "0,";
+  }
+
+  dense += "0]}";
+  CHECK(!loadFromJson(loaded, dense));
+
+  std::string large = "{\"heights\":[],\"padding\":\"" + std::string(32 * 1024 * 1024, 'x') + "\"}";
+  CHECK(!loadFromJson(loaded, large));
+
+  for (const char* broken : { "[]", "{", "{\"heights\":[1,2", "{\"heights\" [1]}", "{\"heights\":[1,]}",
+      "{\"heights\":\"1}", "{\"heights\":tru}", "{heights:[1]}" }) {
+    CHECK(!loadFromJson(loaded, broken));
+  }
+}
+
+}
+
+int main() {
+  testValues();
+  testRpcResponse();
+  testStrings();
+  testInputValues();
+  testInputLimits();
+
+  if (failures != 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+    return 1;
+  }
+
+  std::cout << "All JSON serialization tests passed" << std::endl;
+  return 0;
+}
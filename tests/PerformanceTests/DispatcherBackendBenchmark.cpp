@@ -0,0 +1,199 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "PerformanceTests.h"
+
+#include <iostream>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+
+#include "Logging/ConsoleLogger.h"
+#include "P2p/LevinProtocol.h"
+#include "Rpc/HttpClientPool.h"
+#include "Rpc/HttpServer.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const uint16_t RPC_PORT = 47335;
+const size_t RPC_CLIENT_COUNT = 16;
+const size_t RPC_REQUEST_COUNT = 2000;
+const uint16_t P2P_PORT = 47336;
+const size_t P2P_CONNECTION_COUNT = 100;
+const size_t P2P_MESSAGE_COUNT = 2000;
+const size_t P2P_MESSAGE_SIZE = 256;
+const uint32_t COMMAND = 2001;
+
+class EchoServer : public HttpServer {
+public:
+  EchoServer(System::Dispatcher& dispatcher, Logging::ILogger& logger) : HttpServer(dispatcher, logger) {
+  }
+
+  virtual void processRequest(const HttpRequest& request, HttpResponse& response) override {
+    response.setStatus(HttpResponse::STATUS_200);
+    response.setBody(request.getBody());
+  }
+};
+
+// Clients in contexts of the same dispatcher as the server, each waiting for its response before the next request.
+double rpcRequestsPerSecond(System::Dispatcher& dispatcher, Logging::ILogger& logger, size_t& failures) {
+  EchoServer server(dispatcher, logger);
+  server.start("127.0.0.1", RPC_PORT);
+  HttpClientPool pool(dispatcher, "127.0.0.1", RPC_PORT);
+  pool.setMaxConnections(RPC_CLIENT_COUNT);
+
+  HttpRequest request;
+  request.addHeader("Content-Type", "application/json");
+  request.setUrl("/json_rpc");
+  request.setBody("{\"jsonrpc\":\"2.0\",\"id\":\"0\",\"method\":\"getblockcount\",\"params\":{}}");
+  double ms = measureMs([&] {
+    System::ContextGroup clients(dispatcher);
+    for (size_t i = 0; i < RPC_CLIENT_COUNT; ++i) {
+      clients.spawn([&] {
+        for (size_t j = 0; j < RPC_REQUEST_COUNT; ++j) {
+          HttpResponse response;
+          try {
+            pool.request(request, response);
+            failures += response.getBody() == request.getBody() ? 0 : 1;
+          } catch (std::exception&) {
+            ++failures;
+          }
+        }
+      });
+    }
+
+    clients.wait();
+  });
+
+  server.stop();
+  return RPC_CLIENT_COUNT * RPC_REQUEST_COUNT * 1000 / ms;
+}
+
+// Levin notifications streamed over loopback connections, a writer and a reader context per connection.
+double p2pMessagesPerSecond(System::Dispatcher& dispatcher, size_t& failures) {
+  System::Ipv4Address address("127.0.0.1");
+  System::TcpListener listener(dispatcher, address, P2P_PORT);
+  std::vector<System::TcpConnection> accepted;
+  System::ContextGroup acceptor(dispatcher);
+  acceptor.spawn([&] {
+    while (accepted.size() < P2P_CONNECTION_COUNT) {
+      accepted.push_back(listener.accept());
+    }
+  });
+
+  System::TcpConnector connector(dispatcher);
+  std::vector<System::TcpConnection> connected;
+  while (connected.size() < P2P_CONNECTION_COUNT) {
+    connected.push_back(connector.connect(address, P2P_PORT));
+  }
+
+  acceptor.wait();
+  BinaryArray body(P2P_MESSAGE_SIZE, 0x5a);
+  double ms = measureMs([&] {
+    System::ContextGroup peers(dispatcher);
+    for (size_t i = 0; i < P2P_CONNECTION_COUNT; ++i) {
+      System::TcpConnection& sending = connected[i];
+      System::TcpConnection& receiving = accepted[i];
+      peers.spawn([&] {
+        LevinProtocol proto(sending);
+        for (size_t j = 0; j < P2P_MESSAGE_COUNT; ++j) {
+          proto.sendMessage(COMMAND, body, false);
+        }
+      });
+
+      peers.spawn([&] {
+        LevinProtocol::ReadBuffer buffer;
+        LevinProtocol proto(receiving, &buffer);
+        LevinProtocol::Command cmd;
+        for (size_t j = 0; j < P2P_MESSAGE_COUNT; ++j) {
+          if (!proto.readCommand(cmd) || cmd.buf != body) {
+            ++failures;
+            return;
+          }
+        }
+      });
+    }
+
+    peers.wait();
+  });
+
+  return P2P_CONNECTION_COUNT * P2P_MESSAGE_COUNT * 1000 / ms;
+}
+
+void report(const char* backend, System::Dispatcher& dispatcher, Logging::ILogger& logger) {
+  size_t failures = 0;
+  double requests = rpcRequestsPerSecond(dispatcher, logger, failures);
+  double messages = p2pMessagesPerSecond(dispatcher, failures);
+  if (failures != 0) {
+    std::cout << backend << ": " << failures << " requests or connections failed" << std::endl;
+    return;
+  }
+
+  std::cout << backend << ": " << static_cast<uint64_t>(requests) << " RPC requests/s from " << RPC_CLIENT_COUNT <<
+    " clients, " << static_cast<uint64_t>(messages) << " P2P messages/s of " << P2P_MESSAGE_SIZE << " bytes over " <<
+    P2P_CONNECTION_COUNT << " connections" << std::endl;
+}
+
+}
+
+void runDispatcherBackendBenchmark() {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+#ifdef USE_IO_URING
+  {
+    System::Dispatcher dispatcher(false);
+    report("epoll", dispatcher, logger);
+  }
+
+  System::Dispatcher dispatcher;
+  if (!dispatcher.hasRing()) {
+    std::cout << "io_uring: not available, the kernel lacks it or has it disabled" << std::endl;
+    return;
+  }
+
+  report("io_uring", dispatcher, logger);
+#else
+  System::Dispatcher dispatcher;
+  report("default", dispatcher, logger);
+  std::cout << "io_uring: built without USE_IO_URING" << std::endl;
+#endif
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "PerformanceTests.h"
+
+#include <iostream>
+#include <string>
+
+#include "Common/JsonValue.h"
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "Serialization/SerializationTools.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t RUN_COUNT = 5;
+
+std::string makeHash(uint64_t seed) {
+  std::string hash(64, '0');
+  for (auto& c : hash) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    c = "0123456789abcdef"[seed >> 60];
+  }
+
+  return hash;
+}
+
+COMMAND_RPC_GET_BLOCKS_LIST::response makeBlocksList(uint32_t count) {
+  COMMAND_RPC_GET_BLOCKS_LIST::response response;
+  for (uint32_t height = 0; height < count; ++height) {
+    block_short_response block;
+    block.timestamp = 1650000000 + height * 120;
+    block.height = height;
+    block.hash = makeHash(height);
+    block.tx_count = height % 17;
+    block.cumul_size = 500 + height % 9000;
+    block.difficulty = 1000000 + height;
+    block.min_tx_fee = 1000;
+    response.blocks.push_back(block);
+  }
+
+  response.status = CORE_RPC_STATUS_OK;
+  return response;
+}
+
+F_COMMAND_RPC_GET_BLOCK_DETAILS::response makeBlockDetails(uint64_t transactionCount) {
+  F_COMMAND_RPC_GET_BLOCK_DETAILS::response response = F_COMMAND_RPC_GET_BLOCK_DETAILS::response();
+  response.block.hash = makeHash(0);
+  response.block.prev_hash = makeHash(1);
+  response.block.alreadyGeneratedCoins = "12345678901234567";
+  response.block.penalty = 0.125;
+  for (uint64_t i = 0; i < transactionCount; ++i) {
+    f_transaction_short_response transaction;
+    transaction.hash = makeHash(i + 2);
+    transaction.fee = 1000 + i;
+    transaction.amount_out = 100000000 * i;
+    transaction.size = 300 + i % 2000;
+    response.block.transactions.push_back(transaction);
+  }
+
+  response.status = CORE_RPC_STATUS_OK;
+  return response;
+}
+
+template <typename T>
+void benchmark(const char* name, const T& response) {
+  std::string tree = storeToJson(response);
+  std::string buffer = storeToJsonBuffer(response);
+  // storeToJsonBuffer keeps the serialization order of fields, the tree writer sorts them
+  if (Common::JsonValue::fromString(buffer).toString() != tree) {
+    std::cout << name << ": outputs differ" << std::endl;
+    return;
+  }
+
+  double treeMs = 0;
+  double bufferMs = 0;
+  for (size_t i = 0; i < RUN_COUNT; ++i) {
+    treeMs += measureMs([&] { tree = storeToJson(response); });
+    bufferMs += measureMs([&] { buffer = storeToJsonBuffer(response); });
+  }
+
+  std::cout << name << " " << buffer.size() / 1024 << " KiB: storeToJson " << treeMs / RUN_COUNT <<
+    " ms, storeToJsonBuffer " << bufferMs / RUN_COUNT << " ms" << std::endl;
+}
+
+}
+
+void runJsonSerializerBenchmark() {
+  benchmark("getblockslist, 100000 blocks", makeBlocksList(100000));
+  benchmark("f_block_json, 50000 transactions", makeBlockDetails(50000));
+}
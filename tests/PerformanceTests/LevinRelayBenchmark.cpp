@@ -0,0 +1,210 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "PerformanceTests.h"
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+
+#include "Logging/ConsoleLogger.h"
+#include "P2p/P2pConnectionContext.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t PEER_COUNT = 100;
+const size_t RUN_COUNT = 20;
+const uint32_t COMMAND = 2001;
+const uint16_t PORT = 47333;
+
+struct Peer {
+  Peer(System::Dispatcher& dispatcher, Logging::ILogger& logger, System::TcpConnection&& sending, System::TcpConnection&& receiving) :
+    context(dispatcher, logger, std::move(sending)), receiver(std::move(receiving)) {
+  }
+
+  P2pConnectionContext context;
+  System::TcpConnection receiver;
+};
+
+// Loopback connections written like NodeServer writes its peers: the message is pushed to the write queue of
+// every connection and each connection's writer sends what was queued. A reader on the other end takes the frames.
+class RelayNetwork {
+public:
+  RelayNetwork(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
+    m_workers(dispatcher), m_received(dispatcher), m_pending(0), m_receivedBytes(0) {
+    System::Ipv4Address address("127.0.0.1");
+    System::TcpListener listener(dispatcher, address, PORT);
+    std::vector<System::TcpConnection> accepted;
+    System::ContextGroup acceptor(dispatcher);
+    acceptor.spawn([&] {
+      while (accepted.size() < PEER_COUNT) {
+        accepted.push_back(listener.accept());
+      }
+    });
+
+    System::TcpConnector connector(dispatcher);
+    std::vector<System::TcpConnection> connected;
+    while (connected.size() < PEER_COUNT) {
+      connected.push_back(connector.connect(address, PORT));
+    }
+
+    acceptor.wait();
+    for (size_t i = 0; i < PEER_COUNT; ++i) {
+      m_peers.emplace_back(new Peer(dispatcher, logger, std::move(connected[i]), std::move(accepted[i])));
+      Peer& peer = *m_peers.back();
+      m_workers.spawn([&peer] {
+        try {
+          LevinProtocol proto(peer.context.connection);
+          while (peer.context.sendQueuedMessages(proto)) {
+          }
+        } catch (System::InterruptedException&) {
+        }
+      });
+
+      m_workers.spawn([this, &peer] {
+        try {
+          LevinProtocol::ReadBuffer buffer;
+          LevinProtocol proto(peer.receiver, &buffer);
+          LevinProtocol::Command cmd;
+          while (proto.readCommand(cmd)) {
+            m_receivedBytes += cmd.buf.size();
+            if (--m_pending == 0) {
+              m_received.set();
+            }
+          }
+        } catch (System::InterruptedException&) {
+        }
+      });
+    }
+  }
+
+  ~RelayNetwork() {
+    m_workers.interrupt();
+    m_workers.wait();
+  }
+
+  // a copy of the body per peer, each message encoding its own frame, as before frames were shared
+  void relayPerPeer(const BinaryArray& body) {
+    startRelay();
+    for (auto& peer : m_peers) {
+      peer->context.pushMessage(P2pMessage(P2pMessage::NOTIFY, COMMAND, body));
+    }
+
+    finishRelay();
+  }
+
+  // one frame encoded up front and queued for every peer, like NodeServer::relayFrameToAll
+  void relayShared(const BinaryArray& body) {
+    startRelay();
+    auto frame = std::make_shared<const BinaryArray>(LevinProtocol::encodeMessage(COMMAND, body, false));
+    for (auto& peer : m_peers) {
+      peer->context.pushMessage(P2pMessage(P2pMessage::NOTIFY, COMMAND, frame));
+    }
+
+    finishRelay();
+  }
+
+  size_t receivedBytes() const {
+    return m_receivedBytes;
+  }
+
+private:
+  void startRelay() {
+    m_pending = m_peers.size();
+    m_received.clear();
+  }
+
+  void finishRelay() {
+    m_received.wait();
+  }
+
+  std::vector<std::unique_ptr<Peer>> m_peers;
+  System::ContextGroup m_workers;
+  System::Event m_received;
+  size_t m_pending;
+  size_t m_receivedBytes;
+};
+
+void benchmark(RelayNetwork& network, size_t bodySize) {
+  BinaryArray body(bodySize);
+  for (size_t i = 0; i < body.size(); ++i) {
+    body[i] = static_cast<uint8_t>(i * 31);
+  }
+
+  size_t before = network.receivedBytes();
+  double perPeerMs = measureMs([&] {
+    for (size_t i = 0; i < RUN_COUNT; ++i) {
+      network.relayPerPeer(body);
+    }
+  });
+
+  size_t perPeerReceived = network.receivedBytes() - before;
+  before = network.receivedBytes();
+  double sharedMs = measureMs([&] {
+    for (size_t i = 0; i < RUN_COUNT; ++i) {
+      network.relayShared(body);
+    }
+  });
+
+  if (network.receivedBytes() - before != perPeerReceived || perPeerReceived != RUN_COUNT * PEER_COUNT * bodySize) {
+    std::cout << "body " << bodySize << " bytes: peers received different messages" << std::endl;
+    return;
+  }
+
+  std::cout << "body " << bodySize / 1024 << " KiB to " << PEER_COUNT << " peers: encoded per peer " << perPeerMs / RUN_COUNT <<
+    " ms, shared frame " << sharedMs / RUN_COUNT << " ms per relay" << std::endl;
+}
+
+}
+
+void runLevinRelayBenchmark() {
+  System::Dispatcher dispatcher;
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  RelayNetwork network(dispatcher, logger);
+  benchmark(network, 2 * 1024);
+  benchmark(network, 100 * 1024);
+  benchmark(network, 1024 * 1024);
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "PerformanceTests.h"
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/StringOutputStream.h"
+#include "Logging/ConsoleLogger.h"
+#include "Wallet/WalletJournal.h"
+#include "crypto/chacha8.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t SAVE_COUNT = 10;
+const size_t TRANSACTION_RECORD_SIZE = 160;
+
+// Shaped like a synced wallet cache: transaction records, then the block hash lists of two consumers, which
+// every save extends by the blocks seen since the last one, plus a transaction now and then.
+class WalletCacheModel {
+public:
+  WalletCacheModel(size_t transactionCount, size_t blockCount) : m_random(1) {
+    m_transactions.resize(transactionCount * TRANSACTION_RECORD_SIZE);
+    fill(m_transactions);
+    for (auto& blocks : m_blockLists) {
+      blocks.resize(blockCount * sizeof(Crypto::Hash));
+      fill(blocks);
+    }
+  }
+
+  void advance(size_t newBlocks) {
+    for (auto& blocks : m_blockLists) {
+      std::string added(newBlocks * sizeof(Crypto::Hash), '\0');
+      fill(added);
+      blocks.append(added);
+    }
+
+    std::string transaction(TRANSACTION_RECORD_SIZE, '\0');
+    fill(transaction);
+    m_transactions.append(transaction);
+    ++m_balance;
+  }
+
+  BinaryArray serialize() const {
+    std::string data;
+    data.append(reinterpret_cast<const char*>(&m_balance), sizeof(m_balance));
+    data.append(m_transactions);
+    for (const auto& blocks : m_blockLists) {
+      data.append(blocks);
+    }
+
+    return BinaryArray(data.begin(), data.end());
+  }
+
+private:
+  void fill(std::string& data) {
+    for (auto& c : data) {
+      c = static_cast<char>(m_random());
+    }
+  }
+
+  std::mt19937 m_random;
+  uint64_t m_balance = 0;
+  std::string m_transactions;
+  std::string m_blockLists[2];
+};
+
+void benchmark(size_t transactionCount, size_t blockCount) {
+  Logging::ConsoleLogger logger(Logging::ERROR);
+  std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("wallet-%%%%-%%%%.journal")).string();
+  Crypto::chacha8_key key;
+  Crypto::chacha8_iv iv;
+  std::memset(&key, 7, sizeof(key));
+  std::memset(&iv, 3, sizeof(iv));
+
+  WalletCacheModel model(transactionCount, blockCount);
+  BinaryArray data = model.serialize();
+
+  WalletJournal journal(logger);
+  journal.reset(path, key, iv, data.data(), data.size());
+
+  double appendMs = 0;
+  double encryptMs = 0;
+  for (size_t i = 0; i < SAVE_COUNT; ++i) {
+    model.advance(5);
+    data = model.serialize();
+    appendMs += measureMs([&] { journal.append(data.data(), data.size()); });
+
+    // what a save rewriting the container spends on the same cache before writing it
+    BinaryArray encrypted(data.size());
+    encryptMs += measureMs([&] { Crypto::chacha8(data.data(), data.size(), key, iv, reinterpret_cast<char*>(encrypted.data())); });
+  }
+
+  std::cout << "cache " << data.size() / (1024 * 1024) << " MiB: journal append " << appendMs / SAVE_COUNT <<
+    " ms per save, full encryption " << encryptMs / SAVE_COUNT << " ms per save, journal " << journal.size() / 1024 << " KiB" << std::endl;
+
+  journal.discard();
+}
+
+}
+
+void runWalletJournalBenchmark() {
+  benchmark(10000, 100000);
+  benchmark(50000, 500000);
+}
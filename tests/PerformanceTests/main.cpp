@@ -0,0 +1,86 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include <cstring>
+#include <iostream>
+
+#include "PerformanceTests.h"
+
+namespace {
+
+struct Benchmark {
+  const char* name;
+  void (*run)();
+};
+
+const Benchmark BENCHMARKS[] = {
+  { "dispatcher_backend", &runDispatcherBackendBenchmark },
+  { "json_serializer", &runJsonSerializerBenchmark },
+  { "levin_relay", &runLevinRelayBenchmark },
+  { "wallet_journal", &runWalletJournalBenchmark },
+};
+
+}
+
+// Runs the benchmarks named on the command line, all of them without arguments.
+int main(int argc, char* argv[]) {
+  bool found = argc == 1;
+  for (const auto& benchmark : BENCHMARKS) {
+    bool selected = argc == 1;
+    for (int i = 1; i < argc; ++i) {
+      selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+    }
+
+    if (selected) {
+      std::cout << benchmark.name << std::endl;
+      benchmark.run();
+      found = true;
+    }
+  }
+
+  if (!found) {
+    std::cerr << "Unknown benchmark, known ones:";
+    for (const auto& benchmark : BENCHMARKS) {
+      std::cerr << " " << benchmark.name;
+    }
+
+    std::cerr << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
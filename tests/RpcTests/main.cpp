@@ -0,0 +1,380 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <HTTP/HttpParser.h>
+#include <System/Context.h>
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpListener.h>
+#include <System/TcpStream.h>
+#include <System/Timer.h>
+
+#include "Rpc/HttpClient.h"
+#include "Rpc/HttpClientPool.h"
+#include "Rpc/RpcNotificationQueue.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+      ++failures; \
+    } \
+  } while (false)
+
+typedef RpcNotificationQueue::Notification Notification;
+
+Crypto::Hash makeHash(uint32_t height) {
+  Crypto::Hash hash = Crypto::Hash();
+  hash.data[0] = static_cast<uint8_t>(height);
+  return hash;
+}
+
+void pushTips(RpcNotificationQueue& queue, uint32_t first, uint32_t count) {
+  for (uint32_t height = first; height < first + count; ++height) {
+    queue.push("new_tip", height, makeHash(height));
+  }
+}
+
+void testFirstRequest() {
+  RpcNotificationQueue queue(16);
+  std::vector<Notification> notifications;
+  uint64_t lastId = 1;
+  CHECK(queue.getEpoch() != 0);
+  CHECK(!queue.getSince(0, 0, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 0);
+
+  // old events aren't replayed to a new subscriber, it gets the id to start from
+  pushTips(queue, 1, 5);
+  CHECK(!queue.getSince(0, 0, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 5);
+  CHECK(!queue.getSince(queue.getEpoch(), 0, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 5);
+
+  CHECK(queue.getSince(queue.getEpoch(), lastId, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 5);
+}
+
+void testSince() {
+  RpcNotificationQueue queue(16);
+  uint64_t epoch = queue.getEpoch();
+  pushTips(queue, 1, 5);
+
+  std::vector<Notification> notifications;
+  uint64_t lastId = 0;
+  CHECK(queue.getSince(epoch, 2, 10, notifications, lastId));
+  CHECK(notifications.size() == 3 && lastId == 5);
+  CHECK(notifications.front().id == 3 && notifications.front().height == 3 && notifications.front().hash == makeHash(3));
+  CHECK(notifications.back().id == 5 && notifications.back().type == "new_tip");
+
+  // the rest comes with the next request
+  CHECK(queue.getSince(epoch, 1, 2, notifications, lastId));
+  CHECK(notifications.size() == 2 && notifications.back().id == 3 && lastId == 3);
+  CHECK(queue.getSince(epoch, lastId, 2, notifications, lastId));
+  CHECK(notifications.size() == 2 && lastId == 5);
+
+  CHECK(queue.getSince(epoch, 5, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 5);
+
+  // ahead of the queue, e.g. ids of a node that ran longer
+  CHECK(!queue.getSince(epoch, 6, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 5);
+}
+
+void testDropped() {
+  RpcNotificationQueue queue(4);
+  uint64_t epoch = queue.getEpoch();
+  pushTips(queue, 1, 10);
+
+  std::vector<Notification> notifications;
+  uint64_t lastId = 0;
+  CHECK(!queue.getSince(epoch, 5, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 10);
+
+  // 7 to 10 are still kept
+  CHECK(queue.getSince(epoch, 6, 10, notifications, lastId));
+  CHECK(notifications.size() == 4 && notifications.front().id == 7 && lastId == 10);
+}
+
+void testEpoch() {
+  RpcNotificationQueue queue(16);
+  RpcNotificationQueue restarted(16);
+  CHECK(queue.getEpoch() != restarted.getEpoch());
+  pushTips(queue, 1, 5);
+  pushTips(restarted, 1, 5);
+
+  std::vector<Notification> notifications;
+  uint64_t lastId = 0;
+  CHECK(!restarted.getSince(queue.getEpoch(), 2, 10, notifications, lastId));
+  CHECK(notifications.empty() && lastId == 5);
+  CHECK(!restarted.getSince(0, 2, 10, notifications, lastId));
+  CHECK(restarted.getSince(restarted.getEpoch(), 2, 10, notifications, lastId));
+  CHECK(notifications.size() == 3);
+}
+
+const uint16_t TEST_PORT = 47334;
+
+// Answers each request with its url as the body, once 'batch' requests came over the connection. Zero never answers.
+class TestServer {
+public:
+  explicit TestServer(System::Dispatcher& dispatcher) : m_dispatcher(dispatcher), m_workers(dispatcher), m_batch(1), m_accepted(0) {
+  }
+
+  ~TestServer() {
+    stop();
+  }
+
+  void start() {
+    m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address("127.0.0.1"), TEST_PORT);
+    m_workers.spawn([this] {
+      try {
+        for (;;) {
+          m_connections.push_back(m_listener.accept());
+          ++m_accepted;
+          System::TcpConnection& connection = m_connections.back();
+          m_workers.spawn([this, &connection] { serve(connection); });
+        }
+      } catch (std::exception&) {
+      }
+    });
+  }
+
+  void stop() {
+    m_workers.interrupt();
+    m_workers.wait();
+    m_connections.clear();
+    m_listener = System::TcpListener();
+  }
+
+  void setBatch(size_t batch) {
+    m_batch = batch;
+  }
+
+  size_t accepted() const {
+    return m_accepted;
+  }
+
+private:
+  void serve(System::TcpConnection& connection) {
+    try {
+      System::TcpStreambuf streamBuf(connection);
+      std::istream input(&streamBuf);
+      std::ostream output(&streamBuf);
+      HttpParser parser;
+      for (;;) {
+        std::vector<std::string> urls;
+        do {
+          HttpRequest req;
+          parser.receiveRequest(input, req);
+          urls.push_back(req.getUrl());
+        } while (m_batch == 0 || urls.size() < m_batch);
+
+        for (const std::string& url : urls) {
+          HttpResponse res;
+          res.setStatus(HttpResponse::STATUS_200);
+          res.setBody(url);
+          output << res;
+        }
+
+        output.flush();
+      }
+    } catch (std::exception&) {
+    }
+  }
+
+  System::Dispatcher& m_dispatcher;
+  System::TcpListener m_listener;
+  std::list<System::TcpConnection> m_connections;
+  System::ContextGroup m_workers;
+  size_t m_batch;
+  size_t m_accepted;
+};
+
+bool request(HttpClientPool& pool, const std::string& url, std::string& error) {
+  HttpRequest req;
+  HttpResponse res;
+  req.setUrl(url);
+  error.clear();
+  try {
+    pool.request(req, res);
+  } catch (std::exception& e) {
+    error = e.what();
+    return false;
+  }
+
+  return res.getStatus() == HttpResponse::STATUS_200 && res.getBody() == url;
+}
+
+bool retryingLater(const std::string& error) {
+  return error.find("retrying later") != std::string::npos;
+}
+
+void testReconnectDelay(System::Dispatcher& dispatcher) {
+  TestServer server(dispatcher);
+  HttpClientPool pool(dispatcher, "127.0.0.1", TEST_PORT);
+  pool.setReconnectDelay(std::chrono::milliseconds(200), std::chrono::milliseconds(800));
+  System::Timer timer(dispatcher);
+  std::string error;
+
+  CHECK(!request(pool, "/a", error) && !error.empty() && !retryingLater(error));
+  CHECK(!pool.isConnected());
+  CHECK(!request(pool, "/a", error) && retryingLater(error));
+
+  // the second failure doubles the delay to 400 ms
+  timer.sleep(std::chrono::milliseconds(300));
+  CHECK(!request(pool, "/a", error) && !retryingLater(error));
+  timer.sleep(std::chrono::milliseconds(300));
+  server.start();
+  CHECK(!request(pool, "/a", error) && retryingLater(error));
+  CHECK(server.accepted() == 0);
+
+  timer.sleep(std::chrono::milliseconds(200));
+  CHECK(request(pool, "/a", error));
+  CHECK(pool.isConnected() && server.accepted() == 1);
+
+  // a success starts over from the shortest delay
+  server.stop();
+  CHECK(!request(pool, "/b", error));
+  CHECK(!request(pool, "/b", error) && !retryingLater(error));
+  CHECK(!request(pool, "/b", error) && retryingLater(error));
+  timer.sleep(std::chrono::milliseconds(300));
+  server.start();
+  CHECK(request(pool, "/b", error));
+}
+
+void testTimeout(System::Dispatcher& dispatcher) {
+  TestServer server(dispatcher);
+  server.setBatch(0);
+  server.start();
+  HttpClientPool pool(dispatcher, "127.0.0.1", TEST_PORT);
+  pool.setRequestTimeout(std::chrono::milliseconds(200));
+  std::string error;
+
+  auto start = std::chrono::steady_clock::now();
+  CHECK(!request(pool, "/a", error) && error.find("timed out") != std::string::npos);
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+
+  // the connection which timed out isn't reused, its response could still come
+  server.setBatch(1);
+  CHECK(request(pool, "/b", error));
+  CHECK(server.accepted() == 2);
+  CHECK(request(pool, "/c", error));
+  CHECK(server.accepted() == 2);
+
+  // a request of its own timeout
+  server.setBatch(0);
+  HttpRequest req;
+  HttpResponse res;
+  req.setUrl("/d");
+  pool.setRequestTimeout(std::chrono::milliseconds(0));
+  bool timedOut = false;
+  try {
+    pool.request(req, res, std::chrono::milliseconds(100));
+  } catch (std::exception& e) {
+    timedOut = std::string(e.what()).find("timed out") != std::string::npos;
+  }
+
+  CHECK(timedOut);
+}
+
+void testPipelining(System::Dispatcher& dispatcher) {
+  const size_t REQUEST_COUNT = 4;
+  TestServer server(dispatcher);
+  server.setBatch(REQUEST_COUNT);
+  server.start();
+  HttpClientPool pool(dispatcher, "127.0.0.1", TEST_PORT);
+  pool.setMaxConnections(1);
+  pool.setPipelining(REQUEST_COUNT);
+  pool.setRequestTimeout(std::chrono::milliseconds(2000));
+
+  // the server answers only once all of them came, so they must be sent before any response
+  std::vector<std::string> bodies(REQUEST_COUNT);
+  System::ContextGroup clients(dispatcher);
+  for (size_t i = 0; i < REQUEST_COUNT; ++i) {
+    clients.spawn([&pool, &bodies, i] {
+      HttpRequest req;
+      HttpResponse res;
+      req.setUrl("/" + std::to_string(i));
+      try {
+        pool.request(req, res);
+        bodies[i] = res.getBody();
+      } catch (std::exception& e) {
+        bodies[i] = e.what();
+      }
+    });
+  }
+
+  clients.wait();
+  for (size_t i = 0; i < REQUEST_COUNT; ++i) {
+    CHECK(bodies[i] == "/" + std::to_string(i));
+  }
+
+  CHECK(server.accepted() == 1);
+}
+
+}
+
+int main() {
+  testFirstRequest();
+  testSince();
+  testDropped();
+  testEpoch();
+
+  System::Dispatcher dispatcher;
+  testReconnectDelay(dispatcher);
+  testTimeout(dispatcher);
+  testPipelining(dispatcher);
+
+  if (failures != 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+    return 1;
+  }
+
+  std::cout << "All RPC tests passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,272 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CryptoNote developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include "Logging/ConsoleLogger.h"
+#include "Wallet/WalletJournal.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t CACHE_SIZE = 1024 * 1024;
+const size_t VERSION_TAG_OFFSET = 64;
+
+int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+      ++failures; \
+    } \
+  } while (false)
+
+// Version of a wallet cache: the same random bytes with a few edits and a growing tail, like a cache between saves.
+BinaryArray makeCache(uint32_t version) {
+  std::mt19937 base(1);
+  BinaryArray cache(CACHE_SIZE + version * 1000);
+  for (auto& byte : cache) {
+    byte = static_cast<uint8_t>(base());
+  }
+
+  std::mt19937 edits(version);
+  for (uint32_t i = 0; i < version % 7 + 1; ++i) {
+    cache[edits() % cache.size()] ^= 0x5a;
+  }
+
+  std::memcpy(&cache[cache.size() - VERSION_TAG_OFFSET], &version, sizeof(version));
+  return cache;
+}
+
+uint32_t getVersion(const BinaryArray& cache) {
+  uint32_t version;
+  std::memcpy(&version, &cache[cache.size() - VERSION_TAG_OFFSET], sizeof(version));
+  return version;
+}
+
+std::string readFile(const std::string& path) {
+  std::ifstream file(path, std::ios_base::binary);
+  return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& data) {
+  std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+  file.write(data.data(), data.size());
+}
+
+class WalletJournalTest {
+public:
+  WalletJournalTest() : m_logger(Logging::ERROR), m_containerData(makeCache(0)) {
+    m_path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("wallet-%%%%-%%%%.journal")).string();
+    std::memset(&m_key, 7, sizeof(m_key));
+    std::memset(&m_containerIv, 3, sizeof(m_containerIv));
+  }
+
+  ~WalletJournalTest() {
+    boost::system::error_code ignore;
+    boost::filesystem::remove(m_path, ignore);
+  }
+
+  void reset() {
+    WalletJournal journal(m_logger);
+    journal.reset(m_path, m_key, m_containerIv, m_containerData.data(), m_containerData.size());
+  }
+
+  BinaryArray replay() {
+    WalletJournal journal(m_logger);
+    BinaryArray data = m_containerData;
+    journal.open(m_path, m_key, m_containerIv, data);
+    return data;
+  }
+
+  void appendVersions(uint32_t first, uint32_t last) {
+    WalletJournal journal(m_logger);
+    BinaryArray data = m_containerData;
+    journal.open(m_path, m_key, m_containerIv, data);
+    for (uint32_t version = first; version <= last; ++version) {
+      BinaryArray cache = makeCache(version);
+      journal.append(cache.data(), cache.size());
+    }
+  }
+
+  void testAppendAndReplay() {
+    reset();
+    appendVersions(1, 5);
+    CHECK(replay() == makeCache(5));
+
+    uint64_t size = boost::filesystem::file_size(m_path);
+    appendVersions(5, 5);
+    CHECK(boost::filesystem::file_size(m_path) == size);
+    CHECK(size < CACHE_SIZE);
+  }
+
+  void testOtherContainerData() {
+    reset();
+    appendVersions(1, 1);
+
+    Crypto::chacha8_iv otherIv;
+    std::memset(&otherIv, 4, sizeof(otherIv));
+    WalletJournal journal(m_logger);
+    BinaryArray data = m_containerData;
+    journal.open(m_path, m_key, otherIv, data);
+    CHECK(data == m_containerData);
+  }
+
+  void testTruncated() {
+    reset();
+    appendVersions(1, 1);
+    uint64_t firstSave = boost::filesystem::file_size(m_path);
+    appendVersions(2, 2);
+    std::string journal = readFile(m_path);
+
+    for (uint64_t size = firstSave; size < journal.size(); size += (journal.size() - firstSave) / 31 + 1) {
+      writeFile(m_path, journal.substr(0, size));
+      CHECK(replay() == makeCache(1));
+      CHECK(boost::filesystem::file_size(m_path) == firstSave);
+    }
+
+    writeFile(m_path, journal);
+    CHECK(replay() == makeCache(2));
+  }
+
+  void testCorrupted() {
+    reset();
+    uint64_t header = boost::filesystem::file_size(m_path);
+    appendVersions(1, 1);
+    uint64_t firstSave = boost::filesystem::file_size(m_path);
+    appendVersions(2, 2);
+    std::string journal = readFile(m_path);
+
+    for (uint64_t offset = 0; offset < journal.size(); offset += journal.size() / 61 + 1) {
+      std::string corrupted = journal;
+      corrupted[offset] ^= 1;
+      writeFile(m_path, corrupted);
+      CHECK(replay() == makeCache(offset < header ? 0 : offset < firstSave ? 0 : 1));
+    }
+  }
+
+#ifndef _WIN32
+  // A writer killed in the middle of a save leaves the journal at its last commit, which appends go on from.
+  void testKilledWriter() {
+    std::mt19937 random(42);
+    for (int round = 0; round < 5; ++round) {
+      reset();
+
+      int committed[2];
+      CHECK(::pipe(committed) == 0);
+      pid_t pid = ::fork();
+      if (pid == 0) {
+        ::close(committed[0]);
+        WalletJournal journal(m_logger);
+        BinaryArray data = m_containerData;
+        journal.open(m_path, m_key, m_containerIv, data);
+        for (uint32_t version = 1;; ++version) {
+          BinaryArray cache = makeCache(version);
+          journal.append(cache.data(), cache.size());
+          if (::write(committed[1], &version, sizeof(version)) != sizeof(version)) {
+            ::_exit(1);
+          }
+        }
+      }
+
+      ::close(committed[1]);
+      ::usleep(100000 + random() % 900000);
+      ::kill(pid, SIGKILL);
+      ::waitpid(pid, nullptr, 0);
+
+      uint32_t lastReported = 0;
+      uint32_t version;
+      while (::read(committed[0], &version, sizeof(version)) == sizeof(version)) {
+        lastReported = version;
+      }
+
+      ::close(committed[0]);
+
+      // the writer may have been killed between a commit and its report
+      BinaryArray data = replay();
+      uint32_t replayed = getVersion(data);
+      CHECK(replayed == lastReported || replayed == lastReported + 1);
+      CHECK(data == makeCache(replayed));
+
+      appendVersions(replayed + 1, replayed + 1);
+      CHECK(replay() == makeCache(replayed + 1));
+    }
+  }
+#endif
+
+private:
+  Logging::ConsoleLogger m_logger;
+  std::string m_path;
+  Crypto::chacha8_key m_key;
+  Crypto::chacha8_iv m_containerIv;
+  BinaryArray m_containerData;
+};
+
+}
+
+int main() {
+  WalletJournalTest test;
+  test.testAppendAndReplay();
+  test.testOtherContainerData();
+  test.testTruncated();
+  test.testCorrupted();
+#ifndef _WIN32
+  test.testKilledWriter();
+#endif
+
+  if (failures != 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+    return 1;
+  }
+
+  std::cout << "All wallet journal tests passed" << std::endl;
+  return 0;
+}